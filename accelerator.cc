@@ -0,0 +1,272 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    accelerator.cc - Accelerators implementing the custom instructions.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#include "accelerator.h"
+#include "inst-decoder.h"
+
+#include <algorithm>
+#include <limits>
+#include <regex>
+#include <stdexcept>
+
+#ifdef _MSC_VER
+/* MSVC intrinsics */
+#include <intrin.h>
+#define __builtin_popcount __popcnt
+#else
+#include <dlfcn.h>
+#endif
+
+
+/*
+ * AcceleratorRegistry
+ */
+
+AcceleratorRegistry &
+AcceleratorRegistry::instance()
+{
+  static AcceleratorRegistry registry;
+  return registry;
+}
+
+void
+AcceleratorRegistry::add(const std::string &name, AcceleratorFactory factory)
+{
+  if (! factories.emplace(name, std::move(factory)).second)
+    throw std::invalid_argument("accelerator " + name +
+                                " registered more than once");
+}
+
+std::unique_ptr<Accelerator>
+AcceleratorRegistry::create(const std::string &name) const
+{
+  auto it = factories.find(name);
+  if (it == factories.end())
+    throw std::out_of_range("unknown accelerator " + name);
+
+  return it->second();
+}
+
+std::vector<std::string>
+AcceleratorRegistry::getNames() const
+{
+  std::vector<std::string> names;
+  for (const auto &[name, factory] : factories)
+    names.push_back(name);
+  return names;
+}
+
+void
+AcceleratorRegistry::loadPlugin(const std::string &filename)
+{
+#ifdef _MSC_VER
+  throw std::runtime_error("accelerator plugins are not supported");
+#else
+  /* The handle is never closed: the code of the accelerators has to stay
+   * loaded for as long as the emulator runs.
+   */
+  void *handle = dlopen(filename.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (! handle)
+    throw std::runtime_error(std::string("cannot load plugin: ") + dlerror());
+
+  using RegisterFunction = void (*)(AcceleratorRegistry &);
+  auto registerFunction = reinterpret_cast<RegisterFunction>(
+      dlsym(handle, "rv64emu_register_accelerators"));
+  if (! registerFunction)
+    throw std::runtime_error("plugin " + filename +
+                             " does not export rv64emu_register_accelerators");
+
+  registerFunction(*this);
+#endif
+}
+
+
+/*
+ * AcceleratorBinding
+ */
+
+AcceleratorBinding::AcceleratorBinding(std::string_view spec)
+{
+  std::regex spec_regex("cust([1-8])=([A-Za-z0-9_-]+)");
+  std::match_results<std::string_view::const_iterator> match;
+
+  if (! std::regex_match(spec.begin(), spec.end(), match, spec_regex))
+    throw std::invalid_argument("malformed accelerator binding");
+
+  slot = std::stoul(match[1]) - 1;
+  name = match[2];
+}
+
+
+/*
+ * AcceleratorMemory
+ */
+
+uint8_t
+AcceleratorMemory::readByte(MemAddress addr)
+{
+  record(addr, 1, false);
+  return memory.readByte(addr);
+}
+
+uint16_t
+AcceleratorMemory::readHalfWord(MemAddress addr)
+{
+  record(addr, 2, false);
+  return memory.readHalfWord(addr);
+}
+
+uint32_t
+AcceleratorMemory::readWord(MemAddress addr)
+{
+  record(addr, 4, false);
+  return memory.readWord(addr);
+}
+
+uint64_t
+AcceleratorMemory::readDoubleWord(MemAddress addr)
+{
+  record(addr, 8, false);
+  return memory.readDoubleWord(addr);
+}
+
+void
+AcceleratorMemory::writeByte(MemAddress addr, uint8_t value)
+{
+  record(addr, 1, true);
+  memory.writeByte(addr, value);
+}
+
+void
+AcceleratorMemory::writeHalfWord(MemAddress addr, uint16_t value)
+{
+  record(addr, 2, true);
+  memory.writeHalfWord(addr, value);
+}
+
+void
+AcceleratorMemory::writeWord(MemAddress addr, uint32_t value)
+{
+  record(addr, 4, true);
+  memory.writeWord(addr, value);
+}
+
+void
+AcceleratorMemory::writeDoubleWord(MemAddress addr, uint64_t value)
+{
+  record(addr, 8, true);
+  memory.writeDoubleWord(addr, value);
+}
+
+void
+AcceleratorMemory::record(MemAddress addr, uint64_t size, bool write)
+{
+  if (! accesses.empty())
+    {
+      HostAccess &last = accesses.back();
+      if (last.write == write && last.addr + last.size == addr)
+        {
+          last.size += size;
+          return;
+        }
+    }
+
+  accesses.push_back({ addr, size, write });
+}
+
+
+/*
+ * AcceleratorSlots
+ */
+
+void
+AcceleratorSlots::attach(unsigned int slot,
+                         std::unique_ptr<Accelerator> accelerator)
+{
+  slots.at(slot) = std::move(accelerator);
+}
+
+Accelerator &
+AcceleratorSlots::get(unsigned int slot) const
+{
+  if (slot >= NumSlots || ! slots[slot])
+    throw IllegalInstruction("no accelerator attached to l.cust" +
+                             std::to_string(slot + 1));
+
+  return *slots[slot];
+}
+
+RegValue
+AcceleratorSlots::execute(unsigned int slot, const CustomOperands &operands,
+                          MemAddress PC)
+{
+  accessPC = PC;
+  return get(slot).execute(operands, memory);
+}
+
+
+/*
+ * Built-in accelerators
+ */
+
+/* rD = number of bits set in rA. */
+class PopcountAccelerator : public Accelerator
+{
+  public:
+    RegValue execute(const CustomOperands &operands,
+                     MemoryInterface &) override
+    {
+      return __builtin_popcount(operands.A);
+    }
+};
+
+REGISTER_ACCELERATOR(PopcountAccelerator, "popcount");
+
+/* rD = CRC-32 (IEEE 802.3) of the rB bytes starting at address rA. The
+ * accelerator streams a word per cycle from memory and is not pipelined.
+ */
+class CRC32Accelerator : public Accelerator
+{
+  public:
+    CRC32Accelerator()
+    {
+      for (uint32_t i = 0; i < table.size(); ++i)
+        {
+          uint32_t crc = i;
+          for (int bit = 0; bit < 8; ++bit)
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xedb88320 : 0);
+          table[i] = crc;
+        }
+    }
+
+    unsigned int getLatency(const CustomOperands &operands) const override
+    {
+      /* Computed in 64 bits, so that it cannot wrap for any length. */
+      const uint64_t words = (uint64_t{ operands.B } + 3) / 4;
+      return static_cast<unsigned int>(
+          std::min<uint64_t>(1 + words, std::numeric_limits<unsigned int>::max()));
+    }
+
+    bool isPipelined() const override { return false; }
+
+    RegValue execute(const CustomOperands &operands,
+                     MemoryInterface &memory) override
+    {
+      uint32_t crc = 0xffffffff;
+      for (RegValue i = 0; i < operands.B; ++i)
+        {
+          uint8_t byte = memory.readByte(operands.A + i);
+          crc = (crc >> 8) ^ table[(crc ^ byte) & 0xff];
+        }
+      return ~crc;
+    }
+
+  private:
+    std::array<uint32_t, 256> table{};
+};
+
+REGISTER_ACCELERATOR(CRC32Accelerator, "crc32");
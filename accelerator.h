@@ -0,0 +1,197 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    accelerator.h - Accelerators implementing the custom instructions.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#ifndef __ACCELERATOR_H__
+#define __ACCELERATOR_H__
+
+#include "arch.h"
+#include "host-calls.h"
+#include "memory-interface.h"
+
+#include <array>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* Operands of a custom instruction l.custN rD, rA, rB. The meaning of
+ * the fields, including the low 11 bits of the instruction word, is up
+ * to the accelerator.
+ */
+struct CustomOperands
+{
+  instruction_t instructionWord;
+  RegValue A;             /* value of rA */
+  RegValue B;             /* value of rB */
+  uint16_t immediate;     /* bits 10:0 of the instruction word */
+};
+
+/* An accelerator is a host model of a hardware unit that implements one
+ * custom opcode. Every core gets its own instance, so an accelerator may
+ * keep internal state. It executes in the execute stage and may access
+ * guest memory through the core's memory bus. Like those of the guest
+ * code, such accesses go through the data cache model, stalling the
+ * pipeline on misses, and stores cancel l.lwa/l.swa reservations.
+ */
+class Accelerator
+{
+  public:
+    virtual ~Accelerator() = default;
+
+    /* Cycles until the result is available, which may depend on the
+     * operands. Called when the instruction is issued.
+     */
+    virtual unsigned int getLatency(const CustomOperands &) const
+    { return 1; }
+
+    /* Whether a new operation can be started every cycle, otherwise the
+     * accelerator is busy for the full latency.
+     */
+    virtual bool isPipelined() const { return true; }
+
+    /* Whether the result of execute() is written to rD. */
+    virtual bool writesResult() const { return true; }
+
+    virtual RegValue execute(const CustomOperands &operands,
+                             MemoryInterface &memory) = 0;
+};
+
+using AcceleratorFactory = std::function<std::unique_ptr<Accelerator>()>;
+
+/* Registry of all known accelerators by name. Accelerators built into
+ * the emulator register themselves statically using
+ * REGISTER_ACCELERATOR; plugins are shared objects that export
+ *
+ *   extern "C" void rv64emu_register_accelerators(AcceleratorRegistry &);
+ *
+ * which is called when the plugin is loaded. The emulator is linked with
+ * -rdynamic so that plugins can resolve the registry's symbols.
+ */
+class AcceleratorRegistry
+{
+  public:
+    static AcceleratorRegistry &instance();
+
+    void add(const std::string &name, AcceleratorFactory factory);
+    std::unique_ptr<Accelerator> create(const std::string &name) const;
+    std::vector<std::string> getNames() const;
+
+    void loadPlugin(const std::string &filename);
+
+  private:
+    AcceleratorRegistry() = default;
+
+    std::map<std::string, AcceleratorFactory> factories{};
+};
+
+template <typename T>
+struct AcceleratorRegistrar
+{
+  explicit AcceleratorRegistrar(const char *name)
+  {
+    AcceleratorRegistry::instance().add(name,
+        [] { return std::make_unique<T>(); });
+  }
+};
+
+#define REGISTER_ACCELERATOR(type, name) \
+  static AcceleratorRegistrar<type> registrar_##type{ name }
+
+
+/* Command-line binding of an accelerator to a custom opcode, in the form
+ * custN=name.
+ */
+class AcceleratorBinding
+{
+  public:
+    AcceleratorBinding(std::string_view spec);
+
+    unsigned int slot{};    /* 0 for l.cust1 */
+    std::string name{};
+};
+
+/* The memory of the accelerators of a core: forwards the accesses to
+ * the memory bus of the core and records them, merging consecutive
+ * accesses, so that the processor can charge them to the data cache.
+ */
+class AcceleratorMemory : public MemoryInterface
+{
+  public:
+    explicit AcceleratorMemory(MemoryInterface &memory)
+      : memory(memory)
+    { }
+
+    AcceleratorMemory(const AcceleratorMemory &) = delete;
+    AcceleratorMemory &operator=(const AcceleratorMemory &) = delete;
+
+    uint8_t readByte(MemAddress addr) override;
+    uint16_t readHalfWord(MemAddress addr) override;
+    uint32_t readWord(MemAddress addr) override;
+    uint64_t readDoubleWord(MemAddress addr) override;
+
+    void writeByte(MemAddress addr, uint8_t value) override;
+    void writeHalfWord(MemAddress addr, uint16_t value) override;
+    void writeWord(MemAddress addr, uint32_t value) override;
+    void writeDoubleWord(MemAddress addr, uint64_t value) override;
+
+    bool contains(MemAddress addr) const override
+    {
+      return memory.contains(addr);
+    }
+
+    const std::vector<HostAccess> &getAccesses() const { return accesses; }
+    void clearAccesses() { accesses.clear(); }
+
+  private:
+    MemoryInterface &memory;
+    std::vector<HostAccess> accesses{};
+
+    void record(MemAddress addr, uint64_t size, bool write);
+};
+
+/* The accelerators attached to the eight custom opcodes of a core. */
+class AcceleratorSlots
+{
+  public:
+    static constexpr size_t NumSlots = 8;
+
+    explicit AcceleratorSlots(MemoryInterface &memory)
+      : memory(memory)
+    { }
+
+    AcceleratorSlots(const AcceleratorSlots &) = delete;
+    AcceleratorSlots &operator=(const AcceleratorSlots &) = delete;
+
+    void attach(unsigned int slot, std::unique_ptr<Accelerator> accelerator);
+
+    /* Returns the accelerator of the slot, throws IllegalInstruction if
+     * none is attached.
+     */
+    Accelerator &get(unsigned int slot) const;
+
+    /* Executes the custom instruction at PC on the accelerator of the
+     * slot. Its memory accesses are kept until clearAccesses().
+     */
+    RegValue execute(unsigned int slot, const CustomOperands &operands,
+                     MemAddress PC);
+
+    const std::vector<HostAccess> &getAccesses() const
+    {
+      return memory.getAccesses();
+    }
+    MemAddress getAccessPC() const { return accessPC; }
+    void clearAccesses() { memory.clearAccesses(); }
+
+  private:
+    AcceleratorMemory memory;
+    MemAddress accessPC{};
+    std::array<std::unique_ptr<Accelerator>, NumSlots> slots{};
+};
+
+#endif /* __ACCELERATOR_H__ */
@@ -10,6 +10,7 @@
 #include "utils.h"
 #include "inst-decoder.h"
 #include <iostream>
+#include <limits>
 
 #ifdef _MSC_VER
 /* MSVC intrinsics */
@@ -40,6 +41,23 @@ ALU::getResult()
       return A >> B;
     case ALUOp::SLL:
       return A << B;
+    case ALUOp::MUL:
+      return static_cast<RegValue>(static_cast<int32_t>(A) *
+                                   static_cast<int64_t>(static_cast<int32_t>(B)));
+    case ALUOp::MULU:
+      return A * B;
+    case ALUOp::DIV:
+      /* Division by zero sets SR[OV]; the result is undefined. */
+      if (B == 0)
+        return RegValue{0};
+      if (static_cast<int32_t>(A) == std::numeric_limits<int32_t>::min() &&
+          static_cast<int32_t>(B) == -1)
+        return A;
+      return static_cast<int32_t>(A) / static_cast<int32_t>(B);
+    case ALUOp::DIVU:
+      if (B == 0)
+        return RegValue{0};
+      return A / B;
     case ALUOp::NOP:
       return RegValue{0};
     default:
@@ -48,3 +66,45 @@ ALU::getResult()
 
   return RegValue{0};
 }
+
+
+RegValue
+MultiplyAccumulator::execute(MACOp op, RegValue A, RegValue B)
+{
+  const uint64_t product =
+      static_cast<int64_t>(static_cast<int32_t>(A)) *
+      static_cast<int32_t>(B);
+  const uint64_t productU = static_cast<uint64_t>(A) * B;
+
+  switch (op)
+  {
+    case MACOp::MAC:
+      accumulator += product;
+      break;
+    case MACOp::MACU:
+      accumulator += productU;
+      break;
+    case MACOp::MSB:
+      accumulator -= product;
+      break;
+    case MACOp::MSBU:
+      accumulator -= productU;
+      break;
+    case MACOp::MULD:
+      accumulator = product;
+      break;
+    case MACOp::MULDU:
+      accumulator = productU;
+      break;
+    case MACOp::MACRC:
+      {
+        const RegValue low = static_cast<RegValue>(accumulator);
+        accumulator = 0;
+        return low;
+      }
+    case MACOp::none:
+      break;
+  }
+
+  return RegValue{0};
+}
@@ -34,6 +34,12 @@ class ALU
 
     RegValue getResult();
 
+    /* l.div and l.divu by zero, which set SR[OV]. */
+    bool isDivisionByZero() const
+    {
+      return (op == ALUOp::DIV || op == ALUOp::DIVU) && B == 0;
+    }
+
     void setOp(ALUOp op) { this->op = op; }
 
   private:
@@ -43,4 +49,20 @@ class ALU
     ALUOp op;
 };
 
+/* The multiply-accumulate unit with its 64-bit MACHI:MACLO accumulator.
+ * Operands are 32-bit, products are computed at full 64-bit width.
+ */
+class MultiplyAccumulator
+{
+  public:
+    /* Performs the operation, returns MACLO for MACOp::MACRC. */
+    RegValue execute(MACOp op, RegValue A, RegValue B);
+
+    uint64_t getAccumulator() const { return accumulator; }
+    void setAccumulator(uint64_t value) { accumulator = value; }
+
+  private:
+    uint64_t accumulator{};
+};
+
 #endif /* __ALU_H__ */
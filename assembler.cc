@@ -0,0 +1,992 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    assembler.cc - Assembler for the supported instructions.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#include "assembler.h"
+#include "inst-encoding.h"
+#include "elf.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <functional>
+
+
+static std::string
+trim(const std::string &s)
+{
+  const size_t begin = s.find_first_not_of(" \t\r");
+  if (begin == std::string::npos)
+    return "";
+  return s.substr(begin, s.find_last_not_of(" \t\r") - begin + 1);
+}
+
+static bool
+isSymbolChar(char c)
+{
+  return std::isalnum(static_cast<unsigned char>(c)) ||
+      c == '_' || c == '.' || c == '$';
+}
+
+static uint64_t
+alignUp(uint64_t value, uint64_t alignment)
+{
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+/* Splits at the commas that are not within parentheses or strings. */
+static std::vector<std::string>
+splitOperands(const std::string &text)
+{
+  std::vector<std::string> operands;
+  std::string operand;
+  int depth = 0;
+  bool inString = false;
+  for (size_t i = 0; i < text.size(); ++i)
+    {
+      const char c = text[i];
+      if (inString)
+        {
+          operand += c;
+          if (c == '\\' && i + 1 < text.size())
+            operand += text[++i];
+          else if (c == '"')
+            inString = false;
+          continue;
+        }
+
+      if (c == ',' && depth == 0)
+        {
+          operands.push_back(trim(operand));
+          operand.clear();
+          continue;
+        }
+
+      if (c == '"')
+        inString = true;
+      else if (c == '(')
+        ++depth;
+      else if (c == ')')
+        --depth;
+      operand += c;
+    }
+
+  if (! trim(operand).empty() || ! operands.empty())
+    operands.push_back(trim(operand));
+  return operands;
+}
+
+/* The characters of a string literal, with its escape sequences. */
+static std::string
+parseString(const std::string &literal)
+{
+  if (literal.size() < 2 || literal.front() != '"' || literal.back() != '"')
+    throw std::invalid_argument("expected a string literal");
+
+  std::string s;
+  for (size_t i = 1; i < literal.size() - 1; ++i)
+    {
+      char c = literal[i];
+      if (c == '\\' && i + 1 < literal.size() - 1)
+        {
+          c = literal[++i];
+          switch (c)
+            {
+              case 'n': c = '\n'; break;
+              case 't': c = '\t'; break;
+              case 'r': c = '\r'; break;
+              case '0': c = '\0'; break;
+              default: break;
+            }
+        }
+      s += c;
+    }
+  return s;
+}
+
+
+/*
+ * Expressions
+ */
+
+/* Integer expressions with + - * / ~, parentheses, symbols, "." for
+ * the current location and the hi(), ha() and lo() relocations.
+ */
+class ExpressionParser
+{
+  public:
+    using Lookup = std::function<int64_t(const std::string &)>;
+
+    ExpressionParser(const std::string &text, Lookup lookup)
+      : text(text), lookup(std::move(lookup))
+    { }
+
+    int64_t parse()
+    {
+      const int64_t value = parseSum();
+      skipSpace();
+      if (pos != text.size())
+        throw std::invalid_argument("unexpected '" + text.substr(pos) + "'");
+      return value;
+    }
+
+  private:
+    const std::string &text;
+    Lookup lookup;
+    size_t pos = 0;
+
+    void skipSpace()
+    {
+      while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos])))
+        ++pos;
+    }
+
+    bool accept(char c)
+    {
+      skipSpace();
+      if (pos < text.size() && text[pos] == c)
+        {
+          ++pos;
+          return true;
+        }
+      return false;
+    }
+
+    int64_t parseSum()
+    {
+      int64_t value = parseProduct();
+      while (true)
+        if (accept('+'))
+          value += parseProduct();
+        else if (accept('-'))
+          value -= parseProduct();
+        else
+          return value;
+    }
+
+    int64_t parseProduct()
+    {
+      int64_t value = parseUnary();
+      while (true)
+        if (accept('*'))
+          value *= parseUnary();
+        else if (accept('/'))
+          {
+            const int64_t divisor = parseUnary();
+            if (divisor == 0)
+              throw std::invalid_argument("division by zero");
+            value /= divisor;
+          }
+        else
+          return value;
+    }
+
+    int64_t parseUnary()
+    {
+      if (accept('-'))
+        return -parseUnary();
+      if (accept('~'))
+        return ~parseUnary();
+      if (accept('+'))
+        return parseUnary();
+      return parsePrimary();
+    }
+
+    int64_t parsePrimary()
+    {
+      if (accept('('))
+        {
+          const int64_t value = parseSum();
+          if (! accept(')'))
+            throw std::invalid_argument("expected ')'");
+          return value;
+        }
+
+      skipSpace();
+      const size_t begin = pos;
+      while (pos < text.size() && isSymbolChar(text[pos]))
+        ++pos;
+      const std::string token = text.substr(begin, pos - begin);
+      if (token.empty())
+        throw std::invalid_argument("expected an operand");
+
+      if (std::isdigit(static_cast<unsigned char>(token[0])))
+        {
+          size_t length = 0;
+          uint64_t value;
+          if (token.size() > 2 && token[0] == '0' && std::tolower(token[1]) == 'b')
+            value = std::stoull(token.substr(2), &length, 2) , length += 2;
+          else
+            value = std::stoull(token, &length, 0);
+          if (length != token.size())
+            throw std::invalid_argument("invalid number " + token);
+          return static_cast<int64_t>(value);
+        }
+
+      if (token == "hi" || token == "ha" || token == "lo")
+        {
+          if (! accept('('))
+            return lookup(token);
+
+          const int64_t value = parseSum();
+          if (! accept(')'))
+            throw std::invalid_argument("expected ')'");
+          if (token == "hi")
+            return (value >> 16) & 0xffff;
+          if (token == "ha")
+            return ((value + 0x8000) >> 16) & 0xffff;
+          return value & 0xffff;
+        }
+
+      return lookup(token);
+    }
+};
+
+
+/*
+ * Assembler
+ */
+
+void
+Assembler::error(const std::string &message) const
+{
+  throw AssemblerError(filename + ":" + std::to_string(line) + ": " + message);
+}
+
+void
+Assembler::assemble(std::istream &in, const std::string &filename)
+{
+  this->filename = filename;
+  line = 0;
+
+  std::string text;
+  while (std::getline(in, text))
+    {
+      ++line;
+      parseLine(text);
+    }
+}
+
+void
+Assembler::parseLine(std::string text)
+{
+  /* Comments start with '#' outside of strings. */
+  bool inString = false;
+  for (size_t i = 0; i < text.size(); ++i)
+    {
+      if (text[i] == '\\' && inString)
+        ++i;
+      else if (text[i] == '"')
+        inString = ! inString;
+      else if (text[i] == '#' && ! inString)
+        {
+          text.erase(i);
+          break;
+        }
+    }
+
+  text = trim(text);
+  while (! text.empty())
+    {
+      size_t end = 0;
+      while (end < text.size() && isSymbolChar(text[end]))
+        ++end;
+      const size_t colon = text.find_first_not_of(" \t", end);
+      if (end == 0 || colon == std::string::npos || text[colon] != ':')
+        break;
+
+      defineLabel(text.substr(0, end));
+      text = trim(text.substr(colon + 1));
+    }
+
+  if (text.empty())
+    return;
+
+  const size_t space = text.find_first_of(" \t");
+  const std::string mnemonic = text.substr(0, space);
+  const std::string rest = space == std::string::npos ? "" : trim(text.substr(space));
+  const auto operands = splitOperands(rest);
+
+  if (mnemonic[0] == '.')
+    {
+      parseDirective(mnemonic, operands, rest);
+      return;
+    }
+
+  if (! findEncoding(mnemonic))
+    error("unknown instruction " + mnemonic);
+  if (current == Discarded)
+    return;
+  if (current == BSS)
+    error("instruction in .bss");
+  if (sections[current].size % 4 != 0)
+    error("instruction is not aligned to 4 bytes");
+
+  statements.push_back({ line, { current, sections[current].size },
+                         mnemonic, operands });
+  reserve(4);
+}
+
+void
+Assembler::parseDirective(const std::string &directive,
+                          const std::vector<std::string> &operands,
+                          const std::string &rest)
+{
+  auto constant = [this](const std::string &expression)
+    {
+      return evaluate(expression, { current, sections[current].size });
+    };
+
+  auto need = [this, &operands, &directive](size_t min, size_t max)
+    {
+      if (operands.size() < min || operands.size() > max)
+        error("wrong number of operands for " + directive);
+    };
+
+  static const std::map<std::string, size_t> dataWidths =
+    {
+      { ".byte", 1 },
+      { ".short", 2 }, { ".half", 2 }, { ".hword", 2 }, { ".2byte", 2 },
+      { ".word", 4 }, { ".int", 4 }, { ".long", 4 }, { ".4byte", 4 },
+      { ".quad", 8 }, { ".8byte", 8 }
+    };
+
+  if (directive == ".text" || directive == ".data" || directive == ".bss" ||
+      directive == ".rodata")
+    switchSection(directive);
+  else if (directive == ".section")
+    {
+      need(1, 3);
+      switchSection(operands[0]);
+    }
+  else if (auto width = dataWidths.find(directive); width != dataWidths.end())
+    {
+      need(1, SIZE_MAX);
+      if (current == Discarded)
+        return;
+      if (current == BSS)
+        error("initialized data in .bss");
+
+      statements.push_back({ line, { current, sections[current].size },
+                             directive, operands });
+      reserve(width->second * operands.size());
+    }
+  else if (directive == ".ascii" || directive == ".asciz" || directive == ".string")
+    {
+      need(1, SIZE_MAX);
+      if (current == BSS)
+        error("initialized data in .bss");
+
+      for (const auto &operand : operands)
+        {
+          std::string s;
+          try
+            {
+              s = parseString(operand);
+            }
+          catch (std::invalid_argument &e)
+            {
+              error(e.what());
+            }
+          if (directive != ".ascii")
+            s += '\0';
+          if (current != Discarded)
+            sections[current].bytes.insert(sections[current].bytes.end(),
+                                           s.begin(), s.end());
+        }
+      if (current != Discarded)
+        sections[current].size = sections[current].bytes.size();
+    }
+  else if (directive == ".zero" || directive == ".space" || directive == ".skip")
+    {
+      need(1, 2);
+      const int64_t size = constant(operands[0]);
+      if (size < 0)
+        error("negative size");
+      reserve(size, operands.size() > 1 ? constant(operands[1]) : 0);
+    }
+  else if (directive == ".align" || directive == ".balign" || directive == ".p2align")
+    {
+      /* On OpenRISC, .align takes the alignment in bytes. */
+      need(1, 2);
+      const int64_t value = constant(operands[0]);
+      const int64_t alignment = directive == ".p2align" ? int64_t{1} << value : value;
+      if (alignment < 1 || (alignment & (alignment - 1)) != 0)
+        error("alignment is not a power of 2");
+      align(alignment, operands.size() > 1 ? constant(operands[1]) : 0);
+    }
+  else if (directive == ".global" || directive == ".globl" || directive == ".weak")
+    {
+      need(1, SIZE_MAX);
+      for (const auto &name : operands)
+        getSymbol(name).global = true;
+    }
+  else if (directive == ".type")
+    {
+      need(2, 2);
+      Symbol &symbol = getSymbol(operands[0]);
+      const std::string type = operands[1].substr(operands[1].find_first_not_of("@%"));
+      symbol.function = type == "function";
+      symbol.object = type == "object";
+    }
+  else if (directive == ".size")
+    {
+      need(2, 2);
+      Symbol &symbol = getSymbol(operands[0]);
+      symbol.size = operands[1];
+      symbol.sizeLocation = { current, sections[current].size };
+    }
+  else if (directive == ".set" || directive == ".equ")
+    {
+      need(2, 2);
+      Symbol &symbol = getSymbol(operands[0]);
+      if (symbol.isLabel || ! symbol.expression.empty())
+        error("symbol " + operands[0] + " is already defined");
+      symbol.expression = operands[1];
+      symbol.location = { current, sections[current].size };
+    }
+  else if (directive == ".comm" || directive == ".lcomm")
+    {
+      /* Common symbols are allocated in .bss right away. */
+      need(2, 3);
+      const int previous = current;
+      current = BSS;
+      align(operands.size() > 2 ? constant(operands[2]) : 4);
+      defineLabel(operands[0]);
+      getSymbol(operands[0]).object = true;
+      reserve(constant(operands[1]));
+      current = previous;
+    }
+  else if (directive == ".file" || directive == ".ident" || directive == ".local" ||
+           directive == ".hidden" || directive == ".loc" ||
+           directive.rfind(".cfi_", 0) == 0)
+    {
+      /* No effect on the executable */
+    }
+  else
+    error("unsupported directive " + directive + (rest.empty() ? "" : " " + rest));
+}
+
+Assembler::Symbol &
+Assembler::getSymbol(const std::string &name)
+{
+  if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0])) ||
+      ! std::all_of(name.begin(), name.end(), isSymbolChar))
+    error("invalid symbol name " + name);
+
+  return symbols.try_emplace(name, Symbol{ false, {}, {}, false, false, false,
+                                           {}, {} }).first->second;
+}
+
+void
+Assembler::defineLabel(const std::string &name)
+{
+  Symbol &symbol = getSymbol(name);
+  if (symbol.isLabel || ! symbol.expression.empty())
+    error("symbol " + name + " is already defined");
+  if (current == Discarded)
+    return;
+
+  symbol.isLabel = true;
+  symbol.location = { current, sections[current].size };
+}
+
+void
+Assembler::switchSection(const std::string &name)
+{
+  const std::string section = name[0] == '"' ? parseString(name) : name;
+  auto is = [&section](const char *prefix)
+    {
+      return section.rfind(prefix, 0) == 0;
+    };
+
+  if (is(".text"))
+    current = Text;
+  else if (is(".rodata"))
+    current = ROData;
+  else if (is(".data") || is(".sdata"))
+    current = Data;
+  else if (is(".bss") || is(".sbss"))
+    current = BSS;
+  else
+    current = Discarded;        /* e.g. .comment and .note.GNU-stack */
+}
+
+void
+Assembler::reserve(uint64_t size, uint8_t fill)
+{
+  if (current == Discarded)
+    return;
+
+  Section &section = sections[current];
+  if (current != BSS)
+    section.bytes.resize(section.bytes.size() + size, fill);
+  section.size += size;
+}
+
+void
+Assembler::align(uint64_t alignment, uint8_t fill)
+{
+  if (current == Discarded)
+    return;
+
+  Section &section = sections[current];
+  section.align = std::max(section.align, alignment);
+  reserve(alignUp(section.size, alignment) - section.size, fill);
+}
+
+/* Labels have an address once the sections are placed, so before that
+ * only constants can be evaluated.
+ */
+int64_t
+Assembler::evaluate(const std::string &expression, Location dot,
+                    int depth) const
+{
+  try
+    {
+      return ExpressionParser(expression, [this, dot, depth](const std::string &name)
+        {
+          return getValue(name, dot, depth);
+        }).parse();
+    }
+  catch (std::invalid_argument &e)
+    {
+      error(std::string(e.what()) + " in expression " + expression);
+    }
+  catch (std::out_of_range &)
+    {
+      error("number out of range in expression " + expression);
+    }
+}
+
+int64_t
+Assembler::getValue(const std::string &name, Location dot, int depth) const
+{
+  if (name == ".")
+    return getAddress(dot);
+
+  auto it = symbols.find(name);
+  if (it == symbols.end() || (! it->second.isLabel && it->second.expression.empty()))
+    error("undefined symbol " + name);
+
+  const Symbol &symbol = it->second;
+  if (symbol.isLabel)
+    return getAddress(symbol.location);
+
+  if (depth > 16)
+    error("recursive definition of symbol " + name);
+  return evaluate(symbol.expression, symbol.location, depth + 1);
+}
+
+MemAddress
+Assembler::getAddress(Location location) const
+{
+  if (! placed)
+    error("expression is not a constant");
+  return sections[location.section].base + location.offset;
+}
+
+void
+Assembler::place()
+{
+  MemAddress end = sections[Text].base + sections[Text].size;
+  sections[ROData].base = alignUp(end, sections[ROData].align);
+  end = sections[ROData].base + sections[ROData].size;
+
+  sections[Data].base = alignUp(std::max(DataBase, end), sections[Data].align);
+  end = sections[Data].base + sections[Data].size;
+  sections[BSS].base = alignUp(std::max(DataBase, end), sections[BSS].align);
+
+  placed = true;
+}
+
+void
+Assembler::encode(const Statement &statement)
+{
+  line = statement.line;
+
+  auto write = [this, &statement](uint64_t offset, uint64_t value, size_t width)
+    {
+      auto &bytes = sections[statement.location.section].bytes;
+      for (size_t i = 0; i < width; ++i)
+        bytes[offset + i] = value >> (8 * (width - 1 - i));
+    };
+
+  if (statement.mnemonic[0] != '.')
+    {
+      write(statement.location.offset, encodeInstruction(statement), 4);
+      return;
+    }
+
+  const size_t width = statement.mnemonic == ".byte" ? 1
+      : statement.mnemonic == ".quad" || statement.mnemonic == ".8byte" ? 8
+      : statement.mnemonic == ".word" || statement.mnemonic == ".int" ||
+        statement.mnemonic == ".long" || statement.mnemonic == ".4byte" ? 4 : 2;
+
+  uint64_t offset = statement.location.offset;
+  for (const auto &operand : statement.operands)
+    {
+      const int64_t value = evaluate(operand, { statement.location.section, offset });
+      if (width < 8 && (value < -(int64_t{1} << (8 * width - 1)) ||
+                        value >= int64_t{1} << (8 * width)))
+        error("value " + operand + " does not fit in " +
+              std::to_string(width) + " bytes");
+      write(offset, value, width);
+      offset += width;
+    }
+}
+
+uint32_t
+Assembler::encodeInstruction(const Statement &statement)
+{
+  const InstructionEncoding &encoding = *findEncoding(statement.mnemonic);
+  const auto &operands = statement.operands;
+  const Location dot = statement.location;
+
+  static const std::map<OperandFormat, size_t> operandCounts =
+    {
+      { OperandFormat::none, 0 }, { OperandFormat::DAB, 3 },
+      { OperandFormat::DA, 2 }, { OperandFormat::AB, 2 },
+      { OperandFormat::B, 1 }, { OperandFormat::D, 1 },
+      { OperandFormat::DAI, 3 }, { OperandFormat::DK, 2 },
+      { OperandFormat::AI, 2 }, { OperandFormat::DAL, 3 },
+      { OperandFormat::ABK, 3 }, { OperandFormat::load, 2 },
+      { OperandFormat::store, 2 }, { OperandFormat::target, 1 },
+      { OperandFormat::K, 1 }
+    };
+
+  const bool omitted = encoding.format == OperandFormat::K && operands.empty();
+  if (operands.size() != operandCounts.at(encoding.format) && ! omitted)
+    error("wrong number of operands for " + statement.mnemonic);
+
+  auto reg = [this](const std::string &operand) -> uint32_t
+    {
+      if (operand == "sp")
+        return 1;
+      if (operand == "fp")
+        return 2;
+      if (operand == "lr")
+        return 9;
+
+      if (operand.size() >= 2 && operand.size() <= 3 && operand[0] == 'r' &&
+          std::all_of(operand.begin() + 1, operand.end(), ::isdigit))
+        {
+          const size_t number = std::stoul(operand.substr(1));
+          if (number < NumRegs)
+            return number;
+        }
+      error("invalid register " + operand);
+    };
+
+  /* 16-bit immediates may be signed or unsigned, e.g. lo(). */
+  auto immediate = [this, dot](const std::string &operand, int64_t min,
+                               int64_t max) -> uint32_t
+    {
+      const int64_t value = evaluate(operand, dot);
+      if (value < min || value > max)
+        error("immediate " + operand + " out of range");
+      return static_cast<uint32_t>(value);
+    };
+
+  auto imm16 = [&immediate](const std::string &operand)
+    {
+      return immediate(operand, -0x8000, 0xffff) & 0xffff;
+    };
+
+  /* I(rA), with I optional */
+  auto memory = [this, &reg, &imm16](const std::string &operand)
+    {
+      const size_t open = operand.rfind('(');
+      if (open == std::string::npos || operand.back() != ')')
+        error("expected I(rA) instead of " + operand);
+
+      const std::string offset = trim(operand.substr(0, open));
+      return std::make_pair(imm16(offset.empty() ? "0" : offset),
+                            reg(trim(operand.substr(open + 1, operand.size() - open - 2))));
+    };
+
+  auto D = [](uint32_t r) { return r << 21; };
+  auto A = [](uint32_t r) { return r << 16; };
+  auto B = [](uint32_t r) { return r << 11; };
+  auto split = [](uint32_t k) { return ((k >> 11) & 0x1f) << 21 | (k & 0x7ff); };
+
+  uint32_t word = encoding.match;
+  switch (encoding.format)
+    {
+      case OperandFormat::none:
+        break;
+      case OperandFormat::DAB:
+        word |= D(reg(operands[0])) | A(reg(operands[1])) | B(reg(operands[2]));
+        break;
+      case OperandFormat::DA:
+        word |= D(reg(operands[0])) | A(reg(operands[1]));
+        break;
+      case OperandFormat::AB:
+        word |= A(reg(operands[0])) | B(reg(operands[1]));
+        break;
+      case OperandFormat::B:
+        word |= B(reg(operands[0]));
+        break;
+      case OperandFormat::D:
+        word |= D(reg(operands[0]));
+        break;
+      case OperandFormat::DAI:
+        word |= D(reg(operands[0])) | A(reg(operands[1])) | imm16(operands[2]);
+        break;
+      case OperandFormat::DK:
+        word |= D(reg(operands[0])) | imm16(operands[1]);
+        break;
+      case OperandFormat::AI:
+        word |= A(reg(operands[0])) | imm16(operands[1]);
+        break;
+      case OperandFormat::DAL:
+        word |= D(reg(operands[0])) | A(reg(operands[1])) |
+            immediate(operands[2], 0, 63);
+        break;
+      case OperandFormat::ABK:
+        word |= A(reg(operands[0])) | B(reg(operands[1])) | split(imm16(operands[2]));
+        break;
+      case OperandFormat::load:
+        {
+          const auto [offset, base] = memory(operands[1]);
+          word |= D(reg(operands[0])) | A(base) | offset;
+          break;
+        }
+      case OperandFormat::store:
+        {
+          const auto [offset, base] = memory(operands[0]);
+          word |= A(base) | B(reg(operands[1])) | split(offset);
+          break;
+        }
+      case OperandFormat::target:
+        {
+          const int64_t distance = evaluate(operands[0], dot) - getAddress(dot);
+          if (distance % 4 != 0)
+            error("branch target " + operands[0] + " is not aligned");
+          if (distance / 4 < -(int64_t{1} << 25) || distance / 4 >= int64_t{1} << 25)
+            error("branch target " + operands[0] + " out of range");
+          word |= static_cast<uint32_t>(distance / 4) & 0x3ffffff;
+          break;
+        }
+      case OperandFormat::K:
+        word |= omitted ? 0 : imm16(operands[0]);
+        break;
+    }
+
+  /* The decoder must recognize what was assembled. */
+  InstructionDecoder decoder;
+  decoder.setInstructionWord(word);
+  if (decoder.getOpcode() != encoding.op)
+    error("internal error: " + statement.mnemonic + " is not decoded as such");
+
+  return word;
+}
+
+
+/*
+ * ELF output
+ */
+
+static void
+put16(std::vector<uint8_t> &out, uint16_t value)
+{
+  out.push_back(value >> 8);
+  out.push_back(value);
+}
+
+static void
+put32(std::vector<uint8_t> &out, uint32_t value)
+{
+  put16(out, value >> 16);
+  put16(out, value);
+}
+
+static void
+padTo(std::vector<uint8_t> &out, uint64_t alignment)
+{
+  out.resize(alignUp(out.size(), alignment), 0);
+}
+
+/* Adds s to a string table and returns its offset. */
+static uint32_t
+addString(std::vector<uint8_t> &table, const std::string &s)
+{
+  const uint32_t offset = table.size();
+  table.insert(table.end(), s.begin(), s.end());
+  table.push_back(0);
+  return offset;
+}
+
+std::vector<uint8_t>
+Assembler::createELF() const
+{
+  constexpr uint32_t EhdrSize = 52, PhdrSize = 32, ShdrSize = 40, SymSize = 16;
+
+  /* Sections that are loaded, in address order, numbered from 1 */
+  std::vector<int> loaded;
+  for (int i = 0; i < NumSections; ++i)
+    if (sections[i].size > 0)
+      loaded.push_back(i);
+
+  std::vector<uint8_t> out(EhdrSize + loaded.size() * PhdrSize);
+  std::vector<uint32_t> offsets;
+  for (int i : loaded)
+    {
+      padTo(out, sections[i].align);
+      offsets.push_back(out.size());
+      out.insert(out.end(), sections[i].bytes.begin(), sections[i].bytes.end());
+    }
+
+  /* Symbol table: the local symbols precede the global ones. Local
+   * labels (.L) are left out.
+   */
+  std::vector<uint8_t> strtab{ 0 };
+  std::vector<uint8_t> symtab(SymSize, 0);
+  uint32_t firstGlobal = 1;
+  for (bool global : { false, true })
+    {
+      for (const auto &[name, symbol] : symbols)
+        {
+          if (symbol.global != global || name.rfind(".L", 0) == 0 ||
+              (! symbol.isLabel && symbol.expression.empty()))
+            continue;
+
+          /* Labels in empty sections are absolute. */
+          uint16_t shndx = SHN_ABS;
+          auto section = std::find(loaded.begin(), loaded.end(),
+                                   symbol.location.section);
+          if (symbol.isLabel && section != loaded.end())
+            shndx = section - loaded.begin() + 1;
+          const uint8_t type = symbol.function ? STT_FUNC
+              : symbol.object ? STT_OBJECT : STT_NOTYPE;
+
+          put32(symtab, addString(strtab, name));
+          put32(symtab, getValue(name, {}, 0));
+          put32(symtab, symbol.size.empty() ? 0
+                : evaluate(symbol.size, symbol.sizeLocation));
+          symtab.push_back((global ? STB_GLOBAL : STB_LOCAL) << 4 | type);
+          symtab.push_back(0);
+          put16(symtab, shndx);
+        }
+      if (! global)
+        firstGlobal = symtab.size() / SymSize;
+    }
+
+  std::vector<uint8_t> shstrtab{ 0 };
+  padTo(out, 4);
+  const uint32_t symtabOffset = out.size();
+  out.insert(out.end(), symtab.begin(), symtab.end());
+  const uint32_t strtabOffset = out.size();
+  out.insert(out.end(), strtab.begin(), strtab.end());
+
+  /* Section headers */
+  std::vector<uint8_t> shdrs(ShdrSize, 0);
+  auto addHeader = [&shdrs, &shstrtab](const std::string &name, uint32_t type,
+                                      uint32_t flags, uint32_t addr,
+                                      uint32_t offset, uint32_t size,
+                                      uint32_t link, uint32_t info,
+                                      uint32_t align, uint32_t entsize)
+    {
+      put32(shdrs, addString(shstrtab, name));
+      for (uint32_t value : { type, flags, addr, offset, size, link, info,
+                              align, entsize })
+        put32(shdrs, value);
+    };
+
+  for (size_t i = 0; i < loaded.size(); ++i)
+    {
+      const Section &section = sections[loaded[i]];
+      uint32_t flags = SHF_ALLOC;
+      if (loaded[i] == Text)
+        flags |= SHF_EXECINSTR;
+      else if (loaded[i] != ROData)
+        flags |= SHF_WRITE;
+
+      addHeader(section.name, loaded[i] == BSS ? SHT_NOBITS : SHT_PROGBITS,
+                flags, section.base, offsets[i], section.size, 0, 0,
+                section.align, 0);
+    }
+
+  const uint32_t symtabIndex = loaded.size() + 1;
+  addHeader(".symtab", SHT_SYMTAB, 0, 0, symtabOffset, symtab.size(),
+            symtabIndex + 1, firstGlobal, 4, SymSize);
+  addHeader(".strtab", SHT_STRTAB, 0, 0, strtabOffset, strtab.size(),
+            0, 0, 1, 0);
+  addHeader(".shstrtab", SHT_STRTAB, 0, 0, out.size(), 0, 0, 0, 1, 0);
+  addString(shstrtab, "");
+  /* Patch the size of .shstrtab, now that it is complete */
+  {
+    std::vector<uint8_t> size;
+    put32(size, shstrtab.size());
+    std::copy(size.begin(), size.end(), shdrs.end() - ShdrSize + 20);
+  }
+  out.insert(out.end(), shstrtab.begin(), shstrtab.end());
+
+  padTo(out, 4);
+  const uint32_t shoff = out.size();
+  out.insert(out.end(), shdrs.begin(), shdrs.end());
+
+  /* Program headers, a loadable segment per section */
+  std::vector<uint8_t> phdrs;
+  for (size_t i = 0; i < loaded.size(); ++i)
+    {
+      const Section &section = sections[loaded[i]];
+      uint32_t flags = PF_R;
+      if (loaded[i] == Text)
+        flags |= PF_X;
+      else if (loaded[i] != ROData)
+        flags |= PF_W;
+
+      for (uint32_t value : { uint32_t{PT_LOAD}, offsets[i], uint32_t(section.base),
+                              uint32_t(section.base), uint32_t(section.bytes.size()),
+                              uint32_t(section.size), flags, uint32_t(section.align) })
+        put32(phdrs, value);
+    }
+  std::copy(phdrs.begin(), phdrs.end(), out.begin() + EhdrSize);
+
+  /* ELF header */
+  MemAddress entry = TextBase;
+  for (const char *name : { "main", "_start" })
+    if (auto it = symbols.find(name); it != symbols.end() && it->second.isLabel)
+      entry = getValue(name, {}, 0);
+
+  std::vector<uint8_t> ehdr{ 0x7f, 'E', 'L', 'F', ELFCLASS32, ELFDATA2MSB,
+                             EV_CURRENT, ELFOSABI_NONE };
+  ehdr.resize(EI_NIDENT, 0);
+  put16(ehdr, ET_EXEC);
+  put16(ehdr, EM_OPENRISC);
+  put32(ehdr, EV_CURRENT);
+  put32(ehdr, entry);
+  put32(ehdr, EhdrSize);
+  put32(ehdr, shoff);
+  put32(ehdr, 0);
+  put16(ehdr, EhdrSize);
+  put16(ehdr, PhdrSize);
+  put16(ehdr, loaded.size());
+  put16(ehdr, ShdrSize);
+  put16(ehdr, loaded.size() + 4);
+  put16(ehdr, loaded.size() + 3);
+  std::copy(ehdr.begin(), ehdr.end(), out.begin());
+
+  return out;
+}
+
+void
+Assembler::writeELF(const std::string &filename)
+{
+  if (sections[Text].size == 0)
+    throw AssemblerError(this->filename + ": no instructions");
+
+  place();
+  for (const auto &statement : statements)
+    encode(statement);
+
+  const auto elf = createELF();
+  std::ofstream out(filename, std::ios::binary);
+  out.write(reinterpret_cast<const char *>(elf.data()), elf.size());
+  if (! out)
+    throw std::runtime_error("cannot write " + filename);
+}
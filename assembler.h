@@ -0,0 +1,130 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    assembler.h - Assembler for the supported instructions.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#ifndef __ASSEMBLER_H__
+#define __ASSEMBLER_H__
+
+#include "arch.h"
+
+#include <array>
+#include <istream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/* Exception thrown for errors in the source, with the file and line in
+ * the message.
+ */
+class AssemblerError : public std::runtime_error
+{
+  public:
+    explicit AssemblerError(const std::string &what)
+      : std::runtime_error(what)
+    { }
+};
+
+/* Assembles the instructions the emulator supports (the mnemonics in
+ * inst-encoding.cc) and the common GNU as directives into a big-endian
+ * ELF32 OpenRISC executable that ELFFile loads. There is no linking
+ * step: all symbols must be defined in the source. As tests/Makefile
+ * links, the text starts at TextBase and the data at DataBase, or after
+ * the text if that is larger. The entry point is _start, or main if
+ * there is no _start.
+ */
+class Assembler
+{
+  public:
+    static constexpr MemAddress TextBase = 0x10000;
+    static constexpr MemAddress DataBase = 0x11100;
+
+    Assembler() = default;
+
+    void assemble(std::istream &in, const std::string &filename);
+    void writeELF(const std::string &filename);
+
+  private:
+    enum SectionIndex { Text, ROData, Data, BSS, NumSections, Discarded = NumSections };
+
+    struct Section
+    {
+      const char *name;
+      std::vector<uint8_t> bytes;       /* empty for .bss */
+      uint64_t size;
+      uint64_t align;
+      MemAddress base;
+    };
+
+    struct Location
+    {
+      int section;
+      uint64_t offset;
+    };
+
+    /* A label, or an expression from .set, evaluated where it was set */
+    struct Symbol
+    {
+      bool isLabel;
+      Location location;
+      std::string expression;
+      bool global;
+      bool function;
+      bool object;
+      std::string size;
+      Location sizeLocation;
+    };
+
+    /* Instructions and data are encoded once all labels are placed. */
+    struct Statement
+    {
+      int line;
+      Location location;
+      std::string mnemonic;     /* or the data directive */
+      std::vector<std::string> operands;
+    };
+
+    std::string filename{};
+    int line{};
+    int current = Text;
+
+    std::array<Section, NumSections> sections
+      {{
+         { ".text", {}, 0, 4, TextBase },
+         { ".rodata", {}, 0, 1, 0 },
+         { ".data", {}, 0, 1, 0 },
+         { ".bss", {}, 0, 1, 0 }
+      }};
+
+    std::map<std::string, Symbol> symbols{};
+    std::vector<Statement> statements{};
+    bool placed = false;
+
+    [[noreturn]] void error(const std::string &message) const;
+
+    void parseLine(std::string text);
+    void parseDirective(const std::string &directive,
+                        const std::vector<std::string> &operands,
+                        const std::string &rest);
+    void defineLabel(const std::string &name);
+    Symbol &getSymbol(const std::string &name);
+    void switchSection(const std::string &name);
+    void reserve(uint64_t size, uint8_t fill = 0);
+    void align(uint64_t alignment, uint8_t fill = 0);
+
+    int64_t evaluate(const std::string &expression, Location dot,
+                     int depth = 0) const;
+    int64_t getValue(const std::string &name, Location dot, int depth) const;
+    MemAddress getAddress(Location location) const;
+
+    void place();
+    void encode(const Statement &statement);
+    uint32_t encodeInstruction(const Statement &statement);
+
+    std::vector<uint8_t> createELF() const;
+};
+
+#endif /* __ASSEMBLER_H__ */
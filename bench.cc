@@ -0,0 +1,540 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    bench.cc - Microbenchmarks of the emulator components.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#include "elf-file.h"
+#include "memory.h"
+#include "memory-bus.h"
+#include "processor.h"
+#include "serial.h"
+#include "sys-status.h"
+#include "testing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <regex>
+
+#include <getopt.h>
+
+namespace fs = std::filesystem;
+
+using Clock = std::chrono::steady_clock;
+
+/* Results are accumulated here so that the work is not optimized away. */
+static volatile uint64_t sink;
+
+/* Time spent in the timed parts of a run. The harness starts it before
+ * and stops it after the run; a benchmark stops it around work that
+ * should not be measured, such as setting up.
+ */
+class Stopwatch
+{
+  public:
+    void start() { started = Clock::now(); }
+
+    void stop()
+    {
+      elapsedNs += std::chrono::duration<double, std::nano>(Clock::now() - started).count();
+    }
+
+    double getElapsedNs() const { return elapsedNs; }
+
+  private:
+    Clock::time_point started{};
+    double elapsedNs{};
+};
+
+/* A benchmark performs a number of iterations and returns the number of
+ * operations done, the unit its results are reported per.
+ */
+struct Benchmark
+{
+  std::string name;
+  std::string operation;
+  std::function<uint64_t(uint64_t iterations, Stopwatch &watch)> run;
+};
+
+struct Result
+{
+  std::string name;
+  std::string operation;
+  uint64_t iterations;
+  uint64_t operations;
+  std::vector<double> nsPerOperation;
+};
+
+/* Runs that print to the serial port would disturb the output. */
+class SilenceStderr
+{
+  public:
+    SilenceStderr()
+      : saved(std::cerr.rdbuf(nullptr))
+    { }
+
+    ~SilenceStderr() { std::cerr.rdbuf(saved); }
+
+    SilenceStderr(const SilenceStderr &) = delete;
+    SilenceStderr &operator=(const SilenceStderr &) = delete;
+
+  private:
+    std::streambuf *saved;
+};
+
+
+/*
+ * Benchmarks
+ */
+
+static std::vector<uint32_t>
+readInstructions(const std::string &filename)
+{
+  std::ifstream in(filename);
+  if (! in)
+    throw std::runtime_error("cannot open " + filename);
+
+  std::vector<uint32_t> words;
+  std::string line;
+  while (std::getline(in, line))
+    if (! line.empty())
+      words.push_back(std::stoul(line, nullptr, 16));
+
+  if (words.empty())
+    throw std::runtime_error(filename + " contains no instructions");
+  return words;
+}
+
+static std::byte *
+allocate(size_t size)
+{
+  auto *data = new (std::align_val_t{ 8 }, std::nothrow) std::byte[size];
+  std::fill_n(data, size, std::byte{ 0 });
+  return data;
+}
+
+/* Memory at the addresses the ELF loader typically uses. */
+static constexpr MemAddress DataBase = 0x11100;
+static constexpr size_t DataSize = 64 * 1024;
+
+static std::unique_ptr<Memory>
+createDataMemory()
+{
+  auto memory = std::make_unique<Memory>("data", allocate(DataSize), DataBase,
+                                         DataSize, 8);
+  memory->setMayWrite(true);
+  return memory;
+}
+
+static Benchmark
+decoderBenchmark(const std::string &filename)
+{
+  auto words = readInstructions(filename);
+  return { "decoder", "instruction",
+           [words](uint64_t iterations, Stopwatch &)
+    {
+      InstructionDecoder decoder;
+      ControlSignals signals;
+      uint64_t sum = 0;
+      for (uint64_t i = 0; i < iterations; ++i)
+        for (uint32_t word : words)
+          {
+            decoder.setInstructionWord(word);
+            signals.setInstruction(decoder);
+            sum += static_cast<uint64_t>(decoder.getOpcode()) + decoder.getImmediate();
+          }
+      sink = sink + sum;
+      return iterations * words.size();
+    } };
+}
+
+/* Word accesses that alternate between reads and writes, spread over the
+ * data memory behind the devices and a second memory, so that the
+ * search for the client is representative.
+ */
+static Benchmark
+busBenchmark()
+{
+  return { "bus.dispatch", "access",
+           [](uint64_t iterations, Stopwatch &)
+    {
+      std::vector<std::unique_ptr<MemoryInterface>> clients;
+      clients.emplace_back(std::make_unique<Memory>("text", allocate(DataSize),
+                                                    0x10000 - DataSize,
+                                                    DataSize, 8));
+      clients.emplace_back(std::make_unique<Serial>(0x200));
+      clients.emplace_back(std::make_unique<SysStatus>(0x270, 0, 1));
+      clients.emplace_back(createDataMemory());
+      MemoryBus bus(std::move(clients));
+
+      uint64_t sum = 0;
+      for (uint64_t i = 0; i < iterations; ++i)
+        for (MemAddress offset = 0; offset < 1024; offset += 8)
+          {
+            bus.writeWord(DataBase + offset, offset);
+            sum += bus.readWord(DataBase + offset + 4);
+          }
+      sink = sink + sum;
+      return iterations * 256;
+    } };
+}
+
+static Benchmark
+memoryBenchmark()
+{
+  return { "memory.access", "access",
+           [](uint64_t iterations, Stopwatch &)
+    {
+      auto memory = createDataMemory();
+      uint64_t sum = 0;
+      for (uint64_t i = 0; i < iterations; ++i)
+        for (MemAddress offset = 0; offset < 1024; offset += 16)
+          {
+            memory->writeWord(DataBase + offset, offset);
+            sum += memory->readWord(DataBase + offset + 4);
+            memory->writeDoubleWord(DataBase + offset + 8, offset);
+            sum += memory->readHalfWord(DataBase + offset + 2);
+          }
+      sink = sink + sum;
+      return iterations * 256;
+    } };
+}
+
+/* The accesses of one instruction: two operands and a result. */
+static Benchmark
+registerFileBenchmark()
+{
+  return { "regfile.access", "instruction",
+           [](uint64_t iterations, Stopwatch &)
+    {
+      RegisterFile regfile;
+      uint64_t sum = 0;
+      for (uint64_t i = 0; i < iterations; ++i)
+        for (RegNumber r = 1; r < NumRegs; ++r)
+          {
+            regfile.setRS1(r);
+            regfile.setRS2(NumRegs - r);
+            sum += regfile.getReadData1() + regfile.getReadData2();
+            regfile.setRD(r);
+            regfile.setWriteData(sum);
+            regfile.setWriteEnable(true);
+            regfile.clockPulse();
+          }
+      sink = sink + sum;
+      return iterations * (NumRegs - 1);
+    } };
+}
+
+/* A core running an endless loop of two instructions, l.j to itself and
+ * a l.nop in its delay slot, so that only the pipeline is measured.
+ */
+static Benchmark
+pipelineBenchmark()
+{
+  return { "pipeline.cycle", "cycle",
+           [](uint64_t iterations, Stopwatch &)
+    {
+      constexpr MemAddress Entry = 0x10000;
+      std::byte *text = allocate(16);
+      const uint8_t loop[] = { 0x00, 0x00, 0x00, 0x00, 0x15, 0x00, 0x00, 0x00 };
+      std::copy_n(reinterpret_cast<const std::byte *>(loop), sizeof(loop), text);
+
+      std::vector<std::unique_ptr<MemoryInterface>> clients;
+      clients.emplace_back(std::make_unique<Memory>("text", text, Entry, 16, 8));
+      clients.emplace_back(createDataMemory());
+
+      const uint64_t cycles = iterations * 1000;
+      Processor p(std::move(clients), Entry, 0, 1, nullptr, false);
+      p.runFor(cycles);
+      return cycles;
+    } };
+}
+
+/* Runs of a program, without pipelining. Only the runs are timed,
+ * constructing and destroying the processor is not. Pipelined runs are
+ * not measured, as these do not complete any instructions.
+ */
+static Benchmark
+programBenchmark(const std::string &name,
+                 std::shared_ptr<ELFFile> program,
+                 const std::vector<RegisterInit> &initializers,
+                 unsigned int registerBanks = 1)
+{
+  return { name, "instruction",
+           [program, initializers, registerBanks, name](uint64_t iterations,
+                                                        Stopwatch &watch)
+    {
+      SilenceStderr silence;
+      uint64_t instructions = 0;
+      std::unique_ptr<Processor> p;
+      for (uint64_t i = 0; i < iterations; ++i)
+        {
+          watch.stop();
+          p.reset();
+          p = std::make_unique<Processor>(*program, false);
+          p->setRegisterBanks(registerBanks);
+          for (auto &initializer : initializers)
+            p->initRegister(initializer.number, initializer.value);
+          watch.start();
+
+          p->run(true);
+          if (p->getInstructions() == 0)
+            throw std::runtime_error(name + " completed no instructions");
+          instructions += p->getInstructions();
+        }
+
+      watch.stop();
+      p.reset();
+      watch.start();
+      return instructions;
+    } };
+}
+
+
+/* The unit test program of config, with its register initializers. */
+static Benchmark
+testBenchmark(const fs::path &config)
+{
+  TestFile test(config.string());
+  return programBenchmark("program." + config.stem().string(),
+                          std::make_shared<ELFFile>(test.getExecutable()),
+                          test.getPreRegisters(),
+                          test.getRegisterBanks());
+}
+
+/* A longer program, such as a workload from rv64-emu-gen. */
+static Benchmark
+workloadBenchmark(const fs::path &executable)
+{
+  return programBenchmark("workload." + executable.stem().string(),
+                          std::make_shared<ELFFile>(executable.string()), {});
+}
+
+
+/*
+ * Harness
+ */
+
+/* Returns the time the timed parts of the run took. */
+static double
+timeRun(const Benchmark &benchmark, uint64_t iterations, uint64_t &operations)
+{
+  Stopwatch watch;
+  watch.start();
+  operations = benchmark.run(iterations, watch);
+  watch.stop();
+  return watch.getElapsedNs();
+}
+
+/* The number of iterations is doubled until a repetition takes at least
+ * the minimum time, after which warmup and timed repetitions all use the
+ * same number.
+ */
+static Result
+measure(const Benchmark &benchmark, unsigned int warmup,
+        unsigned int repetitions, double minTimeNs)
+{
+  uint64_t iterations = 1;
+  uint64_t operations = 0;
+  while (true)
+    {
+      if (timeRun(benchmark, iterations, operations) >= minTimeNs ||
+          iterations >= (uint64_t{1} << 40))
+        break;
+      iterations *= 2;
+    }
+
+  for (unsigned int i = 0; i < warmup; ++i)
+    timeRun(benchmark, iterations, operations);
+
+  Result result{ benchmark.name, benchmark.operation, iterations, 0, {} };
+  for (unsigned int i = 0; i < repetitions; ++i)
+    {
+      const double ns = timeRun(benchmark, iterations, result.operations);
+      if (result.operations == 0)
+        throw std::runtime_error(benchmark.name + " did no operations");
+      result.nsPerOperation.push_back(ns / result.operations);
+    }
+
+  return result;
+}
+
+struct Summary
+{
+  double min;
+  double median;
+  double mean;
+  double stddev;
+};
+
+static Summary
+summarize(std::vector<double> values)
+{
+  std::sort(values.begin(), values.end());
+
+  Summary summary{};
+  summary.min = values.front();
+  const size_t n = values.size();
+  summary.median = n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+
+  for (double v : values)
+    summary.mean += v;
+  summary.mean /= n;
+
+  for (double v : values)
+    summary.stddev += (v - summary.mean) * (v - summary.mean);
+  summary.stddev = n > 1 ? std::sqrt(summary.stddev / (n - 1)) : 0.0;
+
+  return summary;
+}
+
+static void
+writeJSON(std::ostream &os, const std::vector<Result> &results,
+          unsigned int warmup, unsigned int repetitions)
+{
+  /* mops is the median throughput in millions of operations per
+   * second, e.g. MIPS for the programs.
+   */
+  os << std::setprecision(6)
+     << "{\n  \"unit\": \"ns per operation\",\n"
+     << "  \"warmup\": " << warmup << ",\n"
+     << "  \"repetitions\": " << repetitions << ",\n"
+     << "  \"benchmarks\": [";
+
+  const char *separator = "\n";
+  for (const Result &result : results)
+    {
+      const Summary s = summarize(result.nsPerOperation);
+      os << separator
+         << "    { \"name\": \"" << result.name << "\", "
+         << "\"operation\": \"" << result.operation << "\", "
+         << "\"iterations\": " << result.iterations << ", "
+         << "\"operations\": " << result.operations << ",\n"
+         << "      \"min\": " << s.min << ", \"median\": " << s.median
+         << ", \"mean\": " << s.mean << ", \"stddev\": " << s.stddev
+         << ", \"mops\": " << 1e3 / s.median << ",\n"
+         << "      \"samples\": [";
+      for (size_t i = 0; i < result.nsPerOperation.size(); ++i)
+        os << (i ? ", " : "") << result.nsPerOperation[i];
+      os << "] }";
+      separator = ",\n";
+    }
+
+  os << "\n  ]\n}\n";
+}
+
+static void
+showHelp(const char *progName)
+{
+  std::cerr << "Usage: " << progName
+            << " [-w WARMUP] [-r REPETITIONS] [-m MS] [-f REGEX] [-t TESTDIR]"
+               " [-d DECODEFILE] [-e ELF]... [-o OUTPUT]\n\n"
+            << "    -w, warmup repetitions per benchmark (default: 2).\n"
+            << "    -r, timed repetitions per benchmark (default: 10).\n"
+            << "    -m, minimum duration of a repetition in ms (default: 20).\n"
+            << "    -f, only runs the benchmarks whose name matches REGEX.\n"
+            << "    -t, directory with the unit test programs (default: tests).\n"
+            << "    -d, instruction stream for the decoder, one hexadecimal word\n"
+            << "        per line (default: testdata/decode-testfile.txt).\n"
+            << "    -e, also runs the ELF executable, e.g. from rv64-emu-gen, as\n"
+            << "        benchmark workload.NAME. May be repeated.\n"
+            << "    -o, writes the JSON results to OUTPUT instead of stdout.\n";
+}
+
+int
+main(int argc, char **argv)
+{
+  unsigned int warmup = 2;
+  unsigned int repetitions = 10;
+  double minTimeMs = 20;
+  std::string filter = ".*";
+  std::string testDir = "tests";
+  std::string decodeFile = "testdata/decode-testfile.txt";
+  std::vector<fs::path> workloads;
+  const char *output = nullptr;
+
+  int c;
+  while ((c = getopt(argc, argv, "w:r:m:f:t:d:e:o:h")) != -1)
+    {
+      switch (c)
+        {
+          case 'w': warmup = std::stoul(optarg); break;
+          case 'r': repetitions = std::max(1ul, std::stoul(optarg)); break;
+          case 'm': minTimeMs = std::stod(optarg); break;
+          case 'f': filter = optarg; break;
+          case 't': testDir = optarg; break;
+          case 'd': decodeFile = optarg; break;
+          case 'e': workloads.push_back(optarg); break;
+          case 'o': output = optarg; break;
+          default:
+            showHelp(argv[0]);
+            return 1;
+        }
+    }
+
+  try
+    {
+      std::vector<Benchmark> benchmarks;
+      benchmarks.push_back(decoderBenchmark(decodeFile));
+      benchmarks.push_back(busBenchmark());
+      benchmarks.push_back(memoryBenchmark());
+      benchmarks.push_back(registerFileBenchmark());
+      benchmarks.push_back(pipelineBenchmark());
+
+      std::vector<fs::path> configs;
+      for (const auto &entry : fs::directory_iterator(testDir))
+        if (entry.path().extension() == ".conf")
+          configs.push_back(entry.path());
+      std::sort(configs.begin(), configs.end());
+      for (const auto &config : configs)
+        {
+          /* The benchmarks run a single core without accelerators. */
+          const TestFile test(config.string());
+          if (test.getCores() > 1 || ! test.getAcceleratorBindings().empty())
+            continue;
+          benchmarks.push_back(testBenchmark(config));
+        }
+      for (const auto &executable : workloads)
+        benchmarks.push_back(workloadBenchmark(executable));
+
+      const std::regex pattern(filter);
+      std::vector<Result> results;
+      for (const auto &benchmark : benchmarks)
+        {
+          if (! std::regex_search(benchmark.name, pattern))
+            continue;
+
+          results.push_back(measure(benchmark, warmup, repetitions,
+                                    minTimeMs * 1e6));
+          const Summary s = summarize(results.back().nsPerOperation);
+          std::cerr << std::left << std::setw(24) << benchmark.name << std::right
+                    << std::fixed << std::setprecision(2) << std::setw(10)
+                    << s.median << " ns/" << benchmark.operation
+                    << "  (+/- " << s.stddev << ")" << std::endl;
+        }
+
+      if (output)
+        {
+          std::ofstream out(output);
+          writeJSON(out, results, warmup, repetitions);
+          if (! out)
+            throw std::runtime_error(std::string("cannot write ") + output);
+        }
+      else
+        writeJSON(std::cout, results, warmup, repetitions);
+    }
+  catch (std::exception &e)
+    {
+      std::cerr << "Error: " << e.what() << std::endl;
+      return 1;
+    }
+
+  return 0;
+}
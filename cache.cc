@@ -0,0 +1,437 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    cache.cc - Coherent per-core L1 data caches with a shared L2.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#include "cache.h"
+#include "stats.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+
+
+static bool
+isPowerOfTwo(size_t value)
+{
+  return value != 0 && (value & (value - 1)) == 0;
+}
+
+/* Byte mask of the bytes [offset, offset+size) within a cache line. */
+static uint64_t
+byteMask(size_t offset, size_t size)
+{
+  const uint64_t bits = size >= 64 ? ~uint64_t{ 0 } : (uint64_t{ 1 } << size) - 1;
+  return bits << offset;
+}
+
+
+/*
+ * L1DataCache
+ */
+
+L1DataCache::L1DataCache(CoherenceController &controller, unsigned int coreId,
+                         const CacheConfig &config)
+  : controller{ controller }, coreId{ coreId },
+    lineSize{ config.lineSize },
+    nSets{ config.l1Size / config.lineSize / config.l1Assoc },
+    assoc{ config.l1Assoc },
+    lines{ std::make_unique<Line[]>(config.l1Size / config.lineSize) }
+{
+}
+
+unsigned int
+L1DataCache::access(MemAddress addr, size_t size, bool write, MemAddress PC)
+{
+  const MemAddress first = lineAddress(addr);
+  const MemAddress last = lineAddress(addr + size - 1);
+  unsigned int latency = 0;
+
+  /* Accesses crossing a line boundary touch two lines. */
+  for (MemAddress line = first; ; line += lineSize)
+    {
+      const MemAddress begin = std::max(addr, line);
+      const MemAddress end = std::min<MemAddress>(addr + size, line + lineSize);
+
+      latency += accessLine(line, byteMask(begin - line, end - begin),
+                            write, PC);
+      if (line == last)
+        break;
+    }
+
+  nStallCycles += latency;
+  return latency;
+}
+
+L1DataCache::Line *
+L1DataCache::find(MemAddress lineAddr)
+{
+  const size_t set = (lineAddr / lineSize) % nSets;
+  Line *ways = &lines[set * assoc];
+
+  for (size_t i = 0; i < assoc; ++i)
+    if (ways[i].tag == lineAddr && ways[i].state != MESIState::Invalid)
+      return &ways[i];
+
+  return nullptr;
+}
+
+/* Select the line to replace: an invalid line if there is one, otherwise
+ * the least recently used line.
+ */
+L1DataCache::Line &
+L1DataCache::victim(MemAddress lineAddr)
+{
+  const size_t set = (lineAddr / lineSize) % nSets;
+  Line *ways = &lines[set * assoc];
+  Line *lru = &ways[0];
+
+  for (size_t i = 0; i < assoc; ++i)
+    {
+      if (ways[i].state == MESIState::Invalid)
+        return ways[i];
+      if (ways[i].lastUse < lru->lastUse)
+        lru = &ways[i];
+    }
+
+  return *lru;
+}
+
+unsigned int
+L1DataCache::accessLine(MemAddress lineAddr, uint64_t mask, bool write,
+                        MemAddress PC)
+{
+  ++useCounter;
+
+  Line *line = find(lineAddr);
+  if (line && (! write || line->state != MESIState::Shared))
+    {
+      /* Silent upgrade, which still has to invalidate the copies that
+       * other cores obtained during this quantum.
+       */
+      if (write && line->state == MESIState::Exclusive)
+        {
+          line->state = MESIState::Modified;
+          record({ lineAddr, mask, PC, true, false });
+        }
+
+      line->lastUse = useCounter;
+      line->accessMask |= mask;
+      ++nHits;
+      return 0;
+    }
+
+  ++nMisses;
+
+  const bool upgrade = line != nullptr;
+  bool otherHasCopy = false;
+  const unsigned int latency = controller.getLatency(coreId, lineAddr,
+                                                     upgrade, otherHasCopy);
+
+  bool evict = false;
+  MemAddress evictedAddr{};
+  if (! upgrade)
+    {
+      line = &victim(lineAddr);
+      evict = line->state != MESIState::Invalid;
+      evictedAddr = line->tag;
+
+      line->tag = lineAddr;
+      line->accessMask = 0;
+      line->state = otherHasCopy ? MESIState::Shared : MESIState::Exclusive;
+    }
+
+  if (write)
+    line->state = MESIState::Modified;
+  line->lastUse = useCounter;
+  line->accessMask |= mask;
+
+  record({ lineAddr, mask, PC, write, false });
+  if (evict)
+    record({ evictedAddr, 0, PC, false, true });
+
+  return latency;
+}
+
+void
+L1DataCache::record(const Transaction &transaction)
+{
+  transactions.push_back(transaction);
+  if (! controller.deferred)
+    controller.commit();
+}
+
+
+/*
+ * CoherenceController
+ */
+
+CoherenceController::CoherenceController(const CacheConfig &config,
+                                         unsigned int nCores)
+  : config{ config }, deferred{ nCores > 1 },
+    l2Sets{ config.l2Size / config.lineSize / config.l2Assoc },
+    l2(config.l2Size / config.lineSize)
+{
+  if (! isPowerOfTwo(config.lineSize) || config.lineSize > 64 ||
+      ! isPowerOfTwo(config.l1Size / config.lineSize / config.l1Assoc) ||
+      ! isPowerOfTwo(l2Sets))
+    throw std::invalid_argument("invalid cache geometry");
+
+  for (unsigned int i = 0; i < nCores; ++i)
+    l1s.emplace_back(std::make_unique<L1DataCache>(*this, i, config));
+}
+
+unsigned int
+CoherenceController::getLatency(unsigned int coreId, MemAddress lineAddr,
+                                bool upgrade, bool &otherHasCopy) const
+{
+  bool otherOwns = false;
+
+  auto it = directory.find(lineAddr);
+  if (it != directory.end())
+    for (unsigned int i = 0; i < it->second.size(); ++i)
+      {
+        const MESIState state = it->second[i];
+        if (i == coreId || state == MESIState::Invalid)
+          continue;
+
+        otherHasCopy = true;
+        otherOwns |= state == MESIState::Modified ||
+            state == MESIState::Exclusive;
+      }
+
+  if (upgrade)
+    return config.invalidationLatency;
+  else if (otherOwns)
+    return config.cacheToCacheLatency;
+  else if (l2Contains(lineAddr))
+    return config.l2Latency;
+  else
+    return config.memoryLatency;
+}
+
+void
+CoherenceController::commit()
+{
+  for (auto &l1 : l1s)
+    {
+      for (const auto &transaction : l1->transactions)
+        {
+          perform(l1->coreId, transaction);
+          touchedLines.push_back(transaction.lineAddr);
+        }
+      l1->transactions.clear();
+    }
+
+  /* Invalidate and downgrade the lines in the L1s accordingly. */
+  for (MemAddress lineAddr : touchedLines)
+    {
+      auto it = directory.find(lineAddr);
+      if (it == directory.end())
+        continue;
+
+      bool cached = false;
+      for (unsigned int i = 0; i < l1s.size(); ++i)
+        {
+          if (L1DataCache::Line *line = l1s[i]->find(lineAddr))
+            line->state = it->second[i];
+          cached |= it->second[i] != MESIState::Invalid;
+        }
+
+      if (! cached)
+        directory.erase(it);
+    }
+
+  touchedLines.clear();
+}
+
+void
+CoherenceController::perform(unsigned int coreId,
+                             const L1DataCache::Transaction &transaction)
+{
+  const MemAddress lineAddr = transaction.lineAddr;
+  std::vector<MESIState> &states =
+      directory.try_emplace(lineAddr, l1s.size(), MESIState::Invalid).first->second;
+
+  if (transaction.evict)
+    {
+      if (states[coreId] == MESIState::Modified)
+        writeback(lineAddr);
+      states[coreId] = MESIState::Invalid;
+      return;
+    }
+
+  /* The line may have been taken away by a core that came earlier. */
+  const bool upgrade = states[coreId] != MESIState::Invalid;
+  bool otherHasCopy = false;
+  bool suppliedByCache = false;
+
+  /* Snoop all other caches */
+  for (unsigned int i = 0; i < states.size(); ++i)
+    {
+      const MESIState state = states[i];
+      if (i == coreId || state == MESIState::Invalid)
+        continue;
+
+      otherHasCopy = true;
+
+      /* The other core loses (write access to) a line that it did not
+       * touch the same bytes of: false sharing.
+       */
+      const L1DataCache::Line *copy = l1s[i]->find(lineAddr);
+      if ((transaction.exclusive || state == MESIState::Modified) &&
+          copy && (copy->accessMask & transaction.mask) == 0)
+        {
+          ++nFalseSharing;
+          ++falseSharingPerLine[lineAddr];
+          ++falseSharingPerPC[transaction.PC];
+        }
+
+      if (state == MESIState::Modified || state == MESIState::Exclusive)
+        {
+          if (! upgrade)
+            {
+              suppliedByCache = true;
+              ++nCacheToCache;
+            }
+          if (state == MESIState::Modified)
+            writeback(lineAddr);
+        }
+
+      if (transaction.exclusive)
+        {
+          states[i] = MESIState::Invalid;
+          ++nInvalidations;
+        }
+      else
+        states[i] = MESIState::Shared;
+    }
+
+  if (! upgrade && ! suppliedByCache)
+    l2Access(lineAddr);
+
+  if (transaction.exclusive)
+    states[coreId] = MESIState::Modified;
+  else if (! upgrade)
+    states[coreId] = otherHasCopy ? MESIState::Shared : MESIState::Exclusive;
+}
+
+void
+CoherenceController::writeback(MemAddress lineAddr)
+{
+  ++nWritebacks;
+  l2Access(lineAddr);
+}
+
+bool
+CoherenceController::l2Contains(MemAddress lineAddr) const
+{
+  const size_t set = (lineAddr / config.lineSize) % l2Sets;
+  const L2Line *ways = &l2[set * config.l2Assoc];
+
+  for (size_t i = 0; i < config.l2Assoc; ++i)
+    if (ways[i].valid && ways[i].tag == lineAddr)
+      return true;
+
+  return false;
+}
+
+bool
+CoherenceController::l2Access(MemAddress lineAddr)
+{
+  const size_t set = (lineAddr / config.lineSize) % l2Sets;
+  L2Line *ways = &l2[set * config.l2Assoc];
+  L2Line *victim = &ways[0];
+
+  ++l2UseCounter;
+  for (size_t i = 0; i < config.l2Assoc; ++i)
+    {
+      if (ways[i].valid && ways[i].tag == lineAddr)
+        {
+          ways[i].lastUse = l2UseCounter;
+          ++nL2Hits;
+          return true;
+        }
+
+      if (! ways[i].valid)
+        victim = &ways[i];
+      else if (victim->valid && ways[i].lastUse < victim->lastUse)
+        victim = &ways[i];
+    }
+
+  victim->valid = true;
+  victim->tag = lineAddr;
+  victim->lastUse = l2UseCounter;
+  ++nL2Misses;
+  return false;
+}
+
+static void
+dumpTop(std::ostream &os, const char *title,
+        const std::map<MemAddress, uint64_t> &counts)
+{
+  constexpr size_t maxEntries = 10;
+
+  std::vector<std::pair<MemAddress, uint64_t>> sorted(counts.begin(),
+                                                      counts.end());
+  std::sort(sorted.begin(), sorted.end(),
+            [](const auto &a, const auto &b) { return a.second > b.second; });
+  if (sorted.size() > maxEntries)
+    sorted.resize(maxEntries);
+
+  auto storeFlags(os.flags());
+  for (const auto &[addr, count] : sorted)
+    os << "  " << title << " 0x" << std::hex << std::setw(8)
+       << std::setfill('0') << addr << std::dec << ": " << count
+       << std::endl;
+  os.flags(storeFlags);
+}
+
+void
+CoherenceController::dumpStatistics(std::ostream &os) const
+{
+  for (const auto &l1 : l1s)
+    os << "L1D core " << l1->coreId << ": " << l1->getHits() << " hits, "
+       << l1->getMisses() << " misses, " << l1->getStallCycles()
+       << " stall cycles." << std::endl;
+
+  os << "L2: " << nL2Hits << " hits, " << nL2Misses << " misses, "
+     << nWritebacks << " writebacks." << std::endl;
+  os << "Coherence: " << nInvalidations << " invalidations, "
+     << nCacheToCache << " cache-to-cache transfers, "
+     << nFalseSharing << " false sharing events." << std::endl;
+
+  if (nFalseSharing > 0)
+    {
+      dumpTop(os, "false sharing on line", falseSharingPerLine);
+      dumpTop(os, "false sharing at PC  ", falseSharingPerPC);
+    }
+}
+
+void
+CoherenceController::registerStatistics(StatsRegistry &stats) const
+{
+  for (const auto &l1 : l1s)
+    {
+      const std::string prefix = "l1d.core" + std::to_string(l1->coreId) + '.';
+      stats.addCounter(prefix + "hits", l1->nHits, "L1 data cache hits");
+      stats.addCounter(prefix + "misses", l1->nMisses,
+                       "L1 data cache misses and upgrades");
+      stats.addCounter(prefix + "stallCycles", l1->nStallCycles,
+                       "cycles stalled on L1 data cache misses");
+    }
+
+  stats.addCounter("l2.hits", nL2Hits, "L2 cache hits");
+  stats.addCounter("l2.misses", nL2Misses, "L2 cache misses");
+  stats.addCounter("l2.writebacks", nWritebacks,
+                   "modified lines written back to the L2");
+  stats.addCounter("coherence.invalidations", nInvalidations,
+                   "L1 lines invalidated by other cores");
+  stats.addCounter("coherence.cacheToCache", nCacheToCache,
+                   "lines supplied by the L1 of another core");
+  stats.addCounter("coherence.falseSharing", nFalseSharing,
+                   "lines lost to another core accessing other bytes");
+}
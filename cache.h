@@ -0,0 +1,197 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    cache.h - Coherent per-core L1 data caches with a shared L2.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#include "arch.h"
+
+#include <map>
+#include <memory>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+/* The caches only model tags and coherence state, the data itself always
+ * lives in the memories on the bus. An access returns the number of
+ * cycles it costs beyond a regular single-cycle memory access, so that
+ * the pipeline can stall accordingly.
+ */
+struct CacheConfig
+{
+  size_t l1Size = 32 * 1024;
+  size_t l1Assoc = 4;
+  size_t l2Size = 512 * 1024;
+  size_t l2Assoc = 8;
+  size_t lineSize = 64;     /* at most 64, such that a byte mask fits */
+
+  unsigned int l2Latency = 10;
+  unsigned int memoryLatency = 50;
+  unsigned int cacheToCacheLatency = 15;
+  unsigned int invalidationLatency = 5;   /* upgrade, no data moves */
+};
+
+enum class MESIState : uint8_t
+{
+  Invalid,
+  Shared,
+  Exclusive,
+  Modified
+};
+
+class CoherenceController;
+class StatsRegistry;
+
+/* Private L1 data cache of a single core, only accessed by the thread of
+ * that core. Misses and upgrades are decided on the cache's own lines
+ * and recorded as bus transactions, which the CoherenceController
+ * performs at the end of the time quantum.
+ */
+class L1DataCache
+{
+  public:
+    L1DataCache(CoherenceController &controller, unsigned int coreId,
+                const CacheConfig &config);
+
+    L1DataCache(const L1DataCache &) = delete;
+    L1DataCache &operator=(const L1DataCache &) = delete;
+
+    unsigned int access(MemAddress addr, size_t size, bool write,
+                        MemAddress PC);
+
+    uint64_t getHits() const { return nHits; }
+    uint64_t getMisses() const { return nMisses; }
+    uint64_t getStallCycles() const { return nStallCycles; }
+
+  private:
+    struct Line
+    {
+      MESIState state{ MESIState::Invalid };
+      MemAddress tag{};
+      uint64_t lastUse{};
+      /* Bytes accessed by this core since the line was filled, used to
+       * tell false sharing from true sharing.
+       */
+      uint64_t accessMask{};
+    };
+
+    /* A miss, an upgrade (also a silent one) or a replacement. */
+    struct Transaction
+    {
+      MemAddress lineAddr;
+      uint64_t mask;
+      MemAddress PC;
+      bool exclusive;
+      bool evict;
+    };
+
+    CoherenceController &controller;
+    const unsigned int coreId;
+    const size_t lineSize;
+    const size_t nSets;
+    const size_t assoc;
+    std::unique_ptr<Line[]> lines;
+
+    uint64_t useCounter{};
+    std::vector<Transaction> transactions{};
+
+    /* Statistics */
+    uint64_t nHits{};
+    uint64_t nMisses{};
+    uint64_t nStallCycles{};
+
+    MemAddress lineAddress(MemAddress addr) const
+    { return addr & ~static_cast<MemAddress>(lineSize - 1); }
+
+    Line *find(MemAddress lineAddr);
+    Line &victim(MemAddress lineAddr);
+    unsigned int accessLine(MemAddress lineAddr, uint64_t mask, bool write,
+                            MemAddress PC);
+    void record(const Transaction &transaction);
+
+    friend class CoherenceController;
+};
+
+/* The CoherenceController models a snooping bus that keeps the L1 data
+ * caches coherent using the MESI protocol, backed by a shared L2 cache.
+ *
+ * With multiple cores, the bus transactions are performed at the end of
+ * the time quantum, core by core in core-ID order, like the stores to
+ * shared memory. A directory holds the state of every line in every L1
+ * as of the last quantum boundary. During a quantum, a core takes the
+ * latency of a miss and whether it fills the line Shared or Exclusive
+ * from the directory and the L2 as they were at the start of the
+ * quantum; the other cores' copies are invalidated or downgraded, and
+ * the L2, the statistics and false sharing are updated, when its
+ * transactions are performed. The results therefore do not depend on
+ * the host scheduling. A single core performs its transactions at once.
+ */
+class CoherenceController
+{
+  public:
+    CoherenceController(const CacheConfig &config, unsigned int nCores);
+
+    CoherenceController(const CoherenceController &) = delete;
+    CoherenceController &operator=(const CoherenceController &) = delete;
+
+    L1DataCache &getL1(unsigned int coreId) { return *l1s[coreId]; }
+
+    /* Perform the recorded bus transactions. Called at the end of every
+     * time quantum, while all cores wait.
+     */
+    void commit();
+
+    void dumpStatistics(std::ostream &os) const;
+    void registerStatistics(StatsRegistry &stats) const;
+
+  private:
+    struct L2Line
+    {
+      bool valid{};
+      MemAddress tag{};
+      uint64_t lastUse{};
+    };
+
+    const CacheConfig config;
+    const bool deferred;
+    std::vector<std::unique_ptr<L1DataCache>> l1s{};
+
+    /* State of the lines in the L1s, per core, as of the last commit. */
+    std::unordered_map<MemAddress, std::vector<MESIState>> directory{};
+    std::vector<MemAddress> touchedLines{};
+
+    const size_t l2Sets;
+    std::vector<L2Line> l2{};
+    uint64_t l2UseCounter{};
+
+    /* Statistics */
+    uint64_t nL2Hits{};
+    uint64_t nL2Misses{};
+    uint64_t nInvalidations{};
+    uint64_t nCacheToCache{};
+    uint64_t nWritebacks{};
+    uint64_t nFalseSharing{};
+    std::map<MemAddress, uint64_t> falseSharingPerLine{};
+    std::map<MemAddress, uint64_t> falseSharingPerPC{};
+
+    /* Latency of a miss or upgrade of core coreId, and whether another
+     * core holds a copy of the line.
+     */
+    unsigned int getLatency(unsigned int coreId, MemAddress lineAddr,
+                            bool upgrade, bool &otherHasCopy) const;
+
+    void perform(unsigned int coreId,
+                 const L1DataCache::Transaction &transaction);
+    void writeback(MemAddress lineAddr);
+
+    bool l2Contains(MemAddress lineAddr) const;
+    bool l2Access(MemAddress lineAddr);
+
+    friend class L1DataCache;
+};
+
+#endif /* __CACHE_H__ */
@@ -3,6 +3,7 @@
 #include "arch.h"
 #include "inst-decoder.h"
 #include "mux.h"
+#include "vector-unit.h"
 #include <iostream>
 
 #pragma GCC diagnostic push
@@ -59,11 +60,17 @@ ALUOp ControlSignals::getALUOp() const
     case opcode::LWZ:
     case opcode::ADDI:
     case opcode::SW:
+    case opcode::SWA:
     case opcode::SB:
       return ALUOp::ADD;
 
     case opcode::ORI:
-      return ALUOp::OR;
+    case opcode::MFSPR:
+    case opcode::MTSPR:
+      return ALUOp::OR; // SPR address rA | K
+
+    case opcode::MULI:
+      return ALUOp::MUL;
 
     case opcode::ADD:
       switch (op2) 
@@ -90,6 +97,18 @@ ALUOp ControlSignals::getALUOp() const
               case opcode3::SRA:
                 return ALUOp::SRA;
             }
+          case opcode2::DIV:
+            switch (op3) 
+            {
+              case opcode3::MUL:
+                return ALUOp::MUL;
+              case opcode3::MULU:
+                return ALUOp::MULU;
+              case opcode3::DIV:
+                return ALUOp::DIV;
+              case opcode3::DIVU:
+                return ALUOp::DIVU;
+            }
       }
     default:
       return ALUOp::NOP;
@@ -102,11 +121,28 @@ InputSelectorA ControlSignals::getSelectorALUInputA() const
   {
     case opcode::ADDI:
     case opcode::LWZ:
+    case opcode::LWA:
     case opcode::SW:
+    case opcode::SWA:
     case opcode::SB:
     case opcode::ORI:
     case opcode::LBZ:
     case opcode::LBS:
+    case opcode::MULI:
+    case opcode::MFSPR:
+    case opcode::MTSPR:
+    case opcode::MAC:
+    case opcode::MACI:
+    case opcode::FLOAT:
+    case opcode::VECTOR:
+    case opcode::CUST1:
+    case opcode::CUST2:
+    case opcode::CUST3:
+    case opcode::CUST4:
+    case opcode::CUST5:
+    case opcode::CUST6:
+    case opcode::CUST7:
+    case opcode::CUST8:
       return InputSelectorA::rs1;
     case opcode::ADD:
       switch (op2) 
@@ -131,6 +167,17 @@ InputSelectorA ControlSignals::getSelectorALUInputA() const
             case opcode3::SRA:
             return InputSelectorA::rs1;
           }
+        case opcode2::DIV:
+          switch (op3) 
+          {
+            case opcode3::MUL:
+            case opcode3::MULU:
+            case opcode3::MULD:
+            case opcode3::MULDU:
+            case opcode3::DIV:
+            case opcode3::DIVU:
+              return InputSelectorA::rs1;
+          }
       }
     default:
       return InputSelectorA::LAST;
@@ -142,6 +189,18 @@ InputSelectorB ControlSignals::getSelectorALUInputB() const
 {
   switch (op) 
   {
+    case opcode::MAC:
+    case opcode::FLOAT:
+    case opcode::VECTOR:
+    case opcode::CUST1:
+    case opcode::CUST2:
+    case opcode::CUST3:
+    case opcode::CUST4:
+    case opcode::CUST5:
+    case opcode::CUST6:
+    case opcode::CUST7:
+    case opcode::CUST8:
+      return InputSelectorB::rs2;
     case opcode::ADD:
       switch (op2) 
       {
@@ -165,6 +224,17 @@ InputSelectorB ControlSignals::getSelectorALUInputB() const
             case opcode3::SRA:
               return InputSelectorB::rs2;
           }
+        case opcode2::DIV:
+          switch (op3) 
+          {
+            case opcode3::MUL:
+            case opcode3::MULU:
+            case opcode3::MULD:
+            case opcode3::MULDU:
+            case opcode3::DIV:
+            case opcode3::DIVU:
+              return InputSelectorB::rs2;
+          }
       }
     case opcode::JR:
       return InputSelectorB::rs2;
@@ -175,10 +245,15 @@ InputSelectorB ControlSignals::getSelectorALUInputB() const
     case opcode::LWS:
     case opcode::LWZ:
     case opcode::SW:
+    case opcode::SWA:
     case opcode::SB:
     case opcode::J:
     case opcode::JAL:
     case opcode::ORI:
+    case opcode::MULI:
+    case opcode::MACI:
+    case opcode::MFSPR:
+    case opcode::MTSPR:
       return InputSelectorB::immediate;
 
     default:
@@ -235,6 +310,36 @@ WriteBackInputSelector ControlSignals::getSelectorWBInput() const
 // give the instructions that may write
 WriteBackOutputSelector ControlSignals::getSelectorWBOutput() const
 {
+  // l.muld and l.muldu only write the accumulator
+  if (getMACOp() == MACOp::MULD || getMACOp() == MACOp::MULDU)
+    return WriteBackOutputSelector::none;
+
+  // vector results are written to a register pair, except for the
+  // lv.all_* and lv.any_* comparisons which only write the flag
+  if (vectorOp != VectorOp::none)
+    return VectorUnit::isCompare(vectorOp) ? WriteBackOutputSelector::none
+                                           : WriteBackOutputSelector::write;
+
+  // whether a custom instruction writes rD depends on its accelerator,
+  // the decode stage clears the write if it does not
+  if (getCustomSlot() >= 0)
+    return WriteBackOutputSelector::write;
+
+  // floating-point comparisons only write the flag
+  switch (getFPUOp())
+  {
+    case FPUOp::none:
+    case FPUOp::SFEQ:
+    case FPUOp::SFNE:
+    case FPUOp::SFGT:
+    case FPUOp::SFGE:
+    case FPUOp::SFLT:
+    case FPUOp::SFLE:
+      break;
+    default:
+      return WriteBackOutputSelector::write;
+  }
+
   switch (op) 
   {
     case opcode::LWS:
@@ -250,12 +355,61 @@ WriteBackOutputSelector ControlSignals::getSelectorWBOutput() const
     case opcode::MACRC:
     case opcode::JAL:
     case opcode::RORI:
+    case opcode::MULI:
+    case opcode::MFSPR:
       return WriteBackOutputSelector::write;
 
   }
   return WriteBackOutputSelector::none;
 }
 
+// determine which multi-cycle functional unit executes the instruction
+FunctionalUnitSelector ControlSignals::getSelectorFunctionalUnit() const
+{
+  if (op == opcode::MULI)
+    return FunctionalUnitSelector::multiplier;
+
+  switch (getMACOp())
+  {
+    case MACOp::none:
+    case MACOp::MACRC:
+      break;
+    default:
+      return FunctionalUnitSelector::mac;
+  }
+
+  if (vectorOp != VectorOp::none)
+    return FunctionalUnitSelector::simd;
+
+  if (getCustomSlot() >= 0)
+    return FunctionalUnitSelector::accelerator;
+
+  switch (getFPUOp())
+  {
+    case FPUOp::none:
+      break;
+    case FPUOp::DIV:
+    case FPUOp::REM:
+      return FunctionalUnitSelector::fpDivider;
+    default:
+      return FunctionalUnitSelector::fpu;
+  }
+
+  if (op == opcode::ADD && op2 == opcode2::DIV)
+  {
+    switch (op3)
+    {
+      case opcode3::MUL:
+      case opcode3::MULU:
+        return FunctionalUnitSelector::multiplier;
+      case opcode3::DIV:
+      case opcode3::DIVU:
+        return FunctionalUnitSelector::divider;
+    }
+  }
+  return FunctionalUnitSelector::none;
+}
+
 // determine the size of memory of load/store instructions
 uint8_t ControlSignals::getMemSize() const 
 { 
@@ -269,6 +423,7 @@ uint8_t ControlSignals::getMemSize() const
     case opcode::LWZ:
     case opcode::SW:
     case opcode::LWA:
+    case opcode::SWA:
       return 4u;
     case opcode::SB:
     case opcode::LBS:
@@ -288,11 +443,124 @@ bool ControlSignals::getMemReadExtend() const
 // to get the Opcode, immedate and the type of instrucions
 void ControlSignals::setInstruction(const InstructionDecoder & decoder)
 {
+  instructionWord = decoder.getInstructionWord();
   op = decoder.getOpcode();
   op2 = decoder.getOpcode2();
   op3 = decoder.getOpcode3();
   type = decoder.getInstructionType();
   immediate = decoder.getImmediate();
+  vectorOp = decoder.getVectorOp();
+
+  // the operands and result of a vector instruction are register pairs
+  if (vectorOp != VectorOp::none &&
+      (decoder.getA() >= NumRegs - 1 || decoder.getB() >= NumRegs - 1 ||
+       decoder.getD() >= NumRegs - 1))
+    throw IllegalInstruction{"Vector register pair out of range."};
 }
 
 #pragma GCC diagnostic pop
+
+// determine the operation of the multiply-accumulate unit
+MACOp ControlSignals::getMACOp() const
+{
+  switch (op)
+  {
+    case opcode::MAC:
+      switch (op2)
+      {
+        case opcode2::MAC:
+          return MACOp::MAC;
+        case opcode2::MACU:
+          return MACOp::MACU;
+        case opcode2::MSB:
+          return MACOp::MSB;
+        case opcode2::MSBU:
+          return MACOp::MSBU;
+        default:
+          break;
+      }
+      break;
+    case opcode::MACI:
+      return MACOp::MAC;
+    case opcode::MACRC:
+      if (op2 == opcode2::MACRC)
+        return MACOp::MACRC;
+      break;
+    case opcode::ADD:
+      if (op2 == opcode2::DIV && op3 == opcode3::MULD)
+        return MACOp::MULD;
+      if (op2 == opcode2::DIV && op3 == opcode3::MULDU)
+        return MACOp::MULDU;
+      break;
+    default:
+      break;
+  }
+  return MACOp::none;
+}
+
+// determine the operation of the floating-point unit
+FPUOp ControlSignals::getFPUOp() const
+{
+  if (op != opcode::FLOAT)
+    return FPUOp::none;
+
+  switch (op2)
+  {
+    case opcode2::ADDS:
+      return FPUOp::ADD;
+    case opcode2::SUBS:
+      return FPUOp::SUB;
+    case opcode2::MULS:
+      return FPUOp::MUL;
+    case opcode2::DIVS:
+      return FPUOp::DIV;
+    case opcode2::REMS:
+      return FPUOp::REM;
+    case opcode2::MADDS:
+      return FPUOp::MADD;
+    case opcode2::ITOFS:
+      return FPUOp::ITOF;
+    case opcode2::FTOIS:
+      return FPUOp::FTOI;
+    case opcode2::SFEQS:
+      return FPUOp::SFEQ;
+    case opcode2::SFNES:
+      return FPUOp::SFNE;
+    case opcode2::SFGTS:
+      return FPUOp::SFGT;
+    case opcode2::SFGES:
+      return FPUOp::SFGE;
+    case opcode2::SFLTS:
+      return FPUOp::SFLT;
+    case opcode2::SFLES:
+      return FPUOp::SFLE;
+    default:
+      return FPUOp::none;
+  }
+}
+
+// determine the accelerator slot of the l.custN instructions
+int ControlSignals::getCustomSlot() const
+{
+  switch (op)
+  {
+    case opcode::CUST1:
+      return 0;
+    case opcode::CUST2:
+      return 1;
+    case opcode::CUST3:
+      return 2;
+    case opcode::CUST4:
+      return 3;
+    case opcode::CUST5:
+      return 4;
+    case opcode::CUST6:
+      return 5;
+    case opcode::CUST7:
+      return 6;
+    case opcode::CUST8:
+      return 7;
+    default:
+      return -1;
+  }
+}
@@ -2,6 +2,7 @@
 #define CONTROLSIGNALS_H
 
 #include "arch.h"
+#include "functional-unit.h"
 #include "inst-decoder.h"
 #include "mux.h"
 
@@ -10,7 +11,7 @@ class ControlSignals
   public:
     ControlSignals() = default;
     void setInstruction(const InstructionDecoder & decoder);
-    uint32_t getInstruction();
+    uint32_t getInstruction() const { return instructionWord; }
     InstructionType getType();
     opcode getopcode();
     opcode2 getopcode2();
@@ -21,16 +22,24 @@ class ControlSignals
     MemorySelector getSelectorMemory() const;
     WriteBackInputSelector getSelectorWBInput() const;
     WriteBackOutputSelector getSelectorWBOutput() const;
+    FunctionalUnitSelector getSelectorFunctionalUnit() const;
+    MACOp getMACOp() const;
+    FPUOp getFPUOp() const;
+    VectorOp getVectorOp() const { return vectorOp; }
+    /* Index of the accelerator slot of l.custN, or -1 */
+    int getCustomSlot() const;
     uint8_t getMemSize() const;
     bool getMemReadExtend() const;
     RegValue add(InstructionDecoder & decoder);
 
   private:
-    opcode op;
-    opcode2 op2;
-    opcode3 op3;
-    InstructionType type;
-    InstructionDecoder decoder;
-    int32_t immediate;
+    opcode op{};
+    opcode2 op2{};
+    opcode3 op3{};
+    InstructionType type{};
+    InstructionDecoder decoder{};
+    uint32_t instructionWord{};
+    int32_t immediate{};
+    VectorOp vectorOp = VectorOp::none;
 };
 #endif // CONTROLSIGNALS_H
\ No newline at end of file
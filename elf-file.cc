@@ -287,3 +287,53 @@ ELFFile::getEntrypoint() const
 {
   return __builtin_bswap32(static_cast<Elf64_Ehdr *>(mapAddr)->e_entry);
 }
+
+std::map<std::string, MemAddress>
+ELFFile::getFunctionSymbols() const
+{
+  std::map<std::string, MemAddress> symbols;
+
+  const auto *elf = static_cast<const Elf32_Ehdr *>(mapAddr);
+  const auto *base = reinterpret_cast<const std::byte *>(elf);
+  const auto *sheaders = reinterpret_cast<const Elf32_Shdr *>(base + __builtin_bswap32(elf->e_shoff));
+  const int shnum = __builtin_bswap16(elf->e_shnum);
+
+  for (int i = 0; i < shnum; ++i)
+    {
+      const Elf32_Shdr &header = sheaders[i];
+      if (__builtin_bswap32(header.sh_type) != SHT_SYMTAB)
+        continue;
+
+      const Elf32_Word sh_link = __builtin_bswap32(header.sh_link);
+      if (sh_link >= static_cast<Elf32_Word>(shnum))
+        continue;
+
+      const Elf32_Shdr &strtab = sheaders[sh_link];
+      const auto *strings = reinterpret_cast<const char *>(base + __builtin_bswap32(strtab.sh_offset));
+      const Elf32_Word stringsSize = __builtin_bswap32(strtab.sh_size);
+
+      const auto *syms = reinterpret_cast<const Elf32_Sym *>(base + __builtin_bswap32(header.sh_offset));
+      const size_t nSyms = __builtin_bswap32(header.sh_size) / sizeof(Elf32_Sym);
+
+      for (size_t j = 0; j < nSyms; ++j)
+        {
+          const Elf32_Sym &sym = syms[j];
+          const Elf32_Word st_name = __builtin_bswap32(sym.st_name);
+          const int type = sym.st_info & 0xf;
+
+          /* Hand-written assembly often leaves the type of its labels
+           * unset, so accept any defined code symbol.
+           */
+          if ((type != STT_FUNC && type != STT_NOTYPE) ||
+              __builtin_bswap16(sym.st_shndx) == SHN_UNDEF ||
+              __builtin_bswap16(sym.st_shndx) >= SHN_LORESERVE ||
+              st_name == 0 || st_name >= stringsSize)
+            continue;
+
+          symbols.emplace(std::string(strings + st_name),
+                          __builtin_bswap32(sym.st_value));
+        }
+    }
+
+  return symbols;
+}
@@ -10,6 +10,7 @@
 
 #include "memory-interface.h"
 
+#include <map>
 #include <vector>
 #include <memory>
 #include <string>
@@ -38,6 +39,11 @@ class ELFFile
                         size_t &segmentSize) const;
     uint64_t getEntrypoint() const;
 
+    /* Addresses of the functions in the symbol table, by name. Empty if
+     * the file has been stripped.
+     */
+    std::map<std::string, MemAddress> getFunctionSymbols() const;
+
 
     ELFFile(const ELFFile &) = delete;
     ELFFile &operator=(const ELFFile &) = delete;
@@ -0,0 +1,178 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    event-scheduler.cc - Discrete-event scheduler with clock domains.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#include "event-scheduler.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+/*
+ * ClockDomain
+ */
+
+ClockDomain::ClockDomain(std::string_view name, unsigned int multiplier,
+                         unsigned int divider)
+  : name{ name }, multiplier{ multiplier }, divider{ divider }
+{
+  if (multiplier < 1 || divider < 1)
+    throw std::out_of_range("invalid frequency ratio of clock domain " +
+                            this->name);
+}
+
+/* Edge k of a domain with ratio m / d falls in processor cycle
+ * ceil(k * d / m).
+ */
+static constexpr uint64_t
+edgeAtOrAfter(uint64_t cycle, uint64_t m, uint64_t d)
+{
+  return cycle == 0 ? 0 : (cycle - 1) * m / d + 1;
+}
+
+static constexpr uint64_t
+cycleOfEdge(uint64_t edge, uint64_t m, uint64_t d)
+{
+  return (edge * d + m - 1) / m;
+}
+
+/* In a domain no faster than the processor, every edge falls in a cycle
+ * of its own, so converting an edge to a cycle and back gives the edge.
+ */
+static constexpr bool
+roundTrips(uint64_t m, uint64_t d)
+{
+  for (uint64_t edge = 0; edge < 1000; ++edge)
+    if (edgeAtOrAfter(cycleOfEdge(edge, m, d), m, d) != edge)
+      return false;
+  return true;
+}
+
+/* The bus at 1/5, with edges in cycles 0, 5, 10, ... */
+static_assert(edgeAtOrAfter(1, 1, 5) == 1 && edgeAtOrAfter(5, 1, 5) == 1 &&
+              edgeAtOrAfter(6, 1, 5) == 2 && cycleOfEdge(2, 1, 5) == 10,
+              "bus edges must round up to multiples of 5 cycles");
+/* A domain at 2/3, with edges in cycles 0, 2, 3, 5, 6, ... */
+static_assert(cycleOfEdge(1, 2, 3) == 2 && cycleOfEdge(3, 2, 3) == 5 &&
+              edgeAtOrAfter(3, 2, 3) == 2 && edgeAtOrAfter(4, 2, 3) == 3,
+              "edges must round up to the next processor cycle");
+/* A domain at 3/1, with three edges in every cycle. */
+static_assert(cycleOfEdge(1, 3, 1) == 1 && cycleOfEdge(3, 3, 1) == 1 &&
+              cycleOfEdge(4, 3, 1) == 2 && edgeAtOrAfter(2, 3, 1) == 4,
+              "a cycle must start with the first of its edges");
+static_assert(roundTrips(1, 5) && roundTrips(2, 3) && roundTrips(3, 7),
+              "edges must map to distinct cycles");
+
+uint64_t
+ClockDomain::getEdge(uint64_t cycle) const
+{
+  return edgeAtOrAfter(cycle, multiplier, divider);
+}
+
+uint64_t
+ClockDomain::getProcessorCycle(uint64_t edge) const
+{
+  return cycleOfEdge(edge, multiplier, divider);
+}
+
+/*
+ * EventScheduler
+ */
+
+const ClockDomain &
+EventScheduler::addClockDomain(std::string_view name,
+                               unsigned int multiplier,
+                               unsigned int divider)
+{
+  for (const auto &domain : domains)
+    if (domain.getName() == name)
+      throw std::invalid_argument("clock domain " + std::string(name) +
+                                  " added more than once");
+
+  return domains.emplace_back(name, multiplier, divider);
+}
+
+const ClockDomain &
+EventScheduler::getClockDomain(std::string_view name) const
+{
+  for (const auto &domain : domains)
+    if (domain.getName() == name)
+      return domain;
+
+  throw std::out_of_range("unknown clock domain " + std::string(name));
+}
+
+void
+EventScheduler::schedule(uint64_t time, Action action)
+{
+  time = std::max(time, now);
+  insert(time, Event{ sequence++, std::move(action) });
+  earliest = std::min(earliest, time);
+}
+
+void
+EventScheduler::scheduleIn(const ClockDomain &domain, uint64_t cycles,
+                           Action action)
+{
+  schedule(domain.getProcessorCycle(domain.getEdge(now) + cycles),
+           std::move(action));
+}
+
+void
+EventScheduler::insert(uint64_t time, Event &&event)
+{
+  if (time - now < WheelSize)
+    wheel[time % WheelSize].push_back(std::move(event));
+  else
+    overflow.emplace(time, std::move(event));
+}
+
+uint64_t
+EventScheduler::findEarliest() const
+{
+  for (uint64_t time = now; time < now + WheelSize; ++time)
+    if (! wheel[time % WheelSize].empty())
+      return time;
+
+  return overflow.empty() ? Never : overflow.begin()->first;
+}
+
+void
+EventScheduler::runUntil(uint64_t time)
+{
+  while (earliest <= time)
+    {
+      now = earliest;
+
+      /* Move the events that came within reach of the wheel. */
+      while (! overflow.empty() && overflow.begin()->first - now < WheelSize)
+        {
+          auto node = overflow.extract(overflow.begin());
+          wheel[node.key() % WheelSize].push_back(std::move(node.mapped()));
+        }
+
+      /* Events may add further events to the current slot. */
+      auto &slot = wheel[now % WheelSize];
+      while (! slot.empty())
+        {
+          std::vector<Event> due;
+          due.swap(slot);
+          std::sort(due.begin(), due.end(),
+                    [](const Event &a, const Event &b)
+                    { return a.sequence < b.sequence; });
+
+          for (auto &event : due)
+            {
+              event.action();
+              ++nEventsRun;
+            }
+        }
+
+      earliest = findEarliest();
+    }
+
+  now = time;
+}
@@ -0,0 +1,128 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    event-scheduler.h - Discrete-event scheduler with clock domains.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#ifndef __EVENT_SCHEDULER_H__
+#define __EVENT_SCHEDULER_H__
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/* A clock domain runs at a fixed ratio of the processor clock,
+ * multiplier / divider. The bus, for instance, runs at 1/5 of the
+ * processor clock. Time is kept in processor cycles; a domain converts
+ * its own cycles into processor cycles.
+ */
+class ClockDomain
+{
+  public:
+    ClockDomain(std::string_view name, unsigned int multiplier,
+                unsigned int divider);
+
+    const std::string &getName() const { return name; }
+
+    /* Index of the first clock edge of this domain at or after the
+     * given processor cycle.
+     */
+    uint64_t getEdge(uint64_t cycle) const;
+
+    /* Processor cycle in which the given clock edge falls. */
+    uint64_t getProcessorCycle(uint64_t edge) const;
+
+  private:
+    const std::string name;
+    unsigned int multiplier;
+    unsigned int divider;
+};
+
+/* Instead of being clocked every cycle, components schedule events at
+ * the cycle in which something happens. Events that are due within the
+ * next WheelSize cycles are kept in a timing wheel, events further away
+ * in an ordered overflow list from which they move to the wheel as time
+ * advances. Advancing time past idle cycles costs a single comparison,
+ * regardless of the number of components.
+ *
+ * Events due in the same cycle run in the order in which they were
+ * scheduled. An event may schedule further events, including in the
+ * current cycle.
+ */
+class EventScheduler
+{
+  public:
+    using Action = std::function<void()>;
+
+    static constexpr uint64_t WheelSize = 256;
+    static constexpr uint64_t Never = std::numeric_limits<uint64_t>::max();
+
+    EventScheduler() = default;
+    EventScheduler(const EventScheduler &) = delete;
+    EventScheduler &operator=(const EventScheduler &) = delete;
+
+    /* Domains live as long as the scheduler, references stay valid. */
+    const ClockDomain &addClockDomain(std::string_view name,
+                                      unsigned int multiplier,
+                                      unsigned int divider);
+    const ClockDomain &getClockDomain(std::string_view name) const;
+
+    uint64_t getTime() const { return now; }
+
+    /* Cycle of the earliest pending event, or Never. */
+    uint64_t getNextEventTime() const { return earliest; }
+
+    /* Schedule an action at an absolute processor cycle. Events in the
+     * past are run at the current cycle.
+     */
+    void schedule(uint64_t time, Action action);
+
+    /* Schedule an action the given number of domain cycles after the
+     * next edge of the domain.
+     */
+    void scheduleIn(const ClockDomain &domain, uint64_t cycles,
+                    Action action);
+
+    /* Run all events up to and including the given cycle. */
+    void advanceTo(uint64_t time)
+    {
+      if (time < earliest)
+        now = std::max(now, time);
+      else
+        runUntil(time);
+    }
+
+    uint64_t getEventsRun() const { return nEventsRun; }
+
+  private:
+    struct Event
+    {
+      uint64_t sequence;
+      Action action;
+    };
+
+    std::array<std::vector<Event>, WheelSize> wheel{};
+    std::multimap<uint64_t, Event> overflow{};
+    std::deque<ClockDomain> domains{};
+
+    uint64_t now{};
+    uint64_t earliest = Never;
+    uint64_t sequence{};
+
+    /* Statistics */
+    uint64_t nEventsRun{};
+
+    void runUntil(uint64_t time);
+    void insert(uint64_t time, Event &&event);
+    uint64_t findEarliest() const;
+};
+
+#endif /* __EVENT_SCHEDULER_H__ */
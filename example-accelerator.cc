@@ -0,0 +1,56 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    example-accelerator.cc - Example accelerator plugin.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+/* A plugin provides accelerators that are not built into the emulator.
+ * It is a shared object, loaded with -P or from the "accelerators"
+ * section of a test, that exports rv64emu_register_accelerators. Build
+ * it with "make example-accelerator.so" and bind its accelerator to a
+ * custom opcode, e.g.
+ *
+ *   ./rv64-emu -P ./example-accelerator.so -A cust3=reverse program.bin
+ */
+
+#include "accelerator.h"
+
+/* Reverses the rB bytes starting at address rA in place. The result is
+ * not written back; the accelerator reads and writes two bytes per
+ * cycle.
+ */
+class ReverseAccelerator : public Accelerator
+{
+  public:
+    unsigned int getLatency(const CustomOperands &operands) const override
+    {
+      return 1 + operands.B / 2;
+    }
+
+    bool isPipelined() const override { return false; }
+
+    bool writesResult() const override { return false; }
+
+    RegValue execute(const CustomOperands &operands,
+                     MemoryInterface &memory) override
+    {
+      if (operands.B < 2)
+        return 0;
+
+      for (MemAddress lo = operands.A, hi = operands.A + operands.B - 1;
+           lo < hi; ++lo, --hi)
+        {
+          const uint8_t byte = memory.readByte(lo);
+          memory.writeByte(lo, memory.readByte(hi));
+          memory.writeByte(hi, byte);
+        }
+      return 0;
+    }
+};
+
+extern "C" void
+rv64emu_register_accelerators(AcceleratorRegistry &registry)
+{
+  registry.add("reverse", [] { return std::make_unique<ReverseAccelerator>(); });
+}
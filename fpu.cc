@@ -0,0 +1,217 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    fpu.cc - ORFPX32 single-precision floating-point unit.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#include "fpu.h"
+
+#include <cfenv>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+
+static float
+toFloat(RegValue value)
+{
+  float f;
+  std::memcpy(&f, &value, sizeof(f));
+  return f;
+}
+
+static RegValue
+toRegValue(float f)
+{
+  RegValue value;
+  std::memcpy(&value, &f, sizeof(value));
+  return value;
+}
+
+static bool
+isSignalingNaN(RegValue value)
+{
+  /* All exponent bits set, quiet bit clear, non-zero mantissa. */
+  return (value & 0x7f800000) == 0x7f800000 &&
+      (value & 0x00400000) == 0 && (value & 0x003fffff) != 0;
+}
+
+/* Translates the host exception flags raised since they were last
+ * cleared into FPCSR flags.
+ */
+static uint32_t
+hostFlags()
+{
+  uint32_t flags = 0;
+  const int raised = std::fetestexcept(FE_ALL_EXCEPT);
+
+  if (raised & FE_OVERFLOW)
+    flags |= FPCSR::OVF;
+  if (raised & FE_UNDERFLOW)
+    flags |= FPCSR::UNF;
+  if (raised & FE_INEXACT)
+    flags |= FPCSR::IXF;
+  if (raised & FE_INVALID)
+    flags |= FPCSR::IVF;
+  if (raised & FE_DIVBYZERO)
+    flags |= FPCSR::DZF;
+
+  return flags;
+}
+
+
+int
+FloatingPointUnit::hostRoundingMode() const
+{
+  switch ((fpcsr & FPCSR::RMMask) >> FPCSR::RMShift)
+    {
+      case 1:
+        return FE_TOWARDZERO;
+      case 2:
+        return FE_UPWARD;
+      case 3:
+        return FE_DOWNWARD;
+      default:
+        return FE_TONEAREST;
+    }
+}
+
+RegValue
+FloatingPointUnit::execute(FPUOp op, RegValue A, RegValue B, RegValue C)
+{
+  std::fenv_t hostEnv;
+  std::feholdexcept(&hostEnv);
+  std::fesetround(hostRoundingMode());
+
+  /* volatile keeps the compiler from moving the operations across the
+   * rounding mode and flag accesses.
+   */
+  volatile float a = toFloat(A), b = toFloat(B), c = toFloat(C);
+  volatile float result = 0.0f;
+  RegValue intResult = 0;
+  uint32_t flags = 0;
+
+  if (isSignalingNaN(A) || (op != FPUOp::ITOF && isSignalingNaN(B)) ||
+      (op == FPUOp::MADD && isSignalingNaN(C)))
+    flags |= FPCSR::SNF;
+
+  switch (op)
+    {
+      case FPUOp::ADD:
+        result = a + b;
+        break;
+      case FPUOp::SUB:
+        result = a - b;
+        break;
+      case FPUOp::MUL:
+        result = a * b;
+        break;
+      case FPUOp::DIV:
+        result = a / b;
+        break;
+      case FPUOp::REM:
+        /* The remainder of the division truncated towards zero, like
+         * the C % operator the architecture manual describes it with.
+         */
+        result = std::fmod(a, b);
+        break;
+      case FPUOp::MADD:
+        /* Fused: a single rounding step, like a hardware FMA. */
+        result = std::fma(a, b, c);
+        break;
+      case FPUOp::ITOF:
+        result = static_cast<float>(static_cast<int32_t>(A));
+        break;
+      case FPUOp::FTOI:
+        {
+          const float rounded = std::nearbyint(a);
+          if (std::isnan(rounded) ||
+              rounded < static_cast<float>(std::numeric_limits<int32_t>::min()) ||
+              rounded >= -static_cast<float>(std::numeric_limits<int32_t>::min()))
+            {
+              flags |= FPCSR::IVF;
+              intResult = static_cast<RegValue>(std::numeric_limits<int32_t>::min());
+            }
+          else
+            {
+              if (rounded != a)
+                flags |= FPCSR::IXF;
+              intResult = static_cast<RegValue>(static_cast<int32_t>(rounded));
+            }
+        }
+        break;
+      default:
+        std::fesetenv(&hostEnv);
+        throw IllegalInstruction("Unimplemented or unknown FPU operation");
+    }
+
+  flags |= hostFlags();
+  std::fesetenv(&hostEnv);
+
+  if (op != FPUOp::FTOI)
+    {
+      const float r = result;
+      if (std::isnan(r))
+        flags |= FPCSR::QNF;
+      else if (std::isinf(r))
+        flags |= FPCSR::INF;
+      else if (r == 0.0f)
+        flags |= FPCSR::ZF;
+      intResult = toRegValue(r);
+    }
+  else if (intResult == 0)
+    flags |= FPCSR::ZF;
+
+  raiseFlags(flags);
+  return intResult;
+}
+
+bool
+FloatingPointUnit::compare(FPUOp op, RegValue A, RegValue B)
+{
+  const float a = toFloat(A), b = toFloat(B);
+  const bool unordered = std::isnan(a) || std::isnan(b);
+
+  if (isSignalingNaN(A) || isSignalingNaN(B))
+    raiseFlags(FPCSR::SNF | FPCSR::IVF);
+
+  switch (op)
+    {
+      case FPUOp::SFEQ:
+        return a == b;
+      case FPUOp::SFNE:
+        return a != b;
+      default:
+        break;
+    }
+
+  /* Ordered comparisons are invalid on any NaN. */
+  if (unordered)
+    {
+      raiseFlags(FPCSR::IVF);
+      return false;
+    }
+
+  switch (op)
+    {
+      case FPUOp::SFGT:
+        return a > b;
+      case FPUOp::SFGE:
+        return a >= b;
+      case FPUOp::SFLT:
+        return a < b;
+      case FPUOp::SFLE:
+        return a <= b;
+      default:
+        throw IllegalInstruction("Unimplemented or unknown FPU comparison");
+    }
+}
+
+void
+FloatingPointUnit::raiseFlags(uint32_t flags)
+{
+  fpcsr |= flags;
+  if (flags != 0 && (fpcsr & FPCSR::FPEE))
+    exceptionPending = true;
+}
@@ -0,0 +1,67 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    fpu.h - ORFPX32 single-precision floating-point unit.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#ifndef __FPU_H__
+#define __FPU_H__
+
+#include "arch.h"
+#include "inst-decoder.h"
+
+/* Bits of the floating-point control status register (FPCSR). */
+namespace FPCSR
+{
+  static constexpr uint32_t FPEE = 1u << 0;   /* exceptions enabled */
+  static constexpr uint32_t RMShift = 1;      /* rounding mode, 2 bits */
+  static constexpr uint32_t RMMask = 3u << RMShift;
+  static constexpr uint32_t OVF = 1u << 3;    /* overflow */
+  static constexpr uint32_t UNF = 1u << 4;    /* underflow */
+  static constexpr uint32_t SNF = 1u << 5;    /* signaling NaN */
+  static constexpr uint32_t QNF = 1u << 6;    /* quiet NaN */
+  static constexpr uint32_t ZF = 1u << 7;     /* zero */
+  static constexpr uint32_t IXF = 1u << 8;    /* inexact */
+  static constexpr uint32_t IVF = 1u << 9;    /* invalid */
+  static constexpr uint32_t INF = 1u << 10;   /* infinity */
+  static constexpr uint32_t DZF = 1u << 11;   /* divide by zero */
+
+  static constexpr uint32_t FlagMask = OVF | UNF | SNF | QNF | ZF | IXF |
+                                       IVF | INF | DZF;
+}
+
+/* The floating-point unit executes the lf.*.s instructions on the host
+ * FPU. Operands and results are IEEE 754 single-precision values held in
+ * the general-purpose registers. For every operation the host rounding
+ * mode is set according to FPCSR[RM], and the host exception flags are
+ * folded into the sticky flags of the FPCSR. When FPCSR[FPEE] is set, an
+ * operation that raises any flag makes a floating-point exception
+ * pending, which the processor takes once the operation has completed.
+ */
+class FloatingPointUnit
+{
+  public:
+    /* Performs an arithmetic or conversion operation. C is the value of
+     * rD, the addend of lf.madd.s.
+     */
+    RegValue execute(FPUOp op, RegValue A, RegValue B, RegValue C);
+
+    /* Performs one of the lf.sf*.s comparisons. */
+    bool compare(FPUOp op, RegValue A, RegValue B);
+
+    uint32_t getFPCSR() const { return fpcsr; }
+    void setFPCSR(uint32_t value) { fpcsr = value; }
+
+    bool isExceptionPending() const { return exceptionPending; }
+    void clearPendingException() { exceptionPending = false; }
+
+  private:
+    uint32_t fpcsr{};
+    bool exceptionPending{};
+
+    int hostRoundingMode() const;
+    void raiseFlags(uint32_t flags);
+};
+
+#endif /* __FPU_H__ */
@@ -45,6 +45,7 @@
 
 #ifdef ENABLE_FRAMEBUFFER
 #include "framebuffer.h"
+#include "event-scheduler.h"
 
 #include <SDL.h>
 #include <SDL_video.h>
@@ -495,14 +496,23 @@ Framebuffer::writeDoubleWord(MemAddress addr, uint64_t value)
 }
 
 void
-Framebuffer::clockPulse()
+Framebuffer::attachScheduler(EventScheduler &scheduler,
+                             const ClockDomain &busClock)
 {
-  if (cycles_since_update > update_freq)
-    {
-      processEvents(true);
-      cycles_since_update = 0;
-    }
-  ++cycles_since_update;
+  scheduleUpdate(scheduler, busClock);
+}
+
+/* Redraw and handle window events every update_freq bus cycles. */
+void
+Framebuffer::scheduleUpdate(EventScheduler &scheduler,
+                            const ClockDomain &busClock)
+{
+  scheduler.scheduleIn(busClock, update_freq + 1,
+                       [this, &scheduler, &busClock]
+                       {
+                         processEvents(true);
+                         scheduleUpdate(scheduler, busClock);
+                       });
 }
 
 #endif
@@ -53,8 +53,10 @@ class Framebuffer : public MemoryInterface
     void writeDoubleWord(MemAddress addr, uint64_t value) override;
 
     bool contains(MemAddress addr) const override;
+    std::string getName() const override { return "framebuffer"; }
 
-    void clockPulse() override;
+    void attachScheduler(EventScheduler &scheduler,
+                         const ClockDomain &busClock) override;
 
     void processEvents(const bool redraw);
 
@@ -71,7 +73,9 @@ class Framebuffer : public MemoryInterface
     bool  finished = false;
 
     uint64_t update_freq = 1000000;
-    uint64_t cycles_since_update{};
+
+    void scheduleUpdate(EventScheduler &scheduler,
+                        const ClockDomain &busClock);
 
     ControlInterface control{};
     std::unique_ptr<RenderContext> context;
@@ -0,0 +1,61 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    functional-unit.cc - Multi-cycle functional units and scoreboard.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#include "functional-unit.h"
+
+#include <regex>
+#include <stdexcept>
+
+
+FunctionalUnit::FunctionalUnit(std::string_view name, unsigned int latency,
+                               unsigned int interval)
+  : name{ name }, latency{}, interval{}
+{
+  configure(latency, interval);
+}
+
+void
+FunctionalUnit::configure(unsigned int latency, unsigned int interval)
+{
+  if (latency < 1 || interval < 1)
+    throw std::out_of_range("latency and initiation interval of unit " +
+                            name + " must be at least 1");
+
+  this->latency = latency;
+  this->interval = interval;
+}
+
+uint64_t
+FunctionalUnit::issue(uint64_t cycle)
+{
+  ++nOperations;
+  nextIssue = cycle + interval;
+  return cycle + latency;
+}
+
+uint64_t
+FunctionalUnit::issue(uint64_t cycle, unsigned int latency,
+                      unsigned int interval)
+{
+  ++nOperations;
+  nextIssue = cycle + interval;
+  return cycle + latency;
+}
+
+
+FunctionalUnitConfig::FunctionalUnitConfig(std::string_view spec)
+{
+  std::regex spec_regex("([a-z]+)=([0-9]+)(:([0-9]+))?");
+  std::match_results<std::string_view::const_iterator> match;
+
+  if (! std::regex_match(spec.begin(), spec.end(), match, spec_regex))
+    throw std::invalid_argument("malformed functional unit specifier");
+
+  name = match[1];
+  latency = std::stoul(match[2]);
+  interval = match[4].matched ? std::stoul(match[4]) : 1;
+}
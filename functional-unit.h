@@ -0,0 +1,149 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    functional-unit.h - Multi-cycle functional units and scoreboard.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#ifndef __FUNCTIONAL_UNIT_H__
+#define __FUNCTIONAL_UNIT_H__
+
+#include "arch.h"
+
+#include <array>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/* Functional units that an instruction may need besides the single-cycle
+ * ALU.
+ */
+enum class FunctionalUnitSelector
+{
+  none,
+  multiplier,
+  divider,
+  mac,
+  fpu,
+  fpDivider,
+  simd,
+  accelerator,
+  LAST
+};
+
+/* Timing model of a functional unit. The result of an operation is
+ * computed right away; the unit only determines when that result may be
+ * consumed (latency) and when the next operation may be issued to the
+ * unit (initiation interval). A fully pipelined unit has an interval of
+ * 1, an iterative unit an interval equal to its latency.
+ */
+class FunctionalUnit
+{
+  public:
+    FunctionalUnit(std::string_view name, unsigned int latency,
+                   unsigned int interval);
+
+    const std::string &getName() const { return name; }
+
+    void configure(unsigned int latency, unsigned int interval);
+
+    bool canIssue(uint64_t cycle) const { return cycle >= nextIssue; }
+
+    /* Issue an operation in the given cycle, returns the cycle in which
+     * the result becomes available.
+     */
+    uint64_t issue(uint64_t cycle);
+
+    /* Issue an operation whose timing is determined by the operation
+     * itself rather than by the unit, as for the accelerators.
+     */
+    uint64_t issue(uint64_t cycle, unsigned int latency,
+                   unsigned int interval);
+
+    void addDependencyStall() { ++nDependencyStalls; }
+    void addStructuralStall() { ++nStructuralStalls; }
+
+    uint64_t getOperations() const { return nOperations; }
+    uint64_t getDependencyStalls() const { return nDependencyStalls; }
+    uint64_t getStructuralStalls() const { return nStructuralStalls; }
+
+  private:
+    const std::string name;
+    unsigned int latency;
+    unsigned int interval;
+
+    uint64_t nextIssue{};
+
+    /* Statistics */
+    uint64_t nOperations{};
+    uint64_t nDependencyStalls{};
+    uint64_t nStructuralStalls{};
+};
+
+/* Command-line override of a unit's timing, in the form
+ * name=latency[:interval]. When the interval is omitted, the unit is
+ * fully pipelined.
+ */
+class FunctionalUnitConfig
+{
+  public:
+    FunctionalUnitConfig(std::string_view spec);
+
+    std::string name{};
+    unsigned int latency{};
+    unsigned int interval{};
+};
+
+/* Every custom instruction slot has a unit of its own, so that a busy
+ * accelerator does not hold up the others. Their units follow the other
+ * units, the first at the index of FunctionalUnitSelector::accelerator.
+ */
+constexpr size_t NumCustomUnits = 8;
+
+using FunctionalUnits =
+    std::array<std::unique_ptr<FunctionalUnit>,
+               static_cast<size_t>(FunctionalUnitSelector::accelerator) +
+               NumCustomUnits>;
+
+inline size_t
+getUnitIndex(FunctionalUnitSelector selector, int customSlot)
+{
+  if (selector == FunctionalUnitSelector::accelerator)
+    return static_cast<size_t>(selector) + customSlot;
+  return static_cast<size_t>(selector);
+}
+
+
+/* The scoreboard records for every register when its pending value will
+ * be available and which unit produces it. Instructions that only depend
+ * on available registers may continue while a long-latency operation is
+ * still in progress. The MAC accumulator is tracked as an additional
+ * register.
+ */
+class Scoreboard
+{
+  public:
+    static constexpr RegNumber Accumulator = NumRegs;
+
+    bool isReady(RegNumber reg, uint64_t cycle) const
+    {
+      return reg == 0 || cycle >= readyCycle[reg];
+    }
+
+    FunctionalUnit *getProducer(RegNumber reg) const
+    {
+      return producer[reg];
+    }
+
+    void setPending(RegNumber reg, uint64_t cycle, FunctionalUnit *unit)
+    {
+      readyCycle[reg] = cycle;
+      producer[reg] = unit;
+    }
+
+  private:
+    std::array<uint64_t, NumRegs + 1> readyCycle{};
+    std::array<FunctionalUnit *, NumRegs + 1> producer{};
+};
+
+#endif /* __FUNCTIONAL_UNIT_H__ */
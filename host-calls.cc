@@ -0,0 +1,182 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    host-calls.cc - Host implementations of guest library routines.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#include "host-calls.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+
+static constexpr std::array<const char *, static_cast<size_t>(HostFunction::LAST)>
+functionNames = { "memcpy", "memset", "strlen", "memcmp" };
+
+/* Number of words a word-at-a-time loop touches for n bytes. */
+static uint64_t
+words(uint64_t n)
+{
+  return (n + 3) / 4;
+}
+
+
+HostFunction
+HostCallInterceptor::getFunction(std::string_view name)
+{
+  for (size_t i = 0; i < functionNames.size(); ++i)
+    if (name == functionNames[i])
+      return static_cast<HostFunction>(i);
+
+  throw std::out_of_range("no host implementation of " + std::string(name));
+}
+
+const char *
+HostCallInterceptor::getName(HostFunction function)
+{
+  return functionNames.at(static_cast<size_t>(function));
+}
+
+void
+HostCallInterceptor::intercept(MemAddress entry, HostFunction function)
+{
+  functions[entry] = function;
+}
+
+bool
+HostCallInterceptor::call(MemAddress entry,
+                          const std::array<RegValue, 3> &args,
+                          RegValue &result, uint64_t &cycles,
+                          std::vector<HostAccess> &accesses)
+{
+  const HostFunction function = functions.at(entry);
+  accesses.clear();
+  size_t extent1 = 0, extent2 = 0;
+  uint64_t bytes = 0;
+
+  switch (function)
+    {
+      case HostFunction::memcpy:
+        {
+          const size_t n = args[2];
+          std::byte *dst = memory.getHostPointer(args[0], true, extent1);
+          std::byte *src = memory.getHostPointer(args[1], false, extent2);
+          if (n > 0 && (! dst || ! src || extent1 < n || extent2 < n))
+            return false;
+
+          if (n > 0)
+            {
+              std::memmove(dst, src, n);
+              accesses.push_back({ args[1], n, false });
+              accesses.push_back({ args[0], n, true });
+            }
+          result = args[0];
+          bytes = n;
+          cycles = CallOverhead + 2 * words(n);
+        }
+        break;
+
+      case HostFunction::memset:
+        {
+          const size_t n = args[2];
+          std::byte *dst = memory.getHostPointer(args[0], true, extent1);
+          if (n > 0 && (! dst || extent1 < n))
+            return false;
+
+          if (n > 0)
+            {
+              std::memset(dst, static_cast<int>(args[1] & 0xff), n);
+              accesses.push_back({ args[0], n, true });
+            }
+          result = args[0];
+          bytes = n;
+          cycles = CallOverhead + words(n);
+        }
+        break;
+
+      case HostFunction::strlen:
+        {
+          const std::byte *str = memory.getHostPointer(args[0], false, extent1);
+          if (! str)
+            return false;
+
+          const void *end = std::memchr(str, 0, extent1);
+          if (! end)
+            return false;
+
+          result = static_cast<const std::byte *>(end) - str;
+          bytes = result + 1;
+          accesses.push_back({ args[0], bytes, false });
+          cycles = CallOverhead + bytes;
+        }
+        break;
+
+      case HostFunction::memcmp:
+        {
+          const size_t n = args[2];
+          const auto *a = reinterpret_cast<const uint8_t *>(
+              memory.getHostPointer(args[0], false, extent1));
+          const auto *b = reinterpret_cast<const uint8_t *>(
+              memory.getHostPointer(args[1], false, extent2));
+          if (n > 0 && (! a || ! b || extent1 < n || extent2 < n))
+            return false;
+
+          /* Like newlib, return the difference of the first differing
+           * bytes and charge only for the bytes compared.
+           */
+          result = 0;
+          bytes = n;
+          if (n > 0)
+            {
+              auto [posA, posB] = std::mismatch(a, a + n, b);
+              if (posA != a + n)
+                {
+                  result = static_cast<RegValue>(int32_t{ *posA } - int32_t{ *posB });
+                  bytes = posA - a + 1;
+                }
+              accesses.push_back({ args[0], bytes, false });
+              accesses.push_back({ args[1], bytes, false });
+            }
+          cycles = CallOverhead + 2 * words(bytes);
+        }
+        break;
+
+      default:
+        return false;
+    }
+
+  auto &counter = counters[static_cast<size_t>(function)];
+  ++counter.calls;
+  counter.bytes += bytes;
+
+  return true;
+}
+
+void
+HostCallInterceptor::dumpStatistics(std::ostream &os) const
+{
+  for (size_t i = 0; i < counters.size(); ++i)
+    if (counters[i].calls > 0)
+      os << "Host call " << functionNames[i] << ": "
+         << counters[i].calls << " calls, "
+         << counters[i].bytes << " bytes." << std::endl;
+}
+
+void
+HostCallInterceptor::registerStatistics(StatsRegistry &stats,
+                                        const std::string &prefix) const
+{
+  for (size_t i = 0; i < counters.size(); ++i)
+    {
+      const std::string path = prefix + '.' + functionNames[i];
+      stats.addCounter(path + ".calls", counters[i].calls,
+                       std::string("calls of ") + functionNames[i] +
+                       " run on the host");
+      stats.addCounter(path + ".bytes", counters[i].bytes,
+                       std::string("bytes handled by ") + functionNames[i] +
+                       " on the host");
+    }
+}
@@ -0,0 +1,98 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    host-calls.h - Host implementations of guest library routines.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#ifndef __HOST_CALLS_H__
+#define __HOST_CALLS_H__
+
+#include "arch.h"
+#include "memory-interface.h"
+#include "stats.h"
+
+#include <array>
+#include <ostream>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/* Guest library routines that have a host equivalent. */
+enum class HostFunction
+{
+  memcpy,
+  memset,
+  strlen,
+  memcmp,
+  LAST
+};
+
+/* A range of guest memory that a routine read or wrote. */
+struct HostAccess
+{
+  MemAddress addr;
+  uint64_t size;
+  bool write;
+};
+
+/* Replaces calls to guest library routines by their host equivalents,
+ * which run directly on guest memory. Calls are caught at the entry
+ * point of the routine; the caller then continues at the return address
+ * in r9 with the result in r11, following the OpenRISC calling
+ * convention (arguments in r3 to r5). Instead of the cycles of the guest
+ * code, an estimate of the cycles taken by a word-at-a-time loop is
+ * charged.
+ *
+ * This is meant for functional runs: the routine's instructions are not
+ * executed, so the functional units do not see them. The memory ranges
+ * the routine accessed are returned, for the caller to account for them
+ * on the bus, in the caches and in the reservations.
+ */
+class HostCallInterceptor
+{
+  public:
+    /* Cycles charged for the call and return */
+    static constexpr uint64_t CallOverhead = 10;
+
+    explicit HostCallInterceptor(MemoryInterface &memory)
+      : memory(memory)
+    { }
+
+    /* Throws std::out_of_range for routines without a host equivalent. */
+    static HostFunction getFunction(std::string_view name);
+    static const char *getName(HostFunction function);
+
+    void intercept(MemAddress entry, HostFunction function);
+
+    bool isIntercepted(MemAddress addr) const
+    {
+      return functions.count(addr) > 0;
+    }
+
+    /* Runs the routine at entry with arguments args. Returns false if the
+     * call cannot be done on the host, e.g. because the data is not in
+     * plain memory, in which case the guest code has to run instead.
+     */
+    bool call(MemAddress entry, const std::array<RegValue, 3> &args,
+              RegValue &result, uint64_t &cycles,
+              std::vector<HostAccess> &accesses);
+
+    void dumpStatistics(std::ostream &os) const;
+    void registerStatistics(StatsRegistry &stats,
+                            const std::string &prefix) const;
+
+  private:
+    MemoryInterface &memory;
+    std::unordered_map<MemAddress, HostFunction> functions{};
+
+    /* Statistics */
+    struct Counters
+    {
+      uint64_t calls;
+      uint64_t bytes;
+    };
+    std::array<Counters, static_cast<size_t>(HostFunction::LAST)> counters{};
+};
+
+#endif /* __HOST_CALLS_H__ */
@@ -0,0 +1,243 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    host-profiler.cc - Profiling of the emulator itself on the host.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#include "host-profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+
+/* Without perf_event_open, as with MSVC, only time is measured. */
+#ifndef _MSC_VER
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_RDPMC
+#endif
+#endif
+
+
+static constexpr std::array<const char *, NumHostRegions> regionNames =
+{
+  "IF propagate", "IF clockPulse",
+  "ID propagate", "ID clockPulse",
+  "EX propagate", "EX clockPulse",
+  "MEM propagate", "MEM clockPulse",
+  "WB propagate", "WB clockPulse",
+  "memory bus", "memories", "devices", "other"
+};
+
+#ifndef _MSC_VER
+static int
+openEvent(uint64_t config)
+{
+  perf_event_attr attr{};
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+
+  return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+#endif
+
+HostCounters::HostCounters()
+  : fds{}
+{
+#ifdef _MSC_VER
+  fds.fill(-1);
+#else
+  const std::array<uint64_t, NumEvents> configs =
+    {
+      PERF_COUNT_HW_CPU_CYCLES,
+      PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_MISSES
+    };
+
+  for (size_t e = 0; e < NumEvents; ++e)
+    fds[e] = openEvent(configs[e]);
+
+  /* Without a cycle counter, time is used instead. */
+  if (fds[Cycles] < 0)
+    for (int &fd : fds)
+      if (fd >= 0)
+        {
+          close(fd);
+          fd = -1;
+        }
+
+  /* The first page of the mapping tells how to read the counter with
+   * rdpmc, if allowed.
+   */
+  for (size_t e = 0; e < NumEvents; ++e)
+    if (fds[e] >= 0)
+      {
+        void *page = mmap(nullptr, sysconf(_SC_PAGESIZE), PROT_READ,
+                          MAP_SHARED, fds[e], 0);
+        if (page != MAP_FAILED)
+          pages[e] = page;
+      }
+#endif
+}
+
+HostCounters::~HostCounters()
+{
+#ifndef _MSC_VER
+  for (size_t e = 0; e < NumEvents; ++e)
+    {
+      if (pages[e])
+        munmap(pages[e], sysconf(_SC_PAGESIZE));
+      if (fds[e] >= 0)
+        close(fds[e]);
+    }
+#endif
+}
+
+void
+HostCounters::read(Values &values) const
+{
+  for (size_t e = 0; e < NumEvents; ++e)
+    values[e] = readEvent(static_cast<Event>(e));
+}
+
+uint64_t
+HostCounters::readEvent(Event event) const
+{
+  if (fds[event] < 0)
+    {
+      if (event != Cycles)
+        return 0;
+#ifdef HAVE_RDPMC
+      return __rdtsc();
+#else
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+#ifdef HAVE_RDPMC
+  if (pages[event])
+    {
+      const volatile auto *page =
+          static_cast<const volatile perf_event_mmap_page *>(pages[event]);
+
+      uint32_t sequence;
+      uint64_t count;
+      bool valid;
+      do
+        {
+          sequence = page->lock;
+          std::atomic_signal_fence(std::memory_order_seq_cst);
+
+          const uint32_t index = page->index;
+          valid = page->cap_user_rdpmc && index != 0;
+          if (valid)
+            {
+              const unsigned int width = page->pmc_width;
+              int64_t pmc = __rdpmc(index - 1);
+              pmc <<= 64 - width;
+              pmc >>= 64 - width;
+              count = page->offset + pmc;
+            }
+
+          std::atomic_signal_fence(std::memory_order_seq_cst);
+        }
+      while (page->lock != sequence);
+
+      if (valid)
+        return count;
+    }
+#endif
+
+  uint64_t value{};
+#ifndef _MSC_VER
+  if (::read(fds[event], &value, sizeof(value)) != sizeof(value))
+    return 0;
+#endif
+  return value;
+}
+
+
+void
+HostProfiler::resume()
+{
+  if (! counters)
+    counters = std::make_unique<HostCounters>();
+
+  counters->read(last);
+  resumed = std::chrono::steady_clock::now();
+}
+
+void
+HostProfiler::pause()
+{
+  charge();
+  elapsed += std::chrono::steady_clock::now() - resumed;
+}
+
+void
+HostProfiler::charge()
+{
+  HostCounters::Values now;
+  counters->read(now);
+
+  HostCounters::Values &total = totals[static_cast<size_t>(stack.back())];
+  for (size_t e = 0; e < HostCounters::NumEvents; ++e)
+    total[e] += now[e] - last[e];
+  last = now;
+}
+
+void
+HostProfiler::report(std::ostream &os, uint64_t instructions) const
+{
+  if (! counters)
+    return;
+
+  HostCounters::Values sum{};
+  for (const auto &total : totals)
+    for (size_t e = 0; e < HostCounters::NumEvents; ++e)
+      sum[e] += total[e];
+
+  const double nsPerInstruction =
+      std::chrono::duration<double, std::nano>(elapsed).count() /
+      std::max<uint64_t>(instructions, 1);
+
+  const auto flags = os.flags();
+  const char fill = os.fill(' ');
+
+  const bool perf = counters->hasPerformanceCounters();
+  os << "Host profile (" << (perf ? "perf_event_open" : "time stamp counter")
+     << "): " << std::fixed << std::setprecision(1) << nsPerInstruction
+     << " host ns per simulated instruction." << std::endl
+     << std::setw(16) << "region"
+     << std::setw(16) << (perf ? "cycles" : "ticks");
+  if (perf)
+    os << std::setw(16) << "instructions" << std::setw(14) << "cache misses";
+  os << std::setw(8) << "share" << std::setw(10) << "ns/instr" << std::endl;
+
+  for (size_t r = 0; r < NumHostRegions; ++r)
+    {
+      const auto &total = totals[r];
+      const double share = sum[0] ? double(total[0]) / sum[0] : 0.0;
+
+      os << std::setw(16) << regionNames[r] << std::setw(16) << total[0];
+      if (perf)
+        os << std::setw(16) << total[HostCounters::Instructions]
+           << std::setw(14) << total[HostCounters::CacheMisses];
+      os << std::setw(7) << share * 100 << '%'
+         << std::setw(10) << share * nsPerInstruction << std::endl;
+    }
+
+  os.flags(flags);
+  os.fill(fill);
+}
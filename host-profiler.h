@@ -0,0 +1,176 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    host-profiler.h - Profiling of the emulator itself on the host.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#ifndef __HOST_PROFILER_H__
+#define __HOST_PROFILER_H__
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+/* Parts of the emulator that host time is attributed to. Stages are in
+ * pipeline order, each with propagate followed by clockPulse. Time
+ * spent in the memory bus is not counted for the stage that accessed
+ * it, and time in the clients not for the bus.
+ */
+enum class HostRegion
+{
+  IFPropagate, IFClockPulse,
+  IDPropagate, IDClockPulse,
+  EXPropagate, EXClockPulse,
+  MEMPropagate, MEMClockPulse,
+  WBPropagate, WBClockPulse,
+  bus,              /* dispatch to the clients */
+  memory,           /* memories, including byte swapping */
+  devices,
+  other,            /* the rest of the simulation loop */
+  LAST
+};
+
+constexpr size_t NumHostRegions = static_cast<size_t>(HostRegion::LAST);
+
+inline HostRegion
+getStageRegion(size_t stage, bool clockPulse)
+{
+  return static_cast<HostRegion>(2 * stage + clockPulse);
+}
+
+/* Host cycles, instructions and cache misses of the calling thread,
+ * read from the performance monitoring counters through perf_event_open
+ * and, where the kernel allows, the rdpmc instruction. When the counters
+ * are not available, only time is measured with the time stamp counter
+ * (or the steady clock).
+ */
+class HostCounters
+{
+  public:
+    enum Event { Cycles, Instructions, CacheMisses, NumEvents };
+    using Values = std::array<uint64_t, NumEvents>;
+
+    HostCounters();
+    ~HostCounters();
+
+    HostCounters(const HostCounters &) = delete;
+    HostCounters &operator=(const HostCounters &) = delete;
+
+    /* Whether the hardware counters are used, or only time. */
+    bool hasPerformanceCounters() const { return fds[Cycles] >= 0; }
+    bool hasEvent(Event event) const { return fds[event] >= 0 || event == Cycles; }
+
+    void read(Values &values) const;
+
+  private:
+    std::array<int, NumEvents> fds;
+    std::array<void *, NumEvents> pages{};
+
+    uint64_t readEvent(Event event) const;
+};
+
+/* Attributes the host events between two transitions to the innermost
+ * region that is active. A transition costs one read of the counters,
+ * so the instrumented emulator runs slower, but the shares of the
+ * regions remain representative.
+ */
+class HostProfiler
+{
+  public:
+    HostProfiler() = default;
+
+    HostProfiler(const HostProfiler &) = delete;
+    HostProfiler &operator=(const HostProfiler &) = delete;
+
+    void enter(HostRegion region)
+    {
+      charge();
+      stack.push_back(region);
+    }
+
+    void leave()
+    {
+      charge();
+      stack.pop_back();
+    }
+
+    /* Only time between resume and pause is profiled, which excludes
+     * the time a core waits for the others in a multi-core system.
+     */
+    void resume();
+    void pause();
+
+    /* Results with host nanoseconds per simulated instruction. */
+    void report(std::ostream &os, uint64_t instructions) const;
+
+  private:
+    /* The counters count the thread that opens them, which is the
+     * thread running the simulation of this core only once it has
+     * started.
+     */
+    std::unique_ptr<HostCounters> counters{};
+    HostCounters::Values last{};
+    std::vector<HostRegion> stack{ HostRegion::other };
+    std::array<HostCounters::Values, NumHostRegions> totals{};
+
+    std::chrono::steady_clock::time_point resumed{};
+    std::chrono::steady_clock::duration elapsed{};
+
+    void charge();
+};
+
+/* Attributes the enclosing block to region, when profiling. */
+class HostProfileScope
+{
+  public:
+    HostProfileScope(HostProfiler *profiler, HostRegion region)
+      : profiler(profiler)
+    {
+      if (profiler)
+        profiler->enter(region);
+    }
+
+    ~HostProfileScope()
+    {
+      if (profiler)
+        profiler->leave();
+    }
+
+    HostProfileScope(const HostProfileScope &) = delete;
+    HostProfileScope &operator=(const HostProfileScope &) = delete;
+
+  private:
+    HostProfiler *profiler;
+};
+
+/* Profiles the enclosing block, a slice of the simulation, when
+ * profiling.
+ */
+class HostProfileSlice
+{
+  public:
+    explicit HostProfileSlice(HostProfiler *profiler)
+      : profiler(profiler)
+    {
+      if (profiler)
+        profiler->resume();
+    }
+
+    ~HostProfileSlice()
+    {
+      if (profiler)
+        profiler->pause();
+    }
+
+    HostProfileSlice(const HostProfileSlice &) = delete;
+    HostProfileSlice &operator=(const HostProfileSlice &) = delete;
+
+  private:
+    HostProfiler *profiler;
+};
+
+#endif /* __HOST_PROFILER_H__ */
@@ -168,6 +168,10 @@ opcode InstructionDecoder::getOpcode() const
       return opcode::MACI;
     case 6: // 0x6
       return opcode::MACRC;
+    case 50: // 0x32
+      return opcode::FLOAT;
+    case 10: // 0xa
+      return opcode::VECTOR;
     case 45: // 0x2d
       return opcode::MFSPR;
     case 48: // 0x30
@@ -265,6 +269,55 @@ InstructionDecoder::getOpcode2() const
         return opcode2::ROR;
     }
   }
+  else if (opcode == opcode::MAC)
+  {
+    switch (selectBits32_8(instructionWord, 0, 3, 0))
+    {
+      case 1: // 0x1
+        return opcode2::MAC;
+      case 2: // 0x2
+        return opcode2::MSB;
+      case 3: // 0x3
+        return opcode2::MACU;
+      case 4: // 0x4
+        return opcode2::MSBU;
+    }
+  }
+  else if (opcode == opcode::FLOAT)
+  {
+    switch (selectBits32_8(instructionWord, 0, 7, 0))
+    {
+      case 0: // 0x0
+        return opcode2::ADDS;
+      case 1: // 0x1
+        return opcode2::SUBS;
+      case 2: // 0x2
+        return opcode2::MULS;
+      case 3: // 0x3
+        return opcode2::DIVS;
+      case 4: // 0x4
+        return opcode2::ITOFS;
+      case 5: // 0x5
+        return opcode2::FTOIS;
+      case 6: // 0x6
+        return opcode2::REMS;
+      case 7: // 0x7
+        return opcode2::MADDS;
+      case 8: // 0x8
+        return opcode2::SFEQS;
+      case 9: // 0x9
+        return opcode2::SFNES;
+      case 10: // 0xa
+        return opcode2::SFGTS;
+      case 11: // 0xb
+        return opcode2::SFGES;
+      case 12: // 0xc
+        return opcode2::SFLTS;
+      case 13: // 0xd
+        return opcode2::SFLES;
+    }
+    throw IllegalInstruction{"Illegal or unsupported floating-point opcode."};
+  }
   else if (opcode == opcode::MACRC)
   {
     if (selectBits32_8(instructionWord, 16, 16, 0) == 0)
@@ -411,6 +464,20 @@ InstructionDecoder::getInstructionType() const
     case opcode::ORI:
     case opcode::XORI:
       return InstructionType::typeI;
+
+    // typeR instructions without opcode 3
+    case opcode::MAC:
+    case opcode::FLOAT:
+    case opcode::VECTOR:
+    case opcode::CUST1:
+    case opcode::CUST2:
+    case opcode::CUST3:
+    case opcode::CUST4:
+    case opcode::CUST5:
+    case opcode::CUST6:
+    case opcode::CUST7:
+    case opcode::CUST8:
+      return InstructionType::typeR;
     
     // typeS instructions
     case opcode::MTSPR:
@@ -431,6 +498,7 @@ InstructionDecoder::getInstructionType() const
     // case opcode::ADRP:
     case opcode::MACI:
     case opcode::NOP:
+    case opcode::RFE:
     case opcode::SYS:
     case opcode::TRAP:
       return InstructionType::NOTYPE;
@@ -563,3 +631,22 @@ InstructionDecoder::getImmediate() const
 }
 
 #pragma GCC diagnostic pop
+
+// get the operation of an ORVDX64 vector instruction
+VectorOp
+InstructionDecoder::getVectorOp() const
+{
+  if (getOpcode() != opcode::VECTOR)
+    return VectorOp::none;
+
+  /* Opcodes in the gaps are not implemented */
+  const uint32_t op = selectBits32_8(instructionWord, 0, 7, 0);
+  if ((op >= 0x10 && op <= 0x1b) || (op >= 0x20 && op <= 0x2b) ||
+      (op >= 0x30 && op <= 0x3a) || (op >= 0x40 && op <= 0x4b) ||
+      op == 0x55 || op == 0x56 || op == 0x59 || op == 0x5a ||
+      (op >= 0x5c && op <= 0x5f) || (op >= 0x69 && op <= 0x78) ||
+      op == 0x7b)
+    return static_cast<VectorOp>(op);
+
+  throw IllegalInstruction{"Illegal or unsupported vector opcode."};
+}
@@ -273,6 +273,8 @@ enum class opcode
   LBZ = 0x23,
   LD = 0x20,
   LF = 0x1a,
+  FLOAT = 0x32,
+  VECTOR = 0xa,
   LHS = 0x26,
   LHZ = 0x25,
   LWA = 0x1b,
@@ -343,7 +345,22 @@ enum class opcode2
   SRLI, // SRLI -> Shift Right Logical with Immediate (opcode2 0x1)
 
   MACRC, // 0x6 MAC Read and Clear (opcode2 0x10000)
-  MOVHI // MOVHI -> Move Immediate High (opcode2 0x0)
+  MOVHI, // MOVHI -> Move Immediate High (opcode2 0x0)
+
+  ADDS,  // 0x32 lf.add.s Add Floating-Point Single (opcode2 0x0)
+  SUBS,  // lf.sub.s Subtract Floating-Point Single (opcode2 0x1)
+  MULS,  // lf.mul.s Multiply Floating-Point Single (opcode2 0x2)
+  DIVS,  // lf.div.s Divide Floating-Point Single (opcode2 0x3)
+  ITOFS, // lf.itof.s Integer To Floating-Point Single (opcode2 0x4)
+  FTOIS, // lf.ftoi.s Floating-Point Single To Integer (opcode2 0x5)
+  REMS,  // lf.rem.s Remainder Floating-Point Single (opcode2 0x6)
+  MADDS, // lf.madd.s Multiply and Add Floating-Point Single (opcode2 0x7)
+  SFEQS, // lf.sfeq.s Set Flag if Equal (opcode2 0x8)
+  SFNES, // lf.sfne.s Set Flag if Not Equal (opcode2 0x9)
+  SFGTS, // lf.sfgt.s Set Flag if Greater Than (opcode2 0xa)
+  SFGES, // lf.sfge.s Set Flag if Greater or Equal (opcode2 0xb)
+  SFLTS, // lf.sflt.s Set Flag if Less Than (opcode2 0xc)
+  SFLES  // lf.sfle.s Set Flag if Less or Equal (opcode2 0xd)
 };
 
 
@@ -397,9 +414,93 @@ enum class ALUOp
   JUMP,
   MOVHI,
   SLL,
+  MUL,
+  MULU,
+  DIV,
+  DIVU,
   NOP
 };
 
+/* Operations of the multiply-accumulate unit on its accumulator */
+enum class MACOp
+{
+  none,
+  MAC,    // accumulator += A * B (signed)
+  MACU,   // accumulator += A * B (unsigned)
+  MSB,    // accumulator -= A * B (signed)
+  MSBU,   // accumulator -= A * B (unsigned)
+  MULD,   // accumulator = A * B (signed)
+  MULDU,  // accumulator = A * B (unsigned)
+  MACRC   // read the low word and clear the accumulator
+};
+
+/* ORVDX64 vector instructions (major opcode 0xa), by their opcode in
+ * bits 7:0. Lane-wise operations on byte (.b) or halfword (.h) lanes.
+ */
+enum class VectorOp
+{
+  ALL_EQ_B = 0x10, ALL_EQ_H = 0x11,
+  ALL_GE_B = 0x12, ALL_GE_H = 0x13,
+  ALL_GT_B = 0x14, ALL_GT_H = 0x15,
+  ALL_LE_B = 0x16, ALL_LE_H = 0x17,
+  ALL_LT_B = 0x18, ALL_LT_H = 0x19,
+  ALL_NE_B = 0x1a, ALL_NE_H = 0x1b,
+  ANY_EQ_B = 0x20, ANY_EQ_H = 0x21,
+  ANY_GE_B = 0x22, ANY_GE_H = 0x23,
+  ANY_GT_B = 0x24, ANY_GT_H = 0x25,
+  ANY_LE_B = 0x26, ANY_LE_H = 0x27,
+  ANY_LT_B = 0x28, ANY_LT_H = 0x29,
+  ANY_NE_B = 0x2a, ANY_NE_H = 0x2b,
+  ADD_B = 0x30, ADD_H = 0x31,
+  ADDS_B = 0x32, ADDS_H = 0x33,     // signed saturating
+  ADDU_B = 0x34, ADDU_H = 0x35,
+  ADDUS_B = 0x36, ADDUS_H = 0x37,   // unsigned saturating
+  AND = 0x38,
+  AVG_B = 0x39, AVG_H = 0x3a,
+  CMP_EQ_B = 0x40, CMP_EQ_H = 0x41,
+  CMP_GE_B = 0x42, CMP_GE_H = 0x43,
+  CMP_GT_B = 0x44, CMP_GT_H = 0x45,
+  CMP_LE_B = 0x46, CMP_LE_H = 0x47,
+  CMP_LT_B = 0x48, CMP_LT_H = 0x49,
+  CMP_NE_B = 0x4a, CMP_NE_H = 0x4b,
+  MAX_B = 0x55, MAX_H = 0x56,
+  MIN_B = 0x59, MIN_H = 0x5a,
+  MULS_H = 0x5c,                    // signed saturating
+  NAND = 0x5d,
+  NOR = 0x5e,
+  OR = 0x5f,
+  SLL_B = 0x69, SLL_H = 0x6a, SLL = 0x6b,
+  SRL_B = 0x6c, SRL_H = 0x6d,
+  SRA_B = 0x6e, SRA_H = 0x6f,
+  SRL = 0x70,
+  SUB_B = 0x71, SUB_H = 0x72,
+  SUBS_B = 0x73, SUBS_H = 0x74,
+  SUBU_B = 0x75, SUBU_H = 0x76,
+  SUBUS_B = 0x77, SUBUS_H = 0x78,
+  XOR = 0x7b,
+  none = 0x100
+};
+
+/* Operations of the floating-point unit */
+enum class FPUOp
+{
+  none,
+  ADD,
+  SUB,
+  MUL,
+  DIV,
+  REM,
+  MADD,
+  ITOF,
+  FTOI,
+  SFEQ,
+  SFNE,
+  SFGT,
+  SFGE,
+  SFLT,
+  SFLE
+};
+
 // enum class  InstructionType {typeR = 'R', typeI = 'I', typeS = 'S', typeSH = 'H', typeJ = 'J', typeF = 'F', NOTYPE = 'N'};
 enum class  InstructionType {typeR, typeI, typeS, typeSH, typeJ, typeF, NOTYPE};
 
@@ -434,6 +535,7 @@ class InstructionDecoder
     opcode3             getOpcode3() const; // get the opcode3 where it apllied
     InstructionType     getInstructionType() const;
     int32_t             getImmediate() const;
+    VectorOp            getVectorOp() const;  // lv.* operation, or none
 
   private:
     uint32_t instructionWord;
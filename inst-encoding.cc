@@ -0,0 +1,252 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    inst-encoding.cc - Instruction encodings by mnemonic.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#include "inst-encoding.h"
+#include "vector-unit.h"
+
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+
+/* The opcodes are those of the decoder, so that both agree. Most have
+ * the opcode in bits 31:26, the set-flag instructions in bits 31:21 and
+ * l.sys and l.trap in bits 31:16.
+ */
+static constexpr uint32_t
+major(opcode op)
+{
+  return static_cast<uint32_t>(op) << 26;
+}
+
+static constexpr uint32_t
+setFlag(opcode op)
+{
+  return static_cast<uint32_t>(op) << 21;
+}
+
+static constexpr uint32_t
+upperHalf(opcode op)
+{
+  return static_cast<uint32_t>(op) << 16;
+}
+
+/* The operations of major opcode ADD are selected by bits 9:6 and 3:0,
+ * which the decoder reads into opcode2 and opcode3.
+ */
+static constexpr uint32_t
+function(uint32_t bits9to6, uint32_t bits3to0)
+{
+  return major(opcode::ADD) | bits9to6 << 6 | bits3to0;
+}
+
+/* Each entry names what the decoder makes of it, which findEncoding()
+ * checks. Instructions the decoder knows but the control signals cannot
+ * execute, such as l.and, l.srl, l.ext* and most set-flag instructions
+ * with an immediate, are left out, so that the assembler rejects them.
+ */
+static const InstructionEncoding encodings[] =
+{
+  { "l.add",   OperandFormat::DAB, function(0x0, 0x0), opcode::ADD,
+    opcode2::ADD, opcode3::ADD },
+  { "l.sub",   OperandFormat::DAB, function(0x0, 0x2), opcode::ADD,
+    opcode2::ADD, opcode3::SUB },
+  { "l.or",    OperandFormat::DAB, function(0x0, 0x4), opcode::ADD,
+    opcode2::ADD, opcode3::OR },
+  { "l.sll",   OperandFormat::DAB, function(0x0, 0x8), opcode::ADD,
+    opcode2::SLL, opcode3::SLL },
+  { "l.sra",   OperandFormat::DAB, function(0x2, 0x8), opcode::ADD,
+    opcode2::EXTHZ, opcode3::SRA },
+  { "l.mul",   OperandFormat::DAB, function(0xc, 0x6), opcode::ADD,
+    opcode2::DIV, opcode3::MUL },
+  { "l.muld",  OperandFormat::AB,  function(0xc, 0x7), opcode::ADD,
+    opcode2::DIV, opcode3::MULD },
+  { "l.div",   OperandFormat::DAB, function(0xc, 0x9), opcode::ADD,
+    opcode2::DIV, opcode3::DIV },
+  { "l.divu",  OperandFormat::DAB, function(0xc, 0xa), opcode::ADD,
+    opcode2::DIV, opcode3::DIVU },
+  { "l.mulu",  OperandFormat::DAB, function(0xc, 0xb), opcode::ADD,
+    opcode2::DIV, opcode3::MULU },
+  { "l.muldu", OperandFormat::AB,  function(0xc, 0xc), opcode::ADD,
+    opcode2::DIV, opcode3::MULDU },
+
+  { "l.addi",  OperandFormat::DAI, major(opcode::ADDI), opcode::ADDI },
+  { "l.ori",   OperandFormat::DAI, major(opcode::ORI), opcode::ORI },
+  { "l.muli",  OperandFormat::DAI, major(opcode::MULI), opcode::MULI },
+  { "l.mfspr", OperandFormat::DAI, major(opcode::MFSPR), opcode::MFSPR },
+  { "l.mtspr", OperandFormat::ABK, major(opcode::MTSPR), opcode::MTSPR },
+
+  { "l.movhi", OperandFormat::DK, major(opcode::MACRC), opcode::MACRC,
+    opcode2::MOVHI },
+  { "l.macrc", OperandFormat::D,  major(opcode::MACRC) | 0x10000,
+    opcode::MACRC, opcode2::MACRC },
+  { "l.mac",   OperandFormat::AB, major(opcode::MAC) | 0x1, opcode::MAC,
+    opcode2::MAC },
+  { "l.msb",   OperandFormat::AB, major(opcode::MAC) | 0x2, opcode::MAC,
+    opcode2::MSB },
+  { "l.macu",  OperandFormat::AB, major(opcode::MAC) | 0x3, opcode::MAC,
+    opcode2::MACU },
+  { "l.msbu",  OperandFormat::AB, major(opcode::MAC) | 0x4, opcode::MAC,
+    opcode2::MSBU },
+  { "l.maci",  OperandFormat::AI, major(opcode::MACI), opcode::MACI },
+
+  { "l.lwz",   OperandFormat::load, major(opcode::LWZ), opcode::LWZ },
+  { "l.lbz",   OperandFormat::load, major(opcode::LBZ), opcode::LBZ },
+  { "l.lbs",   OperandFormat::load, major(opcode::LBS), opcode::LBS },
+  { "l.lwa",   OperandFormat::load, major(opcode::LWA), opcode::LWA },
+  { "l.sw",    OperandFormat::store, major(opcode::SW), opcode::SW },
+  { "l.sb",    OperandFormat::store, major(opcode::SB), opcode::SB },
+  { "l.swa",   OperandFormat::store, major(opcode::SWA), opcode::SWA },
+
+  { "l.j",     OperandFormat::target, major(opcode::J), opcode::J },
+  { "l.jal",   OperandFormat::target, major(opcode::JAL), opcode::JAL },
+  { "l.bnf",   OperandFormat::target, major(opcode::BNF), opcode::BNF },
+  { "l.bf",    OperandFormat::target, major(opcode::BF), opcode::BF },
+  { "l.jr",    OperandFormat::B, major(opcode::JR), opcode::JR },
+  { "l.jalr",  OperandFormat::B, major(opcode::JALR), opcode::JALR },
+
+  { "l.sfeq",   OperandFormat::AB, setFlag(opcode::SFEQ), opcode::SFEQ },
+  { "l.sfne",   OperandFormat::AB, setFlag(opcode::SFNE), opcode::SFNE },
+  { "l.sfges",  OperandFormat::AB, setFlag(opcode::SFGES), opcode::SFGES },
+  { "l.sfles",  OperandFormat::AB, setFlag(opcode::SFLES), opcode::SFLES },
+
+  { "l.nop",   OperandFormat::K, static_cast<uint32_t>(opcode::NOP) << 24, opcode::NOP },
+  { "l.sys",   OperandFormat::K, upperHalf(opcode::SYS), opcode::SYS },
+  { "l.trap",  OperandFormat::K, upperHalf(opcode::TRAP), opcode::TRAP },
+  { "l.rfe",   OperandFormat::none, major(opcode::RFE), opcode::RFE },
+
+  { "l.cust1", OperandFormat::DAB, major(opcode::CUST1), opcode::CUST1 },
+  { "l.cust2", OperandFormat::DAB, major(opcode::CUST2), opcode::CUST2 },
+  { "l.cust3", OperandFormat::DAB, major(opcode::CUST3), opcode::CUST3 },
+  { "l.cust4", OperandFormat::DAB, major(opcode::CUST4), opcode::CUST4 },
+  { "l.cust5", OperandFormat::DAB, major(opcode::CUST5), opcode::CUST5 },
+  { "l.cust6", OperandFormat::DAB, major(opcode::CUST6), opcode::CUST6 },
+  { "l.cust7", OperandFormat::DAB, major(opcode::CUST7), opcode::CUST7 },
+  { "l.cust8", OperandFormat::DAB, major(opcode::CUST8), opcode::CUST8 },
+
+  /* Floating-point operations, selected by bits 7:0 */
+  { "lf.add.s",  OperandFormat::DAB, major(opcode::FLOAT) | 0x0, opcode::FLOAT,
+    opcode2::ADDS },
+  { "lf.sub.s",  OperandFormat::DAB, major(opcode::FLOAT) | 0x1, opcode::FLOAT,
+    opcode2::SUBS },
+  { "lf.mul.s",  OperandFormat::DAB, major(opcode::FLOAT) | 0x2, opcode::FLOAT,
+    opcode2::MULS },
+  { "lf.div.s",  OperandFormat::DAB, major(opcode::FLOAT) | 0x3, opcode::FLOAT,
+    opcode2::DIVS },
+  { "lf.itof.s", OperandFormat::DA,  major(opcode::FLOAT) | 0x4, opcode::FLOAT,
+    opcode2::ITOFS },
+  { "lf.ftoi.s", OperandFormat::DA,  major(opcode::FLOAT) | 0x5, opcode::FLOAT,
+    opcode2::FTOIS },
+  { "lf.rem.s",  OperandFormat::DAB, major(opcode::FLOAT) | 0x6, opcode::FLOAT,
+    opcode2::REMS },
+  { "lf.madd.s", OperandFormat::DAB, major(opcode::FLOAT) | 0x7, opcode::FLOAT,
+    opcode2::MADDS },
+  { "lf.sfeq.s", OperandFormat::AB,  major(opcode::FLOAT) | 0x8, opcode::FLOAT,
+    opcode2::SFEQS },
+  { "lf.sfne.s", OperandFormat::AB,  major(opcode::FLOAT) | 0x9, opcode::FLOAT,
+    opcode2::SFNES },
+  { "lf.sfgt.s", OperandFormat::AB,  major(opcode::FLOAT) | 0xa, opcode::FLOAT,
+    opcode2::SFGTS },
+  { "lf.sfge.s", OperandFormat::AB,  major(opcode::FLOAT) | 0xb, opcode::FLOAT,
+    opcode2::SFGES },
+  { "lf.sflt.s", OperandFormat::AB,  major(opcode::FLOAT) | 0xc, opcode::FLOAT,
+    opcode2::SFLTS },
+  { "lf.sfle.s", OperandFormat::AB,  major(opcode::FLOAT) | 0xd, opcode::FLOAT,
+    opcode2::SFLES },
+};
+
+static const std::pair<VectorOp, const char *> vectorMnemonics[] =
+{
+  { VectorOp::ALL_EQ_B, "lv.all_eq.b" }, { VectorOp::ALL_EQ_H, "lv.all_eq.h" },
+  { VectorOp::ALL_GE_B, "lv.all_ge.b" }, { VectorOp::ALL_GE_H, "lv.all_ge.h" },
+  { VectorOp::ALL_GT_B, "lv.all_gt.b" }, { VectorOp::ALL_GT_H, "lv.all_gt.h" },
+  { VectorOp::ALL_LE_B, "lv.all_le.b" }, { VectorOp::ALL_LE_H, "lv.all_le.h" },
+  { VectorOp::ALL_LT_B, "lv.all_lt.b" }, { VectorOp::ALL_LT_H, "lv.all_lt.h" },
+  { VectorOp::ALL_NE_B, "lv.all_ne.b" }, { VectorOp::ALL_NE_H, "lv.all_ne.h" },
+  { VectorOp::ANY_EQ_B, "lv.any_eq.b" }, { VectorOp::ANY_EQ_H, "lv.any_eq.h" },
+  { VectorOp::ANY_GE_B, "lv.any_ge.b" }, { VectorOp::ANY_GE_H, "lv.any_ge.h" },
+  { VectorOp::ANY_GT_B, "lv.any_gt.b" }, { VectorOp::ANY_GT_H, "lv.any_gt.h" },
+  { VectorOp::ANY_LE_B, "lv.any_le.b" }, { VectorOp::ANY_LE_H, "lv.any_le.h" },
+  { VectorOp::ANY_LT_B, "lv.any_lt.b" }, { VectorOp::ANY_LT_H, "lv.any_lt.h" },
+  { VectorOp::ANY_NE_B, "lv.any_ne.b" }, { VectorOp::ANY_NE_H, "lv.any_ne.h" },
+  { VectorOp::ADD_B, "lv.add.b" }, { VectorOp::ADD_H, "lv.add.h" },
+  { VectorOp::ADDS_B, "lv.adds.b" }, { VectorOp::ADDS_H, "lv.adds.h" },
+  { VectorOp::ADDU_B, "lv.addu.b" }, { VectorOp::ADDU_H, "lv.addu.h" },
+  { VectorOp::ADDUS_B, "lv.addus.b" }, { VectorOp::ADDUS_H, "lv.addus.h" },
+  { VectorOp::AND, "lv.and" },
+  { VectorOp::AVG_B, "lv.avg.b" }, { VectorOp::AVG_H, "lv.avg.h" },
+  { VectorOp::CMP_EQ_B, "lv.cmp_eq.b" }, { VectorOp::CMP_EQ_H, "lv.cmp_eq.h" },
+  { VectorOp::CMP_GE_B, "lv.cmp_ge.b" }, { VectorOp::CMP_GE_H, "lv.cmp_ge.h" },
+  { VectorOp::CMP_GT_B, "lv.cmp_gt.b" }, { VectorOp::CMP_GT_H, "lv.cmp_gt.h" },
+  { VectorOp::CMP_LE_B, "lv.cmp_le.b" }, { VectorOp::CMP_LE_H, "lv.cmp_le.h" },
+  { VectorOp::CMP_LT_B, "lv.cmp_lt.b" }, { VectorOp::CMP_LT_H, "lv.cmp_lt.h" },
+  { VectorOp::CMP_NE_B, "lv.cmp_ne.b" }, { VectorOp::CMP_NE_H, "lv.cmp_ne.h" },
+  { VectorOp::MAX_B, "lv.max.b" }, { VectorOp::MAX_H, "lv.max.h" },
+  { VectorOp::MIN_B, "lv.min.b" }, { VectorOp::MIN_H, "lv.min.h" },
+  { VectorOp::MULS_H, "lv.muls.h" },
+  { VectorOp::NAND, "lv.nand" },
+  { VectorOp::NOR, "lv.nor" },
+  { VectorOp::OR, "lv.or" },
+  { VectorOp::SLL_B, "lv.sll.b" }, { VectorOp::SLL_H, "lv.sll.h" },
+  { VectorOp::SLL, "lv.sll" },
+  { VectorOp::SRL_B, "lv.srl.b" }, { VectorOp::SRL_H, "lv.srl.h" },
+  { VectorOp::SRA_B, "lv.sra.b" }, { VectorOp::SRA_H, "lv.sra.h" },
+  { VectorOp::SRL, "lv.srl" },
+  { VectorOp::SUB_B, "lv.sub.b" }, { VectorOp::SUB_H, "lv.sub.h" },
+  { VectorOp::SUBS_B, "lv.subs.b" }, { VectorOp::SUBS_H, "lv.subs.h" },
+  { VectorOp::SUBU_B, "lv.subu.b" }, { VectorOp::SUBU_H, "lv.subu.h" },
+  { VectorOp::SUBUS_B, "lv.subus.b" }, { VectorOp::SUBUS_H, "lv.subus.h" },
+  { VectorOp::XOR, "lv.xor" },
+};
+
+
+const InstructionEncoding *
+findEncoding(const std::string &mnemonic)
+{
+  /* The vector instructions are added from their mnemonics, with their
+   * operation in bits 7:0.
+   */
+  static const auto table = []
+    {
+      static std::vector<InstructionEncoding> vector;
+      for (const auto &[op, name] : vectorMnemonics)
+        vector.push_back({ name,
+                           VectorUnit::isCompare(op) ? OperandFormat::AB
+                                                     : OperandFormat::DAB,
+                           major(opcode::VECTOR) | static_cast<uint32_t>(op),
+                           opcode::VECTOR });
+
+      std::unordered_map<std::string, const InstructionEncoding *> table;
+      InstructionDecoder decoder;
+      for (const auto &encoding : encodings)
+        {
+          decoder.setInstructionWord(encoding.match);
+          if (decoder.getOpcode() != encoding.op ||
+              decoder.getOpcode2() != encoding.op2 ||
+              decoder.getOpcode3() != encoding.op3)
+            throw std::logic_error(std::string("encoding of ") +
+                                   encoding.mnemonic +
+                                   " disagrees with the decoder");
+          table.emplace(encoding.mnemonic, &encoding);
+        }
+      for (const auto &encoding : vector)
+        table.emplace(encoding.mnemonic, &encoding);
+      return table;
+    }();
+
+  auto it = table.find(mnemonic);
+  return it != table.end() ? it->second : nullptr;
+}
+
+const char *
+getVectorMnemonic(VectorOp op)
+{
+  for (const auto &[vectorOp, name] : vectorMnemonics)
+    if (vectorOp == op)
+      return name;
+  return "lv.?";
+}
@@ -0,0 +1,57 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    inst-encoding.h - Instruction encodings by mnemonic.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#ifndef __INST_ENCODING_H__
+#define __INST_ENCODING_H__
+
+#include "inst-decoder.h"
+
+#include <string>
+
+/* The operands of an instruction in assembly syntax, which determines
+ * the fields they are encoded in. I is a signed and K an unsigned 16-bit
+ * immediate, L a 6-bit shift amount and N a 26-bit word offset from the
+ * PC.
+ */
+enum class OperandFormat
+{
+  none,
+  DAB,          /* rD, rA, rB */
+  DA,           /* rD, rA */
+  AB,           /* rA, rB */
+  B,            /* rB */
+  D,            /* rD */
+  DAI,          /* rD, rA, I */
+  DK,           /* rD, K */
+  AI,           /* rA, I */
+  DAL,          /* rD, rA, L */
+  ABK,          /* rA, rB, K with K split as for stores */
+  load,         /* rD, I(rA) */
+  store,        /* I(rA), rB */
+  target,       /* N */
+  K             /* K */
+};
+
+struct InstructionEncoding
+{
+  const char *mnemonic;
+  OperandFormat format;
+  uint32_t match;       /* the instruction word with all operands zero */
+  opcode op;            /* what the decoder makes of it */
+  opcode2 op2{};
+  opcode3 op3{};
+};
+
+/* The encoding of mnemonic, or nullptr if it is not supported. Only the
+ * instructions the emulator can execute are supported.
+ */
+const InstructionEncoding *findEncoding(const std::string &mnemonic);
+
+/* The lv.* mnemonic of a vector operation. */
+const char *getVectorMnemonic(VectorOp op);
+
+#endif /* __INST_ENCODING_H__ */
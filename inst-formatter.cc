@@ -11,6 +11,8 @@
 
 #include "arch.h"
 #include "inst-decoder.h"
+#include "inst-encoding.h"
+#include "vector-unit.h"
 
 #include <functional>
 #include <map>
@@ -219,44 +221,44 @@ void printCSYNC (std::ostream & os)
   os << "l.csync ";
 }
 
-void printCUST1 (std::ostream & os)
+void printCUST1 (std::ostream & os, const InstructionDecoder & decoder)
 {
-  os << "l.cust1 ";
+  os << "l.cust1 " << printRD(decoder) << ", " << printRA(decoder) << ", " << printRB(decoder);
 }
 
-void printCUST2 (std::ostream & os)
+void printCUST2 (std::ostream & os, const InstructionDecoder & decoder)
 {
-  os << "l.cust2 ";
+  os << "l.cust2 " << printRD(decoder) << ", " << printRA(decoder) << ", " << printRB(decoder);
 }
 
-void printCUST3 (std::ostream & os)
+void printCUST3 (std::ostream & os, const InstructionDecoder & decoder)
 {
-  os << "l.cust3 ";
+  os << "l.cust3 " << printRD(decoder) << ", " << printRA(decoder) << ", " << printRB(decoder);
 }
 
-void printCUST4 (std::ostream & os)
+void printCUST4 (std::ostream & os, const InstructionDecoder & decoder)
 {
-  os << "l.cust4 ";
+  os << "l.cust4 " << printRD(decoder) << ", " << printRA(decoder) << ", " << printRB(decoder);
 }
 
-void printCUST5 (std::ostream & os)
+void printCUST5 (std::ostream & os, const InstructionDecoder & decoder)
 {
-  os << "l.cust4 ";
+  os << "l.cust5 " << printRD(decoder) << ", " << printRA(decoder) << ", " << printRB(decoder);
 }
 
-void printCUST6 (std::ostream & os)
+void printCUST6 (std::ostream & os, const InstructionDecoder & decoder)
 {
-  os << "l.cust5 ";
+  os << "l.cust6 " << printRD(decoder) << ", " << printRA(decoder) << ", " << printRB(decoder);
 }
 
-void printCUST7 (std::ostream & os)
+void printCUST7 (std::ostream & os, const InstructionDecoder & decoder)
 {
-  os << "l.cust6 ";
+  os << "l.cust7 " << printRD(decoder) << ", " << printRA(decoder) << ", " << printRB(decoder);
 }
 
-void printCUST8 (std::ostream & os)
+void printCUST8 (std::ostream & os, const InstructionDecoder & decoder)
 {
-  os << "l.cust7 ";
+  os << "l.cust8 " << printRD(decoder) << ", " << printRA(decoder) << ", " << printRB(decoder);
 }
 
 void printJ (std::ostream & os, const InstructionDecoder & decoder)
@@ -332,7 +334,7 @@ void printMAC (std::ostream & os, const InstructionDecoder & decoder)
 
 void printMACU (std::ostream & os, const InstructionDecoder & decoder)
 {
-  os << "l.macu " << printRA(decoder) << ", " << "$" << printImmediate(decoder);
+  os << "l.macu " << printRA(decoder) << ", " << printRB(decoder);
 }
 
 
@@ -362,6 +364,68 @@ void printMOVHI (std::ostream & os, const InstructionDecoder & decoder)
   os << "l.movhi " << printRD(decoder) << ", " << "$" << printImmediate(decoder);
 }
 
+void printFLOAT (std::ostream & os, const InstructionDecoder & decoder)
+{
+  switch (decoder.getOpcode2())
+  {
+    case opcode2::ADDS:
+      os << "lf.add.s ";
+      break;
+    case opcode2::SUBS:
+      os << "lf.sub.s ";
+      break;
+    case opcode2::MULS:
+      os << "lf.mul.s ";
+      break;
+    case opcode2::DIVS:
+      os << "lf.div.s ";
+      break;
+    case opcode2::REMS:
+      os << "lf.rem.s ";
+      break;
+    case opcode2::MADDS:
+      os << "lf.madd.s ";
+      break;
+    case opcode2::ITOFS:
+      os << "lf.itof.s " << printRD(decoder) << ", " << printRA(decoder);
+      return;
+    case opcode2::FTOIS:
+      os << "lf.ftoi.s " << printRD(decoder) << ", " << printRA(decoder);
+      return;
+    case opcode2::SFEQS:
+      os << "lf.sfeq.s " << printRA(decoder) << ", " << printRB(decoder);
+      return;
+    case opcode2::SFNES:
+      os << "lf.sfne.s " << printRA(decoder) << ", " << printRB(decoder);
+      return;
+    case opcode2::SFGTS:
+      os << "lf.sfgt.s " << printRA(decoder) << ", " << printRB(decoder);
+      return;
+    case opcode2::SFGES:
+      os << "lf.sfge.s " << printRA(decoder) << ", " << printRB(decoder);
+      return;
+    case opcode2::SFLTS:
+      os << "lf.sflt.s " << printRA(decoder) << ", " << printRB(decoder);
+      return;
+    case opcode2::SFLES:
+      os << "lf.sfle.s " << printRA(decoder) << ", " << printRB(decoder);
+      return;
+    default:
+      return;
+  }
+  os << printRD(decoder) << ", " << printRA(decoder) << ", " << printRB(decoder);
+}
+
+void printVECTOR (std::ostream & os, const InstructionDecoder & decoder)
+{
+  const VectorOp op = decoder.getVectorOp();
+  os << getVectorMnemonic(op) << " ";
+  if (VectorUnit::isCompare(op))
+    os << printRA(decoder) << ", " << printRB(decoder);
+  else
+    os << printRD(decoder) << ", " << printRA(decoder) << ", " << printRB(decoder);
+}
+
 void printMFSPR (std::ostream & os, const InstructionDecoder & decoder)
 {
   os << "l.mfspr " << printRD(decoder) << ", " << printRA(decoder) << ", " << "$" << printImmediate(decoder);
@@ -693,28 +757,28 @@ operator<<(std::ostream &os, const InstructionDecoder &decoder)
       printCSYNC(os);
       break;
     case opcode::CUST1:
-      printCUST1(os);
+      printCUST1(os, decoder);
       break;
     case opcode::CUST2:
-      printCUST2(os);
+      printCUST2(os, decoder);
       break;
     case opcode::CUST3:
-      printCUST3(os);
+      printCUST3(os, decoder);
       break;
     case opcode::CUST4:
-      printCUST4(os);
+      printCUST4(os, decoder);
       break;
     case opcode::CUST5:
-      printCUST5(os);
+      printCUST5(os, decoder);
       break;
     case opcode::CUST6:
-      printCUST6(os);
+      printCUST6(os, decoder);
       break;
     case opcode::CUST7:
-      printCUST7(os);
+      printCUST7(os, decoder);
       break;
     case opcode::CUST8:
-      printCUST8(os);
+      printCUST8(os, decoder);
       break;
     case opcode::J:
       printJ(os, decoder);
@@ -786,6 +850,12 @@ operator<<(std::ostream &os, const InstructionDecoder &decoder)
           break;
       }
       break;
+    case opcode::FLOAT:
+      printFLOAT(os, decoder);
+      break;
+    case opcode::VECTOR:
+      printVECTOR(os, decoder);
+      break;
     case opcode::MFSPR:
       printMFSPR(os, decoder);
       break;
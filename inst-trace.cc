@@ -0,0 +1,661 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    inst-trace.cc - Trace of the retired instructions.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#include "inst-trace.h"
+#include "inst-decoder.h"
+
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+
+/*
+ * Record encoding
+ */
+
+/* Flags of an encoded record; the top two bits hold the number of
+ * register writes.
+ */
+enum EncodingFlags : uint8_t
+{
+  JumpedPC = 1 << 0,
+  NewWord = 1 << 1,
+  LoadAccess = 1 << 2,
+  StoreAccess = 1 << 3,
+  BranchInstruction = 1 << 4,
+  BranchTaken = 1 << 5,
+  RegisterWritesShift = 6
+};
+
+/* Every record is at most this large, encoded. */
+static constexpr size_t MaxEncodedRecordSize =
+    1 + 5 + 4 + 1 + 5 + 5 + 5 +
+    InstructionTraceRecord::MaxRegisterWrites * (1 + 5);
+
+static void
+putVarint(std::vector<uint8_t> &out, uint32_t value)
+{
+  while (value >= 0x80)
+    {
+      out.push_back(static_cast<uint8_t>(value | 0x80));
+      value >>= 7;
+    }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+/* Small differences in either direction have short encodings. */
+static void
+putSignedVarint(std::vector<uint8_t> &out, uint32_t difference)
+{
+  const int32_t value = static_cast<int32_t>(difference);
+  putVarint(out, (static_cast<uint32_t>(value) << 1) ^
+                 static_cast<uint32_t>(value >> 31));
+}
+
+static size_t
+getWordSlot(MemAddress PC)
+{
+  return (PC >> 2) % InstructionTraceState::WordCacheSize;
+}
+
+static void
+encodeRecord(InstructionTraceState &state,
+             const InstructionTraceRecord &record,
+             std::vector<uint8_t> &out)
+{
+  const size_t slot = getWordSlot(record.PC);
+  const bool jumped = record.PC != state.nextPC;
+  const bool newWord = state.wordPCs[slot] != record.PC ||
+                       state.words[slot] != record.instruction;
+
+  uint8_t flags = record.nRegisterWrites << RegisterWritesShift;
+  if (jumped)
+    flags |= JumpedPC;
+  if (newWord)
+    flags |= NewWord;
+  if (record.flags & InstructionTraceRecord::Load)
+    flags |= LoadAccess;
+  if (record.flags & InstructionTraceRecord::Store)
+    flags |= StoreAccess;
+  if (record.flags & InstructionTraceRecord::Branch)
+    flags |= BranchInstruction;
+  if (record.flags & InstructionTraceRecord::Taken)
+    flags |= BranchTaken;
+  out.push_back(flags);
+
+  if (jumped)
+    putSignedVarint(out, record.PC - state.nextPC);
+  if (newWord)
+    {
+      for (int shift = 0; shift < 32; shift += 8)
+        out.push_back(static_cast<uint8_t>(record.instruction >> shift));
+      state.wordPCs[slot] = record.PC;
+      state.words[slot] = record.instruction;
+    }
+  state.nextPC = record.PC + INSTRUCTION_SIZE;
+
+  if (flags & (LoadAccess | StoreAccess))
+    {
+      out.push_back(record.memorySize);
+      putSignedVarint(out, record.memoryAddress - state.memoryAddress);
+      putVarint(out, record.memoryValue);
+      state.memoryAddress = record.memoryAddress;
+    }
+
+  if (flags & BranchTaken)
+    putSignedVarint(out, record.branchTarget - record.PC);
+
+  for (size_t i = 0; i < record.nRegisterWrites; ++i)
+    {
+      const RegNumber reg = record.registers[i];
+      out.push_back(reg);
+      putSignedVarint(out, record.registerValues[i] - state.registers[reg]);
+      state.registers[reg] = record.registerValues[i];
+    }
+}
+
+/* Reads the encoding of a decompressed block. */
+class BlockReader
+{
+  public:
+    BlockReader(const std::vector<uint8_t> &block, size_t &offset)
+      : block(block), offset(offset)
+    { }
+
+    uint8_t getByte()
+    {
+      if (offset >= block.size())
+        throw std::runtime_error("corrupt instruction trace record");
+      return block[offset++];
+    }
+
+    uint32_t getVarint()
+    {
+      uint32_t value = 0;
+      for (int shift = 0; shift < 35; shift += 7)
+        {
+          const uint8_t byte = getByte();
+          value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+          if (! (byte & 0x80))
+            return value;
+        }
+      throw std::runtime_error("corrupt instruction trace record");
+    }
+
+    uint32_t getSignedVarint()
+    {
+      const uint32_t value = getVarint();
+      return (value >> 1) ^ (0 - (value & 1));
+    }
+
+  private:
+    const std::vector<uint8_t> &block;
+    size_t &offset;
+};
+
+static void
+decodeRecord(InstructionTraceState &state, BlockReader &in,
+             InstructionTraceRecord &record)
+{
+  record = InstructionTraceRecord{};
+  const uint8_t flags = in.getByte();
+
+  record.PC = state.nextPC;
+  if (flags & JumpedPC)
+    record.PC += in.getSignedVarint();
+
+  const size_t slot = getWordSlot(record.PC);
+  if (flags & NewWord)
+    {
+      for (int shift = 0; shift < 32; shift += 8)
+        record.instruction |= static_cast<uint32_t>(in.getByte()) << shift;
+      state.wordPCs[slot] = record.PC;
+      state.words[slot] = record.instruction;
+    }
+  else if (state.wordPCs[slot] == record.PC)
+    record.instruction = state.words[slot];
+  else
+    throw std::runtime_error("corrupt instruction trace record");
+  state.nextPC = record.PC + INSTRUCTION_SIZE;
+
+  if (flags & LoadAccess)
+    record.flags |= InstructionTraceRecord::Load;
+  if (flags & StoreAccess)
+    record.flags |= InstructionTraceRecord::Store;
+  if (flags & (LoadAccess | StoreAccess))
+    {
+      record.memorySize = in.getByte();
+      record.memoryAddress = state.memoryAddress + in.getSignedVarint();
+      record.memoryValue = in.getVarint();
+      state.memoryAddress = record.memoryAddress;
+    }
+
+  if (flags & BranchInstruction)
+    record.flags |= InstructionTraceRecord::Branch;
+  if (flags & BranchTaken)
+    {
+      record.flags |= InstructionTraceRecord::Taken;
+      record.branchTarget = record.PC + in.getSignedVarint();
+    }
+
+  record.nRegisterWrites = flags >> RegisterWritesShift;
+  if (record.nRegisterWrites > InstructionTraceRecord::MaxRegisterWrites)
+    throw std::runtime_error("corrupt instruction trace record");
+
+  for (size_t i = 0; i < record.nRegisterWrites; ++i)
+    {
+      const RegNumber reg = in.getByte();
+      if (reg >= NumRegs)
+        throw std::runtime_error("corrupt instruction trace record");
+      record.registers[i] = reg;
+      record.registerValues[i] = state.registers[reg] + in.getSignedVarint();
+      state.registers[reg] = record.registerValues[i];
+    }
+}
+
+
+/*
+ * Block compression
+ *
+ * LZ77 in the format of LZ4 blocks: a sequence consists of a token byte
+ * with the number of literals in the high nibble and the match length
+ * minus MinMatch in the low nibble, each continued in following bytes
+ * of 255 if the nibble is 15, then the literals and a 16-bit little
+ * endian match offset. The last sequence only has literals.
+ */
+
+static constexpr size_t MinMatch = 4;
+static constexpr size_t MaxOffset = 0xffff;
+static constexpr unsigned int HashBits = 12;
+
+static uint32_t
+load32(const uint8_t *p)
+{
+  uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static size_t
+hash(uint32_t value)
+{
+  return (value * 2654435761u) >> (32 - HashBits);
+}
+
+static void
+putLength(std::vector<uint8_t> &out, size_t length)
+{
+  for (; length >= 255; length -= 255)
+    out.push_back(255);
+  out.push_back(static_cast<uint8_t>(length));
+}
+
+static void
+putSequence(std::vector<uint8_t> &out,
+            const uint8_t *literals, size_t nLiterals,
+            size_t offset, size_t matchLength)
+{
+  const size_t matchCode = matchLength ? matchLength - MinMatch : 0;
+  out.push_back(static_cast<uint8_t>((std::min<size_t>(nLiterals, 15) << 4) |
+                                     std::min<size_t>(matchCode, 15)));
+  if (nLiterals >= 15)
+    putLength(out, nLiterals - 15);
+  out.insert(out.end(), literals, literals + nLiterals);
+
+  if (! matchLength)
+    return;
+
+  out.push_back(static_cast<uint8_t>(offset));
+  out.push_back(static_cast<uint8_t>(offset >> 8));
+  if (matchCode >= 15)
+    putLength(out, matchCode - 15);
+}
+
+static std::vector<uint8_t>
+compress(const std::vector<uint8_t> &in)
+{
+  std::vector<uint8_t> out;
+  out.reserve(in.size() / 2);
+
+  std::vector<int64_t> table(size_t(1) << HashBits, -1);
+  const uint8_t *src = in.data();
+  size_t anchor = 0;
+  size_t i = 0;
+
+  while (i + MinMatch <= in.size())
+    {
+      const uint32_t value = load32(src + i);
+      const size_t h = hash(value);
+      const int64_t candidate = table[h];
+      table[h] = i;
+
+      if (candidate < 0 || i - candidate > MaxOffset ||
+          load32(src + candidate) != value)
+        {
+          ++i;
+          continue;
+        }
+
+      size_t length = MinMatch;
+      while (i + length < in.size() && src[candidate + length] == src[i + length])
+        ++length;
+
+      putSequence(out, src + anchor, i - anchor, i - candidate, length);
+      i += length;
+      anchor = i;
+    }
+
+  putSequence(out, src + anchor, in.size() - anchor, 0, 0);
+  return out;
+}
+
+static void
+decompress(const uint8_t *in, size_t size, std::vector<uint8_t> &out,
+           size_t outSize)
+{
+  out.clear();
+  out.reserve(outSize);
+
+  const uint8_t *const end = in + size;
+  auto corrupt = []()
+    {
+      throw std::runtime_error("corrupt instruction trace block");
+    };
+  auto getLength = [&](size_t length)
+    {
+      if (length < 15)
+        return length;
+      uint8_t byte;
+      do
+        {
+          if (in == end)
+            corrupt();
+          byte = *in++;
+          length += byte;
+        }
+      while (byte == 255);
+      return length;
+    };
+
+  while (in != end)
+    {
+      const uint8_t token = *in++;
+
+      const size_t nLiterals = getLength(token >> 4);
+      if (static_cast<size_t>(end - in) < nLiterals ||
+          outSize - out.size() < nLiterals)
+        corrupt();
+      out.insert(out.end(), in, in + nLiterals);
+      in += nLiterals;
+
+      if (in == end)
+        break;
+
+      if (end - in < 2)
+        corrupt();
+      const size_t offset = in[0] | (in[1] << 8);
+      in += 2;
+      const size_t length = getLength(token & 0xf) + MinMatch;
+      if (offset == 0 || offset > out.size() ||
+          outSize - out.size() < length)
+        corrupt();
+
+      /* The match may overlap the bytes it produces. */
+      for (size_t i = 0, from = out.size() - offset; i < length; ++i)
+        out.push_back(out[from + i]);
+    }
+
+  if (out.size() != outSize)
+    corrupt();
+}
+
+
+/*
+ * Writer
+ */
+
+InstructionTracer::InstructionTracer(const std::string &filename)
+  : file(filename, std::ios::binary), filename(filename), ring(RingCapacity)
+{
+  if (! file)
+    throw std::runtime_error("cannot create trace file " + filename);
+
+  const InstructionTraceHeader header{ InstructionTraceHeader::Magic,
+                                       InstructionTraceHeader::Version,
+                                       BlockRecords };
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  thread = std::thread(&InstructionTracer::run, this);
+}
+
+InstructionTracer::~InstructionTracer()
+{
+  try
+    {
+      close();
+    }
+  catch (std::exception &e)
+    {
+      std::cerr << "Warning: " << e.what() << std::endl;
+    }
+}
+
+void
+InstructionTracer::close()
+{
+  if (! thread.joinable())
+    return;
+
+  done.store(true, std::memory_order_release);
+  thread.join();
+
+  file.close();
+  if (failed || ! file)
+    throw std::runtime_error("cannot write trace file " + filename);
+}
+
+/* Polls the ring buffer rather than waiting for a signal, so that
+ * retiring an instruction never involves a lock or a system call.
+ */
+void
+InstructionTracer::run()
+{
+  std::vector<InstructionTraceRecord> batch(4096);
+  std::vector<uint8_t> encoded;
+  encoded.reserve(BlockRecords * MaxEncodedRecordSize);
+  InstructionTraceState state;
+  uint32_t records = 0;
+
+  while (true)
+    {
+      size_t n = ring.pop(batch.data(), batch.size());
+      if (n == 0)
+        {
+          /* Records retired before done was set are visible now. */
+          if (done.load(std::memory_order_acquire))
+            {
+              n = ring.pop(batch.data(), batch.size());
+              if (n == 0)
+                break;
+            }
+          else
+            {
+              std::this_thread::sleep_for(std::chrono::microseconds(100));
+              continue;
+            }
+        }
+
+      for (size_t i = 0; i < n; ++i)
+        {
+          encodeRecord(state, batch[i], encoded);
+          if (++records == BlockRecords)
+            {
+              writeBlock(encoded, records);
+              encoded.clear();
+              state.reset();
+              records = 0;
+            }
+        }
+    }
+
+  if (records > 0)
+    writeBlock(encoded, records);
+}
+
+void
+InstructionTracer::writeBlock(const std::vector<uint8_t> &encoded,
+                              uint32_t records)
+{
+  const std::vector<uint8_t> compressed = compress(encoded);
+  const InstructionTraceBlockHeader header{
+    static_cast<uint32_t>(compressed.size()),
+    static_cast<uint32_t>(encoded.size()), records };
+
+  if (! file.write(reinterpret_cast<const char *>(&header), sizeof(header)) ||
+      ! file.write(reinterpret_cast<const char *>(compressed.data()),
+                   compressed.size()))
+    failed = true;
+}
+
+
+/*
+ * Reader
+ */
+
+InstructionTraceReader::InstructionTraceReader(const std::string &filename)
+{
+#ifdef _MSC_VER
+  std::ifstream in(filename, std::ios::binary);
+  if (! in)
+    throw std::runtime_error("cannot open trace file " + filename);
+  contents.assign(std::istreambuf_iterator<char>(in),
+                  std::istreambuf_iterator<char>());
+  data = contents.data();
+  size = contents.size();
+#else
+  int fd = open(filename.data(), O_RDONLY);
+  if (fd < 0)
+    throw std::system_error(std::error_code(static_cast<int>(errno),
+                            std::generic_category()));
+
+  struct stat statbuf;
+  if (fstat(fd, &statbuf) < 0)
+    {
+      ::close(fd);
+      throw std::runtime_error("Could not retrieve file attributes.");
+    }
+  size = statbuf.st_size;
+
+  if (size < sizeof(InstructionTraceHeader))
+    {
+      ::close(fd);
+      throw std::runtime_error("not an instruction trace");
+    }
+
+  void *mapAddr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapAddr == MAP_FAILED)
+    throw std::runtime_error("Could not mmap trace file.");
+  data = static_cast<const uint8_t *>(mapAddr);
+#endif
+
+  InstructionTraceHeader header{};
+  if (size >= sizeof(header))
+    std::memcpy(&header, data, sizeof(header));
+  if (size < sizeof(header) || header.magic != InstructionTraceHeader::Magic)
+    throw std::runtime_error("not an instruction trace");
+  if (header.version != InstructionTraceHeader::Version)
+    throw std::runtime_error("unsupported instruction trace version");
+
+  offset = sizeof(header);
+}
+
+InstructionTraceReader::~InstructionTraceReader()
+{
+#ifndef _MSC_VER
+  munmap(const_cast<uint8_t *>(data), size);
+#endif
+}
+
+bool
+InstructionTraceReader::nextBlock()
+{
+  if (blockOffset != block.size())
+    throw std::runtime_error("corrupt instruction trace block");
+  if (offset == size)
+    return false;
+
+  InstructionTraceBlockHeader header;
+  if (size - offset < sizeof(header))
+    throw std::runtime_error("truncated instruction trace");
+  std::memcpy(&header, data + offset, sizeof(header));
+  offset += sizeof(header);
+
+  if (size - offset < header.compressedSize)
+    throw std::runtime_error("truncated instruction trace");
+  if (header.records == 0 ||
+      header.size > header.records * MaxEncodedRecordSize)
+    throw std::runtime_error("corrupt instruction trace block");
+
+  decompress(data + offset, header.compressedSize, block, header.size);
+  offset += header.compressedSize;
+  ++blocks;
+
+  blockOffset = 0;
+  blockRecords = header.records;
+  state.reset();
+  return true;
+}
+
+bool
+InstructionTraceReader::next(InstructionTraceRecord &record)
+{
+  if (blockRecords == 0 && ! nextBlock())
+    return false;
+
+  BlockReader in(block, blockOffset);
+  decodeRecord(state, in, record);
+  --blockRecords;
+  return true;
+}
+
+
+/*
+ * Text output
+ */
+
+static std::string
+disassemble(uint32_t instruction)
+{
+  std::ostringstream s;
+  try
+    {
+      InstructionDecoder decoder;
+      decoder.setInstructionWord(instruction);
+      s << decoder;
+    }
+  catch (IllegalInstruction &)
+    {
+      s.str("illegal instruction");
+    }
+  return s.str();
+}
+
+void
+printInstructionTrace(InstructionTraceReader &reader, std::ostream &out)
+{
+  auto hex = [](uint32_t value)
+    {
+      std::ostringstream s;
+      s << "0x" << std::hex << std::setw(8) << std::setfill('0') << value;
+      return s.str();
+    };
+
+  InstructionTraceRecord record;
+  while (reader.next(record))
+    {
+      std::ostringstream effects;
+      for (size_t i = 0; i < record.nRegisterWrites; ++i)
+        effects << " r" << static_cast<int>(record.registers[i]) << '='
+                << hex(record.registerValues[i]);
+
+      if (record.flags & (InstructionTraceRecord::Load |
+                          InstructionTraceRecord::Store))
+        effects << ((record.flags & InstructionTraceRecord::Load) ?
+                    " load" : " store")
+                << static_cast<int>(record.memorySize) << " ["
+                << hex(record.memoryAddress) << "]="
+                << hex(record.memoryValue);
+
+      if (record.flags & InstructionTraceRecord::Taken)
+        effects << " taken -> " << hex(record.branchTarget);
+      else if (record.flags & InstructionTraceRecord::Branch)
+        effects << " not taken";
+
+      /* Only pad the disassembly when effects follow, such that lines
+       * do not end in whitespace.
+       */
+      out << std::hex << std::setw(8) << std::setfill('0') << record.PC
+          << std::dec << std::setfill(' ') << "  ";
+      if (effects.tellp() > 0)
+        out << std::left << std::setw(28) << disassemble(record.instruction)
+            << std::right << effects.str();
+      else
+        out << disassemble(record.instruction);
+      out << '\n';
+    }
+}
@@ -0,0 +1,165 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    inst-trace.h - Trace of the retired instructions.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#ifndef __INST_TRACE_H__
+#define __INST_TRACE_H__
+
+#include "arch.h"
+#include "ring-buffer.h"
+
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* What one retired instruction did. */
+struct InstructionTraceRecord
+{
+  static constexpr uint8_t Load = 1 << 0;
+  static constexpr uint8_t Store = 1 << 1;
+  static constexpr uint8_t Branch = 1 << 2;
+  static constexpr uint8_t Taken = 1 << 3;
+
+  static constexpr size_t MaxRegisterWrites = 2;
+
+  MemAddress PC;
+  uint32_t instruction;
+  uint8_t flags;
+  uint8_t memorySize;
+  uint8_t nRegisterWrites;
+  std::array<RegNumber, MaxRegisterWrites> registers;
+  std::array<RegValue, MaxRegisterWrites> registerValues;
+  MemAddress memoryAddress;
+  RegValue memoryValue;
+  MemAddress branchTarget;      /* if taken */
+};
+
+/* The trace file starts with this header, in host byte order, followed
+ * by blocks of records. A block consists of a block header and the LZ77
+ * compressed encoding of its records. The encoding of every record is
+ * relative to the previous records of its block: the PC to the next
+ * sequential PC, register values to the previous value of the register,
+ * the memory address to the previous one, and the instruction word is
+ * left out if it was seen before at the same PC. Blocks can therefore
+ * be decoded independently.
+ */
+struct InstructionTraceHeader
+{
+  static constexpr std::array<char, 8> Magic{ 'R', 'V', 'I', 'T', 'R', 'A', 'C', 'E' };
+  static constexpr uint32_t Version = 1;
+
+  std::array<char, 8> magic;
+  uint32_t version;
+  uint32_t blockRecords;        /* at most, per block */
+};
+
+struct InstructionTraceBlockHeader
+{
+  uint32_t compressedSize;
+  uint32_t size;
+  uint32_t records;
+};
+
+/* The state that the encoding of a record depends on. */
+struct InstructionTraceState
+{
+  static constexpr size_t WordCacheSize = 1024;
+
+  MemAddress nextPC{};
+  MemAddress memoryAddress{};
+  std::array<RegValue, NumRegs> registers{};
+  std::array<MemAddress, WordCacheSize> wordPCs{};
+  std::array<uint32_t, WordCacheSize> words{};
+
+  void reset() { *this = InstructionTraceState{}; }
+};
+
+/* Writes a record per retired instruction. The simulation only copies
+ * the record into a lock-free ring buffer; a background thread encodes,
+ * compresses and writes the blocks. The simulation only waits when the
+ * background thread falls behind by a whole ring buffer.
+ */
+class InstructionTracer
+{
+  public:
+    static constexpr size_t RingCapacity = 1 << 16;
+    static constexpr uint32_t BlockRecords = 1 << 14;
+
+    explicit InstructionTracer(const std::string &filename);
+    ~InstructionTracer();
+
+    InstructionTracer(const InstructionTracer &) = delete;
+    InstructionTracer &operator=(const InstructionTracer &) = delete;
+
+    void retire(const InstructionTraceRecord &record)
+    {
+      while (! ring.tryPush(record))
+        std::this_thread::yield();
+    }
+
+    /* Write out the remaining records and wait for the file to be
+     * complete. Throws std::runtime_error if writing failed.
+     */
+    void close();
+
+  private:
+    std::ofstream file;
+    const std::string filename;
+
+    RingBuffer<InstructionTraceRecord> ring;
+    std::atomic<bool> done{ false };
+    bool failed = false;
+    std::thread thread{};
+
+    void run();
+    void writeBlock(const std::vector<uint8_t> &encoded, uint32_t records);
+};
+
+/* Iterates over the records of a trace file, which is mapped into
+ * memory. Throws std::runtime_error on a malformed trace.
+ */
+class InstructionTraceReader
+{
+  public:
+    explicit InstructionTraceReader(const std::string &filename);
+    ~InstructionTraceReader();
+
+    InstructionTraceReader(const InstructionTraceReader &) = delete;
+    InstructionTraceReader &operator=(const InstructionTraceReader &) = delete;
+
+    /* The next record, or false at the end of the trace. */
+    bool next(InstructionTraceRecord &record);
+
+    uint64_t getFileSize() const { return size; }
+    uint64_t getBlocks() const { return blocks; }
+
+  private:
+    const uint8_t *data{};
+    size_t size{};
+#ifdef _MSC_VER
+    std::vector<uint8_t> contents{};
+#endif
+
+    size_t offset{};
+    uint64_t blocks{};
+
+    /* The decompressed current block */
+    std::vector<uint8_t> block{};
+    size_t blockOffset{};
+    uint32_t blockRecords{};
+    InstructionTraceState state{};
+
+    bool nextBlock();
+};
+
+/* Writes the records as text, with the disassembled instruction. */
+void printInstructionTrace(InstructionTraceReader &reader, std::ostream &out);
+
+#endif /* __INST_TRACE_H__ */
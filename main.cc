@@ -7,6 +7,8 @@
 
 #include "testing.h"
 
+#include <algorithm>
+#include <csignal>
 #include <iostream>
 #include <fstream>
 #include <vector>
@@ -18,8 +20,12 @@
 #include <getopt.h>
 #endif
 
+#include "assembler.h"
 #include "elf-file.h"
 #include "processor.h"
+#include "multicore.h"
+#include "stats.h"
+#include "telemetry.h"
 
 #ifdef _MSC_VER
 /* Defined *somewhere* */
@@ -61,6 +67,151 @@ validateRegisters(const Processor &p,
   return allAsExpected;
 }
 
+/* Compare the statistics listed in a test file with their values. */
+static bool
+validateStatistics(const StatsRegistry &stats,
+                   const std::vector<std::pair<std::string, uint64_t>> &expectedValues)
+{
+  bool allAsExpected = true;
+
+  if (!expectedValues.empty())
+    {
+      const auto values = stats.collect();
+      for (const auto &[name, expected] : expectedValues)
+        {
+          auto it = std::find_if(values.begin(), values.end(),
+                                 [&name = name](const StatsRegistry::Value &value)
+                                 { return value.name == name; });
+          if (it == values.end())
+            {
+              std::cerr << "Statistic " << name << " does not exist"
+                        << std::endl;
+              allAsExpected = false;
+            }
+          else if (!it->isInteger || it->count != expected)
+            {
+              std::cerr << "Statistic " << name << " expected " << expected
+                        << " got ";
+              if (it->isInteger)
+                std::cerr << it->count << std::endl;
+              else
+                std::cerr << it->value << std::endl;
+              allAsExpected = false;
+            }
+        }
+    }
+
+  return allAsExpected;
+}
+
+
+/* Pipelined mode does not support exceptions, which would have to squash
+ * the younger instructions in the pipeline. Programs that use them are
+ * rejected before they run.
+ */
+static bool
+usesExceptions(const ELFFile &program)
+{
+  std::vector<std::byte> segment;
+  MemAddress segmentBase{};
+  size_t segmentSize{};
+
+  if (!program.getTextSegment(segment, segmentBase, segmentSize))
+    return false;
+
+  InstructionDecoder decoder;
+  for (size_t i = 0; i + INSTRUCTION_SIZE <= segmentSize; i += INSTRUCTION_SIZE)
+    {
+      const RegValue *instr = reinterpret_cast<const RegValue*>(&segment[i]);
+      try
+        {
+          decoder.setInstructionWord(__builtin_bswap32(*instr));
+          switch (decoder.getOpcode())
+            {
+              case opcode::SYS:
+              case opcode::TRAP:
+              case opcode::RFE:
+                return true;
+              default:
+                break;
+            }
+        }
+      catch (std::exception &)
+        {
+          /* Not an instruction, e.g. data in the text segment. */
+        }
+    }
+
+  return false;
+}
+
+
+/* Files to write statistics to and the number of cycles between
+ * snapshots, 0 for only a snapshot at the end.
+ */
+struct StatsOptions
+{
+  const char *jsonFilename = nullptr;
+  const char *csvFilename = nullptr;
+  uint64_t interval = 0;
+
+  bool enabled() const { return jsonFilename || csvFilename; }
+};
+
+static std::unique_ptr<StatsOutput>
+createStatsOutput(const StatsRegistry &stats, const StatsOptions &options)
+{
+  return std::make_unique<StatsOutput>(stats,
+                                       options.jsonFilename ? options.jsonFilename : "",
+                                       options.csvFilename ? options.csvFilename : "");
+}
+
+#ifndef _MSC_VER
+/* SIGUSR1 requests a dump of the statistics, which is done between two
+ * slices of the simulation.
+ */
+static volatile std::sig_atomic_t statisticsRequested = 0;
+
+static void
+requestStatistics(int)
+{
+  statisticsRequested = 1;
+}
+#endif
+
+/* Cycles between checks for a statistics request */
+static constexpr uint64_t SignalCheckInterval = 1 << 20;
+
+/* Work done between slices of the simulation, every interval cycles. */
+struct PeriodicTask
+{
+  uint64_t interval;
+  std::function<void(uint64_t)> run;
+};
+
+static void
+runWithPeriodicTasks(Processor &p, bool testMode,
+                     const std::vector<PeriodicTask> &tasks)
+{
+  std::vector<uint64_t> next;
+  for (const auto &task : tasks)
+    next.push_back(p.getCycles() + task.interval);
+
+  RunStatus status;
+  do
+    {
+      const uint64_t end = *std::min_element(next.begin(), next.end());
+      status = p.runFor(end - p.getCycles(), testMode);
+
+      for (size_t i = 0; i < tasks.size(); ++i)
+        if (p.getCycles() >= next[i])
+          {
+            tasks[i].run(p.getCycles());
+            next[i] = (p.getCycles() / tasks[i].interval + 1) * tasks[i].interval;
+          }
+    }
+  while (status == RunStatus::Running);
+}
 
 /* Start the emulator by either executing a test or running a regular
  * program.
@@ -70,12 +221,28 @@ launcher(const char *testFilename,
          const char *execFilename,
          bool pipelining,
          bool debugMode,
-         std::vector<RegisterInit> initializers)
+         std::vector<RegisterInit> initializers,
+         unsigned int nCores,
+         uint64_t quantum,
+         bool cacheModel,
+         const std::vector<FunctionalUnitConfig> &unitConfigs,
+         std::vector<AcceleratorBinding> accelerators,
+         std::vector<HostFunction> hostFunctions,
+         bool fastForward,
+         unsigned int registerBanks,
+         bool regionMode,
+         const char *profilePrefix,
+         const char *pipeTraceFilename,
+         const char *instTraceFilename,
+         const StatsOptions &statsOptions,
+         uint64_t telemetryInterval,
+         bool hostProfile)
 {
   try
     {
       std::string programFilename;
       std::vector<RegisterInit> postRegisters;
+      std::vector<std::pair<std::string, uint64_t>> postStatistics;
 
       if (testFilename)
         {
@@ -95,6 +262,22 @@ launcher(const char *testFilename,
               initializers = testfile.getPreRegisters();
               postRegisters = testfile.getPostRegisters();
               programFilename = testfile.getExecutable();
+              registerBanks = std::max(registerBanks,
+                                       testfile.getRegisterBanks());
+              nCores = std::max(nCores, testfile.getCores());
+              cacheModel = cacheModel || testfile.getCaches();
+              /* Skipping spin loops does not change the outcome, so
+               * the test also runs with pipelining, without skipping.
+               */
+              if (! pipelining)
+                fastForward = fastForward || testfile.getFastForward();
+              postStatistics = testfile.getExpectedStatistics();
+              for (auto &plugin : testfile.getPlugins())
+                AcceleratorRegistry::instance().loadPlugin(plugin);
+              for (auto &binding : testfile.getAcceleratorBindings())
+                accelerators.emplace_back(binding);
+              for (HostFunction function : testfile.getHostCalls())
+                hostFunctions.push_back(function);
             }
           catch (std::exception &e)
             {
@@ -107,21 +290,229 @@ launcher(const char *testFilename,
 
       /* Read the ELF file and start the emulator */
       ELFFile program(programFilename);
+
+      if (pipelining && usesExceptions(program))
+        {
+          std::cerr << "Error: " << programFilename << " uses l.sys, l.trap "
+                    << "or l.rfe; exceptions are not supported with "
+                    << "pipelining." << std::endl;
+          return ExitCodes::InvalidArgument;
+        }
+
+      /* Entry points of the routines to run on the host */
+      std::vector<std::pair<MemAddress, HostFunction>> hostCalls;
+      if (! hostFunctions.empty())
+        {
+          const auto symbols = program.getFunctionSymbols();
+          for (HostFunction function : hostFunctions)
+            {
+              const char *name = HostCallInterceptor::getName(function);
+              auto it = symbols.find(name);
+              if (it != symbols.end())
+                hostCalls.emplace_back(it->second, function);
+              else
+                std::cerr << "Warning: symbol " << name
+                          << " not found, not intercepted." << std::endl;
+            }
+        }
+
+      if (nCores > 1)
+        {
+          MultiCoreSystem system(program, nCores, quantum,
+                                 pipelining, debugMode);
+          if (cacheModel)
+            system.enableCaches(CacheConfig{});
+
+          /* Register initializers, unit timings, accelerators and host
+           * calls apply to all cores.
+           */
+          for (unsigned int i = 0; i < nCores; ++i)
+            {
+              system.getCore(i).setRegisterBanks(registerBanks);
+              for (auto &initializer : initializers)
+                system.getCore(i).initRegister(initializer.number,
+                                               initializer.value);
+              for (auto &config : unitConfigs)
+                system.getCore(i).configureFunctionalUnit(config);
+              for (auto &binding : accelerators)
+                system.getCore(i).attachAccelerator(binding);
+              for (auto &[entry, function] : hostCalls)
+                system.getCore(i).interceptHostCall(entry, function);
+              system.getCore(i).setSpinLoopDetection(fastForward);
+              system.getCore(i).setRegionMode(regionMode);
+              if (profilePrefix)
+                system.getCore(i).enableProfiler(program);
+              if (pipeTraceFilename)
+                system.getCore(i).enablePipelineTrace(std::string(pipeTraceFilename) +
+                                                      ".core" + std::to_string(i));
+              if (instTraceFilename)
+                system.getCore(i).enableInstructionTrace(std::string(instTraceFilename) +
+                                                         ".core" + std::to_string(i));
+              if (hostProfile)
+                system.getCore(i).enableHostProfiler();
+            }
+
+          StatsRegistry stats;
+          std::unique_ptr<StatsOutput> statsOutput;
+          if (statsOptions.enabled() || !postStatistics.empty())
+            system.registerStatistics(stats);
+          if (statsOptions.enabled())
+            {
+              statsOutput = createStatsOutput(stats, statsOptions);
+              if (statsOptions.interval > 0)
+                system.addIntervalHandler(statsOptions.interval,
+                                          [&statsOutput](uint64_t cycle)
+                                          { statsOutput->snapshot(cycle); });
+            }
+
+#ifndef _MSC_VER
+          std::unique_ptr<TelemetryPublisher> telemetry;
+          if (telemetryInterval > 0)
+            {
+              telemetry = std::make_unique<TelemetryPublisher>(nCores,
+                                                               telemetryInterval);
+              system.addIntervalHandler(telemetryInterval,
+                                        [&system, &telemetry](uint64_t)
+                {
+                  for (unsigned int i = 0; i < system.getNumCores(); ++i)
+                    {
+                      const Processor &core = system.getCore(i);
+                      telemetry->update(i, core.getCycles(),
+                                        core.getInstructions(), core.getPC(),
+                                        core.hasHalted());
+                    }
+                });
+            }
+
+          system.addIntervalHandler(SignalCheckInterval,
+                                    [&system](uint64_t cycle)
+            {
+              if (! statisticsRequested)
+                return;
+              statisticsRequested = 0;
+              std::cerr << "Statistics at cycle " << cycle << ":" << std::endl;
+              system.dumpStatistics();
+            });
+#endif
+
+          system.run(testFilename != nullptr);
+
+          if (statsOutput)
+            statsOutput->finish(system.getCycles());
+
+          if (profilePrefix)
+            for (unsigned int i = 0; i < nCores; ++i)
+              system.getCore(i).writeProfile(std::string(profilePrefix) +
+                                             ".core" + std::to_string(i),
+                                             programFilename);
+
+          if (!testFilename)
+            {
+              system.dumpRegisters();
+              system.dumpStatistics();
+            }
+
+          /* Post conditions are validated against core 0. */
+          if (!validateRegisters(system.getCore(0), postRegisters) ||
+              !validateStatistics(stats, postStatistics))
+            return ExitCodes::UnitTestFailed;
+
+          return ExitCodes::Success;
+        }
+
       Processor p(program, pipelining, debugMode);
 
+      std::unique_ptr<CoherenceController> caches;
+      if (cacheModel)
+        {
+          caches = std::make_unique<CoherenceController>(CacheConfig{}, 1);
+          p.attachDataCache(caches->getL1(0));
+        }
+
+      p.setRegisterBanks(registerBanks);
       for (auto &initializer : initializers)
         p.initRegister(initializer.number, initializer.value);
+      for (auto &config : unitConfigs)
+        p.configureFunctionalUnit(config);
+      for (auto &binding : accelerators)
+        p.attachAccelerator(binding);
+      for (auto &[entry, function] : hostCalls)
+        p.interceptHostCall(entry, function);
+      p.setSpinLoopDetection(fastForward);
+      p.setRegionMode(regionMode);
+      if (profilePrefix)
+        p.enableProfiler(program);
+      if (pipeTraceFilename)
+        p.enablePipelineTrace(pipeTraceFilename);
+      if (instTraceFilename)
+        p.enableInstructionTrace(instTraceFilename);
+      if (hostProfile)
+        p.enableHostProfiler();
+
+      StatsRegistry stats;
+      std::unique_ptr<StatsOutput> statsOutput;
+      if (statsOptions.enabled() || !postStatistics.empty())
+        {
+          p.registerStatistics(stats, "");
+          if (caches)
+            caches->registerStatistics(stats);
+        }
+      if (statsOptions.enabled())
+        statsOutput = createStatsOutput(stats, statsOptions);
+
+      std::vector<PeriodicTask> tasks;
+      if (statsOutput && statsOptions.interval > 0)
+        tasks.push_back({ statsOptions.interval,
+                          [&statsOutput](uint64_t cycle)
+                          { statsOutput->snapshot(cycle); } });
+
+#ifndef _MSC_VER
+      std::unique_ptr<TelemetryPublisher> telemetry;
+      if (telemetryInterval > 0)
+        {
+          telemetry = std::make_unique<TelemetryPublisher>(1, telemetryInterval);
+          tasks.push_back({ telemetryInterval,
+                            [&p, &telemetry](uint64_t cycle)
+                            {
+                              telemetry->update(0, cycle, p.getInstructions(),
+                                                p.getPC(), p.hasHalted());
+                            } });
+        }
+
+      tasks.push_back({ SignalCheckInterval,
+                        [&p](uint64_t cycle)
+                        {
+                          if (! statisticsRequested)
+                            return;
+                          statisticsRequested = 0;
+                          std::cerr << "Statistics at cycle " << cycle << ":"
+                                    << std::endl;
+                          p.dumpStatistics();
+                        } });
+#endif
+
+      if (tasks.empty())
+        p.run(testFilename != nullptr);
+      else
+        runWithPeriodicTasks(p, testFilename != nullptr, tasks);
+
+      if (statsOutput)
+        statsOutput->finish(p.getCycles());
 
-      p.run(testFilename != nullptr);
+      if (profilePrefix)
+        p.writeProfile(profilePrefix, programFilename);
 
       /* Dump registers and statistics when not running a unit test. */
       if (!testFilename)
         {
           p.dumpRegisters();
           p.dumpStatistics();
+          if (caches)
+            caches->dumpStatistics(std::cerr);
         }
 
-      if (!validateRegisters(p, postRegisters))
+      if (!validateRegisters(p, postRegisters) ||
+          !validateStatistics(stats, postStatistics))
         return ExitCodes::UnitTestFailed;
     }
   catch (std::runtime_error &e)
@@ -271,25 +662,166 @@ disasmSingle(const char *disasmArg)
   return ExitCodes::InitializationError;
 }
 
+static int
+convertPipeTrace(const char *filename, bool konata)
+{
+  std::ifstream in(filename, std::ios::binary);
+  if (! in)
+    {
+      std::cerr << "Error: cannot open '" << filename << "'." << std::endl;
+      return ExitCodes::InvalidArgument;
+    }
+
+  try
+    {
+      if (konata)
+        convertPipeTraceToKonata(in, std::cout);
+      else
+        convertPipeTraceToO3PipeView(in, std::cout);
+    }
+  catch (std::exception &e)
+    {
+      std::cerr << "Error: " << filename << ": " << e.what() << std::endl;
+      return ExitCodes::InvalidArgument;
+    }
+
+  return ExitCodes::Success;
+}
+
+static int
+dumpInstructionTrace(const char *filename)
+{
+  try
+    {
+      InstructionTraceReader reader(filename);
+      printInstructionTrace(reader, std::cout);
+      std::cerr << filename << ": " << reader.getFileSize() << " bytes in "
+                << reader.getBlocks() << " blocks" << std::endl;
+    }
+  catch (std::exception &e)
+    {
+      std::cerr << "Error: " << filename << ": " << e.what() << std::endl;
+      return ExitCodes::InvalidArgument;
+    }
+
+  return ExitCodes::Success;
+}
+
+static int
+assembleFile(const char *filename, const char *outputFilename)
+{
+  std::ifstream in(filename);
+  if (! in)
+    {
+      std::cerr << "Error: cannot open '" << filename << "'." << std::endl;
+      return ExitCodes::InvalidArgument;
+    }
+
+  std::string output = outputFilename != nullptr ? outputFilename
+      : fs::path(filename).replace_extension(".bin").string();
+  try
+    {
+      Assembler assembler;
+      assembler.assemble(in, filename);
+      assembler.writeELF(output);
+    }
+  catch (std::exception &e)
+    {
+      std::cerr << "Error: " << e.what() << std::endl;
+      return ExitCodes::InitializationError;
+    }
+
+  return ExitCodes::Success;
+}
+
 static void
 showHelp(const char *progName)
 {
   std::cerr << "Usage:" << std::endl;
-  std::cerr << progName << " [-d] [-p] [-r REGINIT] <programFilename>" << std::endl;
+  std::cerr << progName << " [-d] [-p] [-C] [-f] [-R] [-H] [-o PROFILE] [-T TRACE] [-e TRACE] [-j JSON] [-s CSV] [-I N] [-M N] [-c CORES [-q QUANTUM]] [-u UNIT=LAT[:II]] [-P PLUGIN] [-A custN=ACCEL] [-i FUNCS] [-g BANKS] [-r REGINIT] <programFilename>" << std::endl;
   std::cerr << "    or" << std::endl;
-  std::cerr << progName << " [-d] [-p] -t <testFilename>" << std::endl;
+  std::cerr << progName << " [-d] [-p] [-C] [-f] [-R] [-H] [-o PROFILE] [-T TRACE] [-e TRACE] [-j JSON] [-s CSV] [-I N] [-M N] [-c CORES [-q QUANTUM]] [-u UNIT=LAT[:II]] [-P PLUGIN] [-A custN=ACCEL] [-i FUNCS] [-g BANKS] -t <testFilename>" << std::endl;
   std::cerr << "    or" << std::endl;
   std::cerr << progName << " -x <instruction>" << std::endl;
   std::cerr << "    or" << std::endl;
   std::cerr << progName << " -X <filename>" << std::endl;
+  std::cerr << "    or" << std::endl;
+  std::cerr << progName << " -K <trace> | -O <trace>" << std::endl;
+  std::cerr << "    or" << std::endl;
+  std::cerr << progName << " -E <trace>" << std::endl;
+  std::cerr << "    or" << std::endl;
+  std::cerr << progName << " -a <source> [output]" << std::endl;
   std::cerr <<
 R"HERE(
     -d, enables debug mode in which every decoded instruction is printed
         to the terminal.
     -p, enables pipelining. When omitted, the emulator runs in non-pipelined
-        mode.
+        mode. Exceptions and interrupts are not supported with pipelining:
+        programs using l.sys, l.trap or l.rfe are rejected, and the run
+        fails when an exception is raised or an interrupt is pending.
+    -C, enables the data cache model: private L1 data caches per core,
+        kept coherent using MESI, with a shared L2 cache.
+    -f, fast-forwards spin loops: when an iteration of a loop leaves the
+        architectural state unchanged, the iterations up to the next
+        device event are skipped. Only without pipelining.
+    -R, models timing only inside the regions of interest that the
+        program marks by writing their ID to the system status module
+        (0x27c to begin, 0x280 to end). Outside, instructions execute in
+        a single cycle without stalls. Only without pipelining.
+    -H, profiles the emulator itself: host cycles, instructions and
+        cache misses (or, when perf_event_open is not permitted, time
+        stamp counter ticks) spent in each pipeline stage, the memory bus
+        and its clients, and host nanoseconds per simulated instruction.
+        Slows down the emulator.
+    -o, profiles the program: cycles, instructions, stall cycles and
+        data memory traffic per instruction and per function, including
+        the costs of the functions called, are written to PROFILE.callgrind
+        (for KCachegrind) and PROFILE.pb (for pprof). With multiple
+        cores, a profile is written per core to PROFILE.coreN.*. Only
+        without pipelining.
+    -T, writes a binary trace to TRACE with, per instruction, the cycles
+        in which it entered each pipeline stage and left the pipeline,
+        its stall cycles and whether an exception squashed it. With
+        multiple cores, a trace is written per core to TRACE.coreN.
+    -e, --trace, writes a compressed binary trace to TRACE with, per
+        retired instruction, its PC and instruction word, the registers
+        it wrote, its memory access and its branch outcome. With multiple
+        cores, a trace is written per core to TRACE.coreN. Only without
+        pipelining.
+    -j, --stats-json, writes all statistics to JSON: the description of
+        every statistic, followed by the snapshots with their cycle.
+    -s, --stats-csv, writes all statistics to CSV, with a row per
+        statistic per snapshot: snapshot,cycle,name,value.
+    -I, --stats-interval, takes a snapshot of the statistics every N
+        cycles, in addition to the one at the end. With multiple cores,
+        snapshots are taken at the end of the quantum in which the
+        interval elapsed.
+    -M, --telemetry, publishes cycles, instructions, PC, CPI and host
+        MIPS per core every N cycles in shared memory /rv64-emu.PID,
+        for display by rv64-emu-top.
+    -c, specifies the number of cores CORES. Every core runs on its own
+        host thread and all cores share memory and devices.
+    -q, specifies the time quantum in clock cycles after which the cores
+        of a multi-core system synchronize (default: 1000). Stores to
+        shared memory become visible to the other cores at these points,
+        in core order, and l.swa waits for them.
     -r, specifies a register initializer REGINIT, in the form
         rX=Y with X a register number and Y the initializer value.
+    -u, overrides the latency LAT and initiation interval II of the
+        functional unit UNIT ("mul", "div", "mac", "fpu", "fdiv" or
+        "simd"). When II is omitted, the unit is fully pipelined.
+        Defaults: mul=3:1, div=32:32, mac=3:1, fpu=4:1, fdiv=16:16,
+        simd=1:1.
+    -P, loads accelerator plugin PLUGIN, a shared object exporting
+        rv64emu_register_accelerators().
+    -A, attaches accelerator ACCEL to custom instruction l.custN, with
+        N from 1 to 8. Built-in accelerators are "popcount" and "crc32".
+    -i, runs the comma-separated library routines FUNCS ("memcpy",
+        "memset", "strlen" and "memcmp") on the host instead of the
+        program's own code, found through the ELF symbol table. Only
+        supported without pipelining.
+    -g, provides BANKS banks of general-purpose registers (at most 16).
+        SR[CID] selects the bank; exceptions switch to bank 0.
     -t, enables unit test mode, with testFilename a unit test
         configuration file.
     -x, disassembles (decodes) a single instruction specified as
@@ -297,6 +829,16 @@ R"HERE(
     -X, disassembles 'filename' which is either an ELF file (in which case
         the text segment is disassembled) or an ASCII file with hexadecimal
         numbers.
+    -K, converts pipeline trace 'trace' to the Konata format.
+    -O, converts pipeline trace 'trace' to gem5's O3PipeView format, at
+        1000 ticks per cycle.
+    -E, --trace-dump, prints instruction trace 'trace' as text.
+    -a, assembles OpenRISC assembly file 'source' into an ELF executable
+        'output', by default 'source' with extension .bin. All symbols
+        must be defined in the source; the text is placed at 0x10000
+        and the data at 0x11100, as by tests/Makefile.
+
+Sending SIGUSR1 to a running emulator dumps its statistics to stderr.
 )HERE";
 }
 
@@ -311,11 +853,47 @@ main(int argc, char **argv)
   const char *testFilename = nullptr;
   const char *disasmArg = nullptr;
   bool disasmAsFile = false;
+  unsigned int nCores = 1;
+  uint64_t quantum = 1000;
+  bool cacheModel = false;
+  bool fastForward = false;
+  bool regionMode = false;
+  const char *profilePrefix = nullptr;
+  const char *pipeTraceFilename = nullptr;
+  const char *instTraceFilename = nullptr;
+  const char *dumpTraceArg = nullptr;
+  const char *convertTraceArg = nullptr;
+  const char *assembleArg = nullptr;
+  StatsOptions statsOptions;
+  uint64_t telemetryInterval = 0;
+  bool hostProfile = false;
+  bool convertToKonata = false;
+  unsigned int registerBanks = 1;
+  std::vector<FunctionalUnitConfig> unitConfigs;
+  std::vector<AcceleratorBinding> accelerators;
+  std::vector<std::string> plugins;
+  std::vector<HostFunction> hostFunctions;
 
   /* Command line option processing */
   const char *progName = argv[0];
 
-  while ((c = getopt(argc, argv, "dpr:t:x:X:h")) != -1)
+  const char *options = "a:dpA:Cc:e:E:fg:Hi:I:j:K:M:o:O:P:q:Rr:s:t:T:u:x:X:h";
+#ifdef _MSC_VER
+  while ((c = getopt(argc, argv, options)) != -1)
+#else
+  static const struct option longOptions[] =
+    {
+      { "stats-json", required_argument, nullptr, 'j' },
+      { "stats-csv", required_argument, nullptr, 's' },
+      { "stats-interval", required_argument, nullptr, 'I' },
+      { "telemetry", required_argument, nullptr, 'M' },
+      { "trace", required_argument, nullptr, 'e' },
+      { "trace-dump", required_argument, nullptr, 'E' },
+      { nullptr, 0, nullptr, 0 }
+    };
+
+  while ((c = getopt_long(argc, argv, options, longOptions, nullptr)) != -1)
+#endif
     {
       switch (c)
         {
@@ -327,6 +905,127 @@ main(int argc, char **argv)
             pipelining = true;
             break;
 
+          case 'C':
+            cacheModel = true;
+            break;
+
+          case 'f':
+            fastForward = true;
+            break;
+
+          case 'R':
+            regionMode = true;
+            break;
+
+          case 'o':
+            profilePrefix = optarg;
+            break;
+
+          case 'H':
+            hostProfile = true;
+            break;
+
+          case 'T':
+            pipeTraceFilename = optarg;
+            break;
+
+          case 'e':
+            instTraceFilename = optarg;
+            break;
+
+          case 'E':
+            dumpTraceArg = optarg;
+            break;
+
+          case 'j':
+            statsOptions.jsonFilename = optarg;
+            break;
+
+          case 's':
+            statsOptions.csvFilename = optarg;
+            break;
+
+          case 'I':
+            try
+              {
+                statsOptions.interval = std::stoull(optarg);
+                if (statsOptions.interval < 1)
+                  throw std::out_of_range(optarg);
+              }
+            catch (std::exception &)
+              {
+                std::cerr << "Error: Invalid statistics interval "
+                          << optarg << std::endl;
+                return ExitCodes::InvalidArgument;
+              }
+            break;
+
+          case 'M':
+            try
+              {
+                telemetryInterval = std::stoull(optarg);
+                if (telemetryInterval < 1)
+                  throw std::out_of_range(optarg);
+              }
+            catch (std::exception &)
+              {
+                std::cerr << "Error: Invalid telemetry interval "
+                          << optarg << std::endl;
+                return ExitCodes::InvalidArgument;
+              }
+            break;
+
+          case 'K':
+          case 'O':
+            convertTraceArg = optarg;
+            convertToKonata = c == 'K';
+            break;
+
+          case 'g':
+            try
+              {
+                registerBanks = std::stoul(optarg);
+                if (registerBanks < 1 || registerBanks > RegisterFile::MaxBanks)
+                  throw std::out_of_range(optarg);
+              }
+            catch (std::exception &)
+              {
+                std::cerr << "Error: Invalid number of register banks "
+                          << optarg << std::endl;
+                return ExitCodes::InvalidArgument;
+              }
+            break;
+
+          case 'c':
+            try
+              {
+                nCores = std::stoul(optarg);
+                if (nCores < 1)
+                  throw std::out_of_range(optarg);
+              }
+            catch (std::exception &)
+              {
+                std::cerr << "Error: Invalid number of cores "
+                          << optarg << std::endl;
+                return ExitCodes::InvalidArgument;
+              }
+            break;
+
+          case 'q':
+            try
+              {
+                quantum = std::stoull(optarg);
+                if (quantum < 1)
+                  throw std::out_of_range(optarg);
+              }
+            catch (std::exception &)
+              {
+                std::cerr << "Error: Invalid time quantum "
+                          << optarg << std::endl;
+                return ExitCodes::InvalidArgument;
+              }
+            break;
+
           case 'r':
             if (testFilename != nullptr)
               {
@@ -359,6 +1058,60 @@ main(int argc, char **argv)
             testFilename = optarg;
             break;
 
+          case 'u':
+            try
+              {
+                unitConfigs.emplace_back(std::string_view(optarg));
+              }
+            catch (std::exception &)
+              {
+                std::cerr << "Error: Malformed functional unit specifier "
+                          << optarg << std::endl;
+                return ExitCodes::InvalidArgument;
+              }
+            break;
+
+          case 'A':
+            try
+              {
+                accelerators.emplace_back(std::string_view(optarg));
+              }
+            catch (std::exception &)
+              {
+                std::cerr << "Error: Malformed accelerator binding "
+                          << optarg << std::endl;
+                return ExitCodes::InvalidArgument;
+              }
+            break;
+
+          case 'P':
+            plugins.emplace_back(optarg);
+            break;
+
+          case 'i':
+            try
+              {
+                std::string_view list(optarg);
+                while (! list.empty())
+                  {
+                    const size_t comma = std::min(list.find(','), list.size());
+                    hostFunctions.push_back(
+                        HostCallInterceptor::getFunction(list.substr(0, comma)));
+                    list.remove_prefix(std::min(comma + 1, list.size()));
+                  }
+              }
+            catch (std::exception &)
+              {
+                std::cerr << "Error: Unsupported host routine in "
+                          << optarg << std::endl;
+                return ExitCodes::InvalidArgument;
+              }
+            break;
+
+          case 'a':
+            assembleArg = optarg;
+            break;
+
           case 'x':
             if (disasmArg != nullptr)
               {
@@ -402,6 +1155,68 @@ main(int argc, char **argv)
       return disasmSingle(disasmArg);
     }
 
+  if (convertTraceArg != nullptr)
+    return convertPipeTrace(convertTraceArg, convertToKonata);
+
+  if (dumpTraceArg != nullptr)
+    return dumpInstructionTrace(dumpTraceArg);
+
+  if (assembleArg != nullptr)
+    return assembleFile(assembleArg, argc > 0 ? argv[0] : nullptr);
+
+  if (pipelining and ! hostFunctions.empty())
+    {
+      std::cerr << "Error: Host routines cannot be used with pipelining."
+                << std::endl;
+      return ExitCodes::InvalidArgument;
+    }
+
+  if (pipelining and fastForward)
+    {
+      std::cerr << "Error: Spin loops cannot be fast-forwarded with pipelining."
+                << std::endl;
+      return ExitCodes::InvalidArgument;
+    }
+
+  if (pipelining and regionMode)
+    {
+      std::cerr << "Error: Regions of interest cannot be used with pipelining."
+                << std::endl;
+      return ExitCodes::InvalidArgument;
+    }
+
+  if (pipelining and profilePrefix)
+    {
+      std::cerr << "Error: Profiling is not supported with pipelining."
+                << std::endl;
+      return ExitCodes::InvalidArgument;
+    }
+
+  if (pipelining and instTraceFilename)
+    {
+      std::cerr << "Error: Instruction tracing is not supported with pipelining."
+                << std::endl;
+      return ExitCodes::InvalidArgument;
+    }
+
+#ifndef _MSC_VER
+  std::signal(SIGUSR1, requestStatistics);
+#endif
+
+  /* Plugins register their accelerators before any is attached. */
+  for (auto &plugin : plugins)
+    {
+      try
+        {
+          AcceleratorRegistry::instance().loadPlugin(plugin);
+        }
+      catch (std::exception &e)
+        {
+          std::cerr << "Error: " << e.what() << std::endl;
+          return ExitCodes::InitializationError;
+        }
+    }
+
   if (!testFilename and argc < 1)
     {
       std::cerr << "Error: No executable specified." << std::endl << std::endl;
@@ -412,5 +1227,9 @@ main(int argc, char **argv)
   // static_cast<int>(launcher(testFilename, argv[0], pipelining,
   //                 debugMode, initializers)) << "\n";
   return launcher(testFilename, argv[0], pipelining,
-                  debugMode, initializers);
+                  debugMode, initializers, nCores, quantum,
+                  cacheModel, unitConfigs, accelerators,
+                  hostFunctions, fastForward, registerBanks,
+                  regionMode, profilePrefix, pipeTraceFilename,
+                  instTraceFilename, statsOptions, telemetryInterval, hostProfile);
 }
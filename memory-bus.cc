@@ -7,9 +7,10 @@
 
 #include "memory-bus.h"
 #include <iostream>
+#include <map>
 
 MemoryBus::MemoryBus(std::vector<std::unique_ptr<MemoryInterface> > &&clients)
-  : clients{ std::move(clients) }
+  : clients{ std::move(clients) }, traffic(this->clients.size())
 {
 }
 
@@ -18,7 +19,10 @@ MemoryBus::~MemoryBus() = default;
 void
 MemoryBus::addClient(std::unique_ptr<MemoryInterface> client)
 {
+  if (scheduler)
+    client->attachScheduler(*scheduler, *busClock);
   clients.emplace_back(std::move(client));
+  traffic.emplace_back();
 }
 
 uint64_t
@@ -33,61 +37,167 @@ MemoryBus::getBytesWritten() const
   return bytesWritten;
 }
 
+void
+MemoryBus::registerStatistics(StatsRegistry &stats,
+                              const std::string &prefix) const
+{
+  stats.addCounter(prefix + ".bytesRead", bytesRead, "bytes read from the bus");
+  stats.addCounter(prefix + ".bytesWritten", bytesWritten,
+                   "bytes written to the bus");
+
+  std::map<std::string, unsigned int> numbers;
+  for (size_t i = 0; i < clients.size(); ++i)
+    {
+      const std::string name = clients[i]->getName();
+      const std::string path = prefix + '.' + name +
+          std::to_string(numbers[name]++);
+      stats.addCounter(path + ".bytesRead",
+                       [this, i] { return traffic[i].bytesRead; },
+                       "bytes read from " + name);
+      stats.addCounter(path + ".bytesWritten",
+                       [this, i] { return traffic[i].bytesWritten; },
+                       "bytes written to " + name);
+    }
+}
+
+bool
+MemoryBus::isCacheable(MemAddress addr) noexcept
+{
+  const size_t i = findClient(addr);
+  return i < clients.size() && clients[i]->isCacheable();
+}
+
 
 uint8_t
 MemoryBus::readByte(MemAddress addr)
 {
+  HostProfileScope scope(hostProfiler, HostRegion::bus);
+  const size_t i = getClient(addr);
   bytesRead += 1;
-  return getClient(addr)->readByte(addr);
+  traffic[i].bytesRead += 1;
+  HostProfileScope client(hostProfiler, getClientRegion(i));
+  return clients[i]->readByte(addr);
 }
 
 uint16_t
 MemoryBus::readHalfWord(MemAddress addr)
 {
+  HostProfileScope scope(hostProfiler, HostRegion::bus);
+  const size_t i = getClient(addr);
   bytesRead += 2;
-  return getClient(addr)->readHalfWord(addr);
+  traffic[i].bytesRead += 2;
+  HostProfileScope client(hostProfiler, getClientRegion(i));
+  return clients[i]->readHalfWord(addr);
 }
 
 uint32_t
 MemoryBus::readWord(MemAddress addr)
 {
+  HostProfileScope scope(hostProfiler, HostRegion::bus);
+  const size_t i = getClient(addr);
   bytesRead += 4;
-  return getClient(addr)->readWord(addr);
+  traffic[i].bytesRead += 4;
+  HostProfileScope client(hostProfiler, getClientRegion(i));
+  return clients[i]->readWord(addr);
 }
 
 uint64_t
 MemoryBus::readDoubleWord(MemAddress addr)
 {
+  HostProfileScope scope(hostProfiler, HostRegion::bus);
+  const size_t i = getClient(addr);
   bytesRead += 8;
-  return getClient(addr)->readDoubleWord(addr);
+  traffic[i].bytesRead += 8;
+  HostProfileScope client(hostProfiler, getClientRegion(i));
+  return clients[i]->readDoubleWord(addr);
 }
 
 void
 MemoryBus::writeByte(MemAddress addr, uint8_t value)
 {
+  HostProfileScope scope(hostProfiler, HostRegion::bus);
+  const size_t i = getClient(addr);
   bytesWritten += 1;
-  return getClient(addr)->writeByte(addr, value);
+  traffic[i].bytesWritten += 1;
+  HostProfileScope client(hostProfiler, getClientRegion(i));
+  return clients[i]->writeByte(addr, value);
 }
 
 void
 MemoryBus::writeHalfWord(MemAddress addr, uint16_t value)
 {
+  HostProfileScope scope(hostProfiler, HostRegion::bus);
+  const size_t i = getClient(addr);
   bytesWritten += 2;
-  return getClient(addr)->writeHalfWord(addr, value);
+  traffic[i].bytesWritten += 2;
+  HostProfileScope client(hostProfiler, getClientRegion(i));
+  return clients[i]->writeHalfWord(addr, value);
 }
 
 void
 MemoryBus::writeWord(MemAddress addr, uint32_t value)
 {
+  HostProfileScope scope(hostProfiler, HostRegion::bus);
+  const size_t i = getClient(addr);
   bytesWritten += 4;
-  return getClient(addr)->writeWord(addr, value);
+  traffic[i].bytesWritten += 4;
+  HostProfileScope client(hostProfiler, getClientRegion(i));
+  return clients[i]->writeWord(addr, value);
 }
 
 void
 MemoryBus::writeDoubleWord(MemAddress addr, uint64_t value)
 {
+  HostProfileScope scope(hostProfiler, HostRegion::bus);
+  const size_t i = getClient(addr);
   bytesWritten += 8;
-  return getClient(addr)->writeDoubleWord(addr, value);
+  traffic[i].bytesWritten += 8;
+  HostProfileScope client(hostProfiler, getClientRegion(i));
+  return clients[i]->writeDoubleWord(addr, value);
+}
+
+bool
+MemoryBus::compareAndSwapWord(MemAddress addr, uint32_t expected,
+                              uint32_t desired)
+{
+  const size_t i = getClient(addr);
+  bytesRead += 4;
+  traffic[i].bytesRead += 4;
+  if (! clients[i]->compareAndSwapWord(addr, expected, desired))
+    return false;
+
+  bytesWritten += 4;
+  traffic[i].bytesWritten += 4;
+  return true;
+}
+
+void
+MemoryBus::countHostAccess(MemAddress addr, uint64_t size, bool write)
+{
+  const size_t i = getClient(addr);
+  if (write)
+    {
+      bytesWritten += size;
+      traffic[i].bytesWritten += size;
+    }
+  else
+    {
+      bytesRead += size;
+      traffic[i].bytesRead += size;
+    }
+}
+
+std::byte *
+MemoryBus::getHostPointer(MemAddress addr, bool write, size_t &extent)
+{
+  const size_t i = findClient(addr);
+  if (i == clients.size())
+    {
+      extent = 0;
+      return nullptr;
+    }
+
+  return clients[i]->getHostPointer(addr, write, extent);
 }
 
 bool
@@ -98,31 +208,35 @@ MemoryBus::contains(MemAddress addr) const
 }
 
 void
-MemoryBus::clockPulse()
+MemoryBus::attachScheduler(EventScheduler &scheduler,
+                           const ClockDomain &busClock)
 {
+  this->scheduler = &scheduler;
+  this->busClock = &busClock;
+
   for (auto &client : clients)
-    client->clockPulse();
+    client->attachScheduler(scheduler, busClock);
 }
 
 /*
  * Private methods
  */
-MemoryInterface *
-MemoryBus::findClient(MemAddress addr) noexcept
+size_t
+MemoryBus::findClient(MemAddress addr) const noexcept
 {
-  for (auto &client : clients)
-    if (client->contains(addr))
-      return client.get();
+  for (size_t i = 0; i < clients.size(); ++i)
+    if (clients[i]->contains(addr))
+      return i;
 
-  return nullptr;
+  return clients.size();
 }
 
-MemoryInterface *
-MemoryBus::getClient(MemAddress addr)
+size_t
+MemoryBus::getClient(MemAddress addr) const
 {
-  auto *client = findClient(addr);
-  if (!client)
+  const size_t i = findClient(addr);
+  if (i == clients.size())
     throw IllegalAccess(addr);
 
-  return client;
+  return i;
 }
@@ -8,7 +8,9 @@
 #ifndef __MEMORY_BUS_H__
 #define __MEMORY_BUS_H__
 
+#include "host-profiler.h"
 #include "memory-interface.h"
+#include "stats.h"
 
 #include <memory>
 #include <vector>
@@ -19,11 +21,29 @@ class MemoryBus : public MemoryInterface
     MemoryBus(std::vector<std::unique_ptr<MemoryInterface> > &&clients);
     ~MemoryBus() override;
 
+    MemoryBus(const MemoryBus &) = delete;
+    MemoryBus &operator=(const MemoryBus &) = delete;
+
     void addClient(std::unique_ptr<MemoryInterface> client);
 
     uint64_t getBytesRead() const;
     uint64_t getBytesWritten() const;
 
+    /* Bytes read and written per client, named after the client and
+     * numbered per name, e.g. prefix.data1.bytesRead.
+     */
+    void registerStatistics(StatsRegistry &stats, const std::string &prefix) const;
+
+    bool isCacheable(MemAddress addr) noexcept;
+
+    /* Count an access through getHostPointer, which bypasses the bus,
+     * as traffic of the client containing addr.
+     */
+    void countHostAccess(MemAddress addr, uint64_t size, bool write);
+
+    /* Attribute host time to dispatch and to the clients. */
+    void setHostProfiler(HostProfiler *profiler) { hostProfiler = profiler; }
+
     /* MemoryInterface */
     uint8_t readByte(MemAddress addr) override;
     uint16_t readHalfWord(MemAddress addr) override;
@@ -36,14 +56,45 @@ class MemoryBus : public MemoryInterface
     void writeDoubleWord(MemAddress addr, uint64_t value) override;
 
     bool contains(MemAddress addr) const override;
+    std::string getName() const override { return "bus"; }
+
+    bool compareAndSwapWord(MemAddress addr, uint32_t expected,
+                            uint32_t desired) override;
 
-    void clockPulse() override;
+    std::byte *getHostPointer(MemAddress addr, bool write,
+                              size_t &extent) override;
+
+    /* Attaches all current and future clients. */
+    void attachScheduler(EventScheduler &scheduler,
+                         const ClockDomain &busClock) override;
 
   private:
     std::vector<std::unique_ptr<MemoryInterface> > clients;
 
-    MemoryInterface *findClient(MemAddress addr) noexcept;
-    MemoryInterface *getClient(MemAddress addr);
+    /* Traffic per client, in the same order */
+    struct Traffic
+    {
+      uint64_t bytesRead{};
+      uint64_t bytesWritten{};
+    };
+
+    std::vector<Traffic> traffic;
+
+    HostProfiler *hostProfiler{};    /* no ownership */
+
+    /* Does not consult the client when not profiling. */
+    HostRegion getClientRegion(size_t i) const
+    {
+      return hostProfiler && clients[i]->isCacheable()
+          ? HostRegion::memory : HostRegion::devices;
+    }
+
+    EventScheduler *scheduler{};     /* no ownership */
+    const ClockDomain *busClock{};
+
+    /* Index of the client containing addr, or the number of clients. */
+    size_t findClient(MemAddress addr) const noexcept;
+    size_t getClient(MemAddress addr) const;
 
     uint64_t bytesRead = 0;     /* Bytes read from bus */
     uint64_t bytesWritten = 0;  /* Bytes written to bus */
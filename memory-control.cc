@@ -45,8 +45,9 @@ InstructionMemory::getValue() const
 }
 
 
-DataMemory::DataMemory(MemoryBus &bus)
-  : bus{ bus }
+DataMemory::DataMemory(MemoryBus &bus, ReservationMonitor &monitor,
+                       unsigned int coreId)
+  : bus{ bus }, monitor{ monitor }, coreId{ coreId }
 {
 }
 
@@ -155,4 +156,31 @@ DataMemory::clockPulse() const
   default:
     throw std::invalid_argument{"Invalid size to write."};
   }
+
+  monitor.snoopStore(coreId, addr, size);
+}
+
+RegValue
+DataMemory::loadLinked()
+{
+  monitor.reserve(coreId, addr);
+  linkedValue = bus.readWord(addr);
+  return linkedValue;
+}
+
+bool
+DataMemory::storeConditional()
+{
+  if (! monitor.consume(coreId, addr))
+    return false;
+
+  /* The compare-and-swap catches any store that bypassed the
+   * reservation monitor. In a multi-core system, it is decided at the
+   * end of the time quantum.
+   */
+  if (! bus.compareAndSwapWord(addr, linkedValue, selectLowest32(dataIn)))
+    return false;
+
+  monitor.snoopStore(coreId, addr, 4);
+  return true;
 }
@@ -9,6 +9,7 @@
 #define __MEMORY_CONTROL_H__
 
 #include "memory-bus.h"
+#include "reservation-monitor.h"
 
 
 class InstructionMemory
@@ -31,7 +32,8 @@ class InstructionMemory
 class DataMemory
 {
   public:
-    DataMemory(MemoryBus &bus);
+    DataMemory(MemoryBus &bus, ReservationMonitor &monitor,
+               unsigned int coreId);
 
     void setSize(uint8_t size);
     void setAddress(MemAddress addr);
@@ -41,11 +43,26 @@ class DataMemory
 
     RegValue getDataOut(bool signExtend) const;
 
+    MemAddress getAddress() const { return addr; }
+    uint8_t getSize() const { return size; }
+    bool isCacheable() const { return bus.isCacheable(addr); }
+
     void clockPulse() const;
 
+    /* Atomic word accesses for l.lwa and l.swa. */
+    RegValue loadLinked();
+    bool storeConditional();
+
 
   private:
     MemoryBus &bus;
+    ReservationMonitor &monitor;
+    const unsigned int coreId;
+
+    /* Value observed by the last load-linked, used to detect intervening
+     * stores that bypassed the reservation monitor.
+     */
+    RegValue linkedValue{};
 
     uint8_t size{};
     MemAddress addr{};
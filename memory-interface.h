@@ -15,8 +15,12 @@
 #include <sstream>
 #include <iomanip>
 
+#include <cstddef>
 #include <cstdint>
 
+class ClockDomain;
+class EventScheduler;
+
 class MemoryInterface
 {
   public:
@@ -32,7 +36,41 @@ class MemoryInterface
 
     virtual bool contains(MemAddress addr) const = 0;
 
-    virtual void clockPulse() { }
+    /* Name of the client in statistics. */
+    virtual std::string getName() const { return "device"; }
+
+    /* Whether accesses to this client may be cached. Only true for
+     * regular memories, devices are uncached.
+     */
+    virtual bool isCacheable() const { return false; }
+
+    /* Atomically replace the word at addr with desired, if it currently
+     * holds expected. Returns whether the swap took place. Only regular
+     * memories support this; devices throw.
+     */
+    virtual bool compareAndSwapWord(MemAddress addr, uint32_t expected,
+                                    uint32_t desired);
+
+    /* Direct host access to guest memory, for emulator functions that
+     * operate on guest data in bulk. Returns a pointer to addr and sets
+     * extent to the number of bytes that may be accessed from there, or
+     * returns nullptr if this client is not a plain memory or does not
+     * allow the requested kind of access.
+     */
+    virtual std::byte *getHostPointer(MemAddress addr, bool write,
+                                      size_t &extent)
+    {
+      extent = 0;
+      return nullptr;
+    }
+
+    /* Devices are not clocked. Those that act on their own schedule
+     * events, typically in the bus clock domain, on the scheduler they
+     * are attached to.
+     */
+    virtual void attachScheduler(EventScheduler &scheduler,
+                                 const ClockDomain &busClock)
+    { }
 
     virtual ~MemoryInterface() = default;
 };
@@ -74,4 +112,10 @@ class IllegalAccess : public std::exception
     std::string message{};
 };
 
+inline bool
+MemoryInterface::compareAndSwapWord(MemAddress addr, uint32_t, uint32_t)
+{
+  throw IllegalAccess("Atomic access not supported at " + std::to_string(addr));
+}
+
 #endif /* __MEMORY_INTERFACE_H__ */
@@ -10,6 +10,7 @@
 #include <cstdlib>
 
 #ifdef _MSC_VER
+#include <intrin.h>
 #define __builtin_bswap64 _byteswap_uint64
 #define __builtin_bswap32 _byteswap_ulong
 #define __builtin_bswap16 _byteswap_ushort
@@ -114,12 +115,46 @@ Memory::writeDoubleWord(MemAddress addr, uint64_t value)
   writeData(addr, __builtin_bswap64(value));
 }
 
+bool
+Memory::compareAndSwapWord(MemAddress addr, uint32_t expected,
+                           uint32_t desired)
+{
+  if (! canAccess(addr, sizeof(uint32_t), true))
+    throw IllegalAccess(addr, sizeof(uint32_t));
+  if (addr % sizeof(uint32_t) != 0)
+    throw IllegalAccess("Unaligned atomic access at " + std::to_string(addr));
+
+  auto *ptr = reinterpret_cast<uint32_t *>(data + (addr - base));
+  uint32_t expectedBE = __builtin_bswap32(expected);
+
+#ifdef _MSC_VER
+  return _InterlockedCompareExchange(reinterpret_cast<volatile long *>(ptr),
+                                     __builtin_bswap32(desired),
+                                     expectedBE) == static_cast<long>(expectedBE);
+#else
+  return __atomic_compare_exchange_n(ptr, &expectedBE,
+                                     __builtin_bswap32(desired), false,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#endif
+}
+
 bool
 Memory::contains(MemAddress addr) const
 {
   return base <= addr && addr < base + size;
 }
 
+std::byte *
+Memory::getHostPointer(MemAddress addr, bool write, size_t &extent)
+{
+  extent = 0;
+  if (! canAccess(addr, 1, write))
+    return nullptr;
+
+  extent = base + size - addr;
+  return data + (addr - base);
+}
+
 
 /*
  * Private methods
@@ -38,7 +38,14 @@ class Memory : public MemoryInterface
     void writeDoubleWord(MemAddress addr, uint64_t value) override;
 
     bool contains(MemAddress addr) const override;
+    std::string getName() const override { return name; }
+    bool isCacheable() const override { return true; }
 
+    bool compareAndSwapWord(MemAddress addr, uint32_t expected,
+                            uint32_t desired) override;
+
+    std::byte *getHostPointer(MemAddress addr, bool write,
+                              size_t &extent) override;
 
     Memory(const Memory &) = delete;
     Memory &operator=(const Memory &) = delete;
@@ -0,0 +1,455 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    multicore.cc - Multi-core system with cores on separate host threads.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#include "multicore.h"
+#include "serial.h"
+#include "framebuffer.h"
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include <unordered_set>
+
+
+/*
+ * SharedMemoryPort
+ */
+
+SharedMemoryPort::SharedMemoryPort(MemoryInterface &target,
+                                   CompareAndSwapHandler compareAndSwapHandler)
+  : target{ target },
+    compareAndSwapHandler{ std::move(compareAndSwapHandler) }
+{
+}
+
+uint8_t
+SharedMemoryPort::readByte(MemAddress addr)
+{
+  return forward(addr, 1, target.readByte(addr));
+}
+
+uint16_t
+SharedMemoryPort::readHalfWord(MemAddress addr)
+{
+  return forward(addr, 2, target.readHalfWord(addr));
+}
+
+uint32_t
+SharedMemoryPort::readWord(MemAddress addr)
+{
+  return forward(addr, 4, target.readWord(addr));
+}
+
+uint64_t
+SharedMemoryPort::readDoubleWord(MemAddress addr)
+{
+  return forward(addr, 8, target.readDoubleWord(addr));
+}
+
+void
+SharedMemoryPort::writeByte(MemAddress addr, uint8_t value)
+{
+  buffer(addr, 1, value);
+}
+
+void
+SharedMemoryPort::writeHalfWord(MemAddress addr, uint16_t value)
+{
+  buffer(addr, 2, value);
+}
+
+void
+SharedMemoryPort::writeWord(MemAddress addr, uint32_t value)
+{
+  buffer(addr, 4, value);
+}
+
+void
+SharedMemoryPort::writeDoubleWord(MemAddress addr, uint64_t value)
+{
+  buffer(addr, 8, value);
+}
+
+std::byte *
+SharedMemoryPort::getHostPointer(MemAddress addr, bool write,
+                                 size_t &extent)
+{
+  if (write || ! stores.empty())
+    {
+      extent = 0;
+      return nullptr;
+    }
+
+  return target.getHostPointer(addr, false, extent);
+}
+
+void
+SharedMemoryPort::commit(const std::function<void(MemAddress, size_t)> &onStore)
+{
+  if (stores.empty())
+    return;
+
+  /* Empty the buffer first, in case the target refuses a store. */
+  std::vector<Store> pending;
+  pending.swap(stores);
+  buffered.clear();
+
+  for (const auto &[addr, size, value] : pending)
+    {
+      switch (size)
+        {
+          case 1:
+            target.writeByte(addr, value);
+            break;
+          case 2:
+            target.writeHalfWord(addr, value);
+            break;
+          case 4:
+            target.writeWord(addr, value);
+            break;
+          default:
+            target.writeDoubleWord(addr, value);
+            break;
+        }
+
+      onStore(addr, size);
+    }
+
+  /* Keep the capacity for the next quantum. */
+  pending.clear();
+  stores.swap(pending);
+}
+
+/* Replace the bytes of the loaded big-endian value that are still in the
+ * store buffer.
+ */
+uint64_t
+SharedMemoryPort::forward(MemAddress addr, size_t size, uint64_t value) const
+{
+  if (buffered.empty())
+    return value;
+
+  for (size_t i = 0; i < size; ++i)
+    {
+      const MemAddress byteAddr = addr + i;
+      auto it = buffered.find(byteAddr & ~MemAddress{ 7 });
+      if (it == buffered.end() || ! (it->second.valid & (1u << (byteAddr & 7))))
+        continue;
+
+      const unsigned int shift = 8 * (size - 1 - i);
+      value &= ~(uint64_t{ 0xff } << shift);
+      value |= uint64_t{ it->second.data[byteAddr & 7] } << shift;
+    }
+
+  return value;
+}
+
+void
+SharedMemoryPort::buffer(MemAddress addr, size_t size, uint64_t value)
+{
+  /* Refuse stores to memory right away, so that the error is reported
+   * for the instruction. Devices can only refuse when committed.
+   */
+  size_t extent;
+  if (target.isCacheable() &&
+      (! target.getHostPointer(addr, true, extent) || extent < size))
+    throw IllegalAccess(addr, size);
+
+  stores.push_back({ addr, size, value });
+
+  for (size_t i = 0; i < size; ++i)
+    {
+      const MemAddress byteAddr = addr + i;
+      BufferedBytes &bytes = buffered[byteAddr & ~MemAddress{ 7 }];
+      bytes.data[byteAddr & 7] = value >> (8 * (size - 1 - i));
+      bytes.valid |= 1u << (byteAddr & 7);
+    }
+}
+
+
+/*
+ * QuantumBarrier
+ */
+
+QuantumBarrier::QuantumBarrier(size_t nThreads,
+                               std::function<void()> completion)
+  : nThreads{ nThreads }, completion{ std::move(completion) }
+{
+}
+
+void
+QuantumBarrier::arriveAndWait()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  const uint64_t myGeneration = generation;
+
+  if (++arrived == nThreads)
+    {
+      completion();
+
+      arrived = 0;
+      ++generation;
+      cond.notify_all();
+      return;
+    }
+
+  cond.wait(lock, [this, myGeneration] { return generation != myGeneration; });
+}
+
+
+/*
+ * MultiCoreSystem
+ */
+
+MultiCoreSystem::MultiCoreSystem(ELFFile &program, unsigned int nCores,
+                                 uint64_t quantum, bool pipelining,
+                                 bool debugMode)
+  : quantum{ quantum }, busClock{ scheduler.addClockDomain("bus", 1, 5) },
+    sharedClients{ program.createMemories() },
+    monitor{ nCores }, ports(nCores), status(nCores, RunStatus::Running),
+    pendingSwaps(nCores)
+{
+  if (nCores == 0)
+    throw std::out_of_range("number of cores must be at least 1");
+  if (quantum == 0)
+    throw std::out_of_range("time quantum must be at least 1 cycle");
+
+  sharedClients.emplace_back(std::make_unique<Serial>(0x200));
+#ifdef ENABLE_FRAMEBUFFER
+  sharedClients.emplace_back(std::make_unique<Framebuffer>(0x800, 0x1000000));
+#endif
+
+  for (auto &client : sharedClients)
+    client->attachScheduler(scheduler, busClock);
+
+  for (unsigned int i = 0; i < nCores; ++i)
+    {
+      auto compareAndSwapHandler =
+          [this, i](MemoryInterface &target, MemAddress addr,
+                    uint32_t expected, uint32_t desired)
+            {
+              return compareAndSwap(i, target, addr, expected, desired);
+            };
+
+      std::vector<std::unique_ptr<MemoryInterface>> clients;
+      for (auto &client : sharedClients)
+        {
+          auto port = std::make_unique<SharedMemoryPort>(*client,
+                                                         compareAndSwapHandler);
+          ports[i].push_back(port.get());
+          clients.emplace_back(std::move(port));
+        }
+
+      cores.emplace_back(std::make_unique<Processor>(std::move(clients),
+                                                     program.getEntrypoint(),
+                                                     i, nCores, &monitor,
+                                                     pipelining, debugMode));
+    }
+}
+
+MultiCoreSystem::~MultiCoreSystem()
+{
+  /* Destroy the cores (and thus their ports) before the shared clients. */
+  cores.clear();
+}
+
+void
+MultiCoreSystem::enableCaches(const CacheConfig &config)
+{
+  caches = std::make_unique<CoherenceController>(config, cores.size());
+  for (auto &core : cores)
+    core->attachDataCache(caches->getL1(core->getCoreId()));
+}
+
+bool
+MultiCoreSystem::run(bool testMode)
+{
+  QuantumBarrier quantumBarrier(cores.size(), [this] { endOfQuantum(); });
+  barrier = &quantumBarrier;
+
+  std::vector<std::thread> threads;
+  for (unsigned int i = 0; i < cores.size(); ++i)
+    threads.emplace_back(&MultiCoreSystem::coreThread, this, i, testMode);
+
+  for (auto &thread : threads)
+    thread.join();
+
+  barrier = nullptr;
+
+  return std::all_of(status.begin(), status.end(),
+                     [](RunStatus s) { return s == RunStatus::Halted; });
+}
+
+/* Called by core coreId for l.swa. The core waits at the barrier for
+ * the end of the quantum, where the compare-and-swap is performed, and
+ * stalls for the remainder of the quantum.
+ */
+bool
+MultiCoreSystem::compareAndSwap(unsigned int coreId, MemoryInterface &target,
+                                MemAddress addr, uint32_t expected,
+                                uint32_t desired)
+{
+  /* The other cores no longer arrive at the barrier. */
+  if (finished)
+    return false;
+
+  pendingSwaps[coreId] = { &target, addr, expected, desired, false };
+  barrier->arriveAndWait();
+  cores[coreId]->waitForQuantumEnd();
+
+  return pendingSwaps[coreId].swapped;
+}
+
+/* Commit the stores of the quantum to the shared clients, core by core,
+ * followed by the l.swa of the core, if any. A compare-and-swap fails if
+ * a store to the same word was committed earlier at this barrier, as
+ * that would have cancelled the reservation.
+ */
+void
+MultiCoreSystem::commitStores()
+{
+  const bool anySwaps =
+      std::any_of(pendingSwaps.begin(), pendingSwaps.end(),
+                  [](const PendingCompareAndSwap &swap) { return swap.target; });
+  std::unordered_set<MemAddress> committedWords;
+
+  for (unsigned int i = 0; i < cores.size(); ++i)
+    {
+      auto onStore = [this, i, anySwaps, &committedWords](MemAddress addr,
+                                                          size_t size)
+        {
+          monitor.snoopCommittedStore(i, addr, size);
+          if (anySwaps)
+            for (MemAddress word = addr & ~MemAddress{ 3 }; word < addr + size;
+                 word += 4)
+              committedWords.insert(word);
+        };
+
+      try
+        {
+          for (auto *port : ports[i])
+            port->commit(onStore);
+
+          PendingCompareAndSwap &swap = pendingSwaps[i];
+          if (swap.target)
+            {
+              swap.swapped =
+                  committedWords.count(swap.addr & ~MemAddress{ 3 }) == 0 &&
+                  swap.target->compareAndSwapWord(swap.addr, swap.expected,
+                                                  swap.desired);
+              if (swap.swapped)
+                onStore(swap.addr, 4);
+              swap.target = nullptr;
+            }
+        }
+      catch (std::exception &e)
+        {
+          std::cerr << "ABNORMAL PROGRAM TERMINATION; core " << i << std::endl;
+          std::cerr << "Reason: " << e.what() << std::endl;
+          status[i] = RunStatus::Failed;
+        }
+    }
+}
+
+/* Executed by the last core to arrive at the barrier, while all other
+ * cores are waiting. The stores and cache transactions of the quantum
+ * that just passed are committed and events of the shared devices are
+ * run here.
+ */
+void
+MultiCoreSystem::endOfQuantum()
+{
+  commitStores();
+  if (caches)
+    caches->commit();
+
+  globalCycles += quantum;
+  scheduler.advanceTo(globalCycles - 1);
+
+  for (auto &[interval, next, handler] : intervalHandlers)
+    if (globalCycles >= next)
+      {
+        handler(globalCycles);
+        next = (globalCycles / interval + 1) * interval;
+      }
+
+  bool anyRunning = false;
+  for (auto s : status)
+    {
+      if (s == RunStatus::Failed)
+        {
+          finished = true;
+          return;
+        }
+      anyRunning |= s == RunStatus::Running;
+    }
+
+  finished = !anyRunning;
+}
+
+void
+MultiCoreSystem::coreThread(unsigned int coreId, bool testMode)
+{
+  Processor &core = *cores[coreId];
+
+  while (true)
+    {
+      if (status[coreId] == RunStatus::Running)
+        status[coreId] = core.runFor(quantum, testMode);
+
+      /* The run may have ended while the core waited for an l.swa. */
+      if (finished)
+        break;
+
+      barrier->arriveAndWait();
+      if (finished)
+        break;
+    }
+}
+
+void
+MultiCoreSystem::registerStatistics(StatsRegistry &stats) const
+{
+  stats.addCounter("cycles", globalCycles,
+                   "clock cycles, at quantum boundaries");
+  if (caches)
+    caches->registerStatistics(stats);
+  for (auto &core : cores)
+    core->registerStatistics(stats,
+                             "core" + std::to_string(core->getCoreId()) + '.');
+}
+
+void
+MultiCoreSystem::addIntervalHandler(uint64_t interval,
+                                    std::function<void(uint64_t)> handler)
+{
+  intervalHandlers.push_back({ interval, globalCycles + interval,
+                               std::move(handler) });
+}
+
+void
+MultiCoreSystem::dumpRegisters() const
+{
+  for (auto &core : cores)
+    {
+      std::cerr << "Core " << core->getCoreId() << ":" << std::endl;
+      core->dumpRegisters();
+    }
+}
+
+void
+MultiCoreSystem::dumpStatistics() const
+{
+  for (auto &core : cores)
+    {
+      std::cerr << "Core " << core->getCoreId() << ": ";
+      core->dumpStatistics();
+    }
+
+  if (caches)
+    caches->dumpStatistics(std::cerr);
+}
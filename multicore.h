@@ -0,0 +1,241 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    multicore.h - Multi-core system with cores on separate host threads.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#ifndef __MULTICORE_H__
+#define __MULTICORE_H__
+
+#include "arch.h"
+#include "elf-file.h"
+#include "processor.h"
+
+#include <array>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+
+/* A SharedMemoryPort gives a core access to a memory or device that is
+ * owned by the system and shared by all cores. The port does not take
+ * ownership. The scheduler is not forwarded: shared devices schedule
+ * their events with the system instead of with every core.
+ *
+ * Stores are buffered in the port until the system commits them at the
+ * end of the time quantum, so that during a quantum a core only sees its
+ * own stores. Loads of buffered bytes are served from the buffer.
+ * Compare-and-swap operations are handed to the system, which performs
+ * them at the end of the quantum as well.
+ */
+class SharedMemoryPort : public MemoryInterface
+{
+  public:
+    using CompareAndSwapHandler =
+        std::function<bool(MemoryInterface &target, MemAddress addr,
+                           uint32_t expected, uint32_t desired)>;
+
+    SharedMemoryPort(MemoryInterface &target,
+                     CompareAndSwapHandler compareAndSwapHandler);
+    ~SharedMemoryPort() override = default;
+
+    /* MemoryInterface */
+    uint8_t readByte(MemAddress addr) override;
+    uint16_t readHalfWord(MemAddress addr) override;
+    uint32_t readWord(MemAddress addr) override;
+    uint64_t readDoubleWord(MemAddress addr) override;
+
+    void writeByte(MemAddress addr, uint8_t value) override;
+    void writeHalfWord(MemAddress addr, uint16_t value) override;
+    void writeWord(MemAddress addr, uint32_t value) override;
+    void writeDoubleWord(MemAddress addr, uint64_t value) override;
+
+    bool contains(MemAddress addr) const override
+    { return target.contains(addr); }
+    std::string getName() const override
+    { return target.getName(); }
+    bool isCacheable() const override
+    { return target.isCacheable(); }
+
+    bool compareAndSwapWord(MemAddress addr, uint32_t expected,
+                            uint32_t desired) override
+    { return compareAndSwapHandler(target, addr, expected, desired); }
+
+    /* Only reads are allowed, and only while no stores are buffered, as
+     * the host would not see them.
+     */
+    std::byte *getHostPointer(MemAddress addr, bool write,
+                              size_t &extent) override;
+
+    /* Write the buffered stores to the target in program order. onStore
+     * is called for every store once it has been written.
+     */
+    void commit(const std::function<void(MemAddress, size_t)> &onStore);
+
+  private:
+    MemoryInterface &target;
+    CompareAndSwapHandler compareAndSwapHandler;
+
+    struct Store
+    {
+      MemAddress addr;
+      size_t size;
+      uint64_t value;
+    };
+
+    std::vector<Store> stores{};
+
+    /* The most recently stored bytes, per aligned doubleword. */
+    struct BufferedBytes
+    {
+      std::array<uint8_t, 8> data{};
+      uint8_t valid{};
+    };
+
+    std::unordered_map<MemAddress, BufferedBytes> buffered{};
+
+    uint64_t forward(MemAddress addr, size_t size, uint64_t value) const;
+    void buffer(MemAddress addr, size_t size, uint64_t value);
+};
+
+
+/* Reusable thread barrier. The last thread to arrive runs the completion
+ * function before any of the waiting threads is released, so the
+ * completion function may safely inspect and modify state of all cores.
+ */
+class QuantumBarrier
+{
+  public:
+    QuantumBarrier(size_t nThreads, std::function<void()> completion);
+
+    QuantumBarrier(const QuantumBarrier &) = delete;
+    QuantumBarrier &operator=(const QuantumBarrier &) = delete;
+
+    void arriveAndWait();
+
+  private:
+    const size_t nThreads;
+    std::function<void()> completion;
+
+    std::mutex mutex{};
+    std::condition_variable cond{};
+    size_t arrived{};
+    uint64_t generation{};
+};
+
+
+/* The MultiCoreSystem owns the memories and devices, which are shared by
+ * N cores. Each Processor has private pipeline state and a private memory
+ * bus containing ports onto the shared clients.
+ *
+ * Every core runs on its own host thread. Cores advance independently
+ * for a time quantum of the configured number of cycles, after which all
+ * cores synchronize on a barrier. During a quantum, a core only sees its
+ * own stores to shared memory. At the end of the quantum, the stores of
+ * all cores are committed in core-ID order, cancelling the reservations
+ * of the other cores, and events of shared devices are run. l.swa waits
+ * for the end of the quantum and succeeds if no store to the reserved
+ * word was committed before it. Since nothing a core observes depends on
+ * the progress of the other threads, the simulation is deterministic.
+ * Data written by a core becomes visible to the others a quantum later
+ * at most.
+ */
+class MultiCoreSystem
+{
+  public:
+    MultiCoreSystem(ELFFile &program, unsigned int nCores,
+                    uint64_t quantum, bool pipelining, bool debugMode=false);
+    ~MultiCoreSystem();
+
+    MultiCoreSystem(const MultiCoreSystem &) = delete;
+    MultiCoreSystem &operator=(const MultiCoreSystem &) = delete;
+
+    unsigned int getNumCores() const { return cores.size(); }
+    uint64_t getCycles() const { return globalCycles; }
+    Processor &getCore(unsigned int coreId) { return *cores[coreId]; }
+    const Processor &getCore(unsigned int coreId) const { return *cores[coreId]; }
+
+    /* Runs until all cores have halted or a core has failed. Returns
+     * true when all cores halted without problems.
+     */
+    bool run(bool testMode=false);
+
+    /* Give every core a private L1 data cache, kept coherent with MESI
+     * over a shared L2.
+     */
+    void enableCaches(const CacheConfig &config);
+
+    void dumpRegisters() const;
+    void dumpStatistics() const;
+
+    /* Register the statistics of the system and, as coreN.*, those of
+     * every core.
+     */
+    void registerStatistics(StatsRegistry &stats) const;
+
+    /* Call handler with the global cycle count once every interval
+     * cycles, at the end of the quantum in which the interval elapsed,
+     * while all cores are waiting.
+     */
+    void addIntervalHandler(uint64_t interval,
+                            std::function<void(uint64_t)> handler);
+
+  private:
+    const uint64_t quantum;
+
+    /* Events of the shared devices, run at quantum boundaries. */
+    EventScheduler scheduler{};
+    const ClockDomain &busClock;
+
+    /* Shared memories and devices. Must outlive the cores. */
+    std::vector<std::unique_ptr<MemoryInterface>> sharedClients{};
+    ReservationMonitor monitor;
+    std::unique_ptr<CoherenceController> caches{};
+    std::vector<std::unique_ptr<Processor>> cores{};
+
+    /* The ports of every core onto the shared clients. */
+    std::vector<std::vector<SharedMemoryPort *>> ports{};
+
+    /* Per-core run state, only written by the owning thread between
+     * barriers and read in the barrier completion function.
+     */
+    std::vector<RunStatus> status{};
+
+    uint64_t globalCycles{};
+    bool finished{};
+    QuantumBarrier *barrier{};
+
+    /* l.swa of every core, performed at the end of the quantum. */
+    struct PendingCompareAndSwap
+    {
+      MemoryInterface *target{};
+      MemAddress addr{};
+      uint32_t expected{};
+      uint32_t desired{};
+      bool swapped{};
+    };
+
+    std::vector<PendingCompareAndSwap> pendingSwaps{};
+
+    struct IntervalHandler
+    {
+      uint64_t interval;
+      uint64_t next;
+      std::function<void(uint64_t)> handler;
+    };
+
+    std::vector<IntervalHandler> intervalHandlers{};
+
+    bool compareAndSwap(unsigned int coreId, MemoryInterface &target,
+                        MemAddress addr, uint32_t expected,
+                        uint32_t desired);
+    void commitStores();
+    void endOfQuantum();
+    void coreThread(unsigned int coreId, bool testMode);
+};
+
+#endif /* __MULTICORE_H__ */
@@ -0,0 +1,141 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    perf-counters.cc - Performance counters unit.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#include "perf-counters.h"
+
+
+/* The events selected by each PCMR bit. Instruction cache misses, fetch
+ * stalls and TLB misses do not occur in this processor.
+ */
+static const std::array<std::pair<RegValue, uint64_t PerformanceEvents::*>, 10> eventBits =
+{{
+  { PCMR::LA, &PerformanceEvents::loads },
+  { PCMR::SA, &PerformanceEvents::stores },
+  { PCMR::IF, &PerformanceEvents::fetches },
+  { PCMR::DCM, &PerformanceEvents::dataCacheMisses },
+  { PCMR::LSUS, &PerformanceEvents::memoryStalls },
+  { PCMR::BS, &PerformanceEvents::branchStalls },
+  { PCMR::DDS, &PerformanceEvents::dependencyStalls },
+  { PCMR::CYC, &PerformanceEvents::cycles },
+  { PCMR::IR, &PerformanceEvents::instructions },
+  { PCMR::FUS, &PerformanceEvents::structuralStalls },
+}};
+
+PerformanceEvents &
+operator+=(PerformanceEvents &a, const PerformanceEvents &b)
+{
+  a.cycles += b.cycles;
+  a.instructions += b.instructions;
+  a.fetches += b.fetches;
+  a.loads += b.loads;
+  a.stores += b.stores;
+  a.dataCacheMisses += b.dataCacheMisses;
+  a.memoryStalls += b.memoryStalls;
+  a.branchStalls += b.branchStalls;
+  a.dependencyStalls += b.dependencyStalls;
+  a.structuralStalls += b.structuralStalls;
+  return a;
+}
+
+PerformanceEvents
+operator-(const PerformanceEvents &a, const PerformanceEvents &b)
+{
+  PerformanceEvents d;
+  d.cycles = a.cycles - b.cycles;
+  d.instructions = a.instructions - b.instructions;
+  d.fetches = a.fetches - b.fetches;
+  d.loads = a.loads - b.loads;
+  d.stores = a.stores - b.stores;
+  d.dataCacheMisses = a.dataCacheMisses - b.dataCacheMisses;
+  d.memoryStalls = a.memoryStalls - b.memoryStalls;
+  d.branchStalls = a.branchStalls - b.branchStalls;
+  d.dependencyStalls = a.dependencyStalls - b.dependencyStalls;
+  d.structuralStalls = a.structuralStalls - b.structuralStalls;
+  return d;
+}
+
+static constexpr RegValue WritableBits =
+    PCMR::UMRA | PCMR::CISM | PCMR::CIUM | PCMR::LA | PCMR::SA | PCMR::IF |
+    PCMR::DCM | PCMR::ICM | PCMR::IFS | PCMR::LSUS | PCMR::BS |
+    PCMR::DTLBM | PCMR::ITLBM | PCMR::DDS | PCMR::CYC | PCMR::IR |
+    PCMR::FUS;
+
+
+PerformanceCounterUnit::PerformanceCounterUnit(std::function<PerformanceEvents()> sample,
+                                               bool supervisorMode)
+  : sample{ std::move(sample) }, supervisorMode{ supervisorMode }
+{
+}
+
+bool
+PerformanceCounterUnit::isCounting(const Counter &counter) const
+{
+  return (counter.mode & (supervisorMode ? PCMR::CISM : PCMR::CIUM)) != 0;
+}
+
+uint64_t
+PerformanceCounterUnit::getEventsSince(const Counter &counter,
+                                       const PerformanceEvents &now) const
+{
+  if (! isCounting(counter))
+    return 0;
+
+  uint64_t events = 0;
+  for (const auto &[bit, member] : eventBits)
+    if (counter.mode & bit)
+      events += now.*member - counter.base.*member;
+  return events;
+}
+
+/* Fold the events counted so far into the count and count from now on. */
+void
+PerformanceCounterUnit::restart(Counter &counter, const PerformanceEvents &now)
+{
+  counter.count += getEventsSince(counter, now);
+  counter.base = now;
+}
+
+RegValue
+PerformanceCounterUnit::getCount(size_t counter) const
+{
+  const Counter &c = counters.at(counter);
+  return static_cast<RegValue>(c.count + getEventsSince(c, sample()));
+}
+
+void
+PerformanceCounterUnit::setCount(size_t counter, RegValue value)
+{
+  Counter &c = counters.at(counter);
+  c.count = value;
+  c.base = sample();
+}
+
+RegValue
+PerformanceCounterUnit::getMode(size_t counter) const
+{
+  return counters.at(counter).mode | PCMR::CP;
+}
+
+void
+PerformanceCounterUnit::setMode(size_t counter, RegValue value)
+{
+  Counter &c = counters.at(counter);
+  restart(c, sample());
+  c.mode = value & WritableBits;
+}
+
+void
+PerformanceCounterUnit::setSupervisorMode(bool supervisor)
+{
+  if (supervisor == supervisorMode)
+    return;
+
+  const PerformanceEvents now = sample();
+  for (auto &counter : counters)
+    restart(counter, now);
+  supervisorMode = supervisor;
+}
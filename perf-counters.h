@@ -0,0 +1,107 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    perf-counters.h - Performance counters unit.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#ifndef __PERF_COUNTERS_H__
+#define __PERF_COUNTERS_H__
+
+#include "arch.h"
+
+#include <array>
+#include <functional>
+
+/* Totals of the events the performance counters can count, maintained
+ * by the pipeline.
+ */
+struct PerformanceEvents
+{
+  uint64_t cycles{};
+  uint64_t instructions{};        /* retired */
+  uint64_t fetches{};
+  uint64_t loads{};
+  uint64_t stores{};
+  uint64_t dataCacheMisses{};
+  uint64_t memoryStalls{};        /* cycles the data cache stalled */
+  uint64_t branchStalls{};        /* taken branches, mispredicted as not taken */
+  uint64_t dependencyStalls{};
+  uint64_t structuralStalls{};
+};
+
+PerformanceEvents &operator+=(PerformanceEvents &a, const PerformanceEvents &b);
+PerformanceEvents operator-(const PerformanceEvents &a,
+                            const PerformanceEvents &b);
+
+/* Bits of the Performance Counters Mode Registers. Bits 26 and up are
+ * specific to this emulator.
+ */
+namespace PCMR
+{
+  constexpr RegValue CP = 1u << 0;       /* Counter Present */
+  constexpr RegValue UMRA = 1u << 1;     /* User Mode Read Access */
+  constexpr RegValue CISM = 1u << 2;     /* Count In Supervisor Mode */
+  constexpr RegValue CIUM = 1u << 3;     /* Count In User Mode */
+  constexpr RegValue LA = 1u << 4;       /* Load Access */
+  constexpr RegValue SA = 1u << 5;       /* Store Access */
+  constexpr RegValue IF = 1u << 6;       /* Instruction Fetch */
+  constexpr RegValue DCM = 1u << 7;      /* Data Cache Miss */
+  constexpr RegValue ICM = 1u << 8;      /* Instruction Cache Miss */
+  constexpr RegValue IFS = 1u << 9;      /* Instruction Fetch Stall */
+  constexpr RegValue LSUS = 1u << 10;    /* LSU Stall */
+  constexpr RegValue BS = 1u << 11;      /* Branch Stall */
+  constexpr RegValue DTLBM = 1u << 12;   /* DTLB Miss */
+  constexpr RegValue ITLBM = 1u << 13;   /* ITLB Miss */
+  constexpr RegValue DDS = 1u << 14;     /* Data Dependency Stall */
+  constexpr RegValue CYC = 1u << 26;     /* Cycles */
+  constexpr RegValue IR = 1u << 27;      /* Instructions Retired */
+  constexpr RegValue FUS = 1u << 28;     /* Functional Unit (structural) Stall */
+}
+
+/* Eight counters (PCCR0-7), each counting the sum of the events that
+ * are selected in its mode register (PCMR0-7), in supervisor and/or
+ * user mode. Counters are not updated as events happen: a counter
+ * remembers the event totals when it last changed and adds the
+ * difference when read.
+ */
+class PerformanceCounterUnit
+{
+  public:
+    static constexpr size_t NumCounters = 8;
+
+    PerformanceCounterUnit(std::function<PerformanceEvents()> sample,
+                           bool supervisorMode);
+
+    PerformanceCounterUnit(const PerformanceCounterUnit &) = delete;
+    PerformanceCounterUnit &operator=(const PerformanceCounterUnit &) = delete;
+
+    RegValue getCount(size_t counter) const;
+    void setCount(size_t counter, RegValue value);
+    RegValue getMode(size_t counter) const;
+    void setMode(size_t counter, RegValue value);
+
+    /* Called when the processor switches between supervisor and user
+     * mode, which may start or stop counters.
+     */
+    void setSupervisorMode(bool supervisor);
+
+  private:
+    struct Counter
+    {
+      RegValue mode{};
+      uint64_t count{};
+      PerformanceEvents base{};
+    };
+
+    std::function<PerformanceEvents()> sample;
+    bool supervisorMode;
+    std::array<Counter, NumCounters> counters{};
+
+    bool isCounting(const Counter &counter) const;
+    uint64_t getEventsSince(const Counter &counter,
+                            const PerformanceEvents &now) const;
+    void restart(Counter &counter, const PerformanceEvents &now);
+};
+
+#endif /* __PERF_COUNTERS_H__ */
@@ -0,0 +1,57 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    pic.cc - Programmable interrupt controller.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#include "pic.h"
+#include "event-scheduler.h"
+
+#include <stdexcept>
+
+
+ProgrammableInterruptController::ProgrammableInterruptController(const EventScheduler &scheduler,
+                                                                 std::function<void()> onInterrupt)
+  : scheduler{ scheduler }, onInterrupt{ std::move(onInterrupt) }
+{
+}
+
+void
+ProgrammableInterruptController::raise(unsigned int line)
+{
+  if (line >= NumLines)
+    throw std::out_of_range("interrupt line " + std::to_string(line) +
+                            " does not exist");
+
+  const RegValue bit = RegValue{1} << line;
+  if (status & bit)
+    return;
+
+  status |= bit;
+  raisedCycle[line] = scheduler.getTime();
+  if (mask & bit)
+    onInterrupt();
+}
+
+void
+ProgrammableInterruptController::lower(unsigned int line)
+{
+  status &= ~(RegValue{1} << line);
+}
+
+void
+ProgrammableInterruptController::setMask(RegValue value)
+{
+  const bool wasPending = isPending();
+  mask = value;
+  if (! wasPending && isPending())
+    onInterrupt();
+}
+
+void
+ProgrammableInterruptController::setStatus(RegValue value)
+{
+  /* Software can only acknowledge interrupts, not raise them. */
+  status &= value;
+}
@@ -0,0 +1,65 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    pic.h - Programmable interrupt controller.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#ifndef __PIC_H__
+#define __PIC_H__
+
+#include "arch.h"
+
+#include <array>
+#include <functional>
+
+class EventScheduler;
+
+/* The OpenRISC programmable interrupt controller has 32 interrupt lines
+ * that devices assert with raise(). PICSR holds the lines that are
+ * pending, PICMR the lines that are enabled. Lines are latched: a raised
+ * line stays pending until software clears its bit by writing a 0 to
+ * PICSR, or the device lowers it.
+ */
+class ProgrammableInterruptController
+{
+  public:
+    static constexpr unsigned int NumLines = 32;
+
+    /* The callback is invoked whenever an enabled line becomes pending,
+     * typically to wake up the processor.
+     */
+    ProgrammableInterruptController(const EventScheduler &scheduler,
+                                    std::function<void()> onInterrupt);
+
+    ProgrammableInterruptController(const ProgrammableInterruptController &) = delete;
+    ProgrammableInterruptController &operator=(const ProgrammableInterruptController &) = delete;
+
+    void raise(unsigned int line);
+    void lower(unsigned int line);
+
+    /* PICMR and PICSR */
+    RegValue getMask() const { return mask; }
+    void setMask(RegValue value);
+    RegValue getStatus() const { return status; }
+    void setStatus(RegValue value);
+
+    /* Whether an enabled line is pending. */
+    bool isPending() const { return (status & mask) != 0; }
+
+    /* Processor cycle at which the pending line was raised. */
+    uint64_t getRaisedCycle(unsigned int line) const
+    {
+      return raisedCycle.at(line);
+    }
+
+  private:
+    const EventScheduler &scheduler;
+    std::function<void()> onInterrupt;
+
+    RegValue mask{};
+    RegValue status{};
+    std::array<uint64_t, NumLines> raisedCycle{};
+};
+
+#endif /* __PIC_H__ */
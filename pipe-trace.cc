@@ -0,0 +1,315 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    pipe-trace.cc - Pipeline event trace.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#include "pipe-trace.h"
+#include "inst-decoder.h"
+
+#include <functional>
+#include <iomanip>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+
+
+static_assert(sizeof(PipeTraceRecord) == 80, "trace records must be packed");
+
+static constexpr std::array<const char *, NumPipeStages> stageNames =
+{
+  "F", "D", "X", "M", "W"
+};
+
+
+PipelineTracer::PipelineTracer(const std::string &filename)
+  : writer(filename)
+{
+  const PipeTraceHeader header{ PipeTraceHeader::Magic,
+                                PipeTraceHeader::Version,
+                                sizeof(PipeTraceRecord) };
+  writer.write(&header, sizeof(header));
+}
+
+/* Instructions still in flight at the end of the simulation are written
+ * as neither retired nor squashed.
+ */
+PipelineTracer::~PipelineTracer()
+{
+  for (const auto &record : inFlight)
+    writer.write(&record, sizeof(record));
+}
+
+void
+PipelineTracer::fetch(uint64_t cycle, MemAddress PC, uint32_t instruction)
+{
+  PipeTraceRecord record{};
+  record.sequence = nextSequence++;
+  record.PC = PC;
+  record.instruction = instruction;
+  record.stageCycles.fill(PipeTraceRecord::NotReached);
+  record.stageCycles[static_cast<size_t>(PipeStage::IF)] = cycle;
+  record.endCycle = PipeTraceRecord::NotReached;
+
+  inFlight.push_back(record);
+  stages[static_cast<size_t>(PipeStage::IF)] = &inFlight.back();
+}
+
+void
+PipelineTracer::advance(PipeStage stage, uint64_t cycle)
+{
+  const size_t s = static_cast<size_t>(stage);
+  PipeTraceRecord *record = stages[s];
+  stages[s] = nullptr;
+
+  if (stage == PipeStage::WB)
+    {
+      if (record)
+        leave(record, cycle, PipeTraceRecord::Retired);
+      return;
+    }
+
+  stages[s + 1] = record;
+  if (record)
+    record->stageCycles[s + 1] = cycle;
+}
+
+void
+PipelineTracer::stall(bool structural)
+{
+  PipeTraceRecord *record = stages[static_cast<size_t>(PipeStage::ID)];
+  if (! record)
+    return;
+
+  if (structural)
+    ++record->structuralStalls;
+  else
+    ++record->dependencyStalls;
+}
+
+void
+PipelineTracer::freeze()
+{
+  for (PipeTraceRecord *record : stages)
+    if (record)
+      ++record->frozenCycles;
+}
+
+void
+PipelineTracer::squash(uint64_t cycle)
+{
+  for (PipeTraceRecord *&record : stages)
+    {
+      if (record)
+        leave(record, cycle, PipeTraceRecord::Squashed);
+      record = nullptr;
+    }
+}
+
+/* Records are written in fetch order, once all older instructions have
+ * left the pipeline as well.
+ */
+void
+PipelineTracer::leave(PipeTraceRecord *record, uint64_t cycle, uint32_t flags)
+{
+  record->endCycle = cycle;
+  record->flags |= flags;
+
+  while (! inFlight.empty() && inFlight.front().flags != 0)
+    {
+      writer.write(&inFlight.front(), sizeof(PipeTraceRecord));
+      inFlight.pop_front();
+    }
+}
+
+
+/*
+ * Conversion
+ */
+
+static void
+readHeader(std::istream &in)
+{
+  PipeTraceHeader header{};
+  if (! in.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+      header.magic != PipeTraceHeader::Magic)
+    throw std::runtime_error("not a pipeline trace");
+
+  if (header.version != PipeTraceHeader::Version ||
+      header.recordSize != sizeof(PipeTraceRecord))
+    throw std::runtime_error("unsupported pipeline trace version");
+}
+
+static bool
+readRecord(std::istream &in, PipeTraceRecord &record)
+{
+  if (in.read(reinterpret_cast<char *>(&record), sizeof(record)))
+    return true;
+
+  if (in.gcount() != 0)
+    throw std::runtime_error("truncated pipeline trace");
+  return false;
+}
+
+static std::string
+disassemble(uint32_t instruction)
+{
+  std::ostringstream s;
+  try
+    {
+      InstructionDecoder decoder;
+      decoder.setInstructionWord(instruction);
+      s << decoder;
+    }
+  catch (IllegalInstruction &)
+    {
+      s.str("illegal instruction");
+    }
+  return s.str();
+}
+
+/* Konata requires its commands in cycle order, while a record holds the
+ * whole life of an instruction. Records are in fetch order, so once a
+ * record fetched in cycle c has been read, no later record can produce
+ * commands before cycle c and the commands up to there are written.
+ */
+void
+convertPipeTraceToKonata(std::istream &in, std::ostream &out)
+{
+  readHeader(in);
+
+  struct Command
+  {
+    uint64_t cycle;
+    uint64_t order;
+    std::string text;
+
+    bool operator>(const Command &other) const
+    {
+      return cycle != other.cycle ? cycle > other.cycle : order > other.order;
+    }
+  };
+
+  std::priority_queue<Command, std::vector<Command>, std::greater<Command>> commands;
+  uint64_t order = 0;
+  uint64_t currentCycle = 0;
+  bool started = false;
+  uint64_t retired = 0;
+
+  auto flushBefore = [&](uint64_t cycle)
+    {
+      while (! commands.empty() && commands.top().cycle < cycle)
+        {
+          const Command &command = commands.top();
+          if (! started)
+            {
+              out << "C=\t" << command.cycle << '\n';
+              started = true;
+            }
+          else if (command.cycle > currentCycle)
+            out << "C\t" << command.cycle - currentCycle << '\n';
+          currentCycle = std::max(currentCycle, command.cycle);
+          out << command.text << '\n';
+          commands.pop();
+        }
+    };
+
+  out << "Kanata\t0004\n";
+
+  PipeTraceRecord record;
+  while (readRecord(in, record))
+    {
+      const uint64_t fetchCycle = record.stageCycles[0];
+      flushBefore(fetchCycle);
+
+      const std::string id = std::to_string(record.sequence);
+      std::ostringstream label;
+      label << std::hex << "0x" << record.PC << ": "
+            << disassemble(record.instruction);
+      commands.push({ fetchCycle, order++,
+                      "I\t" + id + '\t' + id + "\t0\nL\t" + id + "\t0\t" +
+                      label.str() });
+
+      if (record.dependencyStalls || record.structuralStalls ||
+          record.frozenCycles)
+        commands.push({ fetchCycle, order++,
+                        "L\t" + id + "\t1\t" +
+                        std::to_string(record.dependencyStalls) +
+                        " dependency stalls, " +
+                        std::to_string(record.structuralStalls) +
+                        " structural stalls, " +
+                        std::to_string(record.frozenCycles) +
+                        " frozen cycles" });
+
+      size_t last = 0;
+      for (size_t s = 0; s < NumPipeStages; ++s)
+        {
+          if (record.stageCycles[s] == PipeTraceRecord::NotReached)
+            break;
+          if (s > 0)
+            commands.push({ record.stageCycles[s], order++,
+                            "E\t" + id + "\t0\t" + stageNames[s - 1] });
+          commands.push({ record.stageCycles[s], order++,
+                          "S\t" + id + "\t0\t" + stageNames[s] });
+          last = s;
+        }
+
+      if (record.endCycle != PipeTraceRecord::NotReached)
+        {
+          const bool squashed = record.flags & PipeTraceRecord::Squashed;
+          commands.push({ record.endCycle, order++,
+                          "E\t" + id + "\t0\t" + stageNames[last] +
+                          "\nR\t" + id + '\t' +
+                          std::to_string(squashed ? 0 : retired++) + '\t' +
+                          (squashed ? "1" : "0") });
+        }
+    }
+
+  flushBefore(PipeTraceRecord::NotReached);
+}
+
+/* gem5 describes an out-of-order pipeline; decode, rename and dispatch
+ * all happen in ID, issue is the start of EX and completion the start of
+ * WB.
+ */
+void
+convertPipeTraceToO3PipeView(std::istream &in, std::ostream &out)
+{
+  constexpr uint64_t TicksPerCycle = 1000;
+
+  readHeader(in);
+
+  auto tick = [](uint64_t cycle)
+    {
+      return cycle == PipeTraceRecord::NotReached ? 0 : cycle * TicksPerCycle;
+    };
+
+  PipeTraceRecord record;
+  while (readRecord(in, record))
+    {
+      const auto &cycles = record.stageCycles;
+      const uint64_t ID = tick(cycles[static_cast<size_t>(PipeStage::ID)]);
+      const uint64_t EX = tick(cycles[static_cast<size_t>(PipeStage::EX)]);
+      const uint64_t MEM = tick(cycles[static_cast<size_t>(PipeStage::MEM)]);
+      const uint64_t WB = tick(cycles[static_cast<size_t>(PipeStage::WB)]);
+      const uint64_t retire = record.flags & PipeTraceRecord::Retired
+          ? tick(record.endCycle) : 0;
+
+      /* l.swa, l.sd, l.sw, l.sb and l.sh */
+      const uint32_t opcode = record.instruction >> 26;
+      const bool isStore = opcode >= 0x33 && opcode <= 0x37;
+
+      out << "O3PipeView:fetch:" << tick(cycles[0]) << ":0x"
+          << std::hex << std::setw(8) << std::setfill('0') << record.PC
+          << std::dec << ":0:" << record.sequence << ':'
+          << disassemble(record.instruction) << '\n'
+          << "O3PipeView:decode:" << ID << '\n'
+          << "O3PipeView:rename:" << ID << '\n'
+          << "O3PipeView:dispatch:" << ID << '\n'
+          << "O3PipeView:issue:" << EX << '\n'
+          << "O3PipeView:complete:" << WB << '\n'
+          << "O3PipeView:retire:" << retire << ":store:"
+          << (isStore && retire ? MEM : 0) << '\n';
+    }
+}
@@ -0,0 +1,126 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    pipe-trace.h - Pipeline event trace.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#ifndef __PIPE_TRACE_H__
+#define __PIPE_TRACE_H__
+
+#include "arch.h"
+#include "trace-writer.h"
+
+#include <array>
+#include <deque>
+#include <istream>
+#include <ostream>
+
+/* The stages of the pipeline, in order. */
+enum class PipeStage
+{
+  IF,
+  ID,
+  EX,
+  MEM,
+  WB,
+  LAST
+};
+
+constexpr size_t NumPipeStages = static_cast<size_t>(PipeStage::LAST);
+
+/* The life of one instruction in the pipeline. The trace file starts
+ * with a header and is followed by these records in host byte order, in
+ * the order in which the instructions were fetched.
+ */
+struct PipeTraceRecord
+{
+  static constexpr uint64_t NotReached = ~uint64_t{0};
+
+  static constexpr uint32_t Retired = 1u << 0;
+  static constexpr uint32_t Squashed = 1u << 1;   /* by an exception */
+
+  uint64_t sequence;
+  uint32_t PC;
+  uint32_t instruction;
+
+  /* Cycle in which the instruction entered each stage */
+  std::array<uint64_t, NumPipeStages> stageCycles;
+  /* Cycle in which it left the pipeline */
+  uint64_t endCycle;
+
+  /* Cycles held in decode for an operand or a functional unit */
+  uint32_t dependencyStalls;
+  uint32_t structuralStalls;
+  /* Cycles the whole pipeline was frozen, e.g. for a cache miss */
+  uint32_t frozenCycles;
+  uint32_t flags;
+};
+
+struct PipeTraceHeader
+{
+  static constexpr std::array<char, 8> Magic{ 'R', 'V', 'P', 'I', 'P', 'E', '\0', '\0' };
+  static constexpr uint32_t Version = 1;
+
+  std::array<char, 8> magic;
+  uint32_t version;
+  uint32_t recordSize;
+};
+
+/* Follows instructions through the pipeline, told by the pipeline as
+ * they are fetched and move to the next stage, and writes a record when
+ * they leave it.
+ */
+class PipelineTracer
+{
+  public:
+    explicit PipelineTracer(const std::string &filename);
+    ~PipelineTracer();
+
+    PipelineTracer(const PipelineTracer &) = delete;
+    PipelineTracer &operator=(const PipelineTracer &) = delete;
+
+    /* An instruction enters IF. */
+    void fetch(uint64_t cycle, MemAddress PC, uint32_t instruction);
+
+    /* The instruction in stage moves to the next stage, or leaves the
+     * pipeline from WB. The stage is empty afterwards, until a next
+     * instruction moves in.
+     */
+    void advance(PipeStage stage, uint64_t cycle);
+
+    bool isOccupied(PipeStage stage) const
+    {
+      return stages[static_cast<size_t>(stage)] != nullptr;
+    }
+
+    /* The instruction in decode waits another cycle. */
+    void stall(bool structural);
+
+    /* The whole pipeline is frozen for a cycle. */
+    void freeze();
+
+    /* All instructions in flight are abandoned. */
+    void squash(uint64_t cycle);
+
+  private:
+    TraceWriter writer;
+    uint64_t nextSequence{};
+
+    /* Records in flight, and which of them occupies each stage. The
+     * oldest is written when it leaves.
+     */
+    std::deque<PipeTraceRecord> inFlight{};
+    std::array<PipeTraceRecord *, NumPipeStages> stages{};
+
+    void leave(PipeTraceRecord *record, uint64_t cycle, uint32_t flags);
+};
+
+/* Converters from a pipeline trace to the formats of the Konata
+ * pipeline viewer and of gem5's O3PipeView (util/o3-pipeview.py, with a
+ * tick of 1000 per cycle). Throw std::runtime_error on a malformed trace.
+ */
+void convertPipeTraceToKonata(std::istream &in, std::ostream &out);
+void convertPipeTraceToO3PipeView(std::istream &in, std::ostream &out);
+
+#endif /* __PIPE_TRACE_H__ */
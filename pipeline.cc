@@ -18,31 +18,74 @@ Pipeline::Pipeline(bool pipelining,
                    bool &flag,
                    MemAddress &NPC,
                    size_t &issued,
-                   DataMemory &dataMemory)
-  : pipelining{ pipelining }
+                   DataMemory &dataMemory,
+                   MultiplyAccumulator &mac,
+                   FloatingPointUnit &fpu,
+                   AcceleratorSlots &accelerators,
+                   SpecialPurposeRegisters &spr)
+  : pipelining{ pipelining }, regfile{ regfile }, dataMemory{ dataMemory },
+    NPC{ NPC }, issued{ issued }
 {
+  units[static_cast<size_t>(FunctionalUnitSelector::multiplier)] =
+      std::make_unique<FunctionalUnit>("mul", 3, 1);
+  units[static_cast<size_t>(FunctionalUnitSelector::divider)] =
+      std::make_unique<FunctionalUnit>("div", 32, 32);
+  units[static_cast<size_t>(FunctionalUnitSelector::mac)] =
+      std::make_unique<FunctionalUnit>("mac", 3, 1);
+  units[static_cast<size_t>(FunctionalUnitSelector::fpu)] =
+      std::make_unique<FunctionalUnit>("fpu", 4, 1);
+  units[static_cast<size_t>(FunctionalUnitSelector::fpDivider)] =
+      std::make_unique<FunctionalUnit>("fdiv", 16, 16);
+  units[static_cast<size_t>(FunctionalUnitSelector::simd)] =
+      std::make_unique<FunctionalUnit>("simd", 1, 1);
+  /* Timing is determined per operation by the attached accelerators. */
+  static_assert(NumCustomUnits == AcceleratorSlots::NumSlots,
+                "every custom instruction slot needs a unit");
+  for (size_t slot = 0; slot < NumCustomUnits; ++slot)
+    units[getUnitIndex(FunctionalUnitSelector::accelerator, slot)] =
+        std::make_unique<FunctionalUnit>("cust" + std::to_string(slot + 1),
+                                         1, 1);
+
   /* TODO: this might need modification in case the stages need access
    * to more shared components.
    */
-  stages.emplace_back(std::make_unique<InstructionFetchStage>(pipelining,
-                                                              if_id,
-                                                              instructionMemory,
-                                                              PC, NPC, issued));
-  stages.emplace_back(std::make_unique<InstructionDecodeStage>(pipelining,
-                                                               if_id, id_ex,
-                                                               regfile,
-                                                               decoder,
-                                                               nInstrIssued,
-                                                               nStalls,
-                                                               flag,
-                                                               NPC,
-                                                               issued,
-                                                               debugMode));
+  auto fetch = std::make_unique<InstructionFetchStage>(pipelining,
+                                                       if_id,
+                                                       instructionMemory,
+                                                       PC, NPC, issued,
+                                                       events);
+  fetchStage = fetch.get();
+  stages.emplace_back(std::move(fetch));
+  auto decode = std::make_unique<InstructionDecodeStage>(pipelining,
+                                                         if_id, id_ex,
+                                                         regfile,
+                                                         decoder,
+                                                         nInstrIssued,
+                                                         nStalls,
+                                                         flag,
+                                                         NPC,
+                                                         issued,
+                                                         scoreboard,
+                                                         units,
+                                                         cycle,
+                                                         accelerators,
+                                                         spr,
+                                                         events,
+                                                         mix,
+                                                         debugMode);
+  decodeStage = decode.get();
+  stages.emplace_back(std::move(decode));
   stages.emplace_back(std::make_unique<ExecuteStage>(pipelining,
-                                                     id_ex, ex_m));
-  stages.emplace_back(std::make_unique<MemoryStage>(pipelining,
-                                                    ex_m, m_wb,
-                                                    dataMemory));
+                                                     id_ex, ex_m, flag,
+                                                     mac, fpu,
+                                                     accelerators, spr));
+  auto memory = std::make_unique<MemoryStage>(pipelining,
+                                              ex_m, m_wb,
+                                              dataMemory,
+                                              pendingStalls,
+                                              events);
+  memoryStage = memory.get();
+  stages.emplace_back(std::move(memory));
   stages.emplace_back(std::make_unique<WriteBackStage>(pipelining,
                                                        m_wb,
                                                        regfile, flag,
@@ -52,30 +95,256 @@ Pipeline::Pipeline(bool pipelining,
 void
 Pipeline::propagate()
 {
-  if (! pipelining)
+  if (pendingStalls > 0)
+    return;
+
+  if (! detailed)
+    {
+      /* The complete instruction executes in clockPulse. */
+    }
+  else if (! pipelining)
     {
       /* Execute a single instruction execution step. */
-      stages[currentStage]->propagate();
+      propagateStage(currentStage);
     }
   else
     {
-      /* Run propagate for all stages within a single clock cycle. */
-      for (auto &s : stages)
-        s->propagate();
+      /* Run propagate for all stages within a single clock cycle.
+       * Decode goes first, a stall in decode holds instruction fetch.
+       */
+      const size_t ID = static_cast<size_t>(PipeStage::ID);
+      propagateStage(ID);
+      for (size_t s = 0; s < stages.size(); ++s)
+        if (s != ID &&
+            ! (stages[s].get() == fetchStage && decodeStage->isStalled()))
+          propagateStage(s);
     }
 }
 
 void
 Pipeline::clockPulse()
 {
-  if (! pipelining)
+  if (pendingStalls > 0)
+    {
+      --pendingStalls;
+      ++nStalls;
+      ++cycle;
+      if (tracer)
+        tracer->freeze();
+      return;
+    }
+
+  if (! detailed)
     {
-      stages[currentStage]->clockPulse();
-      currentStage = (currentStage + 1) % stages.size();
+      for (size_t s = 0; s < stages.size(); ++s)
+        {
+          propagateStage(s);
+          clockPulseStage(s);
+          if (instructionTracer)
+            traceInstruction(s);
+        }
+
+      if (tracer)
+        {
+          tracer->fetch(cycle, if_id.PC, if_id.instruction);
+          for (size_t s = 0; s < NumPipeStages; ++s)
+            tracer->advance(static_cast<PipeStage>(s),
+                            s + 1 < NumPipeStages ? cycle : cycle + 1);
+        }
+    }
+  else if (! pipelining)
+    {
+      const size_t stage = currentStage;
+
+      /* The instruction stays in decode until its operands and
+       * functional unit are available.
+       */
+      if (stages[currentStage].get() == decodeStage &&
+          decodeStage->isStalled())
+        decodeStage->recordStall();
+      else
+        {
+          clockPulseStage(currentStage);
+          if (instructionTracer)
+            traceInstruction(currentStage);
+          currentStage = (currentStage + 1) % stages.size();
+        }
+
+      if (tracer)
+        traceStage(stage);
     }
   else
     {
-      for (auto &s : stages)
-        s->clockPulse();
+      /* On a stall, decode inserts a bubble and fetch holds. */
+      const bool stalled = decodeStage->isStalled();
+      if (stalled)
+        decodeStage->recordStall();
+
+      for (size_t s = 0; s < stages.size(); ++s)
+        if (! (stalled && stages[s].get() == fetchStage))
+          clockPulseStage(s);
+
+      /* Every instruction moves to the stage that processed it. */
+      if (tracer)
+        {
+          tracer->advance(PipeStage::WB, cycle);
+          tracer->advance(PipeStage::MEM, cycle);
+          tracer->advance(PipeStage::EX, cycle);
+          if (stalled)
+            tracer->stall(decodeStage->isStructuralStall());
+          else
+            {
+              tracer->advance(PipeStage::ID, cycle);
+              tracer->advance(PipeStage::IF, cycle);
+              tracer->fetch(cycle, if_id.PC, if_id.instruction);
+            }
+        }
+    }
+
+  ++cycle;
+}
+
+/* Without pipelining, the instruction enters a stage in the first cycle
+ * the stage works on it, and leaves the pipeline after WB.
+ */
+void
+Pipeline::traceStage(size_t stage)
+{
+  if (stage == 0)
+    {
+      tracer->fetch(cycle, if_id.PC, if_id.instruction);
+      return;
+    }
+
+  const PipeStage previous = static_cast<PipeStage>(stage - 1);
+  if (tracer->isOccupied(previous))
+    tracer->advance(previous, cycle);
+
+  if (stage == currentStage)
+    tracer->stall(decodeStage->isStructuralStall());
+  else if (stage == NumPipeStages - 1)
+    tracer->advance(PipeStage::WB, cycle + 1);
+}
+
+/* Without pipelining, each stage adds what it did to the record of the
+ * single instruction in flight. A taken branch has set issued when it
+ * leaves decode.
+ */
+void
+Pipeline::traceInstruction(size_t stage)
+{
+  InstructionTraceRecord &record = traceRecord;
+
+  switch (static_cast<PipeStage>(stage))
+    {
+      case PipeStage::IF:
+        record = InstructionTraceRecord{};
+        record.PC = if_id.PC;
+        record.instruction = if_id.instruction;
+        break;
+
+      case PipeStage::ID:
+        switch (id_ex.signals.getopcode())
+          {
+            case opcode::J:
+            case opcode::JAL:
+            case opcode::JR:
+            case opcode::JALR:
+            case opcode::BF:
+            case opcode::BNF:
+            case opcode::RFE:
+              record.flags |= InstructionTraceRecord::Branch;
+              if (issued != 0)
+                {
+                  record.flags |= InstructionTraceRecord::Taken;
+                  record.branchTarget = NPC;
+                }
+              break;
+
+            default:
+              break;
+          }
+        break;
+
+      case PipeStage::EX:
+      case PipeStage::LAST:
+        break;
+
+      case PipeStage::MEM:
+        if (ex_m.actionMem == MemorySelector::none)
+          break;
+        record.flags |= ex_m.actionMem == MemorySelector::load ?
+            InstructionTraceRecord::Load : InstructionTraceRecord::Store;
+        record.memorySize = dataMemory.getSize();
+        record.memoryAddress = dataMemory.getAddress();
+        record.memoryValue = ex_m.actionMem == MemorySelector::load ?
+            m_wb.memRead : ex_m.regB;
+        break;
+
+      case PipeStage::WB:
+        if (m_wb.actionWBOut == WriteBackOutputSelector::write)
+          {
+            const bool pair = m_wb.signals.getVectorOp() != VectorOp::none;
+            for (RegNumber reg = m_wb.regD; reg <= m_wb.regD + pair; ++reg)
+              if (reg != 0 && reg < NumRegs)
+                {
+                  record.registers[record.nRegisterWrites] = reg;
+                  record.registerValues[record.nRegisterWrites] =
+                      regfile.readBankRegister(regfile.getCurrentBank(), reg);
+                  ++record.nRegisterWrites;
+                }
+          }
+        instructionTracer->retire(record);
+        break;
     }
 }
+
+void
+Pipeline::setDetailed(bool enable)
+{
+  if (pipelining && ! enable)
+    throw std::invalid_argument("functional mode is not supported with pipelining");
+
+  detailed = enable;
+  decodeStage->setTiming(enable);
+  memoryStage->setDataCache(enable ? dataCache : nullptr);
+}
+
+/* Called when an instruction raised an exception in the current cycle.
+ * The instruction and the stages it did not reach yet are abandoned, so
+ * that fetch continues at the exception handler.
+ */
+void
+Pipeline::flush()
+{
+  /* The instruction did enter the stage that raised the exception. */
+  if (tracer && ! pipelining && currentStage > 0 &&
+      tracer->isOccupied(static_cast<PipeStage>(currentStage - 1)))
+    tracer->advance(static_cast<PipeStage>(currentStage - 1), cycle);
+
+  currentStage = 0;
+  ++cycle;
+
+  if (tracer)
+    tracer->squash(cycle);
+}
+
+PerformanceEvents
+Pipeline::getPerformanceEvents() const
+{
+  PerformanceEvents current = events;
+  current.cycles = cycle;
+  current.instructions = nInstrCompleted;
+  current.dataCacheMisses = dataCache ? dataCache->getMisses() : 0;
+  return current;
+}
+
+FunctionalUnit *
+Pipeline::getFunctionalUnit(std::string_view name)
+{
+  for (auto &unit : units)
+    if (unit && unit->getName() == name)
+      return unit.get();
+
+  return nullptr;
+}
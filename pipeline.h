@@ -12,7 +12,12 @@
 #include "stages.h"
 
 #include "memory-control.h"
+#include "functional-unit.h"
+#include "host-profiler.h"
+#include "inst-trace.h"
+#include "pipe-trace.h"
 #include <cstddef>
+#include <string_view>
 
 class Pipeline
 {
@@ -26,7 +31,11 @@ class Pipeline
              bool &flag,
              MemAddress &NPC,
              size_t &issued,
-             DataMemory &dataMemory);
+             DataMemory &dataMemory,
+             MultiplyAccumulator &mac,
+             FloatingPointUnit &fpu,
+             AcceleratorSlots &accelerators,
+             SpecialPurposeRegisters &spr);
 
     Pipeline(const Pipeline &) = delete;
     Pipeline &operator=(const Pipeline &) = delete;
@@ -34,6 +43,83 @@ class Pipeline
     void propagate();
     void clockPulse();
 
+    void setDataCache(L1DataCache *cache)
+    {
+      dataCache = cache;
+      memoryStage->setDataCache(detailed ? cache : nullptr);
+    }
+
+    /* The data cache that memory accesses currently go through, if any. */
+    L1DataCache *getActiveDataCache() const
+    {
+      return detailed ? dataCache : nullptr;
+    }
+
+    /* In functional mode, every cycle executes a complete instruction and
+     * timing is not modelled: there are no stalls and the data cache is
+     * bypassed. Only without pipelining; may be switched between
+     * instructions.
+     */
+    void setDetailed(bool enable);
+    bool isDetailed() const { return detailed; }
+
+    /* Report every instruction's progress through the pipeline. */
+    void setTracer(PipelineTracer *tracer) { this->tracer = tracer; }
+
+    /* Report every retired instruction and its effects. Only without
+     * pipelining.
+     */
+    void setInstructionTracer(InstructionTracer *tracer)
+    {
+      instructionTracer = tracer;
+    }
+
+    /* Attribute host time to the stages. */
+    void setHostProfiler(HostProfiler *profiler) { hostProfiler = profiler; }
+
+    /* Event totals for the performance counters. */
+    PerformanceEvents getPerformanceEvents() const;
+
+    const InstructionMix &getInstructionMix() const { return mix; }
+
+    FunctionalUnit *getFunctionalUnit(std::string_view name);
+
+    const FunctionalUnits &getFunctionalUnits() const
+    {
+      return units;
+    }
+
+    /* Whether no instruction is in flight, so that the architectural
+     * state may be changed from outside the pipeline. Only the case
+     * between two instructions in non-pipelined mode; pipelined mode
+     * would need to squash the younger instructions, so it supports no
+     * interrupts.
+     */
+    bool isAtInstructionBoundary() const
+    {
+      return ! pipelining && currentStage == 0 && pendingStalls == 0;
+    }
+
+    /* Account for cycles in which the pipeline did not run, because the
+     * processor was dozing or skipped iterations of a spin loop that
+     * together executed the given number of instructions.
+     */
+    void skipCycles(uint64_t cycles, uint64_t instructions)
+    {
+      cycle += cycles;
+      nInstrIssued += instructions;
+      nInstrCompleted += instructions;
+    }
+
+    /* Abandon the instruction that raised an exception. */
+    void flush();
+
+    /* Freeze the pipeline for the given number of cycles. */
+    void addStallCycles(uint64_t n)
+    {
+      pendingStalls += n;
+    }
+
     bool getPipelining() const
     {
       return pipelining;
@@ -56,15 +142,60 @@ class Pipeline
 
   private:
     bool pipelining;
+    bool detailed = true;
     size_t currentStage{};
+    uint64_t cycle{};
 
     /* Statistics */
     uint64_t nInstrIssued{};
     uint64_t nInstrCompleted{};
     uint64_t nStalls{};
 
+    /* Cycles for which the whole pipeline is frozen, e.g. while waiting
+     * for a cache miss.
+     */
+    uint64_t pendingStalls{};
+
+    PerformanceEvents events{};
+    InstructionMix mix{};
+    L1DataCache *dataCache{}; /* no ownership */
+    PipelineTracer *tracer{}; /* no ownership */
+    InstructionTracer *instructionTracer{}; /* no ownership */
+    HostProfiler *hostProfiler{}; /* no ownership */
+
+    void traceStage(size_t stage);
+
+    /* The instruction being traced, completed stage by stage. */
+    InstructionTraceRecord traceRecord{};
+    void traceInstruction(size_t stage);
+
+    /* Architectural state that traceInstruction reads */
+    RegisterFile &regfile;
+    DataMemory &dataMemory;
+    MemAddress &NPC;
+    size_t &issued;
+
+    void propagateStage(size_t stage)
+    {
+      HostProfileScope scope(hostProfiler, getStageRegion(stage, false));
+      stages[stage]->propagate();
+    }
+
+    void clockPulseStage(size_t stage)
+    {
+      HostProfileScope scope(hostProfiler, getStageRegion(stage, true));
+      stages[stage]->clockPulse();
+    }
+
     /* Stages */
     std::vector<std::unique_ptr<Stage>> stages{};
+    MemoryStage *memoryStage{};
+    InstructionFetchStage *fetchStage{};
+    InstructionDecodeStage *decodeStage{};
+
+    /* Multi-cycle functional units */
+    FunctionalUnits units{};
+    Scoreboard scoreboard{};
 
     /* Pipeline registers */
     IF_IDRegisters if_id{};
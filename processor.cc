@@ -10,29 +10,98 @@
 #include "serial.h"
 #include "framebuffer.h"
 
+#include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <limits>
 
 
 Processor::Processor(ELFFile &program, bool pipelining, bool debugMode)
-  : bus{ program.createMemories() },
-    instructionMemory{ bus },
-    dataMemory{ bus },
-    pipeline{ pipelining, debugMode, PC, instructionMemory, decoder,
-        regfile, flag, NPC, issued, dataMemory }
+  : Processor(program.createMemories(), program.getEntrypoint(),
+              0, 1, nullptr, pipelining, debugMode)
 {
   bus.addClient(std::make_unique<Serial>(0x200));
 
-  auto status = std::make_unique<SysStatus>(0x270);
-  sysStatus = status.get();
-  bus.addClient(std::move(status));
-
 #ifdef ENABLE_FRAMEBUFFER
   bus.addClient(std::make_unique<Framebuffer>(0x800, 0x1000000));
 #endif
+}
+
+Processor::Processor(std::vector<std::unique_ptr<MemoryInterface>> &&clients,
+                     MemAddress entrypoint,
+                     unsigned int coreId, unsigned int nCores,
+                     ReservationMonitor *sharedMonitor,
+                     bool pipelining, bool debugMode)
+  : coreId{ coreId },
+    privateMonitor{ sharedMonitor ? nullptr
+                                  : std::make_unique<ReservationMonitor>(1) },
+    monitor{ sharedMonitor ? *sharedMonitor : *privateMonitor },
+    busClock{ scheduler.addClockDomain("bus", 1, 5) },
+    pic{ scheduler, [this] { wakeUp(); } },
+    tickTimer{ scheduler, [this] { wakeUp(); } },
+    spr{ flag, regfile },
+    bus{ std::move(clients) },
+    instructionMemory{ bus },
+    dataMemory{ bus, monitor, coreId },
+    accelerators{ bus },
+    pipeline{ pipelining, debugMode, PC, instructionMemory, decoder,
+        regfile, flag, NPC, issued, dataMemory, mac, fpu, accelerators,
+        spr },
+    perfCounters{ [this] { return pipeline.getPerformanceEvents(); }, true }
+{
+  /* The system status module is private to each core, such that it
+   * can report the core ID.
+   */
+  auto status = std::make_unique<SysStatus>(0x270, coreId, nCores);
+  sysStatus = status.get();
+  sysStatus->setRegionHandler([this](bool begin, uint32_t id)
+                              { pendingMarkers.push_back({ begin, id }); });
+  bus.addClient(std::move(status));
+  bus.attachScheduler(scheduler, busClock);
+
+  /* The special-purpose registers of the components of the core. */
+  spr.add(SPR::FPCSR,
+          [this] { return fpu.getFPCSR(); },
+          [this](RegValue value) { fpu.setFPCSR(value); });
+  spr.add(SPR::MACLO,
+          [this] { return static_cast<RegValue>(mac.getAccumulator()); },
+          [this](RegValue value)
+          {
+            mac.setAccumulator((mac.getAccumulator() & ~uint64_t{0xffffffff}) | value);
+          });
+  spr.add(SPR::MACHI,
+          [this] { return static_cast<RegValue>(mac.getAccumulator() >> 32); },
+          [this](RegValue value)
+          {
+            mac.setAccumulator((mac.getAccumulator() & 0xffffffff) |
+                               (static_cast<uint64_t>(value) << 32));
+          });
+  spr.add(SPR::PICMR,
+          [this] { return pic.getMask(); },
+          [this](RegValue value) { pic.setMask(value); });
+  spr.add(SPR::PICSR,
+          [this] { return pic.getStatus(); },
+          [this](RegValue value) { pic.setStatus(value); });
+  spr.add(SPR::TTMR,
+          [this] { return tickTimer.getMode(); },
+          [this](RegValue value) { tickTimer.setMode(value); });
+  spr.add(SPR::TTCR,
+          [this] { return tickTimer.getCount(); },
+          [this](RegValue value) { tickTimer.setCount(value); });
+  for (size_t i = 0; i < PerformanceCounterUnit::NumCounters; ++i)
+    {
+      spr.add(SPR::PCCR0 + i,
+              [this, i] { return perfCounters.getCount(i); },
+              [this, i](RegValue value) { perfCounters.setCount(i, value); });
+      spr.add(SPR::PCMR0 + i,
+              [this, i] { return perfCounters.getMode(i); },
+              [this, i](RegValue value) { perfCounters.setMode(i, value); });
+    }
+  spr.setModeChangeHandler([this](bool supervisor)
+                           { perfCounters.setSupervisorMode(supervisor); });
 
   /* Initialize PC */
-  PC = program.getEntrypoint();
+  PC = entrypoint;
 }
 
 /* This method is used to initialize registers using values
@@ -67,37 +136,123 @@ Processor::getRegister(RegNumber regnum) const
 bool
 Processor::run(bool testMode)
 {
+  RunStatus status;
+
+  do
+    status = runFor(std::numeric_limits<uint64_t>::max(), testMode);
+  while (status == RunStatus::Running);
+
+  return status == RunStatus::Halted;
+}
+
+/* Run the processor for at most maxCycles clock cycles. This is used by
+ * the multi-core system to advance a core by a single time quantum.
+ */
+RunStatus
+Processor::runFor(uint64_t maxCycles, bool testMode)
+{
+  runCycles = maxCycles;
+  runEndCycle = maxCycles > std::numeric_limits<uint64_t>::max() - nCycles
+      ? std::numeric_limits<uint64_t>::max() : nCycles + maxCycles;
+  HostProfileSlice slice(hostProfiler.get());
+
   while (! sysStatus->shouldHalt())
     {
+      if (nCycles >= runEndCycle)
+        return RunStatus::Running;
+
       try
         {
-          /* The "bus clock" runs at 1/5 the frequency of the Processor. */
-          if (nCycles % 5 == 0)
-            bus.clockPulse();
+          scheduler.advanceTo(nCycles);
+
+          if (spr.isDozing())
+            {
+              doze();
+              continue;
+            }
+
+          if (! pendingMarkers.empty() && pipeline.isAtInstructionBoundary())
+            processRegionMarkers();
+
+          if (fpu.isExceptionPending())
+            {
+              if (pipeline.getPipelining())
+                throw std::runtime_error("exceptions are not supported in "
+                                         "pipelined mode");
+              if (pipeline.isAtInstructionBoundary())
+                takeFloatingPointException();
+            }
+
+          if (isInterruptPending())
+            {
+              if (pipeline.getPipelining())
+                throw std::runtime_error("interrupts are not supported in "
+                                         "pipelined mode");
+              if (pipeline.isAtInstructionBoundary())
+                takeInterrupt();
+            }
+
+          if (hostCalls && pipeline.isAtInstructionBoundary())
+            tryHostCall();
+
+          if (spinLoopDetection && pipeline.isAtInstructionBoundary() &&
+              skipSpinLoop())
+            continue;
+
+          if (profiler && pipeline.isAtInstructionBoundary())
+            profiler->nextInstruction(issued == 2 ? NPC : PC,
+                                      getProfileTotals());
 
           pipeline.propagate();
           pipeline.clockPulse();
           ++nCycles;
+
+          if (! accelerators.getAccesses().empty())
+            chargeAcceleratorAccesses();
+        }
+      catch (SynchronousException &e)
+        {
+          if (pipeline.getPipelining())
+            {
+              std::cerr << "ABNORMAL PROGRAM TERMINATION; PC = "
+                        << std::hex << e.PC << std::dec << std::endl;
+              std::cerr << "Reason: exceptions are not supported in "
+                        << "pipelined mode" << std::endl;
+              return RunStatus::Failed;
+            }
+
+          /* l.trap and a division raising the range exception are
+           * restarted after the handler returns, l.sys is not.
+           * An exception in a delay slot restarts at the branch, except
+           * for l.sys, which continues at the branch target.
+           */
+          MemAddress epcr = e.cause == ExceptionCause::systemCall ? e.PC + 4 : e.PC;
+          if (e.inDelaySlot)
+            epcr = e.cause == ExceptionCause::systemCall ? NPC : e.PC - 4;
+
+          pipeline.flush();
+          ++nCycles;
+          takeException(e.cause, epcr, e.PC, e.inDelaySlot);
         }
       catch (TestEndMarkerEncountered &e)
         {
           if (testMode)
-            return true;
+            return RunStatus::Halted;
           /* else */
           std::cerr << "ABNORMAL PROGRAM TERMINATION; PC = "
                     << std::hex << PC << std::dec << std::endl;
           std::cerr << "Reason: " << e.what() << std::endl;
-          return false;
+          return RunStatus::Failed;
         }
       catch (InstructionFetchFailure &e)
         {
           if (testMode)
-            return true;
+            return RunStatus::Halted;
           /* else */
           std::cerr << "ABNORMAL PROGRAM TERMINATION; PC = "
                     << std::hex << PC << std::dec << std::endl;
           std::cerr << "Reason: " << e.what() << std::endl;
-          return false;
+          return RunStatus::Failed;
         }
       catch (std::exception &e)
         {
@@ -105,10 +260,427 @@ Processor::run(bool testMode)
           std::cerr << "ABNORMAL PROGRAM TERMINATION; PC = "
                     << std::hex << PC << std::dec << std::endl;
           std::cerr << "Reason: " << e.what() << std::endl;
-          return false;
+          return RunStatus::Failed;
+        }
+    }
+
+  return RunStatus::Halted;
+}
+
+void
+Processor::attachDataCache(L1DataCache &cache)
+{
+  pipeline.setDataCache(&cache);
+}
+
+void
+Processor::configureFunctionalUnit(const FunctionalUnitConfig &config)
+{
+  FunctionalUnit *unit = pipeline.getFunctionalUnit(config.name);
+  if (! unit)
+    throw std::out_of_range("unknown functional unit " + config.name);
+
+  unit->configure(config.latency, config.interval);
+}
+
+void
+Processor::attachAccelerator(const AcceleratorBinding &binding)
+{
+  accelerators.attach(binding.slot,
+                      AcceleratorRegistry::instance().create(binding.name));
+}
+
+void
+Processor::interceptHostCall(MemAddress entry, HostFunction function)
+{
+  if (pipeline.getPipelining())
+    throw std::invalid_argument("host calls cannot be intercepted in pipelined mode");
+
+  if (! hostCalls)
+    hostCalls = std::make_unique<HostCallInterceptor>(bus);
+  hostCalls->intercept(entry, function);
+}
+
+/* Called between instructions: if the next instruction to be fetched is
+ * the entry of an intercepted routine, run the routine on the host and
+ * return to the caller right away. The pipeline is frozen for the
+ * estimated duration of the routine.
+ */
+void
+Processor::tryHostCall()
+{
+  /* Instruction fetch follows a taken branch once its delay slot has
+   * been fetched.
+   */
+  const MemAddress fetchPC = issued == 2 ? NPC : PC;
+  if (! hostCalls->isIntercepted(fetchPC))
+    return;
+
+  RegValue result{};
+  uint64_t cycles{};
+  if (! hostCalls->call(fetchPC, { regfile.readRegister(3),
+                                   regfile.readRegister(4),
+                                   regfile.readRegister(5) },
+                        result, cycles, hostAccesses))
+    return;
+
+  /* The routine accessed memory directly, bypassing the bus. */
+  for (const HostAccess &access : hostAccesses)
+    bus.countHostAccess(access.addr, access.size, access.write);
+  cycles += chargeMemoryAccesses(hostAccesses, fetchPC);
+
+  /* The estimated cycles are charged to the routine. */
+  if (profiler)
+    profiler->nextInstruction(fetchPC, getProfileTotals());
+
+  regfile.writeRegister(11, result);
+  PC = regfile.readRegister(9);
+  NPC = 0;
+  issued = 0;
+  pipeline.addStallCycles(cycles);
+
+  /* The routine may have changed memory. */
+  loopStateValid = false;
+}
+
+/* The accelerator that executed in this cycle accessed memory through
+ * the bus; the cycles spent in the data cache stall the pipeline.
+ */
+void
+Processor::chargeAcceleratorAccesses()
+{
+  const uint64_t cycles = chargeMemoryAccesses(accelerators.getAccesses(),
+                                               accelerators.getAccessPC());
+  accelerators.clearAccesses();
+  pipeline.addStallCycles(cycles);
+  loopStateValid = false;
+}
+
+/* Accesses made outside the memory stage, by host calls and
+ * accelerators, have the same effects as those of the guest code: they
+ * go through the data cache, which invalidates copies in the caches of
+ * other cores, and stores cancel reservations. Returns the cycles spent
+ * in the data cache.
+ */
+uint64_t
+Processor::chargeMemoryAccesses(const std::vector<HostAccess> &accesses,
+                                MemAddress PC)
+{
+  L1DataCache *cache = pipeline.getActiveDataCache();
+  uint64_t cycles = 0;
+  for (const HostAccess &access : accesses)
+    {
+      if (access.write)
+        monitor.snoopStore(coreId, access.addr, access.size);
+      if (cache)
+        cycles += cache->access(access.addr, access.size, access.write, PC);
+    }
+  return cycles;
+}
+
+void
+Processor::enableProfiler(const ELFFile &program)
+{
+  if (pipeline.getPipelining())
+    throw std::invalid_argument("profiling is not supported in pipelined mode");
+
+  profiler = std::make_unique<Profiler>(program);
+}
+
+/* Instruction fetches are not counted as memory traffic. */
+ProfileCosts
+Processor::getProfileTotals() const
+{
+  return { nCycles, pipeline.getInstrCompleted(), pipeline.getStalls(),
+           bus.getBytesRead() + bus.getBytesWritten() -
+           pipeline.getPerformanceEvents().fetches * INSTRUCTION_SIZE };
+}
+
+void
+Processor::writeProfile(const std::string &prefix,
+                        const std::string &programName)
+{
+  profiler->finish(getProfileTotals());
+
+  std::ofstream callgrind(prefix + ".callgrind");
+  profiler->writeCallgrind(callgrind, programName);
+
+  std::ofstream pprof(prefix + ".pb", std::ios::binary);
+  profiler->writePprof(pprof, programName);
+
+  if (! callgrind || ! pprof)
+    throw std::runtime_error("cannot write profile " + prefix);
+}
+
+void
+Processor::enablePipelineTrace(const std::string &filename)
+{
+  pipeTracer = std::make_unique<PipelineTracer>(filename);
+  pipeline.setTracer(pipeTracer.get());
+}
+
+void
+Processor::enableInstructionTrace(const std::string &filename)
+{
+  if (pipeline.getPipelining())
+    throw std::invalid_argument("instruction tracing is not supported in pipelined mode");
+
+  instructionTracer = std::make_unique<InstructionTracer>(filename);
+  pipeline.setInstructionTracer(instructionTracer.get());
+}
+
+void
+Processor::setRegionMode(bool enable)
+{
+  regionMode = enable;
+  setDetailed(! enable || nActiveRegions > 0);
+}
+
+/* Switch between the timing model and functional execution, keeping
+ * track of the events outside the regions of interest, so that these are
+ * reported separately.
+ */
+void
+Processor::setDetailed(bool enable)
+{
+  if (enable == pipeline.isDetailed())
+    return;
+
+  const PerformanceEvents now = pipeline.getPerformanceEvents();
+  if (enable)
+    functionalTotal += now - functionalStart;
+  else
+    functionalStart = now;
+
+  pipeline.setDetailed(enable);
+}
+
+PerformanceEvents
+Processor::getFunctionalEvents() const
+{
+  PerformanceEvents total = functionalTotal;
+  if (! pipeline.isDetailed())
+    total += pipeline.getPerformanceEvents() - functionalStart;
+  return total;
+}
+
+/* Called between instructions after the program wrote a region marker,
+ * so that the region starts or ends at an instruction boundary. Regions
+ * may nest; the timing model is enabled while any region is active.
+ */
+void
+Processor::processRegionMarkers()
+{
+  const PerformanceEvents now = pipeline.getPerformanceEvents();
+
+  for (const RegionMarker &marker : pendingMarkers)
+    {
+      RegionStatistics &region = regions[marker.id];
+      if (marker.begin && ! region.active)
+        {
+          region.active = true;
+          region.start = now;
+          ++region.entered;
+          ++nActiveRegions;
+        }
+      else if (! marker.begin && region.active)
+        {
+          region.active = false;
+          region.total += now - region.start;
+          --nActiveRegions;
         }
     }
+  pendingMarkers.clear();
+
+  if (regionMode)
+    setDetailed(nActiveRegions > 0);
+}
+
+/* Called between instructions: the next instruction to execute, or, if
+ * that is a delay slot, the branch, which is executed again after an
+ * exception handler returns.
+ */
+MemAddress
+Processor::getNextInstruction(bool &inDelaySlot) const
+{
+  inDelaySlot = issued == 1;
+  return inDelaySlot ? PC - 4 : issued == 2 ? NPC : PC;
+}
+
+/* Called between instructions when an enabled interrupt is pending. The
+ * tick timer takes precedence over external interrupts. EPCR points to
+ * the next instruction.
+ */
+void
+Processor::takeInterrupt()
+{
+  ExceptionCause cause;
+  if (tickTimer.isPending() && spr.isEnabled(SR::TEE))
+    {
+      cause = ExceptionCause::tickTimer;
+      recordInterruptLatency(TickTimerSource, tickTimer.getRaisedCycle());
+    }
+  else
+    {
+      cause = ExceptionCause::externalInterrupt;
+      const RegValue lines = pic.getStatus() & pic.getMask();
+      for (unsigned int line = 0; line < ProgrammableInterruptController::NumLines; ++line)
+        if (lines & (RegValue{1} << line))
+          recordInterruptLatency(line, pic.getRaisedCycle(line));
+    }
 
+  bool inDelaySlot;
+  const MemAddress epcr = getNextInstruction(inDelaySlot);
+  takeException(cause, epcr, epcr, inDelaySlot);
+}
+
+/* Called between instructions after a floating-point operation raised a
+ * flag with FPCSR[FPEE] set. The operation has completed, so EPCR points
+ * to the next instruction, like for interrupts.
+ */
+void
+Processor::takeFloatingPointException()
+{
+  fpu.clearPendingException();
+
+  bool inDelaySlot;
+  const MemAddress epcr = getNextInstruction(inDelaySlot);
+  takeException(ExceptionCause::floatingPoint, epcr, epcr, inDelaySlot);
+}
+
+void
+Processor::takeException(ExceptionCause cause, MemAddress epcr,
+                         MemAddress eear, bool inDelaySlot)
+{
+  ++nExceptions[static_cast<size_t>(cause)];
+
+  PC = spr.enterException(cause, epcr, eear, inDelaySlot);
+  NPC = 0;
+  issued = 0;
+
+  /* The handler may change the state the loop detection relies on. */
+  loopStateValid = false;
+}
+
+/* A source is accounted once per time it is raised, even if its handler
+ * returns before acknowledging it and is entered again.
+ */
+void
+Processor::recordInterruptLatency(size_t source, uint64_t raisedCycle)
+{
+  InterruptStatistics &stats = interruptStatistics[source];
+  if (stats.lastRaisedCycle == raisedCycle)
+    return;
+
+  const uint64_t latency = nCycles - raisedCycle;
+  stats.lastRaisedCycle = raisedCycle;
+  ++stats.taken;
+  stats.totalLatency += latency;
+  stats.maxLatency = std::max(stats.maxLatency, latency);
+  interruptLatency.sample(latency);
+}
+
+void
+Processor::waitForQuantumEnd()
+{
+  if (runEndCycle > nCycles + 1)
+    pipeline.addStallCycles(runEndCycle - nCycles - 1);
+
+  runEndCycle = runCycles > std::numeric_limits<uint64_t>::max() - runEndCycle
+      ? std::numeric_limits<uint64_t>::max() : runEndCycle + runCycles;
+}
+
+/* In doze mode the processor clock is stopped. Time advances straight
+ * to the next device event, which may wake up the processor, or to the
+ * end of the time quantum, after which shared devices may do so.
+ */
+void
+Processor::doze()
+{
+  const uint64_t target = std::min(scheduler.getNextEventTime(), runEndCycle);
+  if (target == EventScheduler::Never)
+    throw std::runtime_error("processor dozes while no event can wake it up");
+
+  pipeline.skipCycles(target - nCycles, 0);
+  nDozeCycles += target - nCycles;
+  nCycles = target;
+}
+
+bool
+Processor::LoopState::operator==(const LoopState &other) const
+{
+  return PC == other.PC && registers == other.registers &&
+      flag == other.flag && accumulator == other.accumulator &&
+      fpcsr == other.fpcsr && pmr == other.pmr &&
+      bytesWritten == other.bytesWritten &&
+      customOperations == other.customOperations;
+}
+
+Processor::LoopState
+Processor::captureLoopState(MemAddress loopPC) const
+{
+  LoopState state;
+  state.PC = loopPC;
+  state.registers = *regfile.registers;
+  state.flag = flag;
+  state.accumulator = mac.getAccumulator();
+  state.fpcsr = fpu.getFPCSR();
+  state.pmr = spr.read(SPR::PMR);
+  state.bytesWritten = bus.getBytesWritten();
+  state.customOperations = 0;
+  for (size_t slot = 0; slot < NumCustomUnits; ++slot)
+    state.customOperations += pipeline.getFunctionalUnits()[
+        getUnitIndex(FunctionalUnitSelector::accelerator, slot)]->getOperations();
+  return state;
+}
+
+/* Called between instructions. Loop heads are recognized as the targets
+ * of backward branches. When an iteration of a loop ends in the same
+ * architectural state in which it started, without writing to memory,
+ * every next iteration will do exactly the same until a device event
+ * changes something. Such a spin loop is fast-forwarded by whole
+ * iterations to the next event; the cycles and instructions of the
+ * skipped iterations are still counted.
+ *
+ * In a multi-core system, stores of the other cores become visible at
+ * the end of the time quantum, so fast-forwarding stops there as well.
+ */
+bool
+Processor::skipSpinLoop()
+{
+  if (issued != 2 || NPC > PC)
+    return false;
+
+  LoopState state = captureLoopState(NPC);
+  if (! loopStateValid || ! (state == loopState))
+    {
+      loopState = std::move(state);
+      loopStateValid = true;
+      loopStartCycle = nCycles;
+      loopStartInstructions = pipeline.getInstrCompleted();
+      return false;
+    }
+
+  const uint64_t period = nCycles - loopStartCycle;
+  const uint64_t instructions = pipeline.getInstrCompleted() - loopStartInstructions;
+  const uint64_t target = std::min(scheduler.getNextEventTime(), runEndCycle);
+  if (target == EventScheduler::Never)
+    throw std::runtime_error("spin loop without pending events can never be left");
+
+  loopStartCycle = nCycles;
+  loopStartInstructions = pipeline.getInstrCompleted();
+  if (period == 0 || target <= nCycles)
+    return false;
+
+  const uint64_t iterations = (target - nCycles) / period;
+  if (iterations == 0)
+    return false;
+
+  pipeline.skipCycles(iterations * period, iterations * instructions);
+  nSpinCycles += iterations * period;
+  nCycles += iterations * period;
+  loopStartCycle = nCycles;
+  loopStartInstructions = pipeline.getInstrCompleted();
   return true;
 }
 
@@ -134,14 +706,217 @@ Processor::dumpRegisters() const
     }
 }
 
+void
+Processor::enableHostProfiler()
+{
+  hostProfiler = std::make_unique<HostProfiler>();
+  pipeline.setHostProfiler(hostProfiler.get());
+  bus.setHostProfiler(hostProfiler.get());
+}
+
 void
 Processor::dumpStatistics() const
 {
   std::cerr << nCycles << " clock cycles, "
             << pipeline.getInstrIssued() << " instructions issued, "
             << pipeline.getInstrCompleted() << " instructions completed." << std::endl;
-  if (pipeline.getPipelining())
+  if (pipeline.getPipelining() || pipeline.getStalls() > 0)
     std::cerr << pipeline.getStalls() << " stall cycles inserted." << std::endl;
+  if (nDozeCycles > 0 || nSpinCycles > 0)
+    std::cerr << nDozeCycles << " cycles dozing, " << nSpinCycles
+              << " cycles fast-forwarded in spin loops." << std::endl;
   std::cerr << bus.getBytesRead() << " bytes read, "
             << bus.getBytesWritten() << " bytes written." << std::endl;
+
+  for (const auto &unit : pipeline.getFunctionalUnits())
+    if (unit && unit->getOperations() > 0)
+      std::cerr << "Unit " << unit->getName() << ": "
+                << unit->getOperations() << " operations, "
+                << unit->getDependencyStalls() << " dependency stalls, "
+                << unit->getStructuralStalls() << " structural stalls."
+                << std::endl;
+
+  if (regfile.getBankSwitches() > 0)
+    {
+      /* Without banks, a handler saves the registers of the interrupted
+       * context on entry and restores them before returning, each with a
+       * memory access that executes at the average CPI.
+       */
+      const uint64_t avoided = regfile.getBankSwitches() * (NumRegs - 1);
+      const uint64_t instructions = std::max<uint64_t>(pipeline.getInstrCompleted(), 1);
+      std::cerr << regfile.getBankSwitches() << " register bank switches, "
+                << "avoiding an estimated " << avoided
+                << " register saves and restores ("
+                << avoided * nCycles / instructions << " cycles)." << std::endl;
+    }
+
+  for (size_t i = 0; i < nExceptions.size(); ++i)
+    if (nExceptions[i] > 0)
+      std::cerr << "Exception " << getExceptionName(static_cast<ExceptionCause>(i))
+                << ": " << nExceptions[i] << " taken." << std::endl;
+
+  for (size_t source = 0; source < interruptStatistics.size(); ++source)
+    {
+      const InterruptStatistics &stats = interruptStatistics[source];
+      if (stats.taken == 0)
+        continue;
+
+      if (source == TickTimerSource)
+        std::cerr << "Interrupt tick timer: ";
+      else
+        std::cerr << "Interrupt line " << source << ": ";
+      std::cerr << stats.taken << " taken, latency "
+                << stats.totalLatency / stats.taken << " cycles on average, "
+                << stats.maxLatency << " at most." << std::endl;
+    }
+
+  if (hostCalls)
+    hostCalls->dumpStatistics(std::cerr);
+
+  if (regionMode)
+    {
+      const PerformanceEvents functional = getFunctionalEvents();
+      std::cerr << "Timing was only modelled inside the regions of interest: "
+                << nCycles - functional.cycles << " clock cycles, "
+                << pipeline.getInstrCompleted() - functional.instructions
+                << " instructions completed. Outside them, "
+                << functional.cycles << " cycles and "
+                << functional.instructions
+                << " instructions were executed functionally." << std::endl;
+    }
+
+  for (const auto &[id, region] : regions)
+    {
+      if (region.entered == 0)
+        continue;
+
+      /* A region that is still active at the end of the program ends
+       * there.
+       */
+      PerformanceEvents total = region.total;
+      if (region.active)
+        total += pipeline.getPerformanceEvents() - region.start;
+
+      std::cerr << "Region " << id << ": entered " << region.entered
+                << " times, " << total.cycles << " cycles, "
+                << total.instructions << " instructions, "
+                << total.loads << " loads, " << total.stores << " stores, "
+                << total.dataCacheMisses << " data cache misses, "
+                << total.dependencyStalls << " dependency stalls, "
+                << total.structuralStalls << " structural stalls, "
+                << total.memoryStalls << " memory stall cycles."
+                << std::endl;
+    }
+
+  if (hostProfiler)
+    hostProfiler->report(std::cerr, pipeline.getInstrCompleted());
+}
+
+void
+Processor::registerStatistics(StatsRegistry &stats,
+                              const std::string &prefix) const
+{
+  stats.addCounter(prefix + "cycles", nCycles, "clock cycles");
+  stats.addCounter(prefix + "instructions.issued",
+                   [this] { return pipeline.getInstrIssued(); },
+                   "instructions issued");
+  stats.addCounter(prefix + "instructions.completed",
+                   [this] { return pipeline.getInstrCompleted(); },
+                   "instructions completed");
+  stats.addCounter(prefix + "stalls",
+                   [this] { return pipeline.getStalls(); },
+                   "stall cycles inserted");
+  stats.addCounter(prefix + "dozeCycles", nDozeCycles, "cycles dozing");
+  stats.addCounter(prefix + "spinCycles", nSpinCycles,
+                   "cycles fast-forwarded in spin loops");
+
+  const std::pair<const char *, uint64_t PerformanceEvents::*> events[] =
+    {
+      { "loads", &PerformanceEvents::loads },
+      { "stores", &PerformanceEvents::stores },
+      { "dataCacheMisses", &PerformanceEvents::dataCacheMisses },
+      { "memoryStalls", &PerformanceEvents::memoryStalls },
+      { "branchStalls", &PerformanceEvents::branchStalls },
+      { "dependencyStalls", &PerformanceEvents::dependencyStalls },
+      { "structuralStalls", &PerformanceEvents::structuralStalls }
+    };
+  for (const auto &[name, member] : events)
+    stats.addCounter(prefix + "events." + name,
+                     [this, member = member] { return pipeline.getPerformanceEvents().*member; },
+                     std::string("performance counter event ") + name);
+
+  stats.addCounter(prefix + "functional.cycles",
+                   [this] { return getFunctionalEvents().cycles; },
+                   "clock cycles executed functionally, outside the "
+                   "regions of interest");
+  stats.addCounter(prefix + "functional.instructions",
+                   [this] { return getFunctionalEvents().instructions; },
+                   "instructions executed functionally, outside the "
+                   "regions of interest");
+
+  /* Only the cycles and instructions for which timing was modelled */
+  stats.addFormula(prefix + "CPI",
+                   [this]
+                   {
+                     const PerformanceEvents functional = getFunctionalEvents();
+                     return double(nCycles - functional.cycles) /
+                         (pipeline.getInstrCompleted() - functional.instructions);
+                   },
+                   "clock cycles per completed instruction, with timing modelled");
+  stats.addFormula(prefix + "IPC",
+                   [this]
+                   {
+                     const PerformanceEvents functional = getFunctionalEvents();
+                     return double(pipeline.getInstrCompleted() - functional.instructions) /
+                         (nCycles - functional.cycles);
+                   },
+                   "completed instructions per clock cycle, with timing modelled");
+  stats.addFormula(prefix + "bus.bytesPerCycle",
+                   [this]
+                   {
+                     return double(bus.getBytesRead() + bus.getBytesWritten()) / nCycles;
+                   },
+                   "bus bandwidth in bytes per clock cycle");
+  bus.registerStatistics(stats, prefix + "bus");
+  if (hostCalls)
+    hostCalls->registerStatistics(stats, prefix + "hostCalls");
+
+  stats.addGroup(prefix + "mix",
+                 [this] { return pipeline.getInstructionMix().get(); },
+                 "instructions issued per mnemonic");
+
+  for (const auto &unit : pipeline.getFunctionalUnits())
+    {
+      if (! unit)
+        continue;
+
+      const FunctionalUnit *u = unit.get();
+      const std::string path = prefix + "unit." + u->getName();
+      stats.addCounter(path + ".operations",
+                       [u] { return u->getOperations(); },
+                       "operations issued to " + path);
+      stats.addCounter(path + ".dependencyStalls",
+                       [u] { return u->getDependencyStalls(); },
+                       "cycles waiting for a result of " + path);
+      stats.addCounter(path + ".structuralStalls",
+                       [u] { return u->getStructuralStalls(); },
+                       "cycles waiting for " + path + " to accept an operation");
+    }
+
+  /* In the order of ExceptionCause */
+  static constexpr std::array<const char *, NumExceptionCauses> exceptionKeys =
+    {
+      "tickTimer", "externalInterrupt", "systemCall", "trap", "floatingPoint",
+      "range"
+    };
+  for (size_t i = 0; i < nExceptions.size(); ++i)
+    stats.addCounter(prefix + "exceptions." + exceptionKeys[i], nExceptions[i],
+                     std::string(getExceptionName(static_cast<ExceptionCause>(i))) +
+                     " exceptions taken");
+
+  stats.addHistogram(prefix + "interrupts.latency", interruptLatency,
+                     "cycles from raising an interrupt until entering its handler");
+  stats.addCounter(prefix + "registerBankSwitches",
+                   [this] { return regfile.getBankSwitches(); },
+                   "register bank switches");
 }
@@ -11,15 +11,43 @@
 #include "arch.h"
 
 #include "elf-file.h"
+#include "event-scheduler.h"
+#include "host-calls.h"
+#include "perf-counters.h"
+#include "pic.h"
 #include "pipeline.h"
+#include "profiler.h"
+#include "stats.h"
 #include "sys-status.h"
+#include "tick-timer.h"
 
+#include <map>
+#include <vector>
+
+
+/* Outcome of running a processor for a number of cycles. */
+enum class RunStatus
+{
+  Running,
+  Halted,
+  Failed
+};
 
 class Processor
 {
   public:
     Processor(ELFFile &program, bool pipelining, bool debugMode=false);
 
+    /* Constructs a core of a multi-core system. The memory bus clients
+     * are typically ports onto memories and devices that are owned by
+     * the system and shared with the other cores.
+     */
+    Processor(std::vector<std::unique_ptr<MemoryInterface>> &&clients,
+              MemAddress entrypoint,
+              unsigned int coreId, unsigned int nCores,
+              ReservationMonitor *sharedMonitor,
+              bool pipelining, bool debugMode=false);
+
     Processor(const Processor &) = delete;
     Processor &operator=(const Processor &) = delete;
 
@@ -29,29 +57,243 @@ class Processor
 
     /* Instruction execution steps */
     bool run(bool testMode=false);
+    RunStatus runFor(uint64_t maxCycles, bool testMode=false);
+
+    /* Called during runFor when the current instruction has to wait for
+     * the end of the time quantum, see MultiCoreSystem. The core stalls
+     * for the remainder of the quantum, and runFor returns at the end of
+     * the next one instead.
+     */
+    void waitForQuantumEnd();
+
+    unsigned int getCoreId() const { return coreId; }
+    uint64_t getCycles() const { return nCycles; }
+    uint64_t getInstructions() const { return pipeline.getInstrCompleted(); }
+    MemAddress getPC() const { return PC; }
+    bool hasHalted() const { return sysStatus->shouldHalt(); }
+
+    /* Scheduler of the events of the devices private to this core. */
+    EventScheduler &getScheduler() { return scheduler; }
+
+    /* Attach a private L1 data cache of a coherent cache hierarchy. */
+    void attachDataCache(L1DataCache &cache);
+
+    /* Override the timing of one of the multi-cycle functional units. */
+    void configureFunctionalUnit(const FunctionalUnitConfig &config);
+
+    /* Attach an accelerator to one of the custom instruction opcodes. */
+    void attachAccelerator(const AcceleratorBinding &binding);
+
+    /* Run the host equivalent of a library routine whenever the routine
+     * starting at entry is called. Only supported without pipelining.
+     */
+    void interceptHostCall(MemAddress entry, HostFunction function);
+
+    /* Provide banks of general-purpose registers, selected by SR[CID],
+     * so that exception handlers do not have to save and restore the
+     * registers of the interrupted context.
+     */
+    void setRegisterBanks(size_t n) { regfile.setNumBanks(n); }
+
+    /* Skip ahead when the processor spins in a loop that cannot make
+     * progress until the next device event.
+     */
+    void setSpinLoopDetection(bool enable) { spinLoopDetection = enable; }
+
+    /* Run in functional mode, without timing model, except inside the
+     * regions of interest that the program marks through the system
+     * status module. Only supported without pipelining. The cycles and
+     * instructions outside the regions are reported separately.
+     */
+    void setRegionMode(bool enable);
+
+    /* Attribute cycles, instructions, stalls and memory traffic to the
+     * instructions and functions of the program. Only supported without
+     * pipelining.
+     */
+    void enableProfiler(const ELFFile &program);
+
+    /* Write the profile to prefix.callgrind and prefix.pb (pprof). */
+    void writeProfile(const std::string &prefix,
+                      const std::string &programName);
+
+    /* Record the progress of every instruction through the pipeline in
+     * a trace file.
+     */
+    void enablePipelineTrace(const std::string &filename);
+
+    /* Record every retired instruction, with its register writes, memory
+     * access and branch outcome, in a compressed trace file. Only
+     * supported without pipelining.
+     */
+    void enableInstructionTrace(const std::string &filename);
+
+    /* Measure where the emulator spends host time, per pipeline stage
+     * and for the memory bus; reported with the statistics.
+     */
+    void enableHostProfiler();
+
+    /* Called by devices to end doze mode, e.g. on an interrupt. */
+    void wakeUp() { spr.wakeUp(); }
+
+    /* Devices assert their interrupt lines through the PIC. */
+    ProgrammableInterruptController &getInterruptController() { return pic; }
 
     /* Debugging and statistics */
     void dumpRegisters() const;
     void dumpStatistics() const;
 
+    /* Register the statistics of the core and its components, with
+     * names starting with prefix (e.g. "core0.", or empty).
+     */
+    void registerStatistics(StatsRegistry &stats,
+                            const std::string &prefix) const;
+
   private:
+    const unsigned int coreId{};
+
     /* Statistics */
     uint64_t nCycles{};
 
+    /* Cycle at which runFor returns and the number of cycles it runs. */
+    uint64_t runEndCycle{};
+    uint64_t runCycles{};
+
     /* Components shared by multiple stages or components. */
     RegisterFile regfile{};
     bool flag{};
+    MultiplyAccumulator mac{};
+    FloatingPointUnit fpu{};
     InstructionDecoder decoder{};
 
+    /* l.lwa/l.swa reservations; owned by the processor unless shared
+     * with other cores.
+     */
+    std::unique_ptr<ReservationMonitor> privateMonitor;
+    ReservationMonitor &monitor;
+
+    EventScheduler scheduler{};
+    const ClockDomain &busClock;
+
+    /* Interrupt sources and the special-purpose registers that control
+     * them.
+     */
+    ProgrammableInterruptController pic;
+    TickTimer tickTimer;
+    SpecialPurposeRegisters spr;
+
     MemoryBus bus;
     InstructionMemory instructionMemory;
     DataMemory dataMemory;
+    AcceleratorSlots accelerators;
 
     MemAddress PC{};
     MemAddress NPC{};
     size_t issued{};
 
     Pipeline pipeline;
+    PerformanceCounterUnit perfCounters;
+
+    std::unique_ptr<HostCallInterceptor> hostCalls{};
+    std::vector<HostAccess> hostAccesses{};
+    std::unique_ptr<Profiler> profiler{};
+    std::unique_ptr<PipelineTracer> pipeTracer{};
+    std::unique_ptr<InstructionTracer> instructionTracer{};
+    std::unique_ptr<HostProfiler> hostProfiler{};
+
+    ProfileCosts getProfileTotals() const;
+
+    /* Architectural state at the head of a loop, to detect iterations
+     * that did not change anything.
+     */
+    struct LoopState
+    {
+      MemAddress PC{};
+      std::array<RegValue, NumRegs - 1> registers{};
+      bool flag{};
+      uint64_t accumulator{};
+      uint32_t fpcsr{};
+      RegValue pmr{};
+      uint64_t bytesWritten{};
+      uint64_t customOperations{};
+
+      bool operator==(const LoopState &other) const;
+    };
+
+    bool spinLoopDetection{};
+    bool loopStateValid{};
+    LoopState loopState{};
+    uint64_t loopStartCycle{};
+    uint64_t loopStartInstructions{};
+
+    /* Regions of interest, by ID */
+    struct RegionMarker
+    {
+      bool begin;
+      uint32_t id;
+    };
+
+    struct RegionStatistics
+    {
+      bool active{};
+      uint64_t entered{};
+      PerformanceEvents start{};
+      PerformanceEvents total{};
+    };
+
+    bool regionMode{};
+    std::vector<RegionMarker> pendingMarkers{};
+    std::map<uint32_t, RegionStatistics> regions{};
+    size_t nActiveRegions{};
+
+    void processRegionMarkers();
+
+    /* Events while executing functionally, outside the regions */
+    PerformanceEvents functionalStart{};
+    PerformanceEvents functionalTotal{};
+
+    void setDetailed(bool enable);
+    PerformanceEvents getFunctionalEvents() const;
+
+    /* Statistics */
+    uint64_t nDozeCycles{};
+    uint64_t nSpinCycles{};
+    std::array<uint64_t, NumExceptionCauses> nExceptions{};
+
+    /* Latency from raising an interrupt until entering its handler, per
+     * PIC line and, in the last entry, for the tick timer.
+     */
+    struct InterruptStatistics
+    {
+      uint64_t taken{};
+      uint64_t totalLatency{};
+      uint64_t maxLatency{};
+      uint64_t lastRaisedCycle = EventScheduler::Never;
+    };
+
+    static constexpr size_t TickTimerSource = ProgrammableInterruptController::NumLines;
+    std::array<InterruptStatistics, TickTimerSource + 1> interruptStatistics{};
+    Histogram interruptLatency{};
+
+    bool isInterruptPending() const
+    {
+      return (tickTimer.isPending() && spr.isEnabled(SR::TEE)) ||
+          (pic.isPending() && spr.isEnabled(SR::IEE));
+    }
+
+    MemAddress getNextInstruction(bool &inDelaySlot) const;
+    void takeInterrupt();
+    void takeFloatingPointException();
+    void takeException(ExceptionCause cause, MemAddress epcr,
+                       MemAddress eear, bool inDelaySlot);
+    void recordInterruptLatency(size_t source, uint64_t raisedCycle);
+    void tryHostCall();
+    void chargeAcceleratorAccesses();
+    uint64_t chargeMemoryAccesses(const std::vector<HostAccess> &accesses,
+                                  MemAddress PC);
+    void doze();
+    bool skipSpinLoop();
+    LoopState captureLoopState(MemAddress loopPC) const;
 
     /* Memory bus clients */
     SysStatus *sysStatus{};  /* no ownership */
@@ -0,0 +1,391 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    profiler.cc - Per-instruction and per-function cycle profiler.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#include "profiler.h"
+#include "elf-file.h"
+
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+
+#ifdef _MSC_VER
+#define __builtin_bswap32 _byteswap_ulong
+#endif
+
+
+static constexpr std::array<const char *, NumProfileEvents> eventNames =
+{
+  "Cycles", "Instructions", "Stalls", "Bytes"
+};
+
+/* Names and units of the pprof sample types. */
+static constexpr std::array<std::pair<const char *, const char *>, NumProfileEvents>
+sampleTypes =
+{{
+  { "cycles", "count" },
+  { "instructions", "count" },
+  { "stalls", "cycles" },
+  { "memory", "bytes" }
+}};
+
+static ProfileCosts &
+operator+=(ProfileCosts &a, const ProfileCosts &b)
+{
+  for (size_t i = 0; i < NumProfileEvents; ++i)
+    a[i] += b[i];
+  return a;
+}
+
+static bool
+isZero(const ProfileCosts &costs)
+{
+  return std::all_of(costs.begin(), costs.end(),
+                     [](uint64_t c) { return c == 0; });
+}
+
+
+Profiler::Profiler(const ELFFile &program)
+{
+  std::vector<std::byte> text;
+  size_t textSize{};
+  if (! program.getTextSegment(text, textBase, textSize))
+    throw std::runtime_error("cannot profile a program without text segment");
+
+  textWords = textSize / 4;
+  pcCosts.resize(textWords + 1);
+  isCall.resize(textWords + 1);
+  functionOf.resize(textWords + 1);
+
+  /* l.jal and l.jalr */
+  for (size_t i = 0; i < textWords; ++i)
+    {
+      uint32_t word;
+      std::copy_n(&text[i * 4], 4, reinterpret_cast<std::byte *>(&word));
+      const uint32_t opcode = __builtin_bswap32(word) >> 26;
+      isCall[i] = opcode == 0x01 || opcode == 0x12;
+    }
+
+  /* A function extends up to the next symbol. Of symbols at the same
+   * address, the first by name is kept.
+   */
+  functions.push_back({ "??", 0 });
+  std::map<MemAddress, std::string> byAddress;
+  for (const auto &[name, address] : program.getFunctionSymbols())
+    byAddress.emplace(address, name);
+
+  for (const auto &[address, name] : byAddress)
+    {
+      const size_t begin = getIndex(address);
+      if (begin == textWords)
+        continue;
+
+      functions.push_back({ name, address });
+      std::fill(functionOf.begin() + begin, functionOf.end() - 1,
+                functions.size() - 1);
+    }
+
+  contexts.push_back({ 0, textWords, 0 });
+  currentIndex = previousIndex = textWords;
+}
+
+void
+Profiler::finish(const ProfileCosts &totals)
+{
+  ProfileCosts &costs = pcCosts[currentIndex];
+  for (size_t i = 0; i < NumProfileEvents; ++i)
+    costs[i] += totals[i] - last[i];
+  last = totals;
+
+  closeSegment(totals);
+}
+
+void
+Profiler::closeSegment(const ProfileCosts &totals)
+{
+  ProfileCosts delta;
+  for (size_t i = 0; i < NumProfileEvents; ++i)
+    delta[i] = totals[i] - segmentStart[i];
+  segmentStart = totals;
+
+  if (! isZero(delta))
+    contextCosts[{ currentContext, currentFunction }] += delta;
+}
+
+void
+Profiler::enterFunction(size_t callSite, size_t callee,
+                        const ProfileCosts &totals)
+{
+  closeSegment(totals);
+
+  auto [it, inserted] = contexts[currentContext].children.try_emplace(
+      { callSite, callee }, contexts.size());
+  if (inserted)
+    contexts.push_back({ currentContext, callSite, callee });
+
+  ++contexts[it->second].calls;
+  stack.push_back({ it->second, getAddress(callSite) + 8 });
+  currentContext = it->second;
+  currentFunction = callee;
+}
+
+void
+Profiler::leaveFunction(const ProfileCosts &totals)
+{
+  closeSegment(totals);
+
+  const Frame &frame = stack.back();
+  currentContext = contexts[frame.context].parent;
+  currentFunction = functionOf[getIndex(frame.returnAddress)];
+  stack.pop_back();
+}
+
+void
+Profiler::switchFunction(size_t function, const ProfileCosts &totals)
+{
+  closeSegment(totals);
+  currentFunction = function;
+}
+
+std::map<std::pair<size_t, size_t>, std::pair<uint64_t, ProfileCosts>>
+Profiler::getCallEdges() const
+{
+  /* Children are created after their parents. */
+  std::vector<ProfileCosts> inclusive(contexts.size());
+  for (const auto &[key, costs] : contextCosts)
+    inclusive[key.first] += costs;
+  for (size_t c = contexts.size() - 1; c > 0; --c)
+    inclusive[contexts[c].parent] += inclusive[c];
+
+  std::map<std::pair<size_t, size_t>, std::pair<uint64_t, ProfileCosts>> edges;
+  for (size_t c = 1; c < contexts.size(); ++c)
+    {
+      auto &edge = edges[{ contexts[c].callSite, contexts[c].callee }];
+      edge.first += contexts[c].calls;
+      edge.second += inclusive[c];
+    }
+
+  return edges;
+}
+
+
+/*
+ * Callgrind
+ */
+
+static void
+writeCosts(std::ostream &os, MemAddress address, const ProfileCosts &costs)
+{
+  os << "0x" << std::hex << address << std::dec;
+  for (uint64_t c : costs)
+    os << ' ' << c;
+  os << '\n';
+}
+
+void
+Profiler::writeCallgrind(std::ostream &os, const std::string &programName) const
+{
+  ProfileCosts total{};
+  for (const auto &costs : pcCosts)
+    total += costs;
+
+  os << "# callgrind format\n"
+     << "version: 1\n"
+     << "creator: rv64-emu\n"
+     << "cmd: " << programName << "\n"
+     << "positions: instr\n"
+     << "events:";
+  for (const char *name : eventNames)
+    os << ' ' << name;
+  os << "\nsummary:";
+  for (uint64_t c : total)
+    os << ' ' << c;
+  os << "\n\nob=" << programName << "\n";
+
+  /* Function names are compressed to their ID after first use. */
+  std::set<size_t> named;
+  auto writeName = [&os, &named, this](size_t function)
+    {
+      os << '(' << function + 1 << ')';
+      if (named.insert(function).second)
+        os << ' ' << functions[function].name;
+      os << '\n';
+    };
+
+  /* Group the instructions and call sites by function. */
+  std::vector<std::vector<size_t>> instructions(functions.size());
+  for (size_t i = 0; i <= textWords; ++i)
+    if (! isZero(pcCosts[i]))
+      instructions[functionOf[i]].push_back(i);
+
+  const auto edges = getCallEdges();
+  std::vector<std::vector<decltype(edges)::const_iterator>> calls(functions.size());
+  for (auto it = edges.begin(); it != edges.end(); ++it)
+    calls[functionOf[it->first.first]].push_back(it);
+
+  for (size_t function = 0; function < functions.size(); ++function)
+    {
+      if (instructions[function].empty() && calls[function].empty())
+        continue;
+
+      os << "\nfn=";
+      writeName(function);
+
+      for (size_t i : instructions[function])
+        writeCosts(os, getAddress(i), pcCosts[i]);
+
+      for (const auto &it : calls[function])
+        {
+          const auto [callSite, callee] = it->first;
+          const auto &[count, costs] = it->second;
+
+          os << "cfn=";
+          writeName(callee);
+          os << "calls=" << count << " 0x" << std::hex
+             << functions[callee].entry << std::dec << '\n';
+          writeCosts(os, getAddress(callSite), costs);
+        }
+    }
+}
+
+
+/*
+ * pprof, see profile.proto in the pprof repository. Messages are
+ * written to a buffer first because their length precedes them.
+ */
+
+static void
+putVarint(std::string &buffer, uint64_t value)
+{
+  while (value >= 0x80)
+    {
+      buffer += static_cast<char>((value & 0x7f) | 0x80);
+      value >>= 7;
+    }
+  buffer += static_cast<char>(value);
+}
+
+static void
+putField(std::string &buffer, unsigned int number, uint64_t value)
+{
+  putVarint(buffer, number << 3);
+  putVarint(buffer, value);
+}
+
+static void
+putField(std::string &buffer, unsigned int number, const std::string &bytes)
+{
+  putVarint(buffer, (number << 3) | 2);
+  putVarint(buffer, bytes.size());
+  buffer += bytes;
+}
+
+static void
+putPacked(std::string &buffer, unsigned int number,
+          const std::vector<uint64_t> &values)
+{
+  std::string packed;
+  for (uint64_t value : values)
+    putVarint(packed, value);
+  putField(buffer, number, packed);
+}
+
+void
+Profiler::writePprof(std::ostream &os, const std::string &programName) const
+{
+  std::string profile;
+
+  /* The string table starts with the empty string. */
+  std::vector<std::string> strings{ "" };
+  std::map<std::string, uint64_t> stringIndex{ { "", 0 } };
+  auto intern = [&strings, &stringIndex](const std::string &s)
+    {
+      auto [it, inserted] = stringIndex.try_emplace(s, strings.size());
+      if (inserted)
+        strings.push_back(s);
+      return it->second;
+    };
+
+  for (const auto &[type, unit] : sampleTypes)
+    {
+      std::string valueType;
+      putField(valueType, 1, intern(type));
+      putField(valueType, 2, intern(unit));
+      putField(profile, 1, valueType);
+    }
+
+  /* Location IDs 1 to N are the functions themselves, at their entry,
+   * followed by the call sites.
+   */
+  std::map<size_t, uint64_t> callSiteLocations;
+  for (size_t c = 1; c < contexts.size(); ++c)
+    callSiteLocations.emplace(contexts[c].callSite, 0);
+  uint64_t nextLocation = functions.size() + 1;
+  for (auto &[callSite, location] : callSiteLocations)
+    location = nextLocation++;
+
+  /* Samples, one per calling context and function, leaf first. */
+  for (const auto &[key, costs] : contextCosts)
+    {
+      std::vector<uint64_t> stack{ key.second + 1 };
+      for (size_t c = key.first; c != 0; c = contexts[c].parent)
+        stack.push_back(callSiteLocations.at(contexts[c].callSite));
+
+      std::string sample;
+      putPacked(sample, 1, stack);
+      putPacked(sample, 2, std::vector<uint64_t>(costs.begin(), costs.end()));
+      putField(profile, 2, sample);
+    }
+
+  std::string mapping;
+  putField(mapping, 1, 1);
+  putField(mapping, 2, textBase);
+  putField(mapping, 3, textBase + textWords * 4);
+  putField(mapping, 5, intern(programName));
+  putField(mapping, 7, 1);
+  putField(profile, 3, mapping);
+
+  auto putLocation = [&profile, this](uint64_t id, MemAddress address,
+                                      uint64_t function)
+    {
+      std::string line;
+      putField(line, 1, function);
+
+      std::string location;
+      putField(location, 1, id);
+      if (getIndex(address) != textWords)
+        putField(location, 2, 1);
+      putField(location, 3, address);
+      putField(location, 4, line);
+      putField(profile, 4, location);
+    };
+
+  for (size_t f = 0; f < functions.size(); ++f)
+    putLocation(f + 1, functions[f].entry, f + 1);
+  for (const auto &[callSite, location] : callSiteLocations)
+    putLocation(location, getAddress(callSite), functionOf[callSite] + 1);
+
+  for (size_t f = 0; f < functions.size(); ++f)
+    {
+      std::string function;
+      putField(function, 1, f + 1);
+      putField(function, 2, intern(functions[f].name));
+      putField(function, 3, intern(functions[f].name));
+      putField(profile, 5, function);
+    }
+
+  /* period_type and period: every cycle is accounted. */
+  std::string periodType;
+  putField(periodType, 1, intern(sampleTypes[0].first));
+  putField(periodType, 2, intern(sampleTypes[0].second));
+  putField(profile, 11, periodType);
+  putField(profile, 12, 1);
+
+  for (const auto &s : strings)
+    putField(profile, 6, s);
+
+  os.write(profile.data(), profile.size());
+}
@@ -0,0 +1,159 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    profiler.h - Per-instruction and per-function cycle profiler.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include "arch.h"
+
+#include <array>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class ELFFile;
+
+/* Events attributed to instructions, as running totals. */
+enum class ProfileEvent
+{
+  cycles,
+  instructions,
+  stalls,
+  bytes,          /* data transferred over the memory bus */
+  LAST
+};
+
+constexpr size_t NumProfileEvents = static_cast<size_t>(ProfileEvent::LAST);
+using ProfileCosts = std::array<uint64_t, NumProfileEvents>;
+
+/* The profiler is told about every instruction the processor starts and
+ * charges the events since the previous one to the previous instruction,
+ * in a flat array indexed by the word offset in the text segment.
+ *
+ * Calls are recognized as l.jal and l.jalr, which take effect after
+ * their delay slot, and returns as reaching the return address the call
+ * left in r9, the target of l.jr r9. A shadow call stack follows them
+ * and costs are also charged to the calling context, which is only
+ * updated when a call, return or jump to another function happens.
+ * Inclusive costs are derived from the calling contexts.
+ */
+class Profiler
+{
+  public:
+    explicit Profiler(const ELFFile &program);
+
+    Profiler(const Profiler &) = delete;
+    Profiler &operator=(const Profiler &) = delete;
+
+    /* Called before the instruction at PC is fetched, with the event
+     * totals so far.
+     */
+    void nextInstruction(MemAddress PC, const ProfileCosts &totals)
+    {
+      ProfileCosts &costs = pcCosts[currentIndex];
+      for (size_t i = 0; i < NumProfileEvents; ++i)
+        costs[i] += totals[i] - last[i];
+      last = totals;
+
+      const size_t index = getIndex(PC);
+      if (isCall[previousIndex])
+        enterFunction(previousIndex, functionOf[index], totals);
+      else if (! stack.empty() && PC == stack.back().returnAddress)
+        leaveFunction(totals);
+      else if (functionOf[index] != currentFunction)
+        switchFunction(functionOf[index], totals);
+
+      previousIndex = currentIndex;
+      currentIndex = index;
+    }
+
+    /* Charge the events after the last instruction started. */
+    void finish(const ProfileCosts &totals);
+
+    /* Callgrind format, for KCachegrind and callgrind_annotate. */
+    void writeCallgrind(std::ostream &os, const std::string &programName) const;
+
+    /* Uncompressed pprof protocol buffer. */
+    void writePprof(std::ostream &os, const std::string &programName) const;
+
+  private:
+    struct Function
+    {
+      std::string name;
+      MemAddress entry;
+    };
+
+    /* A calling context is a path through the call graph. Context 0 is
+     * the program entry.
+     */
+    struct Context
+    {
+      size_t parent;
+      size_t callSite;        /* index of the call instruction */
+      size_t callee;          /* function */
+      uint64_t calls{};
+      std::map<std::pair<size_t, size_t>, size_t> children{};
+    };
+
+    struct Frame
+    {
+      size_t context;
+      MemAddress returnAddress;
+    };
+
+    MemAddress textBase{};
+    size_t textWords{};
+
+    /* Per text word, plus one entry for instructions outside the text
+     * segment.
+     */
+    std::vector<ProfileCosts> pcCosts{};
+    std::vector<bool> isCall{};
+    std::vector<size_t> functionOf{};
+
+    /* Function 0 collects code without symbol. */
+    std::vector<Function> functions{};
+
+    std::vector<Context> contexts{};
+    std::vector<Frame> stack{};
+    std::map<std::pair<size_t, size_t>, ProfileCosts> contextCosts{};
+
+    ProfileCosts last{};
+    size_t currentIndex{};
+    size_t previousIndex{};
+
+    /* Costs since segmentStart have not been charged to the current
+     * context and function yet.
+     */
+    ProfileCosts segmentStart{};
+    size_t currentContext{};
+    size_t currentFunction{};
+
+    size_t getIndex(MemAddress PC) const
+    {
+      const MemAddress offset = (PC - textBase) / 4;
+      return PC >= textBase && offset < textWords ? offset : textWords;
+    }
+
+    MemAddress getAddress(size_t index) const
+    {
+      return index < textWords ? textBase + index * 4 : 0;
+    }
+
+    void closeSegment(const ProfileCosts &totals);
+    void enterFunction(size_t callSite, size_t callee,
+                       const ProfileCosts &totals);
+    void leaveFunction(const ProfileCosts &totals);
+    void switchFunction(size_t function, const ProfileCosts &totals);
+
+    /* Inclusive costs per call site and callee, with the number of calls. */
+    std::map<std::pair<size_t, size_t>, std::pair<uint64_t, ProfileCosts>>
+        getCallEdges() const;
+};
+
+#endif /* __PROFILER_H__ */
@@ -14,16 +14,69 @@
 #include <stdexcept>
 #include <string>
 #include <iostream>
+#include <vector>
 
 class Processor;
 
 /* For now hard-coded for a single zero-register and
  * (NumRegs - 1) general-purpose registers.
+ *
+ * Optionally, the register file has multiple banks of general-purpose
+ * registers ("shadow register files"). The ports always access the
+ * current bank; switching banks only changes which bank that is.
  */
 class RegisterFile
 {
   public:
+    using Bank = std::array<RegValue, NumRegs - 1>;
+
+    static constexpr size_t MaxBanks = 16;
+
     RegisterFile() = default;
+    RegisterFile(const RegisterFile &) = delete;
+    RegisterFile &operator=(const RegisterFile &) = delete;
+
+    /* Only before execution starts: the contents of the banks are lost. */
+    void setNumBanks(size_t n)
+    {
+      if (n < 1 || n > MaxBanks)
+        throw std::out_of_range("number of register banks must be between 1 and " +
+                                std::to_string(MaxBanks));
+      banks.assign(n, Bank{});
+      currentBank = 0;
+      registers = &banks[0];
+    }
+
+    size_t getNumBanks() const { return banks.size(); }
+    size_t getCurrentBank() const { return currentBank; }
+
+    void selectBank(size_t bank)
+    {
+      if (bank == currentBank)
+        return;
+
+      registers = &banks.at(bank);
+      currentBank = bank;
+      ++nBankSwitches;
+    }
+
+    /* Access to a register of any bank, e.g. by the handler of an
+     * exception to registers of the interrupted context.
+     */
+    RegValue readBankRegister(size_t bank, RegNumber regnum) const
+    {
+      checkRegNumber(regnum);
+      return regnum == 0 ? 0 : banks.at(bank)[regnum - 1];
+    }
+
+    void writeBankRegister(size_t bank, RegNumber regnum, RegValue value)
+    {
+      checkRegNumber(regnum);
+      if (regnum != 0)
+        banks.at(bank)[regnum - 1] = value;
+    }
+
+    uint64_t getBankSwitches() const { return nBankSwitches; }
 
     /*
      * Input signals
@@ -31,11 +84,21 @@ class RegisterFile
 
     void setRS1(const RegNumber newRS1) { RS1 = newRS1; };
     void setRS2(const RegNumber newRS2) { RS2 = newRS2; };
+    /* Third read port, used by lf.madd.s which reads rD, and the
+     * fourth read port and second write port, used for the second
+     * registers of vector register pairs.
+     */
+    void setRS3(const RegNumber newRS3) { RS3 = newRS3; };
+    void setRS4(const RegNumber newRS4) { RS4 = newRS4; };
 
     void setRD(const RegNumber newRD) { RD = newRD; };
     void setWriteData(const RegValue newData) { writeData = newData;}
     void setWriteEnable(bool newEnable) { writeEnable = newEnable;}
 
+    void setRD2(const RegNumber newRD2) { RD2 = newRD2; };
+    void setWriteData2(const RegValue newData) { writeData2 = newData;}
+    void setWriteEnable2(bool newEnable) { writeEnable2 = newEnable;}
+
     /*
      * Output signals
      */
@@ -50,6 +113,16 @@ class RegisterFile
       return readRegister(RS2);
     }
 
+    RegValue getReadData3() const
+    {
+      return readRegister(RS3);
+    }
+
+    RegValue getReadData4() const
+    {
+      return readRegister(RS4);
+    }
+
     /*
      * Clock signal
      */
@@ -58,19 +131,30 @@ class RegisterFile
     {
       if (writeEnable)
         writeRegister(RD, writeData); 
+      if (writeEnable2)
+        writeRegister(RD2, writeData2);
     }
 
 
   private:
-    std::array<RegValue, NumRegs - 1> registers{};
+    std::vector<Bank> banks = std::vector<Bank>(1);
+    Bank *registers = &banks[0];  /* the current bank */
+    size_t currentBank{};
+    uint64_t nBankSwitches{};
 
     RegNumber RS1{};
     RegNumber RS2{};
+    RegNumber RS3{};
+    RegNumber RS4{};
 
     RegNumber RD{};
     RegValue writeData{};
     bool writeEnable = false;
 
+    RegNumber RD2{};
+    RegValue writeData2{};
+    bool writeEnable2 = false;
+
     void checkRegNumber(const RegNumber regnum) const
     {
       if (regnum >= NumRegs)
@@ -87,7 +171,7 @@ class RegisterFile
 
       if (regnum == 0)
         return 0;
-      return registers[regnum - 1];
+      return (*registers)[regnum - 1];
     }
 
     void writeRegister(const RegNumber regnum,
@@ -97,7 +181,7 @@ class RegisterFile
 
       if (regnum == 0)
         return;
-      registers[regnum - 1] = value;
+      (*registers)[regnum - 1] = value;
     }
 
 
@@ -0,0 +1,61 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    reservation-monitor.cc - Load-linked/store-conditional reservations.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#include "reservation-monitor.h"
+
+
+ReservationMonitor::ReservationMonitor(unsigned int nCores)
+  : nCores{ nCores }, slots{ std::make_unique<Slot[]>(nCores) }
+{
+}
+
+void
+ReservationMonitor::reserve(unsigned int coreId, MemAddress addr)
+{
+  slots[coreId].value = ValidBit | (addr & ~MemAddress{ 3 });
+}
+
+bool
+ReservationMonitor::consume(unsigned int coreId, MemAddress addr)
+{
+  /* Always clear the reservation, whether it matched or not. */
+  const bool reserved =
+      slots[coreId].value == (ValidBit | (addr & ~MemAddress{ 3 }));
+  slots[coreId].value = 0;
+  return reserved;
+}
+
+void
+ReservationMonitor::snoopStore(unsigned int coreId, MemAddress addr,
+                               size_t size)
+{
+  cancel(coreId, addr, size);
+}
+
+void
+ReservationMonitor::snoopCommittedStore(unsigned int coreId, MemAddress addr,
+                                        size_t size)
+{
+  for (unsigned int i = 0; i < nCores; ++i)
+    if (i != coreId)
+      cancel(i, addr, size);
+}
+
+void
+ReservationMonitor::cancel(unsigned int coreId, MemAddress addr, size_t size)
+{
+  const uint64_t current = slots[coreId].value;
+  if (! (current & ValidBit))
+    return;
+
+  const MemAddress reserved = static_cast<MemAddress>(current);
+  if (reserved < (addr & ~MemAddress{ 3 }) ||
+      reserved > ((addr + size - 1) & ~MemAddress{ 3 }))
+    return;
+
+  slots[coreId].value = 0;
+}
@@ -0,0 +1,66 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    reservation-monitor.h - Load-linked/store-conditional reservations.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#ifndef __RESERVATION_MONITOR_H__
+#define __RESERVATION_MONITOR_H__
+
+#include "arch.h"
+
+#include <memory>
+
+/* The ReservationMonitor tracks the reservation of every core, as set
+ * by l.lwa and checked by l.swa. It is shared by all cores of a system.
+ *
+ * The reservation granule is a single aligned word. A store by any core
+ * that overlaps a reserved word cancels the reservation. A core's own
+ * stores do so right away; in a multi-core system, the stores of the
+ * other cores only when they are committed at the end of the time
+ * quantum. While running, a core therefore only touches its own slot,
+ * which lives in its own host cache line; the slots of the other cores
+ * are only changed at the quantum barrier, while all cores wait.
+ */
+class ReservationMonitor
+{
+  public:
+    ReservationMonitor(unsigned int nCores);
+
+    ReservationMonitor(const ReservationMonitor &) = delete;
+    ReservationMonitor &operator=(const ReservationMonitor &) = delete;
+
+    void reserve(unsigned int coreId, MemAddress addr);
+
+    /* Consumes the reservation of the core. Returns whether the core held
+     * a valid reservation for addr.
+     */
+    bool consume(unsigned int coreId, MemAddress addr);
+
+    /* Cancel the reservation of core coreId if it overlaps the store
+     * [addr, addr+size) of that core.
+     */
+    void snoopStore(unsigned int coreId, MemAddress addr, size_t size);
+
+    /* Cancel the reservations of the other cores overlapping a store of
+     * core coreId that is committed to shared memory.
+     */
+    void snoopCommittedStore(unsigned int coreId, MemAddress addr,
+                             size_t size);
+
+  private:
+    static constexpr uint64_t ValidBit = uint64_t{ 1 } << 32;
+
+    struct alignas(64) Slot
+    {
+      uint64_t value{ 0 };
+    };
+
+    const unsigned int nCores;
+    std::unique_ptr<Slot[]> slots;
+
+    void cancel(unsigned int coreId, MemAddress addr, size_t size);
+};
+
+#endif /* __RESERVATION_MONITOR_H__ */
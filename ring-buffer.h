@@ -0,0 +1,77 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    ring-buffer.h - Lock-free single-producer single-consumer queue.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#ifndef __RING_BUFFER_H__
+#define __RING_BUFFER_H__
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/* A bounded queue between exactly one producer thread and one consumer
+ * thread, without locks. The head and tail only ever increase; each is
+ * written by one side and read by the other. Each side caches the last
+ * value it read of the other's index, to touch the shared cache line
+ * only when the queue seems full or empty.
+ */
+template <typename T>
+class RingBuffer
+{
+  public:
+    /* capacity must be a power of 2 */
+    explicit RingBuffer(size_t capacity)
+      : slots(capacity), mask(capacity - 1)
+    { }
+
+    RingBuffer(const RingBuffer &) = delete;
+    RingBuffer &operator=(const RingBuffer &) = delete;
+
+    /* Producer: returns false if the queue is full. */
+    bool tryPush(const T &item)
+    {
+      const size_t h = head.load(std::memory_order_relaxed);
+      if (h - cachedTail == slots.size())
+        {
+          cachedTail = tail.load(std::memory_order_acquire);
+          if (h - cachedTail == slots.size())
+            return false;
+        }
+
+      slots[h & mask] = item;
+      head.store(h + 1, std::memory_order_release);
+      return true;
+    }
+
+    /* Consumer: moves up to max items to out and returns their number. */
+    size_t pop(T *out, size_t max)
+    {
+      const size_t t = tail.load(std::memory_order_relaxed);
+      if (cachedHead == t)
+        cachedHead = head.load(std::memory_order_acquire);
+
+      size_t n = 0;
+      for (; n < max && t + n != cachedHead; ++n)
+        out[n] = slots[(t + n) & mask];
+
+      tail.store(t + n, std::memory_order_release);
+      return n;
+    }
+
+  private:
+    std::vector<T> slots;
+    const size_t mask;
+
+    /* Written by the producer */
+    alignas(64) std::atomic<size_t> head{ 0 };
+    size_t cachedTail{ 0 };
+
+    /* Written by the consumer */
+    alignas(64) std::atomic<size_t> tail{ 0 };
+    size_t cachedHead{ 0 };
+};
+
+#endif /* __RING_BUFFER_H__ */
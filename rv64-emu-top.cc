@@ -0,0 +1,155 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    rv64-emu-top.cc - Display the live telemetry of a running emulator.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#include "telemetry.h"
+
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+
+/* Without a PID, attach to the only emulator that is running. */
+static std::string
+findSegment()
+{
+  std::string found;
+  std::error_code error;
+  for (const auto &entry : fs::directory_iterator("/dev/shm", error))
+    {
+      const std::string name = entry.path().filename();
+      if (name.rfind("rv64-emu.", 0) != 0)
+        continue;
+      if (! found.empty())
+        throw std::runtime_error("several emulators are running, specify a PID");
+      found = '/' + name;
+    }
+
+  if (found.empty())
+    throw std::runtime_error("no emulator is running");
+  return found;
+}
+
+static void
+display(const TelemetryHeader &header, const TelemetryCore *cores, bool clear)
+{
+  if (clear)
+    std::cout << "\033[H\033[2J";
+
+  std::cout << "Update interval: " << header.updateInterval << " cycles\n\n"
+            << "core        cycles  instructions          PC     CPI  host MIPS\n";
+
+  for (uint32_t i = 0; i < header.nCores; ++i)
+    {
+      const auto values = readTelemetry(cores[i]);
+      auto get = [&values](TelemetryField field)
+        {
+          return values[static_cast<size_t>(field)];
+        };
+
+      std::cout << std::setw(4) << i
+                << std::setw(14) << get(TelemetryField::cycles)
+                << std::setw(14) << get(TelemetryField::instructions)
+                << "  0x" << std::hex << std::setw(8) << std::setfill('0')
+                << get(TelemetryField::PC) << std::dec << std::setfill(' ')
+                << std::fixed << std::setprecision(2)
+                << std::setw(8) << toDouble(get(TelemetryField::intervalCPI))
+                << std::setw(11) << toDouble(get(TelemetryField::hostMIPS))
+                << (get(TelemetryField::halted) ? "  halted" : "")
+                << '\n';
+    }
+  std::cout << std::flush;
+}
+
+static void
+showHelp(const char *progName)
+{
+  std::cerr << "Usage: " << progName << " [-1] [-d SECONDS] [PID]\n\n"
+            << "    -1, displays the telemetry once instead of refreshing.\n"
+            << "    -d, sets the refresh delay (default: 1).\n";
+}
+
+int
+main(int argc, char **argv)
+{
+  bool once = false;
+  double delay = 1.0;
+
+  int c;
+  while ((c = getopt(argc, argv, "1d:h")) != -1)
+    {
+      switch (c)
+        {
+          case '1':
+            once = true;
+            break;
+
+          case 'd':
+            delay = std::atof(optarg);
+            break;
+
+          default:
+            showHelp(argv[0]);
+            return 1;
+        }
+    }
+
+  try
+    {
+      const std::string name = optind < argc
+          ? getTelemetryName(std::atol(argv[optind])) : findSegment();
+
+      const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+      struct stat st;
+      if (fd < 0 || fstat(fd, &st) != 0 ||
+          size_t(st.st_size) < sizeof(TelemetryHeader))
+        throw std::runtime_error("cannot open shared memory " + name);
+
+      void *segment = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      close(fd);
+      if (segment == MAP_FAILED)
+        throw std::runtime_error("cannot map shared memory " + name);
+
+      auto *header = static_cast<TelemetryHeader *>(segment);
+      if (header->magic != TelemetryHeader::Magic ||
+          header->version != TelemetryHeader::Version ||
+          size_t(st.st_size) < getTelemetrySize(header->nCores))
+        throw std::runtime_error(name + " is not an emulator telemetry segment");
+
+      const TelemetryCore *cores = getTelemetryCores(header);
+
+      /* The emulator removes the segment when it exits. */
+      while (true)
+        {
+          display(*header, cores, ! once);
+          if (once)
+            break;
+
+          std::this_thread::sleep_for(std::chrono::duration<double>(delay));
+          if (! fs::exists("/dev/shm" + name))
+            break;
+        }
+
+      munmap(segment, st.st_size);
+    }
+  catch (std::exception &e)
+    {
+      std::cerr << "Error: " << e.what() << std::endl;
+      return 1;
+    }
+
+  return 0;
+}
@@ -28,6 +28,7 @@ class Serial : public MemoryInterface
     void writeDoubleWord(MemAddress addr, uint64_t value) override;
 
     bool contains(MemAddress addr) const override;
+    std::string getName() const override { return "serial"; }
 
   private:
     const MemAddress base;
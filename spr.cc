@@ -0,0 +1,172 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    spr.cc - Special-purpose registers accessed with l.mfspr/l.mtspr.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#include "spr.h"
+#include "inst-decoder.h"
+
+#include <sstream>
+
+
+MemAddress
+getExceptionVector(ExceptionCause cause)
+{
+  switch (cause)
+    {
+      case ExceptionCause::tickTimer:
+        return 0x500;
+      case ExceptionCause::externalInterrupt:
+        return 0x800;
+      case ExceptionCause::systemCall:
+        return 0xc00;
+      case ExceptionCause::trap:
+        return 0xe00;
+      case ExceptionCause::floatingPoint:
+        return 0xd00;
+      case ExceptionCause::range:
+        return 0xb00;
+    }
+  return 0;
+}
+
+const char *
+getExceptionName(ExceptionCause cause)
+{
+  switch (cause)
+    {
+      case ExceptionCause::tickTimer:
+        return "tick timer";
+      case ExceptionCause::externalInterrupt:
+        return "external interrupt";
+      case ExceptionCause::systemCall:
+        return "system call";
+      case ExceptionCause::trap:
+        return "trap";
+      case ExceptionCause::floatingPoint:
+        return "floating point";
+      case ExceptionCause::range:
+        return "range";
+    }
+  return "unknown";
+}
+
+
+SpecialPurposeRegisters::SpecialPurposeRegisters(bool &flag,
+                                                 RegisterFile &regfile)
+  : flag{ flag }, regfile{ regfile }
+{
+  add(SPR::CPUCFGR,
+      [this] { return (this->regfile.getNumBanks() - 1) & CPUCFGR::NSGFMask; });
+  add(SPR::EVBAR,
+      [this] { return evbar; },
+      [this](RegValue value) { evbar = value & ~RegValue{0x1fff}; });
+  add(SPR::SR,
+      [this] { return getSR(); },
+      [this](RegValue value) { setSR(value); });
+  add(SPR::EPCR0,
+      [this] { return epcr; },
+      [this](RegValue value) { epcr = value; });
+  add(SPR::EEAR0,
+      [this] { return eear; },
+      [this](RegValue value) { eear = value; });
+  add(SPR::ESR0,
+      [this] { return esr; },
+      [this](RegValue value) { esr = value; });
+
+  /* Only the shadow GPRs of the banks that exist may be accessed. */
+  for (size_t bank = 0; bank < RegisterFile::MaxBanks; ++bank)
+    for (RegNumber reg = 0; reg < NumRegs; ++reg)
+      {
+        const uint16_t address = SPR::ShadowGPR + bank * NumRegs + reg;
+        add(address,
+            [this, address, bank, reg]
+            {
+              if (bank >= this->regfile.getNumBanks())
+                throwUnimplemented(address);
+              return this->regfile.readBankRegister(bank, reg);
+            },
+            [this, address, bank, reg](RegValue value)
+            {
+              if (bank >= this->regfile.getNumBanks())
+                throwUnimplemented(address);
+              this->regfile.writeBankRegister(bank, reg, value);
+            });
+      }
+
+  add(SPR::PMR,
+      [this] { return pmr; },
+      [this](RegValue value)
+      {
+        pmr = value & (PMR::SDFMask | PMR::DME | PMR::SME | PMR::DCGE |
+                       PMR::SUME);
+      });
+}
+
+void
+SpecialPurposeRegisters::add(uint16_t address, ReadHandler read,
+                             WriteHandler write)
+{
+  auto &group = groups[address >> 11];
+  const size_t index = address & 0x7ff;
+  if (index >= group.size())
+    group.resize(index + 1);
+
+  group[index] = Handlers{ std::move(read), std::move(write) };
+}
+
+void
+SpecialPurposeRegisters::throwUnimplemented(uint16_t address)
+{
+  std::stringstream ss;
+  ss << "Unimplemented special-purpose register " << std::hex << std::showbase
+     << address;
+  throw IllegalInstruction(ss.str());
+}
+
+void
+SpecialPurposeRegisters::setSR(RegValue value)
+{
+  const size_t bank = (value & SR::CIDMask) >> SR::CIDShift;
+  if (bank >= regfile.getNumBanks())
+    throw IllegalInstruction("SR selects register bank " + std::to_string(bank) +
+                             " which does not exist");
+
+  const bool modeChanged = ((sr ^ value) & SR::SM) != 0;
+  sr = (value & ~SR::F) | SR::FO;
+  flag = (value & SR::F) != 0;
+  regfile.selectBank(bank);
+
+  if (modeChanged && modeChangeHandler)
+    modeChangeHandler((sr & SR::SM) != 0);
+}
+
+MemAddress
+SpecialPurposeRegisters::enterException(ExceptionCause cause,
+                                        MemAddress epcr, MemAddress eear,
+                                        bool inDelaySlot)
+{
+  this->epcr = epcr;
+  this->eear = eear;
+  esr = getSR();
+
+  if (! (sr & SR::SM) && modeChangeHandler)
+    modeChangeHandler(true);
+  sr |= SR::SM;
+  sr &= ~(SR::TEE | SR::IEE | SR::DSX | SR::CIDMask);
+  regfile.selectBank(0);
+  if (inDelaySlot)
+    sr |= SR::DSX;
+
+  const MemAddress prefix = (sr & SR::EPH) ? 0xf0000000 : 0;
+  return prefix + evbar + getExceptionVector(cause);
+}
+
+MemAddress
+SpecialPurposeRegisters::returnFromException()
+{
+  setSR(esr);
+  return epcr;
+}
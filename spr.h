@@ -0,0 +1,226 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    spr.h - Special-purpose registers accessed with l.mfspr/l.mtspr.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#ifndef __SPR_H__
+#define __SPR_H__
+
+#include "arch.h"
+#include "reg-file.h"
+
+#include <array>
+#include <exception>
+#include <functional>
+#include <string>
+#include <vector>
+
+/* SPR addresses consist of a 5-bit group and an 11-bit register index. */
+namespace SPR
+{
+  constexpr uint16_t address(unsigned int group, unsigned int index)
+  {
+    return static_cast<uint16_t>((group << 11) | index);
+  }
+
+  constexpr uint16_t CPUCFGR = address(0, 2); /* CPU Configuration */
+  constexpr uint16_t EVBAR = address(0, 11);  /* Exception Vector Base */
+  constexpr uint16_t SR = address(0, 17);     /* Supervision Register */
+  constexpr uint16_t EPCR0 = address(0, 32);  /* Exception PC */
+  constexpr uint16_t EEAR0 = address(0, 48);  /* Exception Effective Address */
+  constexpr uint16_t FPCSR = address(0, 20);  /* FP Control Status */
+  constexpr uint16_t ESR0 = address(0, 64);   /* Exception SR */
+  /* GPRs of all register banks, 32 per bank */
+  constexpr uint16_t ShadowGPR = address(0, 1024);
+  constexpr uint16_t MACLO = address(5, 1);   /* MAC accumulator, low */
+  constexpr uint16_t MACHI = address(5, 2);   /* MAC accumulator, high */
+  constexpr uint16_t PCCR0 = address(7, 0);   /* Performance Counters 0-7 */
+  constexpr uint16_t PCMR0 = address(7, 8);   /* Performance Counter Modes */
+  constexpr uint16_t PMR = address(8, 0);     /* Power Management Register */
+  constexpr uint16_t PICMR = address(9, 0);   /* PIC Mask Register */
+  constexpr uint16_t PICSR = address(9, 2);   /* PIC Status Register */
+  constexpr uint16_t TTMR = address(10, 0);   /* Tick Timer Mode Register */
+  constexpr uint16_t TTCR = address(10, 1);   /* Tick Timer Count Register */
+}
+
+/* Bits of the Supervision Register */
+namespace SR
+{
+  constexpr RegValue SM = 1u << 0;       /* Supervisor Mode */
+  constexpr RegValue TEE = 1u << 1;      /* Tick Timer Exception Enable */
+  constexpr RegValue IEE = 1u << 2;      /* Interrupt Exception Enable */
+  constexpr RegValue F = 1u << 9;        /* Flag */
+  constexpr RegValue OV = 1u << 11;      /* Overflow */
+  constexpr RegValue OVE = 1u << 12;     /* Overflow Exception Enable */
+  constexpr RegValue DSX = 1u << 13;     /* Delay Slot Exception */
+  constexpr RegValue EPH = 1u << 14;     /* Exception Prefix High */
+  constexpr RegValue FO = 1u << 15;      /* Fixed One */
+  constexpr unsigned int CIDShift = 28;  /* Context ID, the register bank */
+  constexpr RegValue CIDMask = 0xfu << CIDShift;
+}
+
+/* Bits of the CPU Configuration Register */
+namespace CPUCFGR
+{
+  constexpr RegValue NSGFMask = 0xf;     /* Number of Shadow GPR Files */
+}
+
+/* Bits of the Power Management Register */
+namespace PMR
+{
+  constexpr RegValue SDFMask = 0xf;      /* Slow Down Factor */
+  constexpr RegValue DME = 1u << 4;      /* Doze Mode Enable */
+  constexpr RegValue SME = 1u << 5;      /* Sleep Mode Enable */
+  constexpr RegValue DCGE = 1u << 6;     /* Dynamic Clock Gating Enable */
+  constexpr RegValue SUME = 1u << 7;     /* Suspend Mode Enable */
+}
+
+/* The exceptions that are implemented, with their vector offsets. */
+enum class ExceptionCause
+{
+  tickTimer,
+  externalInterrupt,
+  systemCall,
+  trap,
+  floatingPoint,
+  range
+};
+
+static constexpr size_t NumExceptionCauses = 6;
+
+MemAddress getExceptionVector(ExceptionCause cause);
+const char *getExceptionName(ExceptionCause cause);
+
+/* Thrown by the pipeline when an instruction raises an exception. The
+ * processor catches it to enter the exception handler.
+ */
+class SynchronousException : public std::exception
+{
+  public:
+    SynchronousException(ExceptionCause cause, MemAddress PC,
+                         bool inDelaySlot)
+      : cause{ cause }, PC{ PC }, inDelaySlot{ inDelaySlot },
+        message{ std::string(getExceptionName(cause)) + " exception" }
+    { }
+
+    const char* what() const noexcept override
+    {
+      return message.c_str();
+    }
+
+    const ExceptionCause cause;
+    const MemAddress PC;        /* of the excepting instruction */
+    const bool inDelaySlot;
+
+  private:
+    std::string message{};
+};
+
+/* The special-purpose registers are kept in a dispatch table indexed by
+ * group and register index. The processor state registers (group 0) and
+ * power management are built in; the components that own other SPRs,
+ * such as the PIC and the tick timer, add handlers for them.
+ */
+class SpecialPurposeRegisters
+{
+  public:
+    using ReadHandler = std::function<RegValue()>;
+    using WriteHandler = std::function<void(RegValue)>;
+
+    static constexpr size_t NumGroups = 32;
+
+    /* SR[F] is the flag of the processor, SR[CID] selects the bank of
+     * the register file.
+     */
+    SpecialPurposeRegisters(bool &flag, RegisterFile &regfile);
+
+    SpecialPurposeRegisters(const SpecialPurposeRegisters &) = delete;
+    SpecialPurposeRegisters &operator=(const SpecialPurposeRegisters &) = delete;
+
+    /* Implement an SPR. Without write handler, the SPR is read-only and
+     * writes are ignored.
+     */
+    void add(uint16_t address, ReadHandler read, WriteHandler write = {});
+
+    /* Accesses to SPRs that are not implemented throw IllegalInstruction. */
+    RegValue read(uint16_t address) const
+    {
+      return lookup(address).read();
+    }
+
+    void write(uint16_t address, RegValue value)
+    {
+      const Handlers &handlers = lookup(address);
+      if (handlers.write)
+        handlers.write(value);
+    }
+
+    /* In doze and sleep mode the processor clock is stopped until an
+     * interrupt wakes up the processor.
+     */
+    bool isDozing() const { return (pmr & (PMR::DME | PMR::SME)) != 0; }
+    void wakeUp() { pmr &= ~(PMR::DME | PMR::SME); }
+
+    bool isEnabled(RegValue srBits) const { return (sr & srBits) != 0; }
+
+    /* Sets SR[OV], returns whether SR[OVE] enables the range exception. */
+    bool raiseOverflow()
+    {
+      sr |= SR::OV;
+      return isEnabled(SR::OVE);
+    }
+
+    /* Called whenever SR[SM] changes, with the new value. */
+    void setModeChangeHandler(std::function<void(bool)> handler)
+    {
+      modeChangeHandler = std::move(handler);
+    }
+
+    /* Saves the state to EPCR0, EEAR0 and ESR0 and switches to supervisor
+     * mode with interrupts disabled, using register bank 0. Returns the
+     * address of the handler.
+     */
+    MemAddress enterException(ExceptionCause cause, MemAddress epcr,
+                              MemAddress eear, bool inDelaySlot);
+
+    /* l.rfe: restores SR from ESR0 and returns the address in EPCR0. */
+    MemAddress returnFromException();
+
+  private:
+    struct Handlers
+    {
+      ReadHandler read{};
+      WriteHandler write{};
+    };
+
+    std::array<std::vector<Handlers>, NumGroups> groups{};
+
+    bool &flag;
+    RegisterFile &regfile;
+    std::function<void(bool)> modeChangeHandler{};
+
+    RegValue pmr{};
+    RegValue sr = SR::SM | SR::FO;
+    RegValue evbar{};
+    RegValue epcr{};
+    RegValue eear{};
+    RegValue esr{};
+
+    const Handlers &lookup(uint16_t address) const
+    {
+      const auto &group = groups[address >> 11];
+      const size_t index = address & 0x7ff;
+      if (index >= group.size() || ! group[index].read)
+        throwUnimplemented(address);
+      return group[index];
+    }
+
+    [[noreturn]] static void throwUnimplemented(uint16_t address);
+
+    RegValue getSR() const { return sr | (flag ? SR::F : 0); }
+    void setSR(RegValue value);
+};
+
+#endif /* __SPR_H__ */
@@ -18,6 +18,7 @@
 #include "mux.h"
 #include "reg-file.h"
 
+#include <algorithm>
 #include <iostream>
 #include <string.h>
 #include <string>
@@ -74,6 +75,7 @@ InstructionFetchStage::clockPulse()
   if_id.PC = PC;
   if_id.instruction = instruction;
   PC += 4;
+  ++events.fetches;
 }
 
 /*
@@ -132,20 +134,210 @@ InstructionDecodeStage::propagate()
     regfile.setRS2(9);
 
   }
+
+  checkHazards();
+}
+
+/* Consult the scoreboard for operands that are not available yet and
+ * check whether the required functional unit can accept an operation.
+ */
+void
+InstructionDecodeStage::checkHazards()
+{
+  stalled = false;
+  structuralStall = false;
+  stallUnit = nullptr;
+
+  if (decoder.getOpcode() == opcode::NOP)
+    return;
+
+  /* Fails for a custom instruction without an accelerator. */
+  if (signals.getCustomSlot() >= 0)
+    accelerators.get(signals.getCustomSlot());
+
+  if (! timing)
+    return;
+
+  bool readsA = false, readsB = false;
+  switch (signals.getType())
+  {
+    case InstructionType::typeR:
+    case InstructionType::typeS:
+      readsA = readsB = true;
+      break;
+    case InstructionType::typeI:
+    case InstructionType::typeF:
+    case InstructionType::typeSH:
+      readsA = true;
+      break;
+  }
+
+  if (decoder.getOpcode() == opcode::MACI)
+    readsA = true;
+
+  /* l.macrc has to wait for the accumulator. */
+  if (signals.getMACOp() == MACOp::MACRC &&
+      ! scoreboard.isReady(Scoreboard::Accumulator, cycle))
+  {
+    stalled = true;
+    stallUnit = scoreboard.getProducer(Scoreboard::Accumulator);
+    return;
+  }
+
+  /* Wait for pending reads (RAW) as well as pending writes (WAW). */
+  const RegNumber sources[] = {
+      readsA ? decoder.getA() : RegNumber{0},
+      decoder.getOpcode() == opcode::JR ? RegNumber{9} :
+        readsB ? decoder.getB() : RegNumber{0},
+      regD };
+  if (signals.getVectorOp() != VectorOp::none)
+  {
+    /* The second registers of the pairs; decode rejected pairs out of
+     * range.
+     */
+    for (RegNumber reg : { decoder.getA() + 1, decoder.getB() + 1, regD + 1 })
+    {
+      if (! scoreboard.isReady(reg, cycle))
+      {
+        stalled = true;
+        stallUnit = scoreboard.getProducer(reg);
+        return;
+      }
+    }
+  }
+
+  for (RegNumber reg : sources)
+  {
+    if (! scoreboard.isReady(reg, cycle))
+    {
+      stalled = true;
+      stallUnit = scoreboard.getProducer(reg);
+      return;
+    }
+  }
+
+  auto &unit = units[getUnitIndex(signals.getSelectorFunctionalUnit(),
+                                  signals.getCustomSlot())];
+  if (unit && ! unit->canIssue(cycle))
+  {
+    stalled = true;
+    structuralStall = true;
+    stallUnit = unit.get();
+  }
+}
+
+void
+InstructionDecodeStage::recordStall()
+{
+  ++nStalls;
+  if (structuralStall)
+    ++events.structuralStalls;
+  else
+    ++events.dependencyStalls;
+
+  if (! stallUnit)
+    return;
+
+  if (structuralStall)
+    stallUnit->addStructuralStall();
+  else
+    stallUnit->addDependencyStall();
+}
+
+/* Pass a no-operation to execute while the decoded instruction waits. The
+ * PC of 0 marks it as not being a real instruction.
+ */
+void
+InstructionDecodeStage::insertBubble()
+{
+  InstructionDecoder nop;
+  nop.setInstructionWord(0x15000000);
+  ControlSignals bubble;
+  bubble.setInstruction(nop);
+
+  id_ex.PC = 0;
+  id_ex.signals = bubble;
+  id_ex.actionMem = MemorySelector::none;
+  id_ex.actionWBOut = WriteBackOutputSelector::none;
+  id_ex.action_ALU = ALUOp::NOP;
+}
+
+void
+InstructionDecodeStage::issueOperation(const ControlSignals &signals,
+                                       instruction_t instruction,
+                                       RegValue A, RegValue B, RegNumber regD)
+{
+  const FunctionalUnitSelector selector = signals.getSelectorFunctionalUnit();
+  auto &unit = units[getUnitIndex(selector, signals.getCustomSlot())];
+  if (selector == FunctionalUnitSelector::accelerator)
+  {
+    /* The accelerator determines its own timing. */
+    const Accelerator &accelerator = accelerators.get(signals.getCustomSlot());
+    const CustomOperands operands{ instruction, A, B,
+                                   static_cast<uint16_t>(instruction & 0x7ff) };
+    const unsigned int latency = std::max(1u, accelerator.getLatency(operands));
+    const uint64_t ready =
+        unit->issue(cycle, latency,
+                    accelerator.isPipelined() ? 1 : latency);
+    if (accelerator.writesResult())
+      scoreboard.setPending(regD, ready, unit.get());
+  }
+  else if (unit)
+  {
+    const uint64_t ready = unit->issue(cycle);
+    scoreboard.setPending(selector == FunctionalUnitSelector::mac ?
+                          Scoreboard::Accumulator : regD, ready, unit.get());
+    if (selector == FunctionalUnitSelector::simd)
+      scoreboard.setPending(regD + 1, ready, unit.get());
+  }
 }
 
 void InstructionDecodeStage::clockPulse()
 {
+  if (stalled)
+  {
+    insertBubble();
+    return;
+  }
+
+  /* Exceptions are precise: the excepting instruction and everything
+   * after it has no effect. Without pipelining, nothing older than the
+   * instruction in decode is still in flight. The processor does not
+   * support exceptions in pipelined mode.
+   */
+  if (decoder.getOpcode() == opcode::SYS || decoder.getOpcode() == opcode::TRAP)
+    throw SynchronousException(decoder.getOpcode() == opcode::SYS ?
+                                 ExceptionCause::systemCall :
+                                 ExceptionCause::trap,
+                               PC, issued == 2);
+
+  issueOperation(signals, if_id.instruction,
+                 regfile.getReadData1(), regfile.getReadData2(), regD);
+
   /* ignore the "instruction" in the first cycle. */
   if (! pipelining || (pipelining && PC != 0x0))
-    ++nInstrIssued;
+    {
+      ++nInstrIssued;
+      mix.count(if_id.instruction);
+    }
 
   id_ex.PC = PC;
+  id_ex.inDelaySlot = issued == 2;
   id_ex.signals = signals;
   id_ex.regA = regfile.getReadData1();
   id_ex.regB = regfile.getReadData2();
   id_ex.regD = decoder.getD();
   id_ex.immediate = decoder.getImmediate();
+  regfile.setRS3(decoder.getD());
+  id_ex.addend = regfile.getReadData3();
+
+  if (signals.getVectorOp() != VectorOp::none)
+  {
+    regfile.setRS3(decoder.getA() + 1);
+    regfile.setRS4(decoder.getB() + 1);
+    id_ex.regALow = regfile.getReadData3();
+    id_ex.regBLow = regfile.getReadData4();
+  }
 
   switch (decoder.getOpcode()) 
   {
@@ -187,6 +379,13 @@ void InstructionDecodeStage::clockPulse()
         }
       }
       break;
+    case opcode::MACI:
+      id_ex.immediate = static_cast<int16_t>(id_ex.immediate);
+      break;
+    case opcode::MFSPR:
+    case opcode::MTSPR:
+      id_ex.immediate &= 0xffff; // K is zero-extended
+      break;
     case opcode::JAL:
       issued = 1;
       NPC = PC + signals.add(decoder); // PC value added to the offset value
@@ -200,6 +399,10 @@ void InstructionDecodeStage::clockPulse()
       issued = 1;
       NPC = PC + signals.add(decoder); // PC value added to the offset value
       break;
+    case opcode::RFE:
+      issued = 2; // no delay slot, fetch continues at EPCR right away
+      NPC = spr.returnFromException();
+      break;
     case opcode::SFEQ:
       flag = (id_ex.regA == id_ex.regB); // flag is true if register A and register B are equal
       break;
@@ -214,6 +417,10 @@ void InstructionDecodeStage::clockPulse()
       break;
   }
 
+  /* Fetch continues sequentially, a taken branch redirects it. */
+  if (issued == 1)
+    ++events.branchStalls;
+
   id_ex.PC = PC;
   id_ex.linkReg = linkReg;
   id_ex.regD = regD;
@@ -222,6 +429,9 @@ void InstructionDecodeStage::clockPulse()
   id_ex.actionALUB = signals.getSelectorALUInputB(); // get the second input of the ALU
   id_ex.actionMem = signals.getSelectorMemory(); // get if the instruction is a memory instruction
   id_ex.actionWBOut = signals.getSelectorWBOutput();
+  if (signals.getCustomSlot() >= 0 &&
+      ! accelerators.get(signals.getCustomSlot()).writesResult())
+    id_ex.actionWBOut = WriteBackOutputSelector::none;
   id_ex.action_ALU = signals.getALUOp(); // get the ALU operation
   id_ex.actionWBIn = signals.getSelectorWBInput();
   id_ex.memReadExtend = signals.getMemReadExtend();
@@ -236,6 +446,7 @@ void
 ExecuteStage::propagate()
 {
   PC = id_ex.PC;
+  inDelaySlot = id_ex.inDelaySlot;
   linkReg = id_ex.linkReg;
   signals = id_ex.signals;
   regA = id_ex.regA;
@@ -247,13 +458,17 @@ ExecuteStage::propagate()
   memReadExtend = id_ex.memReadExtend;
   readSize = id_ex.readSize;
   immediate = id_ex.immediate;
+  addend = id_ex.addend;
+  regALow = id_ex.regALow;
+  regBLow = id_ex.regBLow;
 
   if (signals.getopcode() != opcode::BF && signals.getopcode() != opcode::JR &&
       signals.getopcode() != opcode::J && signals.getopcode() != opcode::JAL &&
       signals.getopcode() != opcode::JALR && signals.getopcode() != opcode::BNF &&
       signals.getopcode() != opcode::NOP && signals.getopcode() != opcode::SFNE && 
       signals.getopcode() != opcode::SFEQ && signals.getopcode() != opcode::SFLES && 
-      signals.getopcode() != opcode::SFGES && signals.getopcode() != opcode::MACRC)
+      signals.getopcode() != opcode::SFGES && signals.getopcode() != opcode::MACRC &&
+      signals.getopcode() != opcode::RFE)
   {
     { // Set input A.
         Mux<RegValue, InputSelectorA> mux;
@@ -313,9 +528,14 @@ ExecuteStage::clockPulse()
       signals.getopcode() != opcode::J &&  signals.getopcode() != opcode::JALR && 
       signals.getopcode() != opcode::BNF && signals.getopcode() != opcode::NOP &&
       signals.getopcode() != opcode::SFNE && signals.getopcode() != opcode::SFEQ &&
-      signals.getopcode() != opcode::SFLES && signals.getopcode() != opcode::SFGES)
+      signals.getopcode() != opcode::SFLES && signals.getopcode() != opcode::SFGES &&
+      signals.getopcode() != opcode::RFE)
   {
     ex_m.ALUout = alu.getResult();
+
+    /* The division does not write back when it raises the exception. */
+    if (alu.isDivisionByZero() && spr.raiseOverflow())
+      throw SynchronousException(ExceptionCause::range, PC, inDelaySlot);
   }
 
   if (signals.getopcode() == opcode::JAL)
@@ -323,6 +543,66 @@ ExecuteStage::clockPulse()
     ex_m.ALUout = linkReg;
   } 
 
+  // the accumulator is updated at the end of execute, in program order
+  const MACOp macOp = signals.getMACOp();
+  if (macOp != MACOp::none)
+  {
+    RegValue macB = signals.getopcode() == opcode::MACI ? immediate : regB;
+    RegValue result = mac.execute(macOp, regA, macB);
+    if (macOp == MACOp::MACRC)
+      ex_m.ALUout = result;
+  }
+
+  // floating-point results and FPCSR flags, also in program order
+  switch (const FPUOp fpuOp = signals.getFPUOp())
+  {
+    case FPUOp::none:
+      break;
+    case FPUOp::SFEQ:
+    case FPUOp::SFNE:
+    case FPUOp::SFGT:
+    case FPUOp::SFGE:
+    case FPUOp::SFLT:
+    case FPUOp::SFLE:
+      flag = fpu.compare(fpuOp, regA, regB);
+      break;
+    default:
+      ex_m.ALUout = fpu.execute(fpuOp, regA, regB, addend);
+      break;
+  }
+
+  // special-purpose registers, addressed by rA | K computed by the ALU
+  if (signals.getopcode() == opcode::MFSPR)
+    ex_m.ALUout = spr.read(static_cast<uint16_t>(ex_m.ALUout));
+  else if (signals.getopcode() == opcode::MTSPR)
+    spr.write(static_cast<uint16_t>(ex_m.ALUout), regB);
+
+  // custom instructions are executed by the attached accelerator
+  if (const int slot = signals.getCustomSlot(); slot >= 0)
+  {
+    const instruction_t instructionWord = signals.getInstruction();
+    const CustomOperands operands{ instructionWord, regA, regB,
+                                   static_cast<uint16_t>(instructionWord & 0x7ff) };
+    ex_m.ALUout = accelerators.execute(slot, operands, PC);
+  }
+
+  // vector results go to the register pair rD:rD+1
+  ex_m.ALUoutLow = 0;
+  if (const VectorOp vectorOp = signals.getVectorOp(); vectorOp != VectorOp::none)
+  {
+    const uint64_t A = (static_cast<uint64_t>(regA) << 32) | regALow;
+    const uint64_t B = (static_cast<uint64_t>(regB) << 32) | regBLow;
+
+    if (VectorUnit::isCompare(vectorOp))
+      flag = vectorUnit.compare(vectorOp, A, B);
+    else
+    {
+      const uint64_t result = vectorUnit.execute(vectorOp, A, B);
+      ex_m.ALUout = static_cast<RegValue>(result >> 32);
+      ex_m.ALUoutLow = static_cast<RegValue>(result);
+    }
+  }
+
   ex_m.PC = PC;
   ex_m.actionMem = actionMem;
   ex_m.actionWBIn = actionWBIn;
@@ -350,6 +630,7 @@ MemoryStage::propagate()
   linkReg = ex_m.linkReg;
   signals = ex_m.signals;
   ALUout = ex_m.ALUout;
+  ALUoutLow = ex_m.ALUoutLow;
   regB = ex_m.regB;
   regD = ex_m.regD;
   actionMem = ex_m.actionMem;
@@ -369,7 +650,7 @@ MemoryStage::propagate()
   }
 
   if (signals.getopcode() == opcode::LWZ || signals.getopcode() == opcode::LBS
-      || signals.getopcode() == opcode::LBZ)
+      || signals.getopcode() == opcode::LBZ || signals.getopcode() == opcode::LWA)
   {
     dataMemory.setAddress(ALUout); // address is the result of the ALU
     dataMemory.setSize(ex_m.readSize); // set size with the suitable size based on instruction
@@ -383,7 +664,10 @@ MemoryStage::clockPulse()
   {
     dataMemory.setReadEnable(true); // to let the load instruction to read
     dataMemory.setDataIn(regD);
-    m_wb.memRead = dataMemory.getDataOut(memReadExtend);
+    if (signals.getopcode() == opcode::LWA)
+      m_wb.memRead = dataMemory.loadLinked(); // also places a reservation
+    else
+      m_wb.memRead = dataMemory.getDataOut(memReadExtend);
 
     /* High-order bits of the loaded value are replaced
        with bit 7 of the loaded value ( if it is 1 ) */
@@ -395,16 +679,37 @@ MemoryStage::clockPulse()
 
     dataMemory.setReadEnable(false);
   } 
+  // the cache model only affects timing, the data is always on the bus
+  if (actionMem == MemorySelector::load)
+    ++events.loads;
+  else if (actionMem == MemorySelector::store)
+    ++events.stores;
+
+  if (dataCache && actionMem != MemorySelector::none && dataMemory.isCacheable())
+  {
+    const unsigned int stall = dataCache->access(dataMemory.getAddress(),
+                                                 dataMemory.getSize(),
+                                                 actionMem == MemorySelector::store, PC);
+    stallCycles += stall;
+    events.memoryStalls += stall;
+  }
+
+  storeSucceeded = false;
   if (actionMem == MemorySelector::store) 
   {
-    dataMemory.clockPulse();
+    if (signals.getopcode() == opcode::SWA)
+      storeSucceeded = dataMemory.storeConditional(); // only if still reserved
+    else
+      dataMemory.clockPulse();
     dataMemory.setWriteEnable(false);
   }
+  m_wb.storeSucceeded = storeSucceeded;
   m_wb.PC = PC;
   m_wb.actionWBIn = actionWBIn;
   m_wb.actionWBOut = actionWBOut;
   m_wb.regD = regD;
   m_wb.ALUout = ALUout;
+  m_wb.ALUoutLow = ALUoutLow;
   m_wb.linkReg = linkReg;
   m_wb.signals = signals;
 }
@@ -423,7 +728,15 @@ WriteBackStage::propagate()
   actionWBOut = m_wb.actionWBOut;
   regfile.setRD(m_wb.regD);
 
+  writePair = signals.getVectorOp() != VectorOp::none;
+  if (writePair)
+  {
+    regfile.setRD2(m_wb.regD + 1);
+    regfile.setWriteData2(m_wb.ALUoutLow);
+  }
+
   if (signals.getopcode() == opcode::LWZ ||
+      signals.getopcode() == opcode::LWA ||
       signals.getopcode() == opcode::LBS ||
       signals.getopcode() == opcode::LBZ)
   {
@@ -448,11 +761,16 @@ WriteBackStage::propagate()
 void
 WriteBackStage::clockPulse()
 {
+  if (signals.getopcode() == opcode::SWA)
+    flag = m_wb.storeSucceeded; // flag is set if the atomic store succeeded
+
   if (actionWBOut == WriteBackOutputSelector::write) 
   { 
     regfile.setWriteEnable(true);
+    regfile.setWriteEnable2(writePair);
     regfile.clockPulse();
     regfile.setWriteEnable(false);
+    regfile.setWriteEnable2(false);
   }
 }
 #pragma GCC diagnostic pop
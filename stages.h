@@ -8,12 +8,20 @@
 #ifndef __STAGES_H__
 #define __STAGES_H__
 
+#include "accelerator.h"
 #include "alu.h"
 #include "arch.h"
+#include "cache.h"
+#include "fpu.h"
+#include "vector-unit.h"
 #include "mux.h"
+#include "perf-counters.h"
+#include "spr.h"
+#include "stats.h"
 #include "inst-decoder.h"
 #include "memory-control.h"
 #include "control-signals.h"
+#include "functional-unit.h"
 #include "utils.h"
 #include <cstddef>
 
@@ -40,6 +48,7 @@ struct ID_EXRegisters
 {
   MemAddress PC{0};
   MemAddress     NPC{0};
+  bool       inDelaySlot = false;
   RegValue   regA = 0;
   RegValue   regB = 0;
   RegValue   regD = 0;
@@ -47,6 +56,12 @@ struct ID_EXRegisters
   MemAddress linkReg{0};
   ControlSignals signals{};
 
+  /* Value of rD, the addend of lf.madd.s */
+  RegValue   addend = 0;
+  /* Values of rA+1 and rB+1, the lower halves of vector register pairs */
+  RegValue   regALow = 0;
+  RegValue   regBLow = 0;
+
   uint8_t    readSize = 8;
   WriteBackInputSelector   actionWBIn;
   WriteBackOutputSelector  actionWBOut = WriteBackOutputSelector::none;
@@ -75,6 +90,7 @@ struct EX_MRegisters
   
   MemAddress                branchPC = 0;
   RegValue                  ALUout = 0;
+  RegValue                  ALUoutLow = 0;  // rD+1 of a vector result
   uint8_t                   readSize = 8;
   WriteBackInputSelector    actionWBIn;
   WriteBackOutputSelector   actionWBOut = WriteBackOutputSelector::none;
@@ -93,12 +109,15 @@ struct M_WBRegisters
   RegValue   regD = 0;
   RegValue   memRead{};
   RegValue   ALUout = 0;
+  RegValue   ALUoutLow = 0;
   MemAddress linkReg{0};
   ControlSignals signals{};
 
   WriteBackInputSelector actionWBIn;
   WriteBackOutputSelector actionWBOut = WriteBackOutputSelector::none;
 
+  /* Outcome of l.swa, to be written to the flag */
+  bool storeSucceeded = false;
 
   /* TODO: add necessary fields */
 };
@@ -177,15 +196,20 @@ class InstructionFetchStage : public Stage
                           InstructionMemory instructionMemory,
                           MemAddress &PC, 
                           MemAddress &NPC,
-                          size_t &issued)
+                          size_t &issued,
+                          PerformanceEvents &events)
       : Stage(pipelining),
       if_id(if_id),
       instructionMemory(instructionMemory),
       PC(PC),
       NPC(NPC),
-      issued(issued)
+      issued(issued),
+      events(events)
     { }
 
+    InstructionFetchStage(const InstructionFetchStage &) = delete;
+    InstructionFetchStage &operator=(const InstructionFetchStage &) = delete;
+
     void propagate() override;
     void clockPulse() override;
 
@@ -196,6 +220,7 @@ class InstructionFetchStage : public Stage
     MemAddress &PC;
     MemAddress &NPC;
     size_t &issued;
+    PerformanceEvents &events;
     MemAddress linkReg{0};
     instruction_t instruction{0};
 };
@@ -217,17 +242,47 @@ class InstructionDecodeStage : public Stage
                            bool &flag,
                            MemAddress &NPC,
                            size_t &issued,
+                           Scoreboard &scoreboard,
+                           FunctionalUnits &units,
+                           const uint64_t &cycle,
+                           const AcceleratorSlots &accelerators,
+                           SpecialPurposeRegisters &spr,
+                           PerformanceEvents &events,
+                           InstructionMix &mix,
                            bool debugMode = false)
       : Stage(pipelining),
       if_id(if_id), id_ex(id_ex),
       regfile(regfile), decoder(decoder),
       nInstrIssued(nInstrIssued), nStalls(nStalls),
-      flag(flag), NPC(NPC), issued(issued), debugMode(debugMode)
+      flag(flag), NPC(NPC), issued(issued),
+      scoreboard(scoreboard), units(units), cycle(cycle),
+      accelerators(accelerators), spr(spr), events(events), mix(mix),
+      debugMode(debugMode)
     { }
 
+    InstructionDecodeStage(const InstructionDecodeStage &) = delete;
+    InstructionDecodeStage &operator=(const InstructionDecodeStage &) = delete;
+
     void propagate() override;
     void clockPulse() override;
 
+    /* Whether the decoded instruction has to wait for an operand that is
+     * still being computed or for a busy functional unit.
+     */
+    bool isStalled() const { return stalled; }
+    bool isStructuralStall() const { return structuralStall; }
+    void recordStall();
+
+    /* Without the timing model, instructions never stall. */
+    void setTiming(bool enable) { timing = enable; }
+
+    /* Issue the operation of an instruction with operands A and B to its
+     * multi-cycle functional unit, if any, and mark its results pending.
+     */
+    void issueOperation(const ControlSignals &signals,
+                        instruction_t instruction,
+                        RegValue A, RegValue B, RegNumber regD);
+
   private:
     const IF_IDRegisters &if_id;
     ID_EXRegisters &id_ex;
@@ -242,11 +297,25 @@ class InstructionDecodeStage : public Stage
     MemAddress &NPC;
     size_t &issued;
 
+    Scoreboard &scoreboard;
+    FunctionalUnits &units;
+    const uint64_t &cycle;
+    const AcceleratorSlots &accelerators;
+    SpecialPurposeRegisters &spr;
+    PerformanceEvents &events;
+    InstructionMix &mix;
+    bool timing = true;
+    bool stalled = false;
+    bool structuralStall = false;
+    FunctionalUnit *stallUnit{}; /* no ownership */
 
     bool debugMode = false;
 
     MemAddress PC{0};
     RegNumber regD{0};
+
+    void checkHazards();
+    void insertBubble();
 };
 
 /*
@@ -258,23 +327,41 @@ class ExecuteStage : public Stage
   public:
     ExecuteStage(bool pipelining,
                  const ID_EXRegisters &id_ex,
-                 EX_MRegisters &ex_m)
+                 EX_MRegisters &ex_m,
+                 bool &flag,
+                 MultiplyAccumulator &mac,
+                 FloatingPointUnit &fpu,
+                 AcceleratorSlots &accelerators,
+                 SpecialPurposeRegisters &spr)
       : Stage(pipelining),
-      id_ex(id_ex), ex_m(ex_m)
+      id_ex(id_ex), ex_m(ex_m), flag(flag), mac(mac), fpu(fpu),
+      accelerators(accelerators), spr(spr)
     { }
 
+    ExecuteStage(const ExecuteStage &) = delete;
+    ExecuteStage &operator=(const ExecuteStage &) = delete;
+
     void propagate() override;
     void clockPulse() override;
 
   private:
     const ID_EXRegisters &id_ex;
     EX_MRegisters &ex_m;
+    bool &flag;
+    MultiplyAccumulator &mac;
+    FloatingPointUnit &fpu;
+    AcceleratorSlots &accelerators;
+    SpecialPurposeRegisters &spr;
     RegValue   regA = 0;
+    RegValue   addend = 0;
+    RegValue   regALow = 0;
+    RegValue   regBLow = 0;
     RegValue   regB = 0;
     RegValue   regD = 0;
     int32_t    immediate = 0;
 
     ALU alu{};
+    VectorUnit vectorUnit{};
     bool memReadExtend = false;
 
     uint8_t readSize = 8;
@@ -284,6 +371,7 @@ class ExecuteStage : public Stage
     
 
     MemAddress PC{0};
+    bool inDelaySlot = false;
     MemAddress linkReg{0};
     ControlSignals signals{};
     /* TODO: add other necessary fields/buffers and components (ALU anyone?) */
@@ -299,19 +387,30 @@ class MemoryStage : public Stage
     MemoryStage(bool pipelining,
                 const EX_MRegisters &ex_m,
                 M_WBRegisters &m_wb,
-                DataMemory dataMemory)
+                DataMemory &dataMemory,
+                uint64_t &stallCycles,
+                PerformanceEvents &events)
       : Stage(pipelining),
-      ex_m(ex_m), m_wb(m_wb), dataMemory(dataMemory)
+      ex_m(ex_m), m_wb(m_wb), dataMemory(dataMemory),
+      stallCycles(stallCycles), events(events)
     { }
 
+    MemoryStage(const MemoryStage &) = delete;
+    MemoryStage &operator=(const MemoryStage &) = delete;
+
     void propagate() override;
     void clockPulse() override;
 
+    void setDataCache(L1DataCache *cache) { dataCache = cache; }
+
   private:
     const EX_MRegisters &ex_m;
     M_WBRegisters &m_wb;
 
-    DataMemory dataMemory;
+    DataMemory &dataMemory;
+    L1DataCache *dataCache{}; /* no ownership */
+    uint64_t &stallCycles;
+    PerformanceEvents &events;
 
     RegValue   regB = 0;
     RegValue   regD = 0;
@@ -326,7 +425,9 @@ class MemoryStage : public Stage
     WriteBackOutputSelector actionWBOut = WriteBackOutputSelector::none;
     MemorySelector actionMem = MemorySelector::none;
     RegValue ALUout = 0;
+    RegValue ALUoutLow = 0;
     bool memReadExtend = false;
+    bool storeSucceeded = false;
     Mux<MemAddress, PCSelector> muxPC{};
 };
 
@@ -360,6 +461,7 @@ class WriteBackStage : public Stage
 
     /* TODO add other necessary fields/buffers and components */
     WriteBackOutputSelector actionWBOut = WriteBackOutputSelector::none;
+    bool writePair = false;
 
 
     uint64_t &nInstrCompleted;
@@ -0,0 +1,266 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    stats.cc - Statistics registry and output.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#include "stats.h"
+#include "inst-decoder.h"
+
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+
+InstructionMix::InstructionMix()
+  : counts(NumKeys), samples(NumKeys)
+{
+}
+
+std::vector<std::pair<std::string, uint64_t>>
+InstructionMix::get() const
+{
+  std::map<std::string, uint64_t> mix;
+  for (size_t key = 0; key < NumKeys; ++key)
+    {
+      if (counts[key] == 0)
+        continue;
+
+      std::ostringstream s;
+      try
+        {
+          InstructionDecoder decoder;
+          decoder.setInstructionWord(samples[key]);
+          s << decoder;
+        }
+      catch (IllegalInstruction &)
+        {
+          s.str("illegal");
+        }
+
+      const std::string text = s.str();
+      mix[text.substr(0, text.find_first_of(" \t"))] += counts[key];
+    }
+
+  return { mix.begin(), mix.end() };
+}
+
+
+void
+StatsRegistry::addCounter(const std::string &name, const uint64_t &counter,
+                          const std::string &description)
+{
+  addCounter(name, [&counter] { return counter; }, description);
+}
+
+void
+StatsRegistry::addCounter(const std::string &name,
+                          std::function<uint64_t()> counter,
+                          const std::string &description)
+{
+  entries.push_back({ name, description, std::move(counter), {}, nullptr, {} });
+}
+
+void
+StatsRegistry::addFormula(const std::string &name,
+                          std::function<double()> formula,
+                          const std::string &description)
+{
+  entries.push_back({ name, description, {}, std::move(formula), nullptr, {} });
+}
+
+void
+StatsRegistry::addHistogram(const std::string &name, const Histogram &histogram,
+                            const std::string &description)
+{
+  entries.push_back({ name, description, {}, {}, &histogram, {} });
+}
+
+void
+StatsRegistry::addGroup(const std::string &name,
+                        std::function<std::vector<std::pair<std::string, uint64_t>>()> group,
+                        const std::string &description)
+{
+  entries.push_back({ name, description, {}, {}, nullptr, std::move(group) });
+}
+
+std::vector<StatsRegistry::Value>
+StatsRegistry::collect() const
+{
+  std::vector<Value> values;
+  for (const Entry &entry : entries)
+    {
+      if (entry.counter)
+        values.push_back({ entry.name, true, entry.counter(), 0.0 });
+      else if (entry.formula)
+        values.push_back({ entry.name, false, 0, entry.formula() });
+      else if (entry.histogram)
+        {
+          const Histogram &histogram = *entry.histogram;
+          values.push_back({ entry.name + ".count", true, histogram.getCount(), 0.0 });
+          values.push_back({ entry.name + ".sum", true, histogram.getSum(), 0.0 });
+
+          const auto &buckets = histogram.getBuckets();
+          size_t last = buckets.size();
+          while (last > 0 && buckets[last - 1] == 0)
+            --last;
+          for (size_t i = 0; i < last; ++i)
+            values.push_back({ entry.name + ".lt" +
+                               (i < 64 ? std::to_string(uint64_t{1} << i) : "inf"),
+                               true, buckets[i], 0.0 });
+        }
+      else
+        for (auto &[key, count] : entry.group())
+          values.push_back({ entry.name + '.' + key, true, count, 0.0 });
+    }
+
+  return values;
+}
+
+std::vector<std::pair<std::string, std::string>>
+StatsRegistry::getDescriptions() const
+{
+  std::vector<std::pair<std::string, std::string>> descriptions;
+  for (const Entry &entry : entries)
+    descriptions.emplace_back(entry.name, entry.description);
+  return descriptions;
+}
+
+
+/*
+ * Output
+ */
+
+static std::string
+quote(const std::string &s)
+{
+  std::string quoted{ '"' };
+  for (char c : s)
+    {
+      if (c == '"' || c == '\\')
+        quoted += '\\';
+      quoted += c;
+    }
+  return quoted + '"';
+}
+
+/* Formulas may be undefined, e.g. the CPI before the first instruction
+ * completes; they are written as missing.
+ */
+static void
+writeValue(std::ostream &os, const StatsRegistry::Value &value,
+           const char *missing)
+{
+  if (value.isInteger)
+    os << value.count;
+  else if (std::isfinite(value.value))
+    os << std::setprecision(6) << value.value;
+  else
+    os << missing;
+}
+
+StatsOutput::StatsOutput(const StatsRegistry &registry,
+                         const std::string &jsonFilename,
+                         const std::string &csvFilename)
+  : registry(registry), jsonFilename(jsonFilename), csvFilename(csvFilename)
+{
+  if (! jsonFilename.empty())
+    {
+      json.open(jsonFilename);
+      if (! json)
+        throw std::runtime_error("cannot create statistics file " + jsonFilename);
+
+      json << "{\n  \"descriptions\": {";
+      const char *separator = "\n";
+      for (const auto &[name, description] : registry.getDescriptions())
+        {
+          json << separator << "    " << quote(name) << ": " << quote(description);
+          separator = ",\n";
+        }
+      json << "\n  },\n  \"snapshots\": [";
+    }
+
+  if (! csvFilename.empty())
+    {
+      csv.open(csvFilename);
+      if (! csv)
+        throw std::runtime_error("cannot create statistics file " + csvFilename);
+
+      csv << "snapshot,cycle,name,value\n";
+    }
+}
+
+StatsOutput::~StatsOutput()
+{
+  if (finished)
+    return;
+
+  try
+    {
+      finish(lastCycle);
+    }
+  catch (std::exception &e)
+    {
+      std::cerr << "Warning: " << e.what() << std::endl;
+    }
+}
+
+void
+StatsOutput::snapshot(uint64_t cycle)
+{
+  if (nSnapshots > 0 && cycle == lastCycle)
+    return;
+
+  const auto values = registry.collect();
+
+  if (json.is_open())
+    {
+      json << (nSnapshots > 0 ? "," : "") << "\n    { \"cycle\": " << cycle
+           << ", \"stats\": {";
+      const char *separator = "\n";
+      for (const auto &value : values)
+        {
+          json << separator << "      " << quote(value.name) << ": ";
+          writeValue(json, value, "null");
+          separator = ",\n";
+        }
+      json << "\n    } }";
+    }
+
+  if (csv.is_open())
+    for (const auto &value : values)
+      {
+        csv << nSnapshots << ',' << cycle << ',' << value.name << ',';
+        writeValue(csv, value, "");
+        csv << '\n';
+      }
+
+  ++nSnapshots;
+  lastCycle = cycle;
+}
+
+void
+StatsOutput::finish(uint64_t cycle)
+{
+  snapshot(cycle);
+  finished = true;
+
+  if (json.is_open())
+    {
+      json << "\n  ]\n}\n";
+      json.close();
+      if (! json)
+        throw std::runtime_error("cannot write statistics file " + jsonFilename);
+    }
+
+  if (csv.is_open())
+    {
+      csv.close();
+      if (! csv)
+        throw std::runtime_error("cannot write statistics file " + csvFilename);
+    }
+}
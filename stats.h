@@ -0,0 +1,214 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    stats.h - Statistics registry and output.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include "arch.h"
+
+#include <array>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/* Number of bits needed to represent value, 0 for 0. */
+inline size_t
+getBitWidth(uint64_t value)
+{
+  if (value == 0)
+    return 0;
+
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanReverse64(&index, value);
+  return index + 1;
+#else
+  return 64 - __builtin_clzll(value);
+#endif
+}
+
+/* Distribution of a quantity over power-of-two buckets: bucket 0 counts
+ * the value 0 and bucket i the values from 2^(i-1) up to 2^i.
+ */
+class Histogram
+{
+  public:
+    static constexpr size_t NumBuckets = 65;
+
+    void sample(uint64_t value)
+    {
+      ++buckets[getBitWidth(value)];
+      ++count;
+      sum += value;
+    }
+
+    uint64_t getCount() const { return count; }
+    uint64_t getSum() const { return sum; }
+    const std::array<uint64_t, NumBuckets> &getBuckets() const { return buckets; }
+
+  private:
+    std::array<uint64_t, NumBuckets> buckets{};
+    uint64_t count{};
+    uint64_t sum{};
+};
+
+/* Number of instructions issued per mnemonic. The hot path only indexes
+ * a table by the opcode bits of the instruction word; mnemonics are
+ * found by disassembling a sample word of every entry when the mix is
+ * read.
+ */
+class InstructionMix
+{
+  public:
+    InstructionMix();
+
+    void count(uint32_t instruction)
+    {
+      const uint32_t key = getKey(instruction);
+      ++counts[key];
+      samples[key] = instruction;
+    }
+
+    std::vector<std::pair<std::string, uint64_t>> get() const;
+
+  private:
+    /* Primary opcode in the upper bits, the bits that select between
+     * the instructions sharing it in the lower eight.
+     */
+    static constexpr size_t NumKeys = 64 << 8;
+
+    std::vector<uint64_t> counts;
+    std::vector<uint32_t> samples;
+
+    static uint32_t getKey(uint32_t instruction)
+    {
+      const uint32_t primary = instruction >> 26;
+      switch (primary)
+        {
+          case 0x06:    /* l.movhi, l.macrc */
+            return primary << 8 | ((instruction >> 16) & 0x1);
+          case 0x08:    /* l.sys, l.trap, l.msync, l.psync, l.csync */
+          case 0x2f:    /* l.sf*i */
+          case 0x39:    /* l.sf* */
+            return primary << 8 | ((instruction >> 21) & 0x1f);
+          case 0x0a:    /* vector */
+          case 0x32:    /* floating point */
+            return primary << 8 | (instruction & 0xff);
+          case 0x2e:    /* shifts by immediate */
+            return primary << 8 | ((instruction >> 6) & 0x3);
+          case 0x31:    /* l.mac, l.msb */
+            return primary << 8 | (instruction & 0xf);
+          case 0x38:    /* register-register ALU */
+            return primary << 8 | (instruction & 0xf) | ((instruction >> 2) & 0xf0);
+          default:
+            return primary << 8;
+        }
+    }
+};
+
+/* Central registry of the statistics of the simulator. Components
+ * register their counters once, by reference or through a function
+ * that computes them, so that counting stays a plain increment and
+ * values are only collected when a snapshot is taken. Names are
+ * dot-separated paths, e.g. "core0.bus.memory0.bytesRead".
+ */
+class StatsRegistry
+{
+  public:
+    struct Value
+    {
+      std::string name;
+      bool isInteger;
+      uint64_t count;
+      double value;
+    };
+
+    StatsRegistry() = default;
+    StatsRegistry(const StatsRegistry &) = delete;
+    StatsRegistry &operator=(const StatsRegistry &) = delete;
+
+    void addCounter(const std::string &name, const uint64_t &counter,
+                    const std::string &description);
+    void addCounter(const std::string &name, std::function<uint64_t()> counter,
+                    const std::string &description);
+
+    /* Derived quantities, like CPI. */
+    void addFormula(const std::string &name, std::function<double()> formula,
+                    const std::string &description);
+
+    /* Written as name.count, name.sum and name.ltN for the buckets up to
+     * the last non-empty one.
+     */
+    void addHistogram(const std::string &name, const Histogram &histogram,
+                      const std::string &description);
+
+    /* Counters whose names are only known while running, written as
+     * name.key.
+     */
+    void addGroup(const std::string &name,
+                  std::function<std::vector<std::pair<std::string, uint64_t>>()> group,
+                  const std::string &description);
+
+    std::vector<Value> collect() const;
+
+    /* Descriptions by registered name. */
+    std::vector<std::pair<std::string, std::string>> getDescriptions() const;
+
+  private:
+    struct Entry
+    {
+      std::string name;
+      std::string description;
+      std::function<uint64_t()> counter;
+      std::function<double()> formula;
+      const Histogram *histogram;
+      std::function<std::vector<std::pair<std::string, uint64_t>>()> group;
+    };
+
+    std::vector<Entry> entries{};
+};
+
+/* Writes snapshots of all statistics, taken at intervals and at the end
+ * of the simulation, as JSON and/or as CSV with a row per statistic per
+ * snapshot. Throws std::runtime_error when a file cannot be written.
+ */
+class StatsOutput
+{
+  public:
+    StatsOutput(const StatsRegistry &registry,
+                const std::string &jsonFilename,
+                const std::string &csvFilename);
+    ~StatsOutput();
+
+    StatsOutput(const StatsOutput &) = delete;
+    StatsOutput &operator=(const StatsOutput &) = delete;
+
+    /* A snapshot at a cycle that was already written is skipped. */
+    void snapshot(uint64_t cycle);
+
+    /* Write the final snapshot and complete the files. */
+    void finish(uint64_t cycle);
+
+  private:
+    const StatsRegistry &registry;
+
+    std::ofstream json{};
+    std::ofstream csv{};
+    std::string jsonFilename;
+    std::string csvFilename;
+
+    size_t nSnapshots{};
+    uint64_t lastCycle{};
+    bool finished{};
+};
+
+#endif /* __STATS_H__ */
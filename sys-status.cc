@@ -9,8 +9,10 @@
 
 #include <iostream>
 
-SysStatus::SysStatus(const MemAddress base)
-  : base{ base }
+SysStatus::SysStatus(const MemAddress base,
+                     const unsigned int coreId,
+                     const unsigned int nCores)
+  : base{ base }, coreId{ coreId }, nCores{ nCores }
 {
 }
 
@@ -33,7 +35,12 @@ SysStatus::readHalfWord(MemAddress addr)
 uint32_t
 SysStatus::readWord(MemAddress addr)
 {
-  throw IllegalAccess("Not supported on sysstatus interface");
+  if (addr == base + 0x0)
+    return coreId;
+  else if (addr == base + 0x4)
+    return nCores;
+
+  throw IllegalAccess("Invalid system status address");
 }
 
 uint64_t
@@ -62,7 +69,13 @@ SysStatus::writeHalfWord(MemAddress addr, uint16_t value)
 void
 SysStatus::writeWord(MemAddress addr, uint32_t value)
 {
-  if (addr != base + 0x8)
+  if (addr == base + 0xc || addr == base + 0x10)
+    {
+      if (regionHandler)
+        regionHandler(addr == base + 0xc, value);
+      return;
+    }
+  else if (addr != base + 0x8)
     throw IllegalAccess("Invalid system status address");
 
   std::cerr << "System halt requested." << std::endl;
@@ -78,5 +91,5 @@ SysStatus::writeDoubleWord(MemAddress addr, uint64_t value)
 bool
 SysStatus::contains(MemAddress addr) const
 {
-  return base <= addr && addr < base + 0x10;
+  return base <= addr && addr < base + 0x14;
 }
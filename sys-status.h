@@ -5,10 +5,18 @@
  * Copyright (C) 2016  Leiden University, The Netherlands.
  */
 
-/* The system status module currently only supports halting the
- * system. Other functionalities could be implemented here at different
- * memory addresses. (For instance, reading the instruction counter,
- * number of clock cycles since start up, etc.).
+/* The system status module supports halting the system and reading
+ * the identity of the core that performs the access. Register map
+ * (relative to base):
+ *
+ *   0x0  (read)   core ID of the accessing core
+ *   0x4  (read)   number of cores in the system
+ *   0x8  (write)  halt the accessing core
+ *   0xc  (write)  begin of the region of interest with the written ID
+ *   0x10 (write)  end of the region of interest with the written ID
+ *
+ * In a multi-core system every core has its own instance of this module,
+ * so that the core ID register can simply return a constant.
  */
 
 #ifndef __SYS_STATUS_H__
@@ -16,14 +24,27 @@
 
 #include "memory-interface.h"
 
+#include <functional>
+
 class SysStatus : public MemoryInterface
 {
   public:
-    SysStatus(const MemAddress base);
+    SysStatus(const MemAddress base,
+              const unsigned int coreId = 0,
+              const unsigned int nCores = 1);
     ~SysStatus() override = default;
 
     bool shouldHalt() const { return shouldHaltFlag; }
 
+    /* Called on writes to the region of interest markers, with whether
+     * the region begins and its ID.
+     */
+    using RegionHandler = std::function<void(bool, uint32_t)>;
+    void setRegionHandler(RegionHandler handler)
+    {
+      regionHandler = std::move(handler);
+    }
+
     /* MemoryInterface */
     uint8_t readByte(MemAddress addr) override;
     uint16_t readHalfWord(MemAddress addr) override;
@@ -36,11 +57,15 @@ class SysStatus : public MemoryInterface
     void writeDoubleWord(MemAddress addr, uint64_t value) override;
 
     bool contains(MemAddress addr) const override;
+    std::string getName() const override { return "sys-status"; }
 
   private:
     const MemAddress base;
+    const unsigned int coreId;
+    const unsigned int nCores;
 
     bool shouldHaltFlag = false;
+    RegionHandler regionHandler{};
 };
 
 #endif /* __SYS_STATUS_H__ */
@@ -0,0 +1,90 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    telemetry.cc - Live telemetry through shared memory.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#include "telemetry.h"
+
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+TelemetryPublisher::TelemetryPublisher(unsigned int nCores,
+                                       uint64_t updateInterval)
+  : name(getTelemetryName(getpid())), size(getTelemetrySize(nCores)),
+    previous(nCores)
+{
+  const int fd = shm_open(name.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+  if (fd < 0)
+    throw std::runtime_error("cannot create shared memory " + name);
+
+  void *segment = MAP_FAILED;
+  if (ftruncate(fd, size) == 0)
+    segment = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (segment == MAP_FAILED)
+    {
+      shm_unlink(name.c_str());
+      throw std::runtime_error("cannot map shared memory " + name);
+    }
+
+  /* The new segment is zero-filled, which is a valid initial state for
+   * the counters. The magic is written last.
+   */
+  header = static_cast<TelemetryHeader *>(segment);
+  cores = getTelemetryCores(header);
+  header->version = TelemetryHeader::Version;
+  header->nCores = nCores;
+  header->updateInterval = updateInterval;
+  std::atomic_thread_fence(std::memory_order_release);
+  header->magic = TelemetryHeader::Magic;
+
+  const auto now = std::chrono::steady_clock::now();
+  for (auto &p : previous)
+    p.time = now;
+}
+
+TelemetryPublisher::~TelemetryPublisher()
+{
+  munmap(header, size);
+  shm_unlink(name.c_str());
+}
+
+void
+TelemetryPublisher::update(unsigned int core, uint64_t cycles,
+                           uint64_t instructions, MemAddress PC, bool halted)
+{
+  const auto now = std::chrono::steady_clock::now();
+  Previous &p = previous[core];
+  const double seconds = std::chrono::duration<double>(now - p.time).count();
+  const double intervalCPI = instructions != p.instructions
+      ? double(cycles - p.cycles) / (instructions - p.instructions) : 0.0;
+  const double hostMIPS = seconds > 0.0
+      ? (instructions - p.instructions) / seconds / 1e6 : 0.0;
+  p = { cycles, instructions, now };
+
+  auto set = [&fields = cores[core].fields](TelemetryField field, uint64_t value)
+    {
+      fields[static_cast<size_t>(field)].store(value, std::memory_order_relaxed);
+    };
+
+  TelemetryCore &c = cores[core];
+  const uint64_t sequence = c.sequence.load(std::memory_order_relaxed);
+  c.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  set(TelemetryField::cycles, cycles);
+  set(TelemetryField::instructions, instructions);
+  set(TelemetryField::PC, PC);
+  set(TelemetryField::halted, halted);
+  set(TelemetryField::intervalCPI, fromDouble(intervalCPI));
+  set(TelemetryField::hostMIPS, fromDouble(hostMIPS));
+
+  c.sequence.store(sequence + 2, std::memory_order_release);
+}
@@ -0,0 +1,151 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    telemetry.h - Live telemetry through shared memory.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#ifndef __TELEMETRY_H__
+#define __TELEMETRY_H__
+
+#include "arch.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/* Values published per core. */
+enum class TelemetryField
+{
+  cycles,
+  instructions,
+  PC,
+  halted,
+  intervalCPI,      /* double */
+  hostMIPS,         /* double */
+  LAST
+};
+
+constexpr size_t NumTelemetryFields = static_cast<size_t>(TelemetryField::LAST);
+
+/* Layout of the POSIX shared-memory segment "/rv64-emu.PID" in which a
+ * running emulator publishes its progress, read by rv64-emu-top. The
+ * values of a core are updated together under a sequence lock: the
+ * writer makes the sequence number odd before and even again after an
+ * update, and a reader retries when it finds the number odd or changed
+ * after reading. Doubles are stored by their bit pattern.
+ */
+struct TelemetryCore
+{
+  std::atomic<uint64_t> sequence;
+  std::array<std::atomic<uint64_t>, NumTelemetryFields> fields;
+};
+
+struct TelemetryHeader
+{
+  static constexpr std::array<char, 8> Magic{ 'R', 'V', 'T', 'E', 'L', 'E', 'M', '\0' };
+  static constexpr uint32_t Version = 1;
+
+  std::array<char, 8> magic;
+  uint32_t version;
+  uint32_t nCores;
+  uint64_t updateInterval;      /* cycles */
+  /* followed by nCores TelemetryCore */
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "telemetry is shared between processes");
+
+inline size_t
+getTelemetrySize(uint32_t nCores)
+{
+  return sizeof(TelemetryHeader) + nCores * sizeof(TelemetryCore);
+}
+
+inline TelemetryCore *
+getTelemetryCores(TelemetryHeader *header)
+{
+  return reinterpret_cast<TelemetryCore *>(header + 1);
+}
+
+inline std::string
+getTelemetryName(long pid)
+{
+  return "/rv64-emu." + std::to_string(pid);
+}
+
+inline uint64_t
+fromDouble(double value)
+{
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+inline double
+toDouble(uint64_t bits)
+{
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+/* Consistent copy of the values of a core. */
+inline std::array<uint64_t, NumTelemetryFields>
+readTelemetry(const TelemetryCore &core)
+{
+  std::array<uint64_t, NumTelemetryFields> values;
+  uint64_t before, after;
+  do
+    {
+      before = core.sequence.load(std::memory_order_acquire);
+      for (size_t i = 0; i < NumTelemetryFields; ++i)
+        values[i] = core.fields[i].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = core.sequence.load(std::memory_order_relaxed);
+    }
+  while ((before & 1) || before != after);
+
+  return values;
+}
+
+/* Creates the segment of this process and updates it. The simulation
+ * only calls update once per update interval, so publishing costs
+ * nothing in between. Throws std::runtime_error if the segment cannot
+ * be created.
+ */
+class TelemetryPublisher
+{
+  public:
+    TelemetryPublisher(unsigned int nCores, uint64_t updateInterval);
+    ~TelemetryPublisher();
+
+    TelemetryPublisher(const TelemetryPublisher &) = delete;
+    TelemetryPublisher &operator=(const TelemetryPublisher &) = delete;
+
+    const std::string &getName() const { return name; }
+
+    void update(unsigned int core, uint64_t cycles, uint64_t instructions,
+                MemAddress PC, bool halted);
+
+  private:
+    std::string name;
+    size_t size{};
+    TelemetryHeader *header{};
+    TelemetryCore *cores{};
+
+    /* Values at the previous update, for the rates */
+    struct Previous
+    {
+      uint64_t cycles{};
+      uint64_t instructions{};
+      std::chrono::steady_clock::time_point time{};
+    };
+
+    std::vector<Previous> previous;
+};
+
+#endif /* __TELEMETRY_H__ */
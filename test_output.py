@@ -27,15 +27,14 @@ def posix_nt(posix, nt):
 
 
 def parse_test(testfile):
+    '''The first line holds the command to run, or several joined by
+    " && ", the rest the output they should give together.'''
     with testfile.open() as fh:
-        args = fh.readline().rstrip("\n")
-        # print ("args1: ", args)
-        args = args.split(" ")
-        # print ("args2: ", args)
+        commands = fh.readline().rstrip("\n").split(" && ")
+        commands = [command.split(" ") for command in commands]
         output = fh.read()
-        # print ("args3: ", output)
 
-    return args, output
+    return commands, output
 
 def normalize_output(buf):
     '''Ensures UNIX line endings and removes trailing whitespace from the
@@ -70,6 +69,13 @@ if not RV64_EMU.exists():
     exit(1)
 RV64_EMU = RV64_EMU.resolve()
 
+# The programs a command may start with; other commands are arguments of
+# the emulator.
+PROGRAMS = {
+    "./rv64-emu": RV64_EMU,
+    "./rv64-emu-gen": Path(posix_nt("rv64-emu-gen", "Windows\\rv64-emu-gen.exe")).resolve()
+}
+
 
 # Parse arguments
 parser = ArgumentParser()
@@ -115,28 +121,36 @@ print()
 # Run the tests
 for test in all_tests:
     try:
-        testargs, output = parse_test(test)
+        commands, output = parse_test(test)
     except Exception as e:
         raise e
         # FIXME
 
-    try:
-        result = subprocess.run([str(RV64_EMU), *testargs],
-                                stdout=subprocess.PIPE,
-                                stderr=subprocess.PIPE, timeout=5)
-    except subprocess.TimeoutExpired:
-        result = None
+    tmp = ""
+    for command in commands:
+        if command[0] in PROGRAMS:
+            command = [str(PROGRAMS[command[0]]), *command[1:]]
+        else:
+            command = [str(RV64_EMU), *command]
+
+        try:
+            result = subprocess.run(command, stdout=subprocess.PIPE,
+                                    stderr=subprocess.PIPE, timeout=5)
+        except subprocess.TimeoutExpired:
+            result = None
+
+        # We continue if the exit code is 4 (invalid argument), to
+        # be able to test failures.
+        success = result and (result.returncode in [0, 4])
+        if not success:
+            break
 
-    # We continue if the exit code is 4 (invalid argument), to
-    # be able to test failures.
-    success = result and (result.returncode in [0, 4])
+        tmp += normalize_output(result.stdout.decode())
+        tmp += normalize_output(result.stderr.decode())
 
     fail_detail = ""
 
     if success:
-        tmp = normalize_output(result.stdout.decode())
-        tmp += normalize_output(result.stderr.decode())
-
         if output != tmp:
             success = False
 
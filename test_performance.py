@@ -0,0 +1,257 @@
+#!/usr/bin/env python3
+
+# test_performance.py
+#
+# Run all unit tests in the tests/ directory in both pipelined and
+# non-pipelined mode and compare their performance against a baseline.
+# The simulated cycles, instructions, CPI, stalls and bus traffic are
+# deterministic and must match the baseline exactly.
+#
+# With -H, the host MIPS of a workload generated by rv64-emu-gen is
+# also measured, timing only the runs of the processor. As it depends on
+# the machine, it is compared against a baseline recorded on the same
+# machine, which is not under version control, and may not drop by more
+# than the tolerance.
+#
+# Copyright (C) 2020  Leiden University, The Netherlands
+#
+
+import json
+import os
+import sys
+import subprocess
+import tempfile
+from pathlib import Path
+
+from argparse import ArgumentParser
+try:
+    from colorama import init, Fore, Style
+    enable_color = True
+except ImportError:
+    enable_color = False
+
+# Returns posix on POSIX platform, nt on NT/Windows
+def posix_nt(posix, nt):
+    return posix if os.name == "posix" else nt
+
+
+# Wrapper functions for optional color output
+def bright(s):
+    if enable_color:
+        s = Style.BRIGHT + s + Style.RESET_ALL
+    return s
+
+def passed(s):
+    if enable_color:
+        s = Fore.GREEN + s + Style.RESET_ALL
+    return s
+
+def failed(s):
+    if enable_color:
+        s = Fore.RED + s + Style.RESET_ALL
+    return s
+
+
+if enable_color:
+    init(autoreset=True)
+
+# Simulated results, which are deterministic
+EXACT = ["passed", "cycles", "instructions", "CPI", "stalls", "busBytes"]
+
+# The workload for the host MIPS: long enough to take a sizable fraction
+# of a second per run.
+WORKLOAD_FLAGS = ["-n", "256", "-i", "500", "-r", "1"]
+
+MODES = [("", []), (".pipelined", ["-p"])]
+
+# Need emulator and benchmark available
+def executable(name):
+    path = Path(posix_nt(name, "Windows\\{}.exe".format(name)))
+    if not path.exists():
+        print("{}{} executable not available, compile it first.".format(name, posix_nt('', '.exe')), file=sys.stderr)
+        exit(1)
+    return path.resolve()
+
+RV64_EMU = executable("rv64-emu")
+
+# Parse arguments
+parser = ArgumentParser()
+parser.add_argument("-b", dest="baseline", default="perf-baseline.json",
+                    help="Baseline file (default: perf-baseline.json)")
+parser.add_argument("-u", dest="update", action="store_true",
+                    help="Write the results to the baseline instead of comparing")
+parser.add_argument("-H", dest="host", action="store_true",
+                    help="Also measure the host MIPS of a generated workload")
+parser.add_argument("-B", dest="host_baseline", default="perf-host-baseline.json",
+                    help="Host MIPS baseline of this machine (default: perf-host-baseline.json)")
+parser.add_argument("-t", dest="tolerance", type=float, default=0.25,
+                    help="Allowed relative drop of the host MIPS (default: 0.25)")
+parser.add_argument("-v", dest="verbose", action="store_true",
+                    help="Enable verbose output")
+args = parser.parse_args()
+
+all_tests = list(Path("./tests").glob("*.conf"))
+all_tests.sort()
+
+
+def run_simulation(test, flags):
+    with tempfile.TemporaryDirectory() as tmp:
+        stats_file = Path(tmp) / "stats.json"
+        result = subprocess.run([str(RV64_EMU)] + flags +
+                                ["-t", str(test), "--stats-json", str(stats_file)],
+                                stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                                timeout=10)
+        # The emulator rejects some runs up front, e.g. programs using
+        # exceptions in pipelined mode.
+        if not stats_file.exists():
+            return dict({key: None for key in EXACT}, passed=False)
+        with open(stats_file) as f:
+            stats = json.load(f)["snapshots"][-1]["stats"]
+
+    # Multi-core runs report these per core, as coreN.*
+    def total(name):
+        if name in stats:
+            return stats[name]
+        return sum(value for key, value in stats.items()
+                   if key.startswith("core") and key.split(".", 1)[1] == name)
+
+    cycles = stats["cycles"]
+    instructions = total("instructions.completed")
+    return {
+        "passed": result.returncode == 0,
+        "cycles": cycles,
+        "instructions": instructions,
+        "CPI": round(cycles / instructions, 6) if instructions > 0 else None,
+        "stalls": total("stalls"),
+        "busBytes": total("bus.bytesRead") + total("bus.bytesWritten"),
+    }
+
+
+def measure_host_mips():
+    gen = executable("rv64-emu-gen")
+    bench = executable("rv64-emu-bench")
+    with tempfile.TemporaryDirectory() as tmp:
+        workload = Path(tmp) / "workload.bin"
+        output = Path(tmp) / "bench.json"
+        subprocess.run([str(gen)] + WORKLOAD_FLAGS + ["-o", str(workload)],
+                       stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL,
+                       check=True)
+        subprocess.run([str(bench), "-f", r"^workload\.", "-e", str(workload),
+                        "-r", "5", "-o", str(output)],
+                       stderr=subprocess.DEVNULL, check=True)
+        with open(output) as f:
+            benchmark = json.load(f)["benchmarks"][0]
+
+    # The fastest repetition is the least disturbed by other processes.
+    return 1e3 / benchmark["min"]
+
+
+print(bright("collected {} tests, {} runs".format(len(all_tests),
+                                                  len(all_tests) * len(MODES))))
+print()
+
+results = {}
+for test in all_tests:
+    for suffix, flags in MODES:
+        results[test.stem + suffix] = run_simulation(test, flags)
+
+host_mips = None
+if args.host:
+    print("Measuring host MIPS...")
+    print()
+    host_mips = measure_host_mips()
+
+if args.update:
+    with open(args.baseline, "w") as f:
+        json.dump(results, f, indent=2, sort_keys=True)
+        f.write("\n")
+    print("Wrote {} runs to {}".format(len(results), args.baseline))
+    if host_mips is not None:
+        with open(args.host_baseline, "w") as f:
+            json.dump({"workload": WORKLOAD_FLAGS, "hostMIPS": host_mips}, f, indent=2)
+            f.write("\n")
+        print("Wrote host MIPS {:.4g} to {}".format(host_mips, args.host_baseline))
+    exit(0)
+
+try:
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+except FileNotFoundError:
+    print("Baseline {} does not exist, create it with -u".format(args.baseline), file=sys.stderr)
+    exit(1)
+
+# Compare
+runs_pass = 0
+runs_fail = 0
+fail_log = ""
+host_fail = False
+
+for name, result in results.items():
+    problems = []
+    if name not in baseline:
+        problems.append("not in baseline")
+    else:
+        expected = baseline[name]
+        for key in EXACT:
+            if result[key] != expected.get(key):
+                problems.append("{} changed from {} to {}".format(key, expected.get(key), result[key]))
+
+    if not problems:
+        runs_pass += 1
+        if not args.verbose:
+            print(passed("."), end='')
+        else:
+            print(passed("PASS"), name)
+    else:
+        runs_fail += 1
+        log = failed("FAIL ") + name + "\n" + "".join("    " + p + "\n" for p in problems)
+        if not args.verbose:
+            print(failed("F"), end='')
+            fail_log += log
+        else:
+            print(log, end='')
+
+missing = sorted(set(baseline) - set(results))
+for name in missing:
+    runs_fail += 1
+    fail_log += failed("FAIL ") + name + "\n    missing, but in baseline\n"
+
+print()
+
+if host_mips is not None:
+    try:
+        with open(args.host_baseline) as f:
+            host_baseline = json.load(f)
+    except FileNotFoundError:
+        print("Host baseline {} does not exist, record it on this machine with -u -H".format(
+            args.host_baseline), file=sys.stderr)
+        exit(1)
+
+    if host_baseline["workload"] != WORKLOAD_FLAGS:
+        print("Host baseline {} is of another workload, record it again with -u -H".format(
+            args.host_baseline), file=sys.stderr)
+        exit(1)
+
+    ratio = host_mips / host_baseline["hostMIPS"]
+    print("Host MIPS {:.4g} ({:+.1f}% compared to baseline)".format(host_mips, (ratio - 1) * 100))
+    if ratio < 1 - args.tolerance:
+        host_fail = True
+        fail_log += failed("FAIL ") + "host MIPS dropped from {:.4g} to {:.4g}\n".format(
+            host_baseline["hostMIPS"], host_mips)
+
+# Output fail log if necessary
+if not args.verbose:
+    print()
+    print(fail_log)
+
+# Output final banner
+banner = " {} runs, {} pass, {} fail ".format(runs_pass + runs_fail, runs_pass, runs_fail)
+banner = "=" * 20 + banner + "=" * 20
+if runs_fail == 0 and not host_fail:
+    print(passed(banner))
+    status = 0
+else:
+    print(failed(banner))
+    status = 1
+
+exit(status)
@@ -53,6 +53,96 @@ TestFile::getPostRegisters() const
   return getRegisters("post");
 }
 
+unsigned int
+TestFile::getRegisterBanks() const
+{
+  return getProcessorProperty("banks", 1);
+}
+
+unsigned int
+TestFile::getCores() const
+{
+  return getProcessorProperty("cores", 1);
+}
+
+bool
+TestFile::getCaches() const
+{
+  return getProcessorProperty("caches", 0) != 0;
+}
+
+bool
+TestFile::getFastForward() const
+{
+  return getProcessorProperty("fastforward", 0) != 0;
+}
+
+std::vector<std::pair<std::string, uint64_t>>
+TestFile::getExpectedStatistics() const
+{
+  std::vector<std::pair<std::string, uint64_t>> result;
+
+  for (const auto & [prop, value] : getProperties("stats"))
+    result.emplace_back(prop, std::stoull(value, nullptr, 0));
+
+  return result;
+}
+
+std::vector<std::string>
+TestFile::getAcceleratorBindings() const
+{
+  std::vector<std::string> result;
+
+  for (const auto & [prop, value] : getProperties("accelerators"))
+    if (prop != "plugin")
+      result.push_back(prop + "=" + value);
+
+  return result;
+}
+
+std::vector<std::string>
+TestFile::getPlugins() const
+{
+  std::vector<std::string> result;
+
+  for (const auto & [prop, value] : getProperties("accelerators"))
+    if (prop == "plugin")
+      result.push_back(value);
+
+  return result;
+}
+
+std::vector<HostFunction>
+TestFile::getHostCalls() const
+{
+  std::vector<HostFunction> result;
+
+  for (const auto & [prop, value] : getProperties("processor"))
+    if (prop == "hostcalls")
+      {
+        std::string_view list(value);
+        while (! list.empty())
+          {
+            const size_t comma = std::min(list.find(','), list.size());
+            result.push_back(HostCallInterceptor::getFunction(list.substr(0, comma)));
+            list.remove_prefix(std::min(comma + 1, list.size()));
+          }
+      }
+
+  return result;
+}
+
+unsigned int
+TestFile::getProcessorProperty(std::string_view name,
+                               unsigned int defaultValue) const
+{
+  for (const auto & [prop, value] : getProperties("processor"))
+    if (prop == name)
+      return std::stoul(value);
+
+  return defaultValue;
+}
+
 std::string
 TestFile::getExecutable() const
 {
@@ -66,6 +156,51 @@ TestFile::validate() const
 {
   validateSection("pre");
   validateSection("post");
+
+  for (const auto & [prop, value] : getProperties("processor"))
+    {
+      if (prop == "banks")
+        {
+          if (! std::regex_match(value, std::regex("[0-9]+")))
+            throw std::runtime_error("Invalid number of register banks " + value);
+        }
+      else if (prop == "cores")
+        {
+          if (! std::regex_match(value, std::regex("[1-9][0-9]*")))
+            throw std::runtime_error("Invalid number of cores " + value);
+        }
+      else if (prop == "caches")
+        {
+          if (value != "0" && value != "1")
+            throw std::runtime_error("Invalid value of caches " + value);
+        }
+      else if (prop == "fastforward")
+        {
+          if (value != "0" && value != "1")
+            throw std::runtime_error("Invalid value of fastforward " + value);
+        }
+      else if (prop == "hostcalls")
+        {
+          try
+            {
+              getHostCalls();
+            }
+          catch (std::out_of_range &)
+            {
+              throw std::runtime_error("Invalid host routines " + value);
+            }
+        }
+      else
+        throw std::runtime_error("Unknown processor property " + prop);
+    }
+
+  for (const auto & [prop, value] : getProperties("stats"))
+    if (! std::regex_match(value, std::regex("0x[0-9a-fA-F]+|[0-9]+")))
+      throw std::runtime_error("Invalid value of statistic " + prop);
+
+  for (const auto & [prop, value] : getProperties("accelerators"))
+    if (prop != "plugin" && ! std::regex_match(prop, std::regex("cust[1-8]")))
+      throw std::runtime_error("Invalid custom opcode " + prop);
 }
 
 void
@@ -12,6 +12,7 @@
 
 #include "arch.h"
 #include "config-file.h"
+#include "host-calls.h"
 
 enum ExitCodes : int
 {
@@ -41,7 +42,17 @@ class RegisterInit
  * the registers should be initialized with and the values the registers
  * should have at program end respectively. The filename of a test file
  * should end with ".conf". The corresponding executable has the same
- * filename, but with extension ".bin".
+ * filename, but with extension ".bin". An optional "processor" section
+ * configures the processor the test needs, e.g. "banks=4" for four
+ * banks of general-purpose registers, "cores=4" to run the program on
+ * four cores, "caches=1" for the cache model, "fastforward=1" to skip
+ * spin loops, or "hostcalls=memcpy,strlen" to run these library routines
+ * on the host. The "post" values are checked against core 0. An
+ * optional "stats" section lists the values that statistics should have
+ * at program end, by name. An optional
+ * "accelerators" section binds accelerators to the custom opcodes, e.g.
+ * "cust1=crc32", and may load a plugin providing them, e.g.
+ * "plugin=./example-accelerator.so", relative to the working directory.
  */
 class TestFile : public ConfigFile
 {
@@ -51,6 +62,29 @@ class TestFile : public ConfigFile
     std::vector<RegisterInit> getPreRegisters() const;
     std::vector<RegisterInit> getPostRegisters() const;
 
+    /* Number of register banks; 1 unless the test asks for more. */
+    unsigned int getRegisterBanks() const;
+
+    /* Number of cores; 1 unless the test asks for more. */
+    unsigned int getCores() const;
+
+    /* Whether the test runs with the cache model. */
+    bool getCaches() const;
+
+    /* Whether the test skips spin loops, like the -f option. */
+    bool getFastForward() const;
+
+    /* The library routines to run on the host, if any. */
+    std::vector<HostFunction> getHostCalls() const;
+
+    std::vector<std::pair<std::string, uint64_t>> getExpectedStatistics() const;
+
+    /* Accelerator bindings in the form custN=name. */
+    std::vector<std::string> getAcceleratorBindings() const;
+
+    /* The plugin to load, if any. */
+    std::vector<std::string> getPlugins() const;
+
     /* Return the name of the executable to run given the name of the
      * test file.
      */
@@ -61,6 +95,9 @@ class TestFile : public ConfigFile
 
     void validate() const;
 
+    unsigned int getProcessorProperty(std::string_view name,
+                                      unsigned int defaultValue) const;
+
     /* Verify that all properties in the given section consist of an
      * register name (rXX) and integer value.
      */
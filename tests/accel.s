@@ -0,0 +1,25 @@
+# Test of the built-in accelerators, bound to custom opcodes by the
+# test: l.cust1 computes the CRC-32 of the rB bytes at address rA and
+# l.cust2 counts the bits set in rA. The accelerator reads memory
+# through the data cache like a load: the first CRC-32 misses, the
+# second hits.
+
+       .data
+       .align 8
+       .local  A
+A:
+       .ascii  "123456789"
+       .size   A, .-A
+       .text
+       .align 4
+       .globl  _start
+       .type   _start, @function
+_start:
+       l.movhi r1,1
+       l.ori   r1,r1,0x1100        # A
+       l.addi  r2,r0,9
+       l.cust1 r3,r1,r2            # 0xcbf43926
+       l.cust2 r4,r3,r0            # 17
+       l.cust1 r5,r1,r2            # 0xcbf43926
+       .word  0x40ffccff
+       .size   _start, .-_start
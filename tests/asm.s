@@ -0,0 +1,37 @@
+# Test of the built-in assembler: the hi(), lo() and ha() operators,
+# the .zero and .align directives, and the placement of the data
+# section at 0x11100 (69888 decimal). A is the first datum, so its
+# address is 69888; B follows after 4 bytes of data, 5 bytes of
+# padding by .zero and the alignment to a multiple of 8, at 69904.
+# ha() rounds up when bit 15 is set, so that the sign-extended lo()
+# offset of a load adds back up to the address.
+
+       .data
+       .align 8
+       .local  A
+A:
+       .int 7
+       .zero 5
+       .align 8
+       .local  B
+B:
+       .int 9
+       .size   A, .-A
+       .text
+       .align 4
+       .globl  _start
+       .type   _start, @function
+_start:
+       l.movhi r1,hi(A)
+       l.ori   r1,r1,lo(A)         # 69888
+       l.movhi r2,ha(B)
+       l.lwz   r3,lo(B)(r2)        # 9
+       l.movhi r4,hi(B)
+       l.ori   r4,r4,lo(B)
+       l.sub   r5,r4,r1            # 16
+       l.lwz   r6,0(r1)            # 7
+       l.movhi r7,hi(0x18000)      # 65536
+       l.movhi r8,ha(0x18000)      # 131072
+       l.addi  r9,r0,lo(0x12345)   # 9029
+       .word  0x40ffccff
+       .size   _start, .-_start
@@ -0,0 +1,46 @@
+# Test of the load-link and store-conditional instructions l.lwa and
+# l.swa. The flag is copied from SR[F] (bit 9, 512) after each l.swa.
+# The first l.swa holds the reservation of the l.lwa before it and
+# succeeds. The second loses its reservation to the plain store in
+# between and fails, without writing memory. The third has no
+# reservation left at all, as the failed l.swa consumed it.
+# R1 holds the address of A, 0x11100 (69888 decimal).
+
+       .data
+       .align 8
+       .local  A
+A:
+       .int 10, 20
+       .size   A, .-A
+       .text
+       .align 4
+       .globl  _start
+       .type   _start, @function
+_start:
+       l.lwa   r2,0(r1)            # 10
+       l.addi  r3,r2,1
+       l.swa   0(r1),r3            # succeeds
+       l.bnf   .L1
+        l.addi r4,r0,0
+       l.addi  r4,r0,1             # 1
+.L1:
+       l.lwz   r5,0(r1)            # 11
+
+       l.lwa   r6,0(r1)            # 11
+       l.addi  r7,r0,30
+       l.sw    0(r1),r7            # cancels the reservation
+       l.swa   0(r1),r3            # fails
+       l.bnf   .L2
+        l.addi r8,r0,0
+       l.addi  r8,r0,1             # not reached
+.L2:
+       l.lwz   r10,0(r1)           # 30
+
+       l.swa   4(r1),r3            # fails, no reservation
+       l.bnf   .L3
+        l.addi r11,r0,0
+       l.addi  r11,r0,1            # not reached
+.L3:
+       l.lwz   r12,4(r1)           # 20
+       .word  0x40ffccff
+       .size   _start, .-_start
@@ -0,0 +1,43 @@
+# Test of the banks of general-purpose registers, with two banks as
+# configured in banks.conf. SR[CID] (bits 31:28 of SPR 17) selects the
+# bank. Register r of bank b is also SPR 1024 + 32 * b + r, e.g. r2 of
+# bank 1 is SPR 1058. The system call handler, at 0xc00 from EVBAR,
+# runs in bank 0 without disturbing the registers of bank 1, and l.rfe
+# returns to bank 1. The post values are those of bank 0. As in
+# except.s, .zero places the handler from the instruction count.
+
+       .text
+       .align 4
+       .globl  _start
+       .type   _start, @function
+_start:
+       l.movhi r1,1
+       l.mtspr r0,r1,11            # EVBAR = 0x10000
+       l.addi  r2,r0,7             # 7
+       l.addi  r3,r0,11
+       l.mtspr r0,r3,1058          # r2 of bank 1 = 11
+       l.movhi r4,0x1000           # CID = 1
+       l.mfspr r5,r0,17            # SR in bank 0
+       l.or    r6,r5,r4
+       l.mtspr r0,r6,17
+
+       l.add   r6,r2,r2            # 22, in bank 1
+       l.mfspr r7,r0,1026          # 7, r2 of bank 0
+       l.sys   1
+       l.addi  r10,r0,3            # 3, in bank 1
+       l.mfspr r11,r0,17
+       l.movhi r15,0x1000
+       l.sub   r11,r11,r15         # CID = 0
+       l.mtspr r0,r11,17
+
+       l.mfspr r12,r0,1066         # 3, r10 of bank 1
+       l.mfspr r13,r0,1063         # 7, r7 of bank 1
+       l.mfspr r14,r0,1058         # 11, r2 of bank 1
+       .word  0x40ffccff
+
+       .zero   0xc00 - 21 * 4
+sys_handler:
+       l.addi  r8,r0,1             # 1, in bank 0
+       l.mfspr r9,r0,1062          # 22, r6 of bank 1
+       l.rfe
+       .size   _start, .-_start
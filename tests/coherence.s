@@ -0,0 +1,65 @@
+# Test of the MESI protocol and false-sharing detection of the cache
+# model on two cores. Both cores first read the same word, which ends up
+# Shared in both L1s. Then each core increments its own word of another
+# line a number of times. The cores write different bytes of the same
+# line, which keeps moving between their L1s: false sharing. A delay
+# loop makes each increment take more than a time quantum, so the line
+# moves once per increment. Finally core 0 waits for core 1, which
+# announces the end of its loop with an atomic increment, and reads both
+# words.
+
+       .data
+       .align 64
+       .local  line
+line:
+       .int 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+       .local  shared
+shared:
+       .int 7, 0
+       .text
+       .align 4
+       .globl  _start
+       .type   _start, @function
+_start:
+       l.addi  r1,r0,0x270
+       l.lwz   r2,0(r1)            # core number
+       l.movhi r4,hi(line)
+       l.ori   r4,r4,lo(line)
+       l.add   r5,r2,r2
+       l.add   r5,r5,r5
+       l.add   r5,r4,r5            # own word in line
+       l.lwz   r3,64(r4)           # 7, Shared in both L1s
+
+       l.addi  r6,r0,4
+.L1:
+       l.lwz   r7,0(r5)
+       l.addi  r7,r7,1
+       l.sw    0(r5),r7
+       l.addi  r8,r0,100
+.L2:
+       l.addi  r8,r8,-1
+       l.sfne  r8,r0
+       l.bf    .L2
+        l.nop
+       l.addi  r6,r6,-1
+       l.sfne  r6,r0
+       l.bf    .L1
+        l.nop
+
+.L3:
+       l.lwa   r6,68(r4)
+       l.addi  r6,r6,1
+       l.swa   68(r4),r6
+       l.bnf   .L3
+        l.nop
+       l.addi  r7,r0,2
+.L4:
+       l.lwz   r6,68(r4)
+       l.sfne  r6,r7
+       l.bf    .L4
+        l.nop
+
+       l.lwz   r9,0(r4)            # 4
+       l.lwz   r10,4(r4)           # 4
+       .word  0x40ffccff
+       .size   _start, .-_start
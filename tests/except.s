@@ -0,0 +1,47 @@
+# Test of l.sys, l.trap and l.rfe. EVBAR (SPR 11) is set to the start
+# of the program, 0x10000, so that the system call handler is at offset
+# 0xc00 and the trap handler at 0xe00 of the text. l.sys returns to
+# the instruction after it, or to the branch target from a delay slot;
+# l.trap is restarted, so its handler skips it by adding 4 to EPCR0
+# (SPR 32). l.rfe restores SR, and with it the flag, from ESR0 (SPR 64).
+# The handlers are placed by padding with .zero, which only takes
+# constants: update the instruction counts when changing the code.
+
+       .text
+       .align 4
+       .globl  _start
+       .type   _start, @function
+_start:
+       l.movhi r1,1
+       l.mtspr r0,r1,11            # EVBAR = 0x10000
+       l.sfeq  r0,r0               # flag set, saved in ESR0
+       l.sys   1
+       l.bnf   .L1
+        l.addi r4,r0,0
+       l.addi  r4,r0,1             # 1, flag restored
+.L1:
+       l.trap  0                   # at 0x1001c
+       l.addi  r5,r0,1             # 1
+       l.j     .L2
+        l.sys  2
+       l.addi  r6,r0,1             # not reached
+.L2:
+       l.addi  r12,r0,1            # 1
+       .word  0x40ffccff
+
+       .zero   0xc00 - 14 * 4
+sys_handler:
+       l.addi  r3,r3,1             # 2 system calls
+       l.mfspr r7,r0,32            # EPCR0 = .L2 at 0x10030
+       l.mfspr r8,r0,64            # ESR0, with the flag
+       l.mfspr r9,r0,17            # SR, with the flag and DSX
+       l.sfne  r0,r0               # clear the flag
+       l.rfe
+
+       .zero   0xe00 - 0xc00 - 6 * 4
+trap_handler:
+       l.mfspr r10,r0,32           # EPCR0 = 0x1001c
+       l.addi  r11,r10,4
+       l.mtspr r0,r11,32
+       l.rfe
+       .size   _start, .-_start
@@ -0,0 +1,51 @@
+# Test that fast-forwarding does not change the outcome of a program.
+# The test runs with spin-loop skipping. The program first spins until
+# the tick timer interrupt after 1000 cycles, then dozes until the next
+# one, 500 cycles later. Both waits end in the same cycle as without
+# skipping, which TTCR (SPR 0x5001), read after each wait, shows. The
+# expected cycle and instruction counts are those of a run without -f.
+# EVBAR (SPR 11) is set to the start of the program, so that the tick
+# timer handler is at offset 0x500; it clears TTMR[IP] (SPR 0x5000) by
+# subtracting it. The handler is placed by padding with .zero, which
+# only takes constants: update the instruction count when changing the
+# code.
+
+       .text
+       .align 4
+       .globl  _start
+       .type   _start, @function
+_start:
+       l.movhi r1,1
+       l.mtspr r0,r1,11            # EVBAR = 0x10000
+       l.mfspr r5,r0,17
+       l.ori   r5,r5,2             # SR[TEE]
+       l.mtspr r0,r5,17
+       l.mtspr r0,r0,0x5001        # TTCR = 0
+       l.movhi r2,0x6000           # restart, interrupt enable
+       l.ori   r2,r2,1000
+       l.mtspr r0,r2,0x5000
+.L1:
+       l.sfeq  r3,r0               # spins until the interrupt
+       l.bf    .L1
+        l.nop  0
+       l.mfspr r10,r0,0x5001       # cycles since the match
+
+       l.mtspr r0,r0,0x5001        # TTCR = 0
+       l.movhi r2,0x6000           # restart, interrupt enable
+       l.ori   r2,r2,500
+       l.mtspr r0,r2,0x5000
+       l.addi  r6,r0,16            # PMR[DME]
+       l.mtspr r0,r6,0x4000        # dozes until the interrupt
+       l.mfspr r11,r0,0x5001       # cycles since the match
+       l.mtspr r0,r0,0x5000        # disable the timer
+       .word  0x40ffccff
+
+       .zero   0x500 - 22 * 4
+tick_handler:
+       l.addi  r3,r3,1             # 2 interrupts
+       l.mfspr r7,r0,0x5000
+       l.movhi r8,0x1000           # TTMR[IP]
+       l.sub   r7,r7,r8
+       l.mtspr r0,r7,0x5000
+       l.rfe
+       .size   _start, .-_start
@@ -0,0 +1,34 @@
+# Test of the floating-point exception. EVBAR (SPR 11) is set to the
+# start of the program, 0x10000, so that the handler is at offset 0xd00
+# of the text. With FPEE (bit 0 of FPCSR, SPR 20) set, an operation
+# that raises a flag enters the handler once it has completed: EPCR0
+# (SPR 32) points to the next instruction. Exact operations raise no
+# flag and do not enter the handler. The handler is placed by padding
+# with .zero, which only takes constants: update the instruction count
+# when changing the code.
+
+       .text
+       .align 4
+       .globl  _start
+       .type   _start, @function
+_start:
+       l.movhi   r1,1
+       l.mtspr   r0,r1,11          # EVBAR = 0x10000
+       l.addi    r2,r0,1
+       l.mtspr   r0,r2,20          # FPEE
+       l.addi    r3,r0,3
+       lf.itof.s r4,r3             # 3.0, exact
+       lf.div.s  r7,r4,r0          # +inf, DZF | INF
+       l.addi    r8,r0,1           # at 0x1001c, 1
+       lf.add.s  r12,r4,r4         # 6.0, exact
+       l.mfspr   r13,r0,20         # 1, FPEE only
+       .word  0x40ffccff
+
+       .zero   0xd00 - 11 * 4
+fp_handler:
+       l.addi    r9,r9,1           # 1 exception
+       l.mfspr   r10,r0,32         # EPCR0 = 0x1001c
+       l.mfspr   r11,r0,20         # FPEE | DZF | INF
+       l.mtspr   r0,r2,20          # clear the flags
+       l.rfe
+       .size   _start, .-_start
@@ -0,0 +1,42 @@
+# Test of the floating-point unit. Integers are converted with
+# lf.itof.s and lf.ftoi.s; the other results are checked as IEEE 754
+# bit patterns, e.g. 7.0 is 0x40e00000 (1088421888 decimal). FPCSR is
+# SPR 20: its sticky flags collect IXF (256) on inexact results and its
+# RM field (bits 2:1) selects the rounding mode of lf.ftoi.s as well.
+
+       .text
+       .align 4
+       .globl  _start
+       .type   _start, @function
+_start:
+       lf.itof.s r3,r1             # 3.0
+       lf.itof.s r4,r2             # 4.0
+       lf.add.s  r5,r3,r4          # 7.0
+       lf.mul.s  r6,r3,r4          # 12.0
+       lf.sub.s  r7,r3,r4          # -1.0
+       l.or      r8,r5,r0
+       lf.madd.s r8,r3,r4          # 19.0
+       lf.ftoi.s r9,r8             # 19
+       lf.rem.s  r10,r5,r4         # 3.0, truncated
+       lf.ftoi.s r11,r10           # 3
+
+       lf.sflt.s r3,r4
+       l.bnf     .L1
+        l.addi   r12,r0,0
+       l.addi    r12,r0,1          # 1
+.L1:
+       lf.sfeq.s r5,r3
+       l.bnf     .L2
+        l.addi   r13,r0,0
+       l.addi    r13,r0,1          # not reached
+.L2:
+       l.mfspr   r14,r0,20         # 0, all exact
+
+       lf.div.s  r15,r5,r4         # 1.75
+       lf.ftoi.s r16,r15           # 2, to nearest
+       l.addi    r17,r0,2
+       l.mtspr   r0,r17,20         # round towards zero
+       lf.ftoi.s r18,r15           # 1
+       l.mfspr   r19,r0,20         # 2 | IXF
+       .word  0x40ffccff
+       .size   _start, .-_start
@@ -0,0 +1,184 @@
+# Test of the host implementations of library routines: the test runs
+# memcpy, memset, strlen and memcmp on the host. Each routine is called
+# once through its intercepted entry and once through the guest code
+# behind it, ref_*. Both calls must give the same result; the
+# statistics show that the intercepted calls ran on the host.
+
+       .data
+       .align 8
+       .local  S
+S:
+       .asciz  "hello, world"
+       .align 4
+       .local  D1
+D1:
+       .zero   16
+       .local  D2
+D2:
+       .zero   16
+       .text
+       .align 4
+       .globl  _start
+       .type   _start, @function
+_start:
+       l.movhi r1,1
+       l.ori   r1,r1,0x1100        # S; D1 at S+16, D2 at S+32
+
+       l.addi  r3,r1,16
+       l.or    r4,r1,r0
+       l.jal   memcpy
+       l.addi  r5,r0,13
+       l.sub   r14,r11,r1          # 16
+       l.addi  r3,r1,32
+       l.or    r4,r1,r0
+       l.jal   ref_memcpy
+       l.addi  r5,r0,13
+       l.sub   r15,r11,r1          # 32
+       l.lwz   r16,16(r1)          # "hell"
+       l.lwz   r17,32(r1)
+       l.lwz   r18,24(r1)          # "orld"
+       l.lwz   r19,40(r1)
+
+       l.addi  r3,r1,16
+       l.jal   strlen
+       l.nop   0
+       l.or    r20,r11,r0          # 12
+       l.addi  r3,r1,32
+       l.jal   ref_strlen
+       l.nop   0
+       l.or    r21,r11,r0
+
+       l.addi  r3,r1,21            # only the low byte of c is stored
+       l.addi  r4,r0,0x158
+       l.jal   memset
+       l.addi  r5,r0,2
+       l.addi  r3,r1,37
+       l.addi  r4,r0,0x158
+       l.jal   ref_memset
+       l.addi  r5,r0,2
+       l.lwz   r22,20(r1)          # "oXXw"
+       l.lwz   r23,36(r1)
+
+       l.or    r3,r1,r0
+       l.addi  r4,r1,16
+       l.jal   memcmp
+       l.addi  r5,r0,13
+       l.or    r24,r11,r0          # ',' - 'X'
+       l.or    r3,r1,r0
+       l.addi  r4,r1,16
+       l.jal   ref_memcmp
+       l.addi  r5,r0,13
+       l.or    r25,r11,r0
+       l.addi  r3,r1,16
+       l.addi  r4,r1,32
+       l.jal   memcmp
+       l.addi  r5,r0,13
+       l.or    r26,r11,r0          # 0
+       l.addi  r3,r1,16
+       l.addi  r4,r1,32
+       l.jal   ref_memcmp
+       l.addi  r5,r0,13
+       l.or    r27,r11,r0
+       .word  0x40ffccff
+       .size   _start, .-_start
+
+# The intercepted entries; without interception they run the guest code.
+       .globl  memcpy
+       .type   memcpy, @function
+memcpy:
+       l.j     ref_memcpy
+       l.nop   0
+       .size   memcpy, .-memcpy
+
+       .globl  memset
+       .type   memset, @function
+memset:
+       l.j     ref_memset
+       l.nop   0
+       .size   memset, .-memset
+
+       .globl  strlen
+       .type   strlen, @function
+strlen:
+       l.j     ref_strlen
+       l.nop   0
+       .size   strlen, .-strlen
+
+       .globl  memcmp
+       .type   memcmp, @function
+memcmp:
+       l.j     ref_memcmp
+       l.nop   0
+       .size   memcmp, .-memcmp
+
+# Byte-at-a-time guest versions, arguments in r3 to r5, result in r11.
+       .type   ref_memcpy, @function
+ref_memcpy:
+       l.or    r11,r3,r0
+.Lcpy:
+       l.sfeq  r5,r0
+       l.bf    .Lcpyend
+       l.nop   0
+       l.lbz   r6,0(r4)
+       l.sb    0(r3),r6
+       l.addi  r3,r3,1
+       l.addi  r4,r4,1
+       l.j     .Lcpy
+       l.addi  r5,r5,-1
+.Lcpyend:
+       l.jr    r9
+       l.nop   0
+       .size   ref_memcpy, .-ref_memcpy
+
+       .type   ref_memset, @function
+ref_memset:
+       l.or    r11,r3,r0
+.Lset:
+       l.sfeq  r5,r0
+       l.bf    .Lsetend
+       l.nop   0
+       l.sb    0(r3),r4
+       l.addi  r3,r3,1
+       l.j     .Lset
+       l.addi  r5,r5,-1
+.Lsetend:
+       l.jr    r9
+       l.nop   0
+       .size   ref_memset, .-ref_memset
+
+       .type   ref_strlen, @function
+ref_strlen:
+       l.addi  r11,r0,0
+.Llen:
+       l.lbz   r6,0(r3)
+       l.sfeq  r6,r0
+       l.bf    .Llenend
+       l.nop   0
+       l.addi  r3,r3,1
+       l.j     .Llen
+       l.addi  r11,r11,1
+.Llenend:
+       l.jr    r9
+       l.nop   0
+       .size   ref_strlen, .-ref_strlen
+
+       .type   ref_memcmp, @function
+ref_memcmp:
+       l.addi  r11,r0,0
+.Lcmp:
+       l.sfeq  r5,r0
+       l.bf    .Lcmpend
+       l.nop   0
+       l.lbz   r6,0(r3)
+       l.lbz   r7,0(r4)
+       l.sub   r11,r6,r7
+       l.sfne  r11,r0
+       l.bf    .Lcmpend
+       l.addi  r3,r3,1
+       l.addi  r4,r4,1
+       l.j     .Lcmp
+       l.addi  r5,r5,-1
+.Lcmpend:
+       l.jr    r9
+       l.nop   0
+       .size   ref_memcmp, .-ref_memcmp
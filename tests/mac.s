@@ -0,0 +1,38 @@
+# Test of the multiply-accumulate unit: l.mac, l.maci, l.macu, l.msb,
+# l.msbu, l.muld and l.muldu update the 64-bit accumulator, l.macrc
+# reads and clears it. MACLO and MACHI are SPRs 10241 and 10242; the
+# accumulator carries into MACHI and goes negative in between.
+
+       .text
+       .align 4
+       .globl  _start
+       .type   _start, @function
+_start:
+       l.addi  r2,r0,7
+       l.mac   r1,r2               # 42
+       l.maci  r1,-2               # 30
+       l.msb   r2,r2               # -19
+       l.mac   r2,r2               # 30
+       l.macrc r3                  # 30
+       l.mfspr r4,r0,10241         # 0
+
+       l.movhi r5,1
+       l.macu  r5,r5               # 2^32
+       l.mfspr r6,r0,10242         # 1
+       l.msbu  r1,r2               # 2^32 - 42
+       l.mfspr r7,r0,10242         # 0
+       l.macrc r8                  # 4294967254
+
+       l.addi  r9,r0,-7
+       l.muld  r9,r9
+       l.macrc r10                 # 49
+       l.muldu r1,r2
+       l.mac   r1,r1
+       l.macrc r11                 # 78
+
+       l.mtspr r0,r2,10242
+       l.mfspr r12,r0,10242        # 7
+       l.macrc r13
+       l.mfspr r14,r0,10242        # 0
+       .word  0x40ffccff
+       .size   _start, .-_start
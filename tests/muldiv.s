@@ -0,0 +1,51 @@
+# Test of the multiplier and divider: l.mul, l.muli, l.mulu, l.div and
+# l.divu, with signed operands and with results used right away by the
+# next instruction, which has to wait for the unit. Registers are
+# 32-bit, so e.g. -42 is expected as 4294967254.
+#
+# Division by zero sets SR[OV] (bit 11 of SR, SPR 17). With SR[OVE]
+# (bit 12) set, it also takes the range exception instead of writing
+# back. EVBAR (SPR 11) is set to the start of the program, 0x10000, so
+# that the handler is at offset 0xb00 of the text. EPCR0 (SPR 32) points
+# to the division, which the handler skips. The handler is placed by
+# padding with .zero, which only takes constants: update the
+# instruction count when changing the code.
+
+       .text
+       .align 4
+       .globl  _start
+       .type   _start, @function
+_start:
+       l.addi  r2,r0,7
+       l.mul   r3,r1,r2            # 42
+       l.addi  r4,r0,-7
+       l.mul   r5,r4,r1            # -42
+       l.muli  r6,r1,-3            # -18
+       l.mulu  r7,r1,r2            # 42
+       l.div   r8,r5,r1            # -7
+       l.divu  r9,r3,r1            # 7
+       l.addi  r10,r0,100
+       l.divu  r11,r10,r2          # 14
+       l.div   r12,r10,r4          # -14
+       l.mul   r13,r3,r3           # 1764
+       l.div   r14,r13,r2          # 252
+       l.add   r15,r14,r13         # 2016
+
+       l.div   r16,r10,r0          # 0, sets SR[OV]
+       l.mfspr r17,r0,17           # SM | OV | FO
+       l.movhi r23,1
+       l.mtspr r0,r23,11           # EVBAR = 0x10000
+       l.ori   r18,r17,0x1000
+       l.mtspr r0,r18,17           # OVE
+       l.divu  r19,r10,r0          # at 0x10050, not written back
+       l.addi  r20,r0,1            # 1
+       .word  0x40ffccff
+
+       .zero   0xb00 - 23 * 4
+range_handler:
+       l.addi  r24,r24,1           # 1 exception
+       l.mfspr r21,r0,32           # EPCR0 = 0x10050
+       l.addi  r22,r21,4
+       l.mtspr r0,r22,32
+       l.rfe
+       .size   _start, .-_start
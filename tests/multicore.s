@@ -0,0 +1,57 @@
+# Test of a multi-core system. Every core increments a shared counter a
+# hundred times with l.lwa and l.swa, stores a byte with its core number
+# plus one in a shared word and then announces that it is done with an
+# atomic increment of a second counter. Once all cores are done, the
+# counter holds 100 per core and the shared word 0x01020304. The cores
+# read their core number and the number of cores from the system status
+# module at 0x270.
+
+       .data
+       .align 8
+       .local  counter
+counter:
+       .int 0, 0
+       .local  bytes
+bytes:
+       .int 0
+       .text
+       .align 4
+       .globl  _start
+       .type   _start, @function
+_start:
+       l.addi  r1,r0,0x270
+       l.lwz   r2,0(r1)            # core number
+       l.lwz   r3,4(r1)            # number of cores
+       l.movhi r4,hi(counter)
+       l.ori   r4,r4,lo(counter)
+       l.addi  r5,r0,100
+.L1:
+       l.lwa   r6,0(r4)
+       l.addi  r6,r6,1
+       l.swa   0(r4),r6
+       l.bnf   .L1
+        l.nop
+       l.addi  r5,r5,-1
+       l.sfne  r5,r0
+       l.bf    .L1
+        l.nop
+
+       l.add   r7,r4,r2
+       l.addi  r6,r2,1
+       l.sb    8(r7),r6
+.L2:
+       l.lwa   r6,4(r4)
+       l.addi  r6,r6,1
+       l.swa   4(r4),r6
+       l.bnf   .L2
+        l.nop
+.L3:
+       l.lwz   r7,4(r4)
+       l.sfne  r7,r3
+       l.bf    .L3
+        l.nop
+
+       l.lwz   r8,0(r4)            # 400
+       l.lwz   r9,8(r4)            # 0x01020304
+       .word  0x40ffccff
+       .size   _start, .-_start
@@ -0,0 +1,53 @@
+# Test of the performance counters, PCCR0-7 (SPR 0x3800-0x3807) and
+# their mode registers PCMR0-7 (SPR 0x3808-0x380f). The program runs in
+# supervisor mode: counters with PCMR[CISM] (bit 2) count, those with
+# only PCMR[CIUM] (bit 3) do not. PCMR[CP] (bit 0) always reads as set,
+# the bits without a meaning read as zero. A counter that stopped
+# keeps its value, also when it was written.
+
+       .data
+       .align 8
+       .local  A
+A:
+       .int    1, 2, 3, 0, 0
+       .text
+       .align 4
+       .globl  _start
+       .type   _start, @function
+_start:
+       l.movhi r1,1
+       l.ori   r1,r1,0x1100        # A
+       l.mfspr r2,r0,0x3808        # PCMR0 = CP
+       l.movhi r3,0xffff
+       l.ori   r3,r3,0xffff
+       l.mtspr r0,r3,0x3809
+       l.mfspr r3,r0,0x3809        # PCMR1, the writable bits and CP
+
+       l.mtspr r0,r0,0x3800        # PCCR0 = 0
+       l.mtspr r0,r0,0x3802        # PCCR2 = 0
+       l.mtspr r0,r0,0x3804        # PCCR4 = 0
+       l.addi  r4,r0,100
+       l.mtspr r0,r4,0x3803        # PCCR3 = 100, stopped
+       l.movhi r4,0x0800           # instructions retired
+       l.ori   r4,r4,4             # in supervisor mode
+       l.addi  r5,r0,0x34          # loads and stores in supervisor mode
+       l.addi  r6,r0,0x38          # loads and stores in user mode
+       l.mtspr r0,r5,0x380a
+       l.mtspr r0,r6,0x380c
+       l.mtspr r0,r4,0x3808        # counting starts here
+       l.lwz   r7,0(r1)
+       l.lwz   r8,4(r1)
+       l.lwz   r9,8(r1)
+       l.sw    12(r1),r7
+       l.sw    16(r1),r8
+       l.addi  r10,r0,1
+       l.addi  r10,r10,1
+       l.addi  r10,r10,1
+       l.mtspr r0,r0,0x3808        # and stops here
+       l.mfspr r11,r0,0x3800       # 9, the 8 above and one l.mtspr
+       l.mfspr r12,r0,0x3800       # unchanged while stopped
+       l.mfspr r13,r0,0x3802       # 5 loads and stores
+       l.mfspr r14,r0,0x3803       # 100
+       l.mfspr r15,r0,0x3804       # 0, not counting in supervisor mode
+       .word  0x40ffccff
+       .size   _start, .-_start
@@ -0,0 +1,30 @@
+# Test of an accelerator from a plugin, the example built with "make
+# example-accelerator.so". l.cust3 reverses the rB bytes at address rA
+# in place. Its stores cancel the reservation of the l.lwa before it,
+# like a store of the program would, so the l.swa fails.
+
+       .data
+       .align 8
+       .local  B
+B:
+       .ascii  "abcdefgh"
+       .size   B, .-B
+       .text
+       .align 4
+       .globl  _start
+       .type   _start, @function
+_start:
+       l.movhi r1,1
+       l.ori   r1,r1,0x1100        # B
+       l.lwa   r2,0(r1)            # "abcd"
+       l.addi  r3,r0,8
+       l.cust3 r0,r1,r3            # "hgfedcba"
+       l.swa   0(r1),r2            # fails
+       l.bnf   .L1
+        l.addi r4,r0,0
+       l.addi  r4,r0,1             # not reached
+.L1:
+       l.lwz   r5,0(r1)            # "hgfe"
+       l.lwz   r6,4(r1)            # "dcba"
+       .word  0x40ffccff
+       .size   _start, .-_start
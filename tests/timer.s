@@ -0,0 +1,51 @@
+# Test of the tick timer, whose matches are events more than a timing
+# wheel (256 cycles) ahead. EVBAR (SPR 11) is set to the start of the
+# program, so that the tick timer handler is at offset 0x500. The timer
+# first runs once for 1000 cycles, stopping TTCR (SPR 0x5001) at the
+# match, then restarts every 300 cycles until two more interrupts were
+# taken. The handler clears TTMR[IP] (SPR 0x5000) by subtracting it.
+# The handler is placed by padding with .zero, which only takes
+# constants: update the instruction count when changing the code.
+
+       .text
+       .align 4
+       .globl  _start
+       .type   _start, @function
+_start:
+       l.movhi r1,1
+       l.mtspr r0,r1,11            # EVBAR = 0x10000
+       l.mfspr r5,r0,17
+       l.ori   r5,r5,2             # SR[TEE]
+       l.mtspr r0,r5,17
+       l.mtspr r0,r0,0x5001        # TTCR = 0
+       l.movhi r2,0xa000           # single run, interrupt enable
+       l.ori   r2,r2,1000
+       l.mtspr r0,r2,0x5000
+.L1:
+       l.sfeq  r3,r0
+       l.bf    .L1
+        l.nop  0
+       l.or    r10,r4,r0           # 1000
+
+       l.mtspr r0,r0,0x5001        # TTCR = 0
+       l.movhi r2,0x6000           # restart, interrupt enable
+       l.ori   r2,r2,300
+       l.mtspr r0,r2,0x5000
+       l.addi  r6,r0,3
+.L2:
+       l.sfne  r3,r6
+       l.bf    .L2
+        l.nop  0
+       l.mtspr r0,r0,0x5000        # disable the timer
+       .word  0x40ffccff
+
+       .zero   0x500 - 23 * 4
+tick_handler:
+       l.addi  r3,r3,1             # 3 interrupts
+       l.mfspr r4,r0,0x5001        # TTCR
+       l.mfspr r7,r0,0x5000
+       l.movhi r8,0x1000           # TTMR[IP]
+       l.sub   r7,r7,r8
+       l.mtspr r0,r7,0x5000
+       l.rfe
+       .size   _start, .-_start
@@ -0,0 +1,21 @@
+# Test of the vector instructions, which operate on 64-bit vectors held
+# in register pairs rN:rN+1, with rN holding the first lanes. r30:r31 is
+# the last pair, so lv.* with r31 as an operand or result is an illegal
+# instruction in every mode: the run ends there and r20 is never set.
+
+       .text
+       .align 4
+       .globl  _start
+       .type   _start, @function
+_start:
+       lv.add.b      r6,r2,r4      # 0x11121314:0x15161718
+       lv.add.b      r30,r2,r4     # last pair
+       lv.all_eq.b   r2,r2
+       l.bnf         .L1
+        l.addi       r8,r0,0
+       l.addi        r8,r0,1       # 1
+.L1:
+       lv.add.b      r31,r2,r4     # r31:r32, illegal
+       l.addi        r20,r0,1      # not reached
+       .word  0x40ffccff
+       .size   _start, .-_start
@@ -0,0 +1,108 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    tick-timer.cc - OpenRISC tick timer.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#include "tick-timer.h"
+#include "event-scheduler.h"
+
+
+TickTimer::TickTimer(EventScheduler &scheduler,
+                     std::function<void()> onInterrupt)
+  : scheduler{ scheduler }, onInterrupt{ std::move(onInterrupt) }
+{
+}
+
+RegValue
+TickTimer::getCountAt(uint64_t time) const
+{
+  if (! running)
+    return count;
+
+  return static_cast<RegValue>(count + (time - countStart));
+}
+
+void
+TickTimer::restartAt(uint64_t time, RegValue value)
+{
+  count = value;
+  countStart = time;
+}
+
+void
+TickTimer::setMode(RegValue value)
+{
+  const uint64_t now = scheduler.getTime();
+  const bool wasPending = isPending();
+
+  restartAt(now, getCountAt(now));
+
+  /* Software may clear, but not set, the interrupt pending bit. */
+  ttmr = (value & ~TTMR::IP) | (value & ttmr & TTMR::IP);
+  running = (ttmr & TTMR::ModeMask) != TTMR::Disabled;
+  scheduleMatch();
+
+  if (! wasPending && isPending())
+    onInterrupt();
+}
+
+RegValue
+TickTimer::getCount() const
+{
+  return getCountAt(scheduler.getTime());
+}
+
+void
+TickTimer::setCount(RegValue value)
+{
+  restartAt(scheduler.getTime(), value);
+  scheduleMatch();
+}
+
+void
+TickTimer::scheduleMatch()
+{
+  ++generation;
+  if (! running)
+    return;
+
+  uint64_t delta = ((ttmr & TTMR::TPMask) - (count & TTMR::TPMask)) & TTMR::TPMask;
+  if (delta == 0)
+    delta = TTMR::TPMask + 1;
+
+  scheduler.schedule(countStart + delta,
+                     [this, expected = generation, time = countStart + delta]
+                     {
+                       if (generation == expected)
+                         match(time);
+                     });
+}
+
+void
+TickTimer::match(uint64_t time)
+{
+  restartAt(time, getCountAt(time));
+
+  switch (ttmr & TTMR::ModeMask)
+    {
+      case TTMR::Restart:
+        count = 0;
+        break;
+      case TTMR::SingleRun:
+        running = false;
+        break;
+      default:
+        break;
+    }
+
+  scheduleMatch();
+
+  if ((ttmr & TTMR::IE) && ! (ttmr & TTMR::IP))
+    {
+      ttmr |= TTMR::IP;
+      raisedCycle = time;
+      onInterrupt();
+    }
+}
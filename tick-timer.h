@@ -0,0 +1,84 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    tick-timer.h - OpenRISC tick timer.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#ifndef __TICK_TIMER_H__
+#define __TICK_TIMER_H__
+
+#include "arch.h"
+
+#include <functional>
+
+class EventScheduler;
+
+/* Bits of the Tick Timer Mode Register */
+namespace TTMR
+{
+  constexpr RegValue TPMask = 0x0fffffff;   /* Time Period */
+  constexpr RegValue IP = 1u << 28;         /* Interrupt Pending */
+  constexpr RegValue IE = 1u << 29;         /* Interrupt Enable */
+  constexpr RegValue ModeMask = 3u << 30;
+  constexpr RegValue Disabled = 0u << 30;
+  constexpr RegValue Restart = 1u << 30;    /* TTCR restarts on a match */
+  constexpr RegValue SingleRun = 2u << 30;  /* TTCR stops on a match */
+  constexpr RegValue Continuous = 3u << 30; /* TTCR keeps counting */
+}
+
+/* The tick timer counts processor cycles in TTCR. When the low 28 bits
+ * of TTCR match the time period in TTMR, the timer sets TTMR[IP] if
+ * interrupts are enabled. The counter is not incremented every cycle:
+ * its value is derived from the scheduler time when read and a match is
+ * scheduled as an event.
+ */
+class TickTimer
+{
+  public:
+    /* The callback is invoked when the timer interrupt becomes pending. */
+    TickTimer(EventScheduler &scheduler, std::function<void()> onInterrupt);
+
+    TickTimer(const TickTimer &) = delete;
+    TickTimer &operator=(const TickTimer &) = delete;
+
+    /* TTMR */
+    RegValue getMode() const { return ttmr; }
+    void setMode(RegValue value);
+
+    /* TTCR */
+    RegValue getCount() const;
+    void setCount(RegValue value);
+
+    bool isPending() const
+    {
+      return (ttmr & (TTMR::IP | TTMR::IE)) == (TTMR::IP | TTMR::IE);
+    }
+
+    /* Processor cycle at which the pending interrupt was raised. */
+    uint64_t getRaisedCycle() const { return raisedCycle; }
+
+  private:
+    EventScheduler &scheduler;
+    std::function<void()> onInterrupt;
+
+    RegValue ttmr{};
+
+    /* TTCR had the value count at cycle countStart. */
+    RegValue count{};
+    uint64_t countStart{};
+    bool running{};
+
+    /* Matches scheduled before the last change of TTMR or TTCR are
+     * stale and ignored when they fire.
+     */
+    uint64_t generation{};
+    uint64_t raisedCycle{};
+
+    RegValue getCountAt(uint64_t time) const;
+    void restartAt(uint64_t time, RegValue value);
+    void scheduleMatch();
+    void match(uint64_t time);
+};
+
+#endif /* __TICK_TIMER_H__ */
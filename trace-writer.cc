@@ -0,0 +1,107 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    trace-writer.cc - Buffered trace file writer.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#include "trace-writer.h"
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+
+TraceWriter::TraceWriter(const std::string &filename, size_t bufferSize)
+  : file(filename, std::ios::binary), filename(filename),
+    bufferSize(bufferSize)
+{
+  if (! file)
+    throw std::runtime_error("cannot create trace file " + filename);
+
+  active.reserve(bufferSize);
+  pending.reserve(bufferSize);
+  thread = std::thread(&TraceWriter::run, this);
+}
+
+TraceWriter::~TraceWriter()
+{
+  try
+    {
+      close();
+    }
+  catch (std::exception &e)
+    {
+      std::cerr << "Warning: " << e.what() << std::endl;
+    }
+}
+
+void
+TraceWriter::write(const void *data, size_t size)
+{
+  if (active.size() + size > bufferSize && ! active.empty())
+    handOver();
+
+  const size_t offset = active.size();
+  active.resize(offset + size);
+  std::memcpy(active.data() + offset, data, size);
+}
+
+/* Wait until the background thread has written the previous buffer and
+ * give it the active one.
+ */
+void
+TraceWriter::handOver()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  cond.wait(lock, [this] { return ! hasPending; });
+
+  std::swap(active, pending);
+  active.clear();
+  hasPending = true;
+  cond.notify_all();
+}
+
+void
+TraceWriter::close()
+{
+  if (! thread.joinable())
+    return;
+
+  if (! active.empty())
+    handOver();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    done = true;
+  }
+  cond.notify_all();
+  thread.join();
+
+  file.close();
+  if (failed || ! file)
+    throw std::runtime_error("cannot write trace file " + filename);
+}
+
+void
+TraceWriter::run()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true)
+    {
+      cond.wait(lock, [this] { return hasPending || done; });
+      if (! hasPending)
+        return;
+
+      /* The simulation does not touch the pending buffer until it is
+       * handed back.
+       */
+      lock.unlock();
+      if (! file.write(pending.data(), pending.size()))
+        failed = true;
+      lock.lock();
+
+      hasPending = false;
+      cond.notify_all();
+    }
+}
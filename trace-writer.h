@@ -0,0 +1,64 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    trace-writer.h - Buffered trace file writer.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#ifndef __TRACE_WRITER_H__
+#define __TRACE_WRITER_H__
+
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Collects trace data in a buffer that is written to the file by a
+ * background thread when it fills up, while the simulation continues in
+ * a second buffer. The simulation only waits when the disk falls behind
+ * by more than a buffer.
+ */
+class TraceWriter
+{
+  public:
+    static constexpr size_t DefaultBufferSize = 1 << 20;
+
+    explicit TraceWriter(const std::string &filename,
+                         size_t bufferSize = DefaultBufferSize);
+    ~TraceWriter();
+
+    TraceWriter(const TraceWriter &) = delete;
+    TraceWriter &operator=(const TraceWriter &) = delete;
+
+    void write(const void *data, size_t size);
+
+    /* Write out the buffered data and wait for the file to be complete.
+     * Throws std::runtime_error if writing failed.
+     */
+    void close();
+
+  private:
+    std::ofstream file;
+    const std::string filename;
+    const size_t bufferSize;
+
+    /* Filled by the simulation */
+    std::vector<char> active{};
+
+    /* Handed to the background thread */
+    std::vector<char> pending{};
+    bool hasPending = false;
+    bool done = false;
+    bool failed = false;
+
+    std::mutex mutex{};
+    std::condition_variable cond{};
+    std::thread thread{};
+
+    void handOver();
+    void run();
+};
+
+#endif /* __TRACE_WRITER_H__ */
@@ -0,0 +1,351 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    vector-unit.cc - ORVDX64 vector/DSP unit.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#include "vector-unit.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <type_traits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+/*
+ * Portable lane-wise kernels
+ */
+
+template <typename T>
+static T
+saturate(int64_t value)
+{
+  return static_cast<T>(std::clamp<int64_t>(value,
+                                            std::numeric_limits<T>::min(),
+                                            std::numeric_limits<T>::max()));
+}
+
+/* Applies f to every pair of lanes of type T in A and B. */
+template <typename T, typename F>
+static uint64_t
+mapLanes(uint64_t A, uint64_t B, F f)
+{
+  using U = std::make_unsigned_t<T>;
+  uint64_t result = 0;
+
+  for (unsigned int shift = 0; shift < 64; shift += 8 * sizeof(T))
+    {
+      const T a = static_cast<T>(A >> shift);
+      const T b = static_cast<T>(B >> shift);
+      result |= static_cast<uint64_t>(static_cast<U>(f(a, b))) << shift;
+    }
+
+  return result;
+}
+
+/* Lane mask of all ones where the predicate holds. */
+template <typename T, typename P>
+static uint64_t
+compareLanes(uint64_t A, uint64_t B, P predicate)
+{
+  return mapLanes<T>(A, B, [predicate](T a, T b)
+                     { return predicate(a, b) ? T(~T(0)) : T(0); });
+}
+
+static uint64_t
+executeScalar(VectorOp op, uint64_t A, uint64_t B)
+{
+  switch (op)
+    {
+      case VectorOp::ADD_B:
+      case VectorOp::ADDU_B:
+        return mapLanes<uint8_t>(A, B, [](uint8_t a, uint8_t b) { return a + b; });
+      case VectorOp::ADD_H:
+      case VectorOp::ADDU_H:
+        return mapLanes<uint16_t>(A, B, [](uint16_t a, uint16_t b) { return a + b; });
+      case VectorOp::ADDS_B:
+        return mapLanes<int8_t>(A, B, [](int8_t a, int8_t b)
+                                { return saturate<int8_t>(a + b); });
+      case VectorOp::ADDS_H:
+        return mapLanes<int16_t>(A, B, [](int16_t a, int16_t b)
+                                 { return saturate<int16_t>(a + b); });
+      case VectorOp::ADDUS_B:
+        return mapLanes<uint8_t>(A, B, [](uint8_t a, uint8_t b)
+                                 { return saturate<uint8_t>(a + b); });
+      case VectorOp::ADDUS_H:
+        return mapLanes<uint16_t>(A, B, [](uint16_t a, uint16_t b)
+                                  { return saturate<uint16_t>(a + b); });
+      case VectorOp::SUB_B:
+      case VectorOp::SUBU_B:
+        return mapLanes<uint8_t>(A, B, [](uint8_t a, uint8_t b) { return a - b; });
+      case VectorOp::SUB_H:
+      case VectorOp::SUBU_H:
+        return mapLanes<uint16_t>(A, B, [](uint16_t a, uint16_t b) { return a - b; });
+      case VectorOp::SUBS_B:
+        return mapLanes<int8_t>(A, B, [](int8_t a, int8_t b)
+                                { return saturate<int8_t>(a - b); });
+      case VectorOp::SUBS_H:
+        return mapLanes<int16_t>(A, B, [](int16_t a, int16_t b)
+                                 { return saturate<int16_t>(a - b); });
+      case VectorOp::SUBUS_B:
+        return mapLanes<uint8_t>(A, B, [](uint8_t a, uint8_t b)
+                                 { return saturate<uint8_t>(a - b); });
+      case VectorOp::SUBUS_H:
+        return mapLanes<uint16_t>(A, B, [](uint16_t a, uint16_t b)
+                                  { return saturate<uint16_t>(a - b); });
+      case VectorOp::AVG_B:
+        return mapLanes<int8_t>(A, B, [](int8_t a, int8_t b) { return (a + b) >> 1; });
+      case VectorOp::AVG_H:
+        return mapLanes<int16_t>(A, B, [](int16_t a, int16_t b) { return (a + b) >> 1; });
+      case VectorOp::MAX_B:
+        return mapLanes<int8_t>(A, B, [](int8_t a, int8_t b) { return std::max(a, b); });
+      case VectorOp::MAX_H:
+        return mapLanes<int16_t>(A, B, [](int16_t a, int16_t b) { return std::max(a, b); });
+      case VectorOp::MIN_B:
+        return mapLanes<int8_t>(A, B, [](int8_t a, int8_t b) { return std::min(a, b); });
+      case VectorOp::MIN_H:
+        return mapLanes<int16_t>(A, B, [](int16_t a, int16_t b) { return std::min(a, b); });
+      case VectorOp::MULS_H:
+        return mapLanes<int16_t>(A, B, [](int16_t a, int16_t b)
+                                 { return saturate<int16_t>(a * b); });
+      case VectorOp::SLL_B:
+        return mapLanes<uint8_t>(A, B, [](uint8_t a, uint8_t b) { return a << (b & 7); });
+      case VectorOp::SLL_H:
+        return mapLanes<uint16_t>(A, B, [](uint16_t a, uint16_t b) { return a << (b & 15); });
+      case VectorOp::SRL_B:
+        return mapLanes<uint8_t>(A, B, [](uint8_t a, uint8_t b) { return a >> (b & 7); });
+      case VectorOp::SRL_H:
+        return mapLanes<uint16_t>(A, B, [](uint16_t a, uint16_t b) { return a >> (b & 15); });
+      case VectorOp::SRA_B:
+        return mapLanes<int8_t>(A, B, [](int8_t a, int8_t b) { return a >> (b & 7); });
+      case VectorOp::SRA_H:
+        return mapLanes<int16_t>(A, B, [](int16_t a, int16_t b) { return a >> (b & 15); });
+      case VectorOp::SLL:
+        return A << (B & 63);
+      case VectorOp::SRL:
+        return A >> (B & 63);
+      case VectorOp::AND:
+        return A & B;
+      case VectorOp::OR:
+        return A | B;
+      case VectorOp::XOR:
+        return A ^ B;
+      case VectorOp::NAND:
+        return ~(A & B);
+      case VectorOp::NOR:
+        return ~(A | B);
+      case VectorOp::CMP_EQ_B:
+        return compareLanes<int8_t>(A, B, std::equal_to<int8_t>());
+      case VectorOp::CMP_EQ_H:
+        return compareLanes<int16_t>(A, B, std::equal_to<int16_t>());
+      case VectorOp::CMP_NE_B:
+        return compareLanes<int8_t>(A, B, std::not_equal_to<int8_t>());
+      case VectorOp::CMP_NE_H:
+        return compareLanes<int16_t>(A, B, std::not_equal_to<int16_t>());
+      case VectorOp::CMP_GT_B:
+        return compareLanes<int8_t>(A, B, std::greater<int8_t>());
+      case VectorOp::CMP_GT_H:
+        return compareLanes<int16_t>(A, B, std::greater<int16_t>());
+      case VectorOp::CMP_GE_B:
+        return compareLanes<int8_t>(A, B, std::greater_equal<int8_t>());
+      case VectorOp::CMP_GE_H:
+        return compareLanes<int16_t>(A, B, std::greater_equal<int16_t>());
+      case VectorOp::CMP_LT_B:
+        return compareLanes<int8_t>(A, B, std::less<int8_t>());
+      case VectorOp::CMP_LT_H:
+        return compareLanes<int16_t>(A, B, std::less<int16_t>());
+      case VectorOp::CMP_LE_B:
+        return compareLanes<int8_t>(A, B, std::less_equal<int8_t>());
+      case VectorOp::CMP_LE_H:
+        return compareLanes<int16_t>(A, B, std::less_equal<int16_t>());
+      default:
+        throw IllegalInstruction("Unimplemented or unknown vector operation");
+    }
+}
+
+
+/*
+ * SSE2 kernels. A 64-bit vector occupies the lower half of an XMM
+ * register; lane order does not matter for lane-wise operations.
+ */
+
+#ifdef __SSE2__
+static bool
+executeSSE2(VectorOp op, uint64_t A, uint64_t B, uint64_t &result)
+{
+  const __m128i a = _mm_cvtsi64_si128(static_cast<long long>(A));
+  const __m128i b = _mm_cvtsi64_si128(static_cast<long long>(B));
+  const __m128i ones = _mm_set1_epi32(-1);
+  __m128i r;
+
+  switch (op)
+    {
+      case VectorOp::ADD_B:
+      case VectorOp::ADDU_B:
+        r = _mm_add_epi8(a, b);
+        break;
+      case VectorOp::ADD_H:
+      case VectorOp::ADDU_H:
+        r = _mm_add_epi16(a, b);
+        break;
+      case VectorOp::ADDS_B:
+        r = _mm_adds_epi8(a, b);
+        break;
+      case VectorOp::ADDS_H:
+        r = _mm_adds_epi16(a, b);
+        break;
+      case VectorOp::ADDUS_B:
+        r = _mm_adds_epu8(a, b);
+        break;
+      case VectorOp::ADDUS_H:
+        r = _mm_adds_epu16(a, b);
+        break;
+      case VectorOp::SUB_B:
+      case VectorOp::SUBU_B:
+        r = _mm_sub_epi8(a, b);
+        break;
+      case VectorOp::SUB_H:
+      case VectorOp::SUBU_H:
+        r = _mm_sub_epi16(a, b);
+        break;
+      case VectorOp::SUBS_B:
+        r = _mm_subs_epi8(a, b);
+        break;
+      case VectorOp::SUBS_H:
+        r = _mm_subs_epi16(a, b);
+        break;
+      case VectorOp::SUBUS_B:
+        r = _mm_subs_epu8(a, b);
+        break;
+      case VectorOp::SUBUS_H:
+        r = _mm_subs_epu16(a, b);
+        break;
+      case VectorOp::MAX_H:
+        r = _mm_max_epi16(a, b);
+        break;
+      case VectorOp::MIN_H:
+        r = _mm_min_epi16(a, b);
+        break;
+      case VectorOp::MAX_B:
+        {
+          const __m128i gt = _mm_cmpgt_epi8(a, b);
+          r = _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));
+        }
+        break;
+      case VectorOp::MIN_B:
+        {
+          const __m128i gt = _mm_cmpgt_epi8(a, b);
+          r = _mm_or_si128(_mm_and_si128(gt, b), _mm_andnot_si128(gt, a));
+        }
+        break;
+      case VectorOp::MULS_H:
+        {
+          /* Full 32-bit products, packed back with signed saturation. */
+          const __m128i lo = _mm_mullo_epi16(a, b);
+          const __m128i hi = _mm_mulhi_epi16(a, b);
+          r = _mm_packs_epi32(_mm_unpacklo_epi16(lo, hi), _mm_setzero_si128());
+        }
+        break;
+      case VectorOp::AND:
+        r = _mm_and_si128(a, b);
+        break;
+      case VectorOp::OR:
+        r = _mm_or_si128(a, b);
+        break;
+      case VectorOp::XOR:
+        r = _mm_xor_si128(a, b);
+        break;
+      case VectorOp::NAND:
+        r = _mm_xor_si128(_mm_and_si128(a, b), ones);
+        break;
+      case VectorOp::NOR:
+        r = _mm_xor_si128(_mm_or_si128(a, b), ones);
+        break;
+      case VectorOp::CMP_EQ_B:
+        r = _mm_cmpeq_epi8(a, b);
+        break;
+      case VectorOp::CMP_EQ_H:
+        r = _mm_cmpeq_epi16(a, b);
+        break;
+      case VectorOp::CMP_NE_B:
+        r = _mm_xor_si128(_mm_cmpeq_epi8(a, b), ones);
+        break;
+      case VectorOp::CMP_NE_H:
+        r = _mm_xor_si128(_mm_cmpeq_epi16(a, b), ones);
+        break;
+      case VectorOp::CMP_GT_B:
+        r = _mm_cmpgt_epi8(a, b);
+        break;
+      case VectorOp::CMP_GT_H:
+        r = _mm_cmpgt_epi16(a, b);
+        break;
+      case VectorOp::CMP_LT_B:
+        r = _mm_cmpgt_epi8(b, a);
+        break;
+      case VectorOp::CMP_LT_H:
+        r = _mm_cmpgt_epi16(b, a);
+        break;
+      case VectorOp::CMP_GE_B:
+        r = _mm_xor_si128(_mm_cmpgt_epi8(b, a), ones);
+        break;
+      case VectorOp::CMP_GE_H:
+        r = _mm_xor_si128(_mm_cmpgt_epi16(b, a), ones);
+        break;
+      case VectorOp::CMP_LE_B:
+        r = _mm_xor_si128(_mm_cmpgt_epi8(a, b), ones);
+        break;
+      case VectorOp::CMP_LE_H:
+        r = _mm_xor_si128(_mm_cmpgt_epi16(a, b), ones);
+        break;
+      default:
+        /* No SSE2 equivalent, e.g. per-lane variable shifts. */
+        return false;
+    }
+
+  result = static_cast<uint64_t>(_mm_cvtsi128_si64(r));
+  return true;
+}
+#endif /* __SSE2__ */
+
+
+/*
+ * VectorUnit
+ */
+
+uint64_t
+VectorUnit::execute(VectorOp op, uint64_t A, uint64_t B) const
+{
+#ifdef __SSE2__
+  uint64_t result;
+  if (executeSSE2(op, A, B, result))
+    return result;
+#endif
+
+  return executeScalar(op, A, B);
+}
+
+bool
+VectorUnit::isCompare(VectorOp op)
+{
+  const auto value = static_cast<unsigned int>(op);
+  return (value >= 0x10 && value <= 0x1b) || (value >= 0x20 && value <= 0x2b);
+}
+
+bool
+VectorUnit::compare(VectorOp op, uint64_t A, uint64_t B) const
+{
+  /* lv.all_* and lv.any_* use the same ordering of conditions as the
+   * lv.cmp_* instructions, only their opcodes differ.
+   */
+  const auto value = static_cast<unsigned int>(op);
+  const bool all = value < 0x20;
+  const VectorOp cmp = static_cast<VectorOp>(0x40 + (value & 0xf));
+
+  const uint64_t mask = execute(cmp, A, B);
+  return all ? mask == ~uint64_t{0} : mask != 0;
+}
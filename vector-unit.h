@@ -0,0 +1,31 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    vector-unit.h - ORVDX64 vector/DSP unit.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#ifndef __VECTOR_UNIT_H__
+#define __VECTOR_UNIT_H__
+
+#include "arch.h"
+#include "inst-decoder.h"
+
+/* The vector unit executes the lv.* instructions on 64-bit vectors of
+ * eight byte or four halfword lanes. On this 32-bit machine a vector
+ * is held in a register pair rN:rN+1, where rN holds the upper 32 bits
+ * (the first lanes, in big-endian order). The kernels use SSE2 on hosts
+ * that support it, and otherwise fall back to a loop over the lanes.
+ */
+class VectorUnit
+{
+  public:
+    uint64_t execute(VectorOp op, uint64_t A, uint64_t B) const;
+
+    /* Evaluates the lv.all_* and lv.any_* comparisons that set the flag. */
+    bool compare(VectorOp op, uint64_t A, uint64_t B) const;
+
+    static bool isCompare(VectorOp op);
+};
+
+#endif /* __VECTOR_UNIT_H__ */
@@ -0,0 +1,582 @@
+/* rv64-emu -- Simple 64-bit RISC-V simulator
+ *
+ *    workload-gen.cc - Generator of synthetic workloads.
+ *
+ * Copyright (C) 2016-2021  Leiden University, The Netherlands.
+ */
+
+#include "assembler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+
+#include <getopt.h>
+
+/* A generated program runs a loop with a randomly generated body a
+ * number of iterations and then halts through the system status module.
+ * The body consists of instructions from the categories below, in the
+ * requested mix. Their source registers are the results of earlier
+ * instructions at the requested dependency distances.
+ *
+ * Loads and stores access a buffer of the requested footprint at
+ * successive multiples of the stride. Each memory instruction in the
+ * body has its own offset from a pointer, which advances past all of
+ * them once per iteration and returns to the start of the buffer at the
+ * footprint, rounded up to a multiple of that advance.
+ *
+ * Branches skip one to three instructions forward. A predictable branch
+ * has a fixed outcome, so that the requested fraction of them is taken.
+ * An unpredictable branch tests a byte of a table of random outcomes,
+ * like a branch on input data. Per iteration, the table holds a byte for
+ * every unpredictable branch; it repeats after OutcomePeriod iterations.
+ *
+ * Only instructions the emulator executes are generated, hence there
+ * are no bitwise and, shifts or less-than comparisons.
+ *
+ * Registers:
+ *   r2  buffer address     r3  pointer offset   r4  pointer offset limit
+ *   r5  iterations left    r6  outcome table    r7  scratch
+ *   r8  pointer            r9  outcomes of this iteration
+ *   r10 end of the outcome table
+ *   r11-r31  results of the body instructions
+ */
+
+enum class Category { alu, mul, div, load, store, branch };
+
+static const std::vector<std::pair<std::string, Category>> categories =
+  {
+    { "alu", Category::alu },
+    { "mul", Category::mul },
+    { "div", Category::div },
+    { "load", Category::load },
+    { "store", Category::store },
+    { "branch", Category::branch }
+  };
+
+static constexpr unsigned int FirstPoolReg = 11;
+static constexpr unsigned int PoolSize = 32 - FirstPoolReg;
+static constexpr MemAddress HaltAddress = 0x278;
+static constexpr unsigned int OutcomePeriod = 1024;
+
+struct WorkloadParams
+{
+  unsigned int bodySize = 256;
+  uint32_t iterations = 1000;
+  std::map<Category, double> mix =
+    {
+      { Category::alu, 50 }, { Category::mul, 5 }, { Category::div, 1 },
+      { Category::load, 20 }, { Category::store, 10 }, { Category::branch, 14 }
+    };
+  /* Distance 0 stands for no dependency within the register pool */
+  std::map<unsigned int, double> distances =
+    {
+      { 1, 20 }, { 2, 20 }, { 4, 20 }, { 8, 20 }, { 0, 20 }
+    };
+  double loadUse = 0.2;
+  double takenRatio = 0.5;
+  double predictability = 0.9;
+  uint32_t footprint = 4096;      /* a multiple of the stride */
+  uint32_t stride = 4;
+  uint64_t seed = 1;
+};
+
+class WorkloadGenerator
+{
+  public:
+    explicit WorkloadGenerator(const WorkloadParams &params)
+      : params(params), random(params.seed)
+    { }
+
+    std::string generate();
+
+  private:
+    const WorkloadParams &params;
+    std::mt19937_64 random;
+
+    /* The register each body instruction wrote, 0 for none */
+    std::vector<unsigned int> written{};
+    unsigned int nextReg = 0;
+    bool lastWasLoad = false;
+
+    std::vector<std::string> body{};
+    unsigned int memoryAccesses = 0;
+    std::map<Category, unsigned int> counts{};
+    unsigned int loadUses = 0;
+    unsigned int unpredictable = 0;
+
+    bool chance(double probability)
+    {
+      return std::uniform_real_distribution<>(0, 1)(random) < probability;
+    }
+
+    unsigned int allocate();
+    unsigned int source(bool first);
+    void emit(const std::string &instruction, unsigned int dest);
+    void generateInstruction(unsigned int &labels,
+                             std::vector<std::pair<unsigned int, unsigned int>> &targets);
+};
+
+static std::string
+reg(unsigned int r)
+{
+  return "r" + std::to_string(r);
+}
+
+unsigned int
+WorkloadGenerator::allocate()
+{
+  const unsigned int r = FirstPoolReg + nextReg;
+  nextReg = (nextReg + 1) % PoolSize;
+  return r;
+}
+
+/* The register written by the instruction at a random distance back,
+ * or by the closest instruction before it that wrote one.
+ */
+unsigned int
+WorkloadGenerator::source(bool first)
+{
+  std::vector<unsigned int> values;
+  std::vector<double> weights;
+  for (const auto &[distance, weight] : params.distances)
+    {
+      values.push_back(distance);
+      weights.push_back(weight);
+    }
+
+  const bool loadUse = first && lastWasLoad && chance(params.loadUse);
+  if (loadUse)
+    ++loadUses;
+
+  for (int attempt = 0; ; ++attempt)
+    {
+      unsigned int distance = loadUse ? 1
+          : values[std::discrete_distribution<>(weights.begin(), weights.end())(random)];
+
+      /* Without a dependency, read the register about to be reused. */
+      if (distance == 0 || distance > written.size())
+        return FirstPoolReg + nextReg;
+
+      while (distance <= written.size() && written[written.size() - distance] == 0)
+        ++distance;
+      if (distance > written.size())
+        return FirstPoolReg + nextReg;
+
+      /* Only the chosen fraction of loads is used right away. */
+      if (distance == 1 && lastWasLoad && ! loadUse)
+        {
+          if (attempt < 8)
+            continue;
+          return FirstPoolReg + nextReg;
+        }
+
+      return written[written.size() - distance];
+    }
+}
+
+void
+WorkloadGenerator::emit(const std::string &instruction, unsigned int dest)
+{
+  body.push_back("\t" + instruction);
+  written.push_back(dest);
+}
+
+void
+WorkloadGenerator::generateInstruction(unsigned int &labels,
+                                       std::vector<std::pair<unsigned int, unsigned int>> &targets)
+{
+  std::vector<double> weights;
+  for (const auto &category : categories)
+    {
+      auto it = params.mix.find(category.second);
+      weights.push_back(it != params.mix.end() ? it->second : 0);
+    }
+  const Category category =
+      categories[std::discrete_distribution<>(weights.begin(), weights.end())(random)].second;
+  ++counts[category];
+
+  bool isLoad = false;
+  switch (category)
+    {
+      case Category::alu:
+        {
+          static const char *const regOps[] =
+            { "l.add", "l.sub", "l.or" };
+          static const char *const immOps[] = { "l.addi", "l.ori" };
+
+          const unsigned int a = source(true);
+          if (chance(0.5))
+            {
+              const unsigned int b = source(false);
+              const unsigned int d = allocate();
+              emit(std::string(regOps[random() % 3]) + "\t" + reg(d) + ", " +
+                   reg(a) + ", " + reg(b), d);
+            }
+          else
+            {
+              const unsigned int d = allocate();
+              emit(std::string(immOps[random() % 2]) + "\t" + reg(d) + ", " +
+                   reg(a) + ", " + std::to_string(random() % 4096), d);
+            }
+          break;
+        }
+
+      case Category::mul:
+      case Category::div:
+        {
+          const unsigned int a = source(true);
+          const unsigned int b = source(false);
+          const unsigned int d = allocate();
+          emit(std::string(category == Category::mul ? "l.mul" : "l.divu") +
+               "\t" + reg(d) + ", " + reg(a) + ", " + reg(b), d);
+          break;
+        }
+
+      case Category::load:
+        {
+          const unsigned int d = allocate();
+          emit("l.lwz\t" + reg(d) + ", " +
+               std::to_string(memoryAccesses++ * params.stride) + "(r8)", d);
+          isLoad = true;
+          break;
+        }
+
+      case Category::store:
+        {
+          const unsigned int b = source(true);
+          emit("l.sw\t" + std::to_string(memoryAccesses++ * params.stride) +
+               "(r8), " + reg(b), 0);
+          break;
+        }
+
+      case Category::branch:
+        {
+          if (chance(params.predictability))
+            emit(chance(params.takenRatio) ? "l.sfeq\tr0, r0" : "l.sfne\tr0, r0", 0);
+          else
+            {
+              emit("l.lbz\tr7, " + std::to_string(unpredictable++) + "(r9)", 0);
+              emit("l.sfne\tr7, r0", 0);
+            }
+
+          const unsigned int label = labels++;
+          emit("l.bf\t.Lskip" + std::to_string(label), 0);
+          emit("l.nop", 0);
+          /* Counting the branch itself, which is done with below */
+          targets.emplace_back(random() % 3 + 2, label);
+          break;
+        }
+    }
+  lastWasLoad = isLoad;
+}
+
+std::string
+WorkloadGenerator::generate()
+{
+  unsigned int labels = 0;
+  /* Instructions to go until each branch target, and its label */
+  std::vector<std::pair<unsigned int, unsigned int>> targets;
+
+  for (unsigned int i = 0; i < params.bodySize; ++i)
+    {
+      generateInstruction(labels, targets);
+
+      for (auto &target : targets)
+        if (--target.first == 0)
+          body.push_back(".Lskip" + std::to_string(target.second) + ":");
+      targets.erase(std::remove_if(targets.begin(), targets.end(),
+                                   [](const auto &t) { return t.first == 0; }),
+                    targets.end());
+    }
+  for (const auto &target : targets)
+    body.push_back(".Lskip" + std::to_string(target.second) + ":");
+
+  const uint64_t span = uint64_t{memoryAccesses} * params.stride;
+  if (span > 0x7fff)
+    throw std::invalid_argument("the " + std::to_string(memoryAccesses) +
+                                " memory accesses of the body times the"
+                                " stride exceed the 16-bit offsets");
+  const uint64_t limit = span == 0 ? 0
+      : std::max<uint64_t>(1, (params.footprint + span - 1) / span) * span;
+  if (unpredictable > 0x7fff)
+    throw std::invalid_argument("too many unpredictable branches");
+  const uint32_t outcomes = unpredictable *
+      std::min<uint32_t>(params.iterations, OutcomePeriod);
+
+  std::ostringstream os;
+  os << "# Synthetic workload generated by rv64-emu-gen\n"
+     << "#\n"
+     << "#   body " << params.bodySize << " instructions, "
+     << params.iterations << " iterations, seed " << params.seed << "\n"
+     << "#   mix";
+  for (const auto &[name, category] : categories)
+    os << " " << name << "=" << counts[category];
+  os << "\n"
+     << "#   " << loadUses << " load-use pairs, "
+     << unpredictable << " unpredictable branches, taken ratio "
+     << params.takenRatio << "\n"
+     << "#   footprint " << limit << " bytes, stride "
+     << params.stride << " bytes, " << memoryAccesses
+     << " accesses per iteration\n\n";
+
+  os << "\t.text\n"
+     << "\t.align 4\n"
+     << "\t.global _start\n"
+     << "\t.type _start, @function\n"
+     << "_start:\n"
+     << "\tl.movhi\tr2, hi(buffer)\n"
+     << "\tl.ori\tr2, r2, lo(buffer)\n"
+     << "\tl.or\tr3, r0, r0\n"
+     << "\tl.movhi\tr4, hi(" << limit << ")\n"
+     << "\tl.ori\tr4, r4, lo(" << limit << ")\n"
+     << "\tl.movhi\tr5, hi(" << params.iterations << ")\n"
+     << "\tl.ori\tr5, r5, lo(" << params.iterations << ")\n"
+     << "\tl.movhi\tr6, hi(outcomes)\n"
+     << "\tl.ori\tr6, r6, lo(outcomes)\n"
+     << "\tl.or\tr9, r6, r6\n"
+     << "\tl.movhi\tr10, hi(outcomes + " << outcomes << ")\n"
+     << "\tl.ori\tr10, r10, lo(outcomes + " << outcomes << ")\n";
+  for (unsigned int r = FirstPoolReg; r < FirstPoolReg + PoolSize; ++r)
+    os << "\tl.ori\t" << reg(r) << ", r0, " << r * 37 << "\n";
+
+  os << ".Lloop:\n"
+     << "\tl.add\tr8, r2, r3\n";
+  for (const auto &line : body)
+    os << line << "\n";
+  if (span > 0)
+    os << "\tl.addi\tr3, r3, " << span << "\n"
+       << "\tl.sfne\tr3, r4\n"
+       << "\tl.bf\t.Lnext\n"
+       << "\tl.nop\n"
+       << "\tl.or\tr3, r0, r0\n"
+       << ".Lnext:\n";
+  if (unpredictable > 0)
+    os << "\tl.addi\tr9, r9, " << unpredictable << "\n"
+       << "\tl.sfne\tr9, r10\n"
+       << "\tl.bf\t.Lnext_outcomes\n"
+       << "\tl.nop\n"
+       << "\tl.or\tr9, r6, r6\n"
+       << ".Lnext_outcomes:\n";
+  os << "\tl.addi\tr5, r5, -1\n"
+     << "\tl.sfne\tr5, r0\n"
+     << "\tl.bf\t.Lloop\n"
+     << "\tl.nop\n"
+     << "\tl.ori\tr7, r0, " << HaltAddress << "\n"
+     << "\tl.sw\t0(r7), r0\n"
+     << ".Lhalt:\n"
+     << "\tl.j\t.Lhalt\n"
+     << "\tl.nop\n"
+     << "\t.size _start, .-_start\n\n";
+
+  os << "\t.section .rodata\n"
+     << "\t.type outcomes, @object\n"
+     << "outcomes:";
+  for (uint32_t i = 0; i < outcomes; ++i)
+    os << (i % 32 == 0 ? "\n\t.byte " : ", ") << (chance(params.takenRatio) ? 1 : 0);
+  os << "\n\t.size outcomes, .-outcomes\n\n";
+
+  os << "\t.bss\n"
+     << "\t.align 8\n"
+     << "\t.type buffer, @object\n"
+     << "buffer:\n"
+     << "\t.zero " << std::max<uint64_t>(limit, 4) << "\n"
+     << "\t.size buffer, .-buffer\n";
+
+  return os.str();
+}
+
+
+/*
+ * Option parsing
+ */
+
+/* Parses a comma-separated list of KEY=WEIGHT. */
+static std::vector<std::pair<std::string, double>>
+parseWeights(const std::string &list)
+{
+  std::vector<std::pair<std::string, double>> weights;
+  std::istringstream is(list);
+  std::string item;
+  while (std::getline(is, item, ','))
+    {
+      const size_t equals = item.find('=');
+      if (equals == std::string::npos)
+        throw std::invalid_argument("expected KEY=WEIGHT instead of " + item);
+
+      const double weight = std::stod(item.substr(equals + 1));
+      if (weight < 0)
+        throw std::invalid_argument("negative weight in " + item);
+      weights.emplace_back(item.substr(0, equals), weight);
+    }
+
+  if (weights.empty())
+    throw std::invalid_argument("empty list of weights");
+  return weights;
+}
+
+static std::map<Category, double>
+parseMix(const std::string &list)
+{
+  std::map<Category, double> mix;
+  double total = 0;
+  for (const auto &[name, weight] : parseWeights(list))
+    {
+      auto it = std::find_if(categories.begin(), categories.end(),
+                             [&name](const auto &c) { return c.first == name; });
+      if (it == categories.end())
+        throw std::invalid_argument("unknown instruction category " + name);
+      mix[it->second] = weight;
+      total += weight;
+    }
+
+  if (total == 0)
+    throw std::invalid_argument("the instruction mix is empty");
+  return mix;
+}
+
+static std::map<unsigned int, double>
+parseDistances(const std::string &list)
+{
+  std::map<unsigned int, double> distances;
+  for (const auto &[key, weight] : parseWeights(list))
+    {
+      if (key == "none")
+        distances[0] = weight;
+      else
+        {
+          const unsigned long distance = std::stoul(key);
+          if (distance == 0 || distance >= PoolSize)
+            throw std::invalid_argument("dependency distance must be 1 to " +
+                                        std::to_string(PoolSize - 1));
+          distances[distance] = weight;
+        }
+    }
+  return distances;
+}
+
+static double
+parseFraction(const char *arg)
+{
+  const double value = std::stod(arg);
+  if (value < 0 || value > 1)
+    throw std::invalid_argument(std::string("fraction out of range: ") + arg);
+  return value;
+}
+
+/* Sizes may have a k or M suffix. */
+static uint32_t
+parseSize(const char *arg)
+{
+  size_t end;
+  uint64_t value = std::stoul(arg, &end);
+  if (arg[end] == 'k' || arg[end] == 'K')
+    value <<= 10, ++end;
+  else if (arg[end] == 'M')
+    value <<= 20, ++end;
+  if (arg[end] != '\0' || value > 0x40000000)
+    throw std::invalid_argument(std::string("invalid size ") + arg);
+  return value;
+}
+
+static void
+showHelp(const char *progName)
+{
+  std::cerr << "Usage: " << progName
+            << " [-n BODY] [-i ITERATIONS] [-m MIX] [-d DISTANCES] [-u FRAC]"
+               " [-b FRAC] [-p FRAC] [-f BYTES] [-s BYTES] [-r SEED]"
+               " [-S ASM] [-o OUTPUT]\n\n"
+            << "Generates a synthetic workload: a loop of BODY random instructions.\n\n"
+            << "    -n, instructions in the loop body (default: 256).\n"
+            << "    -i, iterations of the loop (default: 1000).\n"
+            << "    -m, instruction mix as comma-separated CATEGORY=WEIGHT, with\n"
+            << "        categories alu, mul, div, load, store and branch (default:\n"
+            << "        alu=50,mul=5,div=1,load=20,store=10,branch=14).\n"
+            << "    -d, distribution of the distance to the instruction producing a\n"
+            << "        source operand, as DISTANCE=WEIGHT with DISTANCE from 1 to "
+            << PoolSize - 1 << "\n"
+            << "        or none (default: 1=20,2=20,4=20,8=20,none=20).\n"
+            << "    -u, fraction of loads whose result the next instruction uses\n"
+            << "        (default: 0.2).\n"
+            << "    -b, fraction of branches taken (default: 0.5).\n"
+            << "    -p, fraction of branches with a fixed outcome; the others are\n"
+            << "        pseudo-random (default: 0.9).\n"
+            << "    -f, memory footprint, rounded up to a multiple of the stride\n"
+            << "        times the memory accesses in the body (default: 4k).\n"
+            << "    -s, stride between memory accesses, a multiple of 4 (default: 4).\n"
+            << "    -r, seed of the random generator (default: 1).\n"
+            << "    -S, writes the assembly to ASM.\n"
+            << "    -o, writes the ELF executable to OUTPUT.\n\n"
+            << "Without -S and -o, the assembly is written to stdout.\n";
+}
+
+int
+main(int argc, char **argv)
+{
+  WorkloadParams params;
+  const char *asmFilename = nullptr;
+  const char *output = nullptr;
+
+  try
+    {
+      int c;
+      while ((c = getopt(argc, argv, "n:i:m:d:u:b:p:f:s:r:S:o:h")) != -1)
+        {
+          switch (c)
+            {
+              case 'n': params.bodySize = std::stoul(optarg); break;
+              case 'i': params.iterations = std::stoul(optarg); break;
+              case 'm': params.mix = parseMix(optarg); break;
+              case 'd': params.distances = parseDistances(optarg); break;
+              case 'u': params.loadUse = parseFraction(optarg); break;
+              case 'b': params.takenRatio = parseFraction(optarg); break;
+              case 'p': params.predictability = parseFraction(optarg); break;
+              case 'f': params.footprint = parseSize(optarg); break;
+              case 's': params.stride = parseSize(optarg); break;
+              case 'r': params.seed = std::stoull(optarg); break;
+              case 'S': asmFilename = optarg; break;
+              case 'o': output = optarg; break;
+              default:
+                showHelp(argv[0]);
+                return 1;
+            }
+        }
+
+      if (params.bodySize == 0 || params.iterations == 0)
+        throw std::invalid_argument("the body and iterations must not be empty");
+      if (params.footprint == 0)
+        throw std::invalid_argument("the footprint must not be empty");
+      if (params.stride == 0 || params.stride % 4 != 0)
+        throw std::invalid_argument("the stride must be a multiple of 4");
+
+      const std::string program = WorkloadGenerator(params).generate();
+
+      if (asmFilename)
+        {
+          std::ofstream out(asmFilename);
+          out << program;
+          if (! out)
+            throw std::runtime_error(std::string("cannot write ") + asmFilename);
+        }
+      if (output)
+        {
+          std::istringstream in(program);
+          Assembler assembler;
+          assembler.assemble(in, asmFilename ? asmFilename : "<generated>");
+          assembler.writeELF(output);
+        }
+      if (! asmFilename && ! output)
+        std::cout << program;
+    }
+  catch (std::exception &e)
+    {
+      std::cerr << "Error: " << e.what() << std::endl;
+      return 1;
+    }
+
+  return 0;
+}